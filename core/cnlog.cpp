@@ -21,6 +21,7 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  *************************************************************************/
 #include "cnlog.hpp"
+#include "cnlog_binary.hpp"
 
 #include <string>
 #include <mutex>  // NOLINT
@@ -190,6 +191,16 @@ LogMessage::LogMessage(std::string file, int line, int module, int severity,
       is_print_tail_(is_print_tail),
       is_clear_endl_(is_clear_endl),
       release_can_print_(release_can_print) {
+  // with the binary log, only errors are still formatted as text so they
+  // keep showing up on the screen
+  is_binary_ = binaryLogOn();
+  is_text_ = !is_binary_ || logSeverity_ == LOG_ERROR ||
+             logSeverity_ == LOG_FATAL;
+  if (!is_text_) {
+    // the singleton is otherwise first touched by printHead
+    cnlogSingleton::get();
+    return;
+  }
   bool is_colored = false;
 #ifndef ANDROID_LOG
   if (is_print_head_ &&
@@ -236,6 +247,18 @@ LogMessage::~LogMessage() {
   log_level = cnlogSingleton::logLevel();
   is_print_tail_ = true;
 #endif
+  if (is_binary_) {
+    if (logSeverity_ >= log_level) {
+      binaryLogWrite(logInfoFile_, logInfoLine_, logSeverity_,
+                     (is_print_head_ ? CNLOG_BINARY_PRINT_HEAD : 0) |
+                         (is_print_tail_ ? CNLOG_BINARY_PRINT_TAIL : 0) |
+                         (is_clear_endl_ ? CNLOG_BINARY_CLEAR_ENDL : 0),
+                     contex_str_.str());
+    }
+    if (!is_text_) {
+      return;
+    }
+  }
   file_str_ << contex_str_.str();
   cout_str_ << contex_str_.str();
   if (is_print_tail_) {
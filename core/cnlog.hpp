@@ -138,6 +138,8 @@ class LogMessage {
   bool is_print_tail_;            // whether print log tail or not
   bool is_clear_endl_;            // whether clear endl int the string context
   bool release_can_print_;        // whether can print in release mode
+  bool is_binary_;                // whether record to the binary log
+  bool is_text_;                  // whether format to the file or screen
   std::stringstream contex_str_;  // the context behind "<<"
   std::stringstream cout_str_;    // the context to show in the screen
   std::stringstream file_str_;    // the context to save in the file
@@ -0,0 +1,353 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include "cnlog_binary.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>              // NOLINT
+#include <condition_variable>  // NOLINT
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
+#include <unordered_set>
+#include <vector>
+
+#include "tool.h"
+
+#if defined(WINDOWS) || defined(WIN32)  // used in windows
+
+#include <windows.h>
+#include <process.h>
+
+#else
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#endif
+
+// how often the background thread drains the rings, a ring more than half
+// full wakes it up earlier
+#define CNLOG_BINARY_DRAIN_MS 20
+#define CNLOG_BINARY_BUFFER_DEFAULT_KB 1024
+
+namespace mluop {
+namespace logging {
+namespace {
+
+#pragma pack(push, 1)
+struct SiteRecord {
+  uint32_t size;
+  uint8_t type;
+  uint8_t reserved[3];
+  uint32_t line;
+  uint64_t site;
+};
+
+struct MessageRecord {
+  uint32_t size;
+  uint8_t type;
+  uint8_t severity;
+  uint8_t flags;
+  uint8_t reserved;
+  int32_t card;
+  uint32_t tid;
+  uint64_t time;
+  uint64_t site;
+};
+
+struct DroppedRecord {
+  uint32_t size;
+  uint8_t type;
+  uint8_t reserved[3];
+  uint32_t tid;
+  uint64_t count;
+};
+#pragma pack(pop)
+
+inline uint32_t currentPid() {
+#if defined(WINDOWS) || defined(WIN32)
+  return _getpid();
+#else
+  return getpid();
+#endif
+}
+
+inline uint32_t currentTid() {
+#if defined(WINDOWS) || defined(WIN32)
+  return GetCurrentThreadId();
+#else
+  return syscall(SYS_gettid);
+#endif
+}
+
+/**
+ * @brief: byte ring written by one logging thread and read by the drainer.
+ * head_ and tail_ only grow, a record is published by moving head_ past it
+ * so the drainer never sees part of a record.
+ */
+class LogRing {
+ public:
+  LogRing(size_t size, uint32_t tid)
+      : size_(size), tid_(tid), data_(new char[size]) {}
+
+  bool push(const void *record, size_t record_size, const void *text,
+            size_t text_size) {
+    const uint64_t head = head_.load(std::memory_order_relaxed);
+    const uint64_t tail = tail_.load(std::memory_order_acquire);
+    if (head - tail + record_size + text_size > size_) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    copyIn(head, record, record_size);
+    copyIn(head + record_size, text, text_size);
+    head_.store(head + record_size + text_size, std::memory_order_release);
+    return true;
+  }
+
+  inline bool halfFull() const {
+    return 2 * (head_.load(std::memory_order_relaxed) -
+                tail_.load(std::memory_order_relaxed)) >
+           size_;
+  }
+
+  void drain(std::string *out) {
+    const uint64_t tail = tail_.load(std::memory_order_relaxed);
+    const uint64_t head = head_.load(std::memory_order_acquire);
+    const size_t begin = tail % size_;
+    const size_t first = std::min<size_t>(head - tail, size_ - begin);
+    out->append(data_.get() + begin, first);
+    out->append(data_.get(), head - tail - first);
+    tail_.store(head, std::memory_order_release);
+  }
+
+  // messages dropped since the previous call, drainer only
+  uint64_t takeDropped() {
+    const uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+    const uint64_t count = dropped - reported_;
+    reported_ = dropped;
+    return count;
+  }
+
+  inline uint32_t tid() const { return tid_; }
+
+  std::atomic<bool> closed{false};  // set when the thread exits
+
+ private:
+  void copyIn(uint64_t pos, const void *src, size_t size) {
+    const size_t begin = pos % size_;
+    const size_t first = std::min(size, size_ - begin);
+    memcpy(data_.get() + begin, src, first);
+    memcpy(data_.get(), static_cast<const char *>(src) + first,
+           size - first);
+  }
+
+  const size_t size_;
+  const uint32_t tid_;
+  std::unique_ptr<char[]> data_;
+  std::atomic<uint64_t> head_{0};
+  std::atomic<uint64_t> tail_{0};
+  std::atomic<uint64_t> dropped_{0};
+  uint64_t reported_ = 0;
+};
+
+class BinaryLog {
+ public:
+  // Never destroyed: the detached drainer may still use the members at exit.
+  static BinaryLog &instance() {
+    static BinaryLog *log = new BinaryLog();
+    return *log;
+  }
+
+  inline bool on() const { return on_; }
+
+  std::shared_ptr<LogRing> attach() {
+    auto ring = std::make_shared<LogRing>(ring_size_, currentTid());
+    std::lock_guard<std::mutex> guard(mutex_);
+    rings_.push_back(ring);
+    return ring;
+  }
+
+  void wake() { wake_.notify_one(); }
+
+  void flush() {
+    std::lock_guard<std::mutex> drain_guard(drain_mutex_);
+    std::vector<std::shared_ptr<LogRing>> rings;
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      rings = rings_;
+    }
+    std::string out;
+    std::vector<LogRing *> finished;
+    for (auto &ring : rings) {
+      // read before draining, so a closed ring is empty once drained
+      const bool closed = ring->closed.load(std::memory_order_acquire);
+      ring->drain(&out);
+      const uint64_t dropped = ring->takeDropped();
+      if (dropped > 0) {
+        DroppedRecord record = {sizeof(DroppedRecord), CNLOG_BINARY_DROPPED,
+                                {0, 0, 0}, ring->tid(), dropped};
+        out.append(reinterpret_cast<const char *>(&record), sizeof(record));
+      }
+      if (closed) {
+        finished.push_back(ring.get());
+      }
+    }
+    if (!out.empty()) {
+      file_.write(out.data(), out.size());
+      file_.flush();
+    }
+    if (!finished.empty()) {
+      std::lock_guard<std::mutex> guard(mutex_);
+      rings_.erase(std::remove_if(rings_.begin(), rings_.end(),
+                                  [&](const std::shared_ptr<LogRing> &r) {
+                                    return std::find(finished.begin(),
+                                                     finished.end(),
+                                                     r.get()) !=
+                                           finished.end();
+                                  }),
+                   rings_.end());
+    }
+  }
+
+ private:
+  BinaryLog() {
+    const std::string path = mluop::getStringEnvVar("MLUOP_LOG_BINARY_FILE");
+    if (path.empty()) {
+      return;
+    }
+    file_.open(path, std::ios::binary | std::ios::trunc);
+    if (!file_.is_open()) {
+      std::cerr << "can't init binary Log, open " << path << " failed!"
+                << std::endl;
+      return;
+    }
+    const uint32_t header[2] = {currentPid(), 0};
+    file_.write(CNLOG_BINARY_MAGIC, 8);
+    file_.write(reinterpret_cast<const char *>(header), sizeof(header));
+    ring_size_ = 1024 * std::max<uint64_t>(
+                            4, mluop::getUintEnvVar(
+                                   "MLUOP_LOG_BINARY_BUFFER_KB",
+                                   CNLOG_BINARY_BUFFER_DEFAULT_KB));
+    on_ = true;
+    std::thread(&BinaryLog::work, this).detach();
+    std::atexit([] { BinaryLog::instance().flush(); });
+  }
+
+  void work() {
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait_for(lock,
+                       std::chrono::milliseconds(CNLOG_BINARY_DRAIN_MS));
+      }
+      flush();
+    }
+  }
+
+  bool on_ = false;
+  size_t ring_size_ = 0;
+  std::ofstream file_;
+  std::vector<std::shared_ptr<LogRing>> rings_;  // guarded by mutex_
+  std::mutex mutex_;
+  std::mutex drain_mutex_;  // one drainer at a time, owns file_
+  std::condition_variable wake_;
+};
+
+/**
+ * @brief: logging state of a thread, the ring is kept alive by the drainer
+ * after the thread exits until its last messages are written.
+ */
+struct ThreadLog {
+  std::shared_ptr<LogRing> ring;
+  std::unordered_set<uint64_t> sites;  // site records already in the ring
+  ~ThreadLog() {
+    if (ring != nullptr) {
+      ring->closed.store(true, std::memory_order_release);
+    }
+  }
+};
+
+thread_local ThreadLog thread_log_;
+
+inline uint64_t siteId(const std::string &file, int line) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (char c : file) {
+    hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3ULL;
+  }
+  return (hash ^ static_cast<uint32_t>(line)) * 0x100000001b3ULL;
+}
+
+}  // anonymous namespace
+
+bool binaryLogOn() { return BinaryLog::instance().on(); }
+
+void binaryLogWrite(const std::string &file, int line, int severity,
+                    int flags, const std::string &text) {
+  ThreadLog &log = thread_log_;
+  if (log.ring == nullptr) {
+    log.ring = BinaryLog::instance().attach();
+  }
+  LogRing &ring = *log.ring;
+
+  const uint64_t site = siteId(file, line);
+  if (log.sites.count(site) == 0) {
+    SiteRecord record = {
+        static_cast<uint32_t>(sizeof(SiteRecord) + file.size()),
+        CNLOG_BINARY_SITE,
+        {0, 0, 0},
+        static_cast<uint32_t>(line),
+        site};
+    if (ring.push(&record, sizeof(record), file.data(), file.size())) {
+      log.sites.insert(site);
+    }
+  }
+
+  int card = -1;
+  cnrtGetDevice(&card);
+  const uint64_t time =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::system_clock::now().time_since_epoch())
+          .count();
+  MessageRecord record = {
+      static_cast<uint32_t>(sizeof(MessageRecord) + text.size()),
+      CNLOG_BINARY_MESSAGE,
+      static_cast<uint8_t>(severity),
+      static_cast<uint8_t>(flags),
+      0,
+      card,
+      ring.tid(),
+      time,
+      site};
+  ring.push(&record, sizeof(record), text.data(), text.size());
+  if (ring.halfFull()) {
+    BinaryLog::instance().wake();
+  }
+}
+
+}  // namespace logging
+}  // namespace mluop
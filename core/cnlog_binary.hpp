@@ -0,0 +1,67 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef CORE_CNLOG_BINARY_HPP_
+#define CORE_CNLOG_BINARY_HPP_
+
+#include <cstdint>
+#include <string>
+
+namespace mluop {
+namespace logging {
+
+/**
+ * @brief: binary backend of LogMessage, enabled by MLUOP_LOG_BINARY_FILE.
+ *
+ * Every thread appends its messages to its own lock-free ring buffer of
+ * MLUOP_LOG_BINARY_BUFFER_KB kilobytes (default 1024), and a background
+ * thread drains the rings into the binary file. Only the message text is
+ * formatted by the logging thread; time, pid, card and source location are
+ * stored raw and rendered offline by tools/cnlog_decode.py. A message not
+ * fitting into a full ring is dropped and counted in the file.
+ *
+ * File layout, little endian: "MLUOPLG1", u32 pid, u32 0, then records
+ * starting with u32 size (whole record) and u8 type:
+ *   1 site:    u8[3] 0, u32 line, u64 site id, file name
+ *   2 message: u8 severity, u8 flags, u8 0, i32 card, u32 tid,
+ *              u64 nanoseconds since epoch, u64 site id, text
+ *   3 dropped: u8[3] 0, u32 tid, u64 messages dropped since last record
+ */
+#define CNLOG_BINARY_MAGIC "MLUOPLG1"
+#define CNLOG_BINARY_SITE 1
+#define CNLOG_BINARY_MESSAGE 2
+#define CNLOG_BINARY_DROPPED 3
+// flags of a message record
+#define CNLOG_BINARY_PRINT_HEAD 1
+#define CNLOG_BINARY_PRINT_TAIL 2
+#define CNLOG_BINARY_CLEAR_ENDL 4
+
+bool binaryLogOn();
+
+// Records one message, never blocks.
+void binaryLogWrite(const std::string &file, int line, int severity,
+                    int flags, const std::string &text);
+
+}  // namespace logging
+}  // namespace mluop
+
+#endif  // CORE_CNLOG_BINARY_HPP_
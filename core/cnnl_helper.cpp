@@ -22,6 +22,14 @@
  *************************************************************************/
 #include "cnnl_helper.h"
 
+#include <map>
+#include <mutex>  // NOLINT
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "core/context.h"
+#include "core/tool.h"
+
 void mluOpCnnlCheck(mluOpStatus_t result, char const *const func,
                     const char *const file, int const line) {
   if (result) {
@@ -136,3 +144,470 @@ cnnlStatus_t mluOpConvertHandle(mluOpHandle_t handle, cnnlHandle_t _handle) {
                     "Internal set queue failed.", CNNL_STATUS_INTERNAL_ERROR);
   return CNNL_STATUS_SUCCESS;
 }
+
+namespace {
+
+inline bool cnnlResourceCacheOn() {
+  static const bool on =
+      mluop::getBoolEnvVar("MLUOP_CNNL_RESOURCE_CACHE", true);
+  return on;
+}
+
+// Released descriptors waiting to be handed out again, at most
+// CNNL_DESCRIPTOR_FREELIST_SIZE of them.
+template <typename T>
+class DescriptorFreelist {
+ public:
+  bool pop(T *desc) {
+    if (descs_.empty()) {
+      return false;
+    }
+    *desc = descs_.back();
+    descs_.pop_back();
+    return true;
+  }
+
+  bool push(T desc) {
+    if (descs_.size() >= CNNL_DESCRIPTOR_FREELIST_SIZE) {
+      return false;
+    }
+    descs_.push_back(desc);
+    return true;
+  }
+
+  template <typename Destroy>
+  void clear(Destroy destroy) {
+    for (auto desc : descs_) {
+      if (destroy(desc) != CNNL_STATUS_SUCCESS) {
+        LOG(ERROR) << "CNNL_HELPER: CNNL destroy descriptor failed.";
+      }
+    }
+    descs_.clear();
+  }
+
+ private:
+  std::vector<T> descs_;
+};
+
+// Tensor descriptors released by the calling thread, destroyed at its exit.
+struct ThreadTensorDescriptors {
+  ~ThreadTensorDescriptors() { descs.clear(cnnlDestroyTensorDescriptor); }
+  DescriptorFreelist<cnnlTensorDescriptor_t> descs;
+};
+
+thread_local ThreadTensorDescriptors thread_tensor_descs;
+
+// Matmul attributes set by the kernels. A released matmul descriptor gets
+// the values of a fresh descriptor back, so the next user does not inherit
+// a transpose or TF32 setting. Kernels setting another attribute must add
+// it here.
+const cnnlMatMulDescAttribute_t matmul_reset_attrs[] = {
+    CNNL_MATMUL_DESC_TRANSA, CNNL_MATMUL_DESC_TRANSB,
+    CNNL_MATMUL_DESC_COMPUTE_TYPE, CNNL_MATMUL_ALLOW_TF32};
+constexpr int matmul_reset_attr_num =
+    sizeof(matmul_reset_attrs) / sizeof(matmul_reset_attrs[0]);
+
+struct MatMulDefaults {
+  bool valid = false;
+  int32_t values[matmul_reset_attr_num] = {0};
+};
+
+const MatMulDefaults &matMulDefaults() {
+  static const MatMulDefaults defaults = [] {
+    MatMulDefaults result;
+    cnnlMatMulDescriptor_t desc;
+    if (cnnlCreateMatMulDescriptor(&desc) != CNNL_STATUS_SUCCESS) {
+      return result;
+    }
+    result.valid = true;
+    for (int i = 0; i < matmul_reset_attr_num; ++i) {
+      size_t size_written = 0;
+      if (cnnlGetMatMulDescAttr(desc, matmul_reset_attrs[i],
+                                &result.values[i], sizeof(int32_t),
+                                &size_written) != CNNL_STATUS_SUCCESS ||
+          size_written != sizeof(int32_t)) {
+        result.valid = false;
+      }
+    }
+    cnnlDestroyMatMulDescriptor(desc);
+    if (!result.valid) {
+      VLOG(5) << "CNNL_HELPER: matmul descriptors are not reused.";
+    }
+    return result;
+  }();
+  return defaults;
+}
+
+cnnlStatus_t resetMatMulDescriptor(cnnlMatMulDescriptor_t desc) {
+  const MatMulDefaults &defaults = matMulDefaults();
+  if (!defaults.valid) {
+    return CNNL_STATUS_NOT_SUPPORTED;
+  }
+  for (int i = 0; i < matmul_reset_attr_num; ++i) {
+    cnnlStatus_t ret = cnnlSetMatMulDescAttr(desc, matmul_reset_attrs[i],
+                                             &defaults.values[i],
+                                             sizeof(int32_t));
+    if (ret != CNNL_STATUS_SUCCESS) {
+      return ret;
+    }
+  }
+  return CNNL_STATUS_SUCCESS;
+}
+
+struct MatMulAlgoEntry {
+  cnnlMatMulAlgo_t algo = nullptr;
+  size_t workspace_size = 0;
+};
+
+}  // anonymous namespace
+
+// CNNL objects owned by a mluOp handle, see mluOpContext::cnnl_resources.
+struct mluOpCnnlResources {
+  std::mutex mutex;
+  cnnlHandle_t handle = nullptr;
+  cnrtQueue_t queue = nullptr;  // queue handle is bound to
+  DescriptorFreelist<cnnlMatMulDescriptor_t> matmul_descs;
+  DescriptorFreelist<cnnlTransposeDescriptor_t> transpose_descs;
+  std::map<mluOpMatMulAlgoKey, MatMulAlgoEntry> matmul_algos;
+};
+
+mluOpCnnlResources *mluOpCreateCnnlResources() {
+  return new (std::nothrow) mluOpCnnlResources();
+}
+
+void mluOpDestroyCnnlResources(mluOpCnnlResources *resources) {
+  if (resources == nullptr) {
+    return;
+  }
+  if (resources->handle != nullptr) {
+    if (cnnlSetQueue(resources->handle, nullptr) != CNNL_STATUS_SUCCESS ||
+        cnnlDestroy(resources->handle) != CNNL_STATUS_SUCCESS) {
+      LOG(ERROR) << "CNNL_HELPER: Internal destroy handle failed.";
+    }
+  }
+  resources->matmul_descs.clear(cnnlDestroyMatMulDescriptor);
+  resources->transpose_descs.clear(cnnlDestroyTransposeDescriptor);
+  mluOpClearMatMulAlgos(resources);
+  delete resources;
+}
+
+void mluOpClearMatMulAlgos(mluOpCnnlResources *resources) {
+  if (resources == nullptr) {
+    return;
+  }
+  std::lock_guard<std::mutex> guard(resources->mutex);
+  for (auto &iter : resources->matmul_algos) {
+    if (cnnlDestroyMatMulAlgo(iter.second.algo) != CNNL_STATUS_SUCCESS) {
+      LOG(ERROR) << "CNNL_HELPER: CNNL destroy matmul algo failed.";
+    }
+  }
+  resources->matmul_algos.clear();
+}
+
+cnnlStatus_t mluOpAcquireCnnlHandle(mluOpHandle_t handle,
+                                    cnnlHandle_t *_handle) {
+  if (!cnnlResourceCacheOn()) {
+    CHECK_FUNC_RETURN(cnnlCreate(_handle), CNNL_STATUS_SUCCESS,
+                      "CNNL create handle failed.",
+                      CNNL_STATUS_INTERNAL_ERROR);
+    return mluOpConvertHandle(handle, *_handle);
+  }
+  mluOpCnnlResources *resources = handle->cnnl_resources;
+  if (resources == nullptr) {
+    LOG(ERROR) << "CNNL_HELPER: handle has no CNNL resources.";
+    return CNNL_STATUS_INTERNAL_ERROR;
+  }
+  std::lock_guard<std::mutex> guard(resources->mutex);
+  if (resources->handle == nullptr) {
+    cnnlHandle_t cnnl_handle;
+    CHECK_FUNC_RETURN(cnnlCreate(&cnnl_handle), CNNL_STATUS_SUCCESS,
+                      "CNNL create handle failed.",
+                      CNNL_STATUS_INTERNAL_ERROR);
+    if (mluOpConvertHandle(handle, cnnl_handle) != CNNL_STATUS_SUCCESS) {
+      cnnlDestroy(cnnl_handle);
+      return CNNL_STATUS_INTERNAL_ERROR;
+    }
+    resources->handle = cnnl_handle;
+    resources->queue = handle->queue;
+  } else if (resources->queue != handle->queue) {
+    // mluOpSetQueue was called since the last CNNL call
+    CHECK_FUNC_RETURN(cnnlSetQueue(resources->handle, handle->queue),
+                      CNNL_STATUS_SUCCESS, "Internal set queue failed.",
+                      CNNL_STATUS_INTERNAL_ERROR);
+    resources->queue = handle->queue;
+  }
+  *_handle = resources->handle;
+  return CNNL_STATUS_SUCCESS;
+}
+
+cnnlStatus_t mluOpReleaseCnnlHandle(cnnlHandle_t _handle) {
+  if (cnnlResourceCacheOn()) {
+    // stays with the mluOp handle until mluOpDestroy
+    return CNNL_STATUS_SUCCESS;
+  }
+  CHECK_FUNC_RETURN(cnnlSetQueue(_handle, nullptr), CNNL_STATUS_SUCCESS,
+                    "Internal set handle queue failed.",
+                    CNNL_STATUS_INTERNAL_ERROR);
+  CHECK_FUNC_RETURN(cnnlDestroy(_handle), CNNL_STATUS_SUCCESS,
+                    "Internal destroy handle failed.",
+                    CNNL_STATUS_INTERNAL_ERROR);
+  return CNNL_STATUS_SUCCESS;
+}
+
+cnnlStatus_t mluOpAcquireCnnlTensorDescriptor(cnnlTensorDescriptor_t *_desc) {
+  if (cnnlResourceCacheOn() && thread_tensor_descs.descs.pop(_desc)) {
+    return CNNL_STATUS_SUCCESS;
+  }
+  return cnnlCreateTensorDescriptor(_desc);
+}
+
+cnnlStatus_t mluOpReleaseCnnlTensorDescriptor(cnnlTensorDescriptor_t _desc) {
+  // dtypes, position and scale set by a previous user must not leak into
+  // the next one
+  if (cnnlResourceCacheOn() &&
+      cnnlResetTensorDescriptor(_desc) == CNNL_STATUS_SUCCESS &&
+      thread_tensor_descs.descs.push(_desc)) {
+    return CNNL_STATUS_SUCCESS;
+  }
+  return cnnlDestroyTensorDescriptor(_desc);
+}
+
+cnnlStatus_t mluOpAcquireCnnlMatMulDescriptor(mluOpHandle_t handle,
+                                              cnnlMatMulDescriptor_t *_desc) {
+  if (cnnlResourceCacheOn() && handle->cnnl_resources != nullptr) {
+    mluOpCnnlResources *resources = handle->cnnl_resources;
+    std::lock_guard<std::mutex> guard(resources->mutex);
+    if (resources->matmul_descs.pop(_desc)) {
+      return CNNL_STATUS_SUCCESS;
+    }
+  }
+  return cnnlCreateMatMulDescriptor(_desc);
+}
+
+cnnlStatus_t mluOpReleaseCnnlMatMulDescriptor(mluOpHandle_t handle,
+                                              cnnlMatMulDescriptor_t _desc) {
+  if (cnnlResourceCacheOn() && handle->cnnl_resources != nullptr &&
+      resetMatMulDescriptor(_desc) == CNNL_STATUS_SUCCESS) {
+    mluOpCnnlResources *resources = handle->cnnl_resources;
+    std::lock_guard<std::mutex> guard(resources->mutex);
+    if (resources->matmul_descs.push(_desc)) {
+      return CNNL_STATUS_SUCCESS;
+    }
+  }
+  return cnnlDestroyMatMulDescriptor(_desc);
+}
+
+cnnlStatus_t mluOpAcquireCnnlTransposeDescriptor(
+    mluOpHandle_t handle, cnnlTransposeDescriptor_t *_desc) {
+  if (cnnlResourceCacheOn() && handle->cnnl_resources != nullptr) {
+    mluOpCnnlResources *resources = handle->cnnl_resources;
+    std::lock_guard<std::mutex> guard(resources->mutex);
+    if (resources->transpose_descs.pop(_desc)) {
+      return CNNL_STATUS_SUCCESS;
+    }
+  }
+  return cnnlCreateTransposeDescriptor(_desc);
+}
+
+cnnlStatus_t mluOpReleaseCnnlTransposeDescriptor(
+    mluOpHandle_t handle, cnnlTransposeDescriptor_t _desc) {
+  // cnnlSetTransposeDescriptor overwrites the whole descriptor, no reset
+  if (cnnlResourceCacheOn() && handle->cnnl_resources != nullptr) {
+    mluOpCnnlResources *resources = handle->cnnl_resources;
+    std::lock_guard<std::mutex> guard(resources->mutex);
+    if (resources->transpose_descs.push(_desc)) {
+      return CNNL_STATUS_SUCCESS;
+    }
+  }
+  return cnnlDestroyTransposeDescriptor(_desc);
+}
+
+bool mluOpMatMulAlgoKey::operator<(const mluOpMatMulAlgoKey &other) const {
+  return std::tie(m, k, n, trans_a, trans_b, a_dtype, b_dtype, c_dtype,
+                  compute_type, allow_tf32, batch) <
+         std::tie(other.m, other.k, other.n, other.trans_a, other.trans_b,
+                  other.a_dtype, other.b_dtype, other.c_dtype,
+                  other.compute_type, other.allow_tf32, other.batch);
+}
+
+int64_t mluOpMatMulDimBucket(int64_t dim) {
+  int64_t bucket = 1;
+  while (bucket < dim) {
+    bucket <<= 1;
+  }
+  return bucket;
+}
+
+namespace {
+
+// Objects of one heuristic query, released on every return path.
+struct MatMulQuery {
+  explicit MatMulQuery(mluOpHandle_t handle) : handle(handle) {}
+  ~MatMulQuery() {
+    for (auto desc : {a_desc, b_desc, c_desc}) {
+      if (desc != nullptr) {
+        mluOpReleaseCnnlTensorDescriptor(desc);
+      }
+    }
+    if (matmul_desc != nullptr) {
+      mluOpReleaseCnnlMatMulDescriptor(handle, matmul_desc);
+    }
+    if (result != nullptr) {
+      cnnlDestroyMatMulHeuristicResult(result);
+    }
+    if (algo != nullptr) {
+      cnnlDestroyMatMulAlgo(algo);
+    }
+    if (cnnl_handle != nullptr) {
+      mluOpReleaseCnnlHandle(cnnl_handle);
+    }
+  }
+
+  mluOpHandle_t handle;
+  cnnlHandle_t cnnl_handle = nullptr;
+  cnnlTensorDescriptor_t a_desc = nullptr;
+  cnnlTensorDescriptor_t b_desc = nullptr;
+  cnnlTensorDescriptor_t c_desc = nullptr;
+  cnnlMatMulDescriptor_t matmul_desc = nullptr;
+  cnnlMatMulHeuristicResult_t result = nullptr;
+  cnnlMatMulAlgo_t algo = nullptr;
+};
+
+// [rows, cols], or [batch, rows, cols] when batch is positive
+cnnlStatus_t setMatrixDescriptor(cnnlTensorDescriptor_t *desc,
+                                 mluOpDataType_t dtype, int64_t batch,
+                                 int64_t rows, int64_t cols) {
+  CHECK_FUNC_RETURN(mluOpAcquireCnnlTensorDescriptor(desc),
+                    CNNL_STATUS_SUCCESS,
+                    "CNNL creates tensor descriptor failed.",
+                    CNNL_STATUS_INTERNAL_ERROR);
+  const int64_t dims[3] = {batch, rows, cols};
+  const int dim_num = batch > 0 ? 3 : 2;
+  return cnnlSetTensorDescriptor_v2(
+      *desc, CNNL_LAYOUT_ARRAY,
+      mluOpConvertEnum<mluOpDataType_t, cnnlDataType_t>(dtype), dim_num,
+      dims + 3 - dim_num);
+}
+
+cnnlStatus_t queryMatMulAlgo(mluOpHandle_t handle,
+                             const mluOpMatMulAlgoKey &key,
+                             MatMulAlgoEntry *entry) {
+  MatMulQuery query(handle);
+  CHECK_FUNC_RETURN(
+      setMatrixDescriptor(&query.a_desc, key.a_dtype, key.batch,
+                          key.trans_a ? key.k : key.m,
+                          key.trans_a ? key.m : key.k),
+      CNNL_STATUS_SUCCESS, "Internal set matmul a failed.",
+      CNNL_STATUS_INTERNAL_ERROR);
+  CHECK_FUNC_RETURN(
+      setMatrixDescriptor(&query.b_desc, key.b_dtype, key.batch,
+                          key.trans_b ? key.n : key.k,
+                          key.trans_b ? key.k : key.n),
+      CNNL_STATUS_SUCCESS, "Internal set matmul b failed.",
+      CNNL_STATUS_INTERNAL_ERROR);
+  CHECK_FUNC_RETURN(
+      setMatrixDescriptor(&query.c_desc, key.c_dtype, key.batch, key.m,
+                          key.n),
+      CNNL_STATUS_SUCCESS, "Internal set matmul c failed.",
+      CNNL_STATUS_INTERNAL_ERROR);
+
+  CHECK_FUNC_RETURN(
+      mluOpAcquireCnnlMatMulDescriptor(handle, &query.matmul_desc),
+      CNNL_STATUS_SUCCESS, "CNNL create matmul descriptor failed.",
+      CNNL_STATUS_INTERNAL_ERROR);
+  const std::pair<cnnlMatMulDescAttribute_t, int32_t> attrs[] = {
+      {CNNL_MATMUL_DESC_TRANSA, key.trans_a},
+      {CNNL_MATMUL_DESC_TRANSB, key.trans_b},
+      {CNNL_MATMUL_DESC_COMPUTE_TYPE, key.compute_type},
+      {CNNL_MATMUL_ALLOW_TF32, key.allow_tf32}};
+  for (const auto &attr : attrs) {
+    if (attr.second < 0) {
+      continue;
+    }
+    CHECK_FUNC_RETURN(
+        cnnlSetMatMulDescAttr(query.matmul_desc, attr.first, &attr.second,
+                              sizeof(int32_t)),
+        CNNL_STATUS_SUCCESS, "Internal set matmul attribute failed.",
+        CNNL_STATUS_INTERNAL_ERROR);
+  }
+
+  CHECK_FUNC_RETURN(cnnlCreateMatMulHeuristicResult(&query.result),
+                    CNNL_STATUS_SUCCESS,
+                    "CNNL create matmul heuristic result failed.",
+                    CNNL_STATUS_INTERNAL_ERROR);
+  CHECK_FUNC_RETURN(cnnlCreateMatMulAlgo(&query.algo), CNNL_STATUS_SUCCESS,
+                    "CNNL create matmul algo failed.",
+                    CNNL_STATUS_INTERNAL_ERROR);
+  CHECK_FUNC_RETURN(mluOpAcquireCnnlHandle(handle, &query.cnnl_handle),
+                    CNNL_STATUS_SUCCESS, "Internal convert handle failed.",
+                    CNNL_STATUS_INTERNAL_ERROR);
+  int returned_algo_count = 0;
+  if (key.batch > 0) {
+    CHECK_FUNC_RETURN(
+        cnnlGetBatchMatMulExAlgoHeuristic(
+            query.cnnl_handle, query.matmul_desc, query.a_desc, query.b_desc,
+            query.c_desc, nullptr, 1, &query.result, &returned_algo_count),
+        CNNL_STATUS_SUCCESS, "Internal get batch matmul heuristic failed.",
+        CNNL_STATUS_INTERNAL_ERROR);
+    CHECK_FUNC_RETURN(
+        cnnlGetBatchMatMulExHeuristicResult(query.result, query.algo,
+                                            &entry->workspace_size),
+        CNNL_STATUS_SUCCESS,
+        "Internal get batch matmul heuristic result failed.",
+        CNNL_STATUS_INTERNAL_ERROR);
+  } else {
+    CHECK_FUNC_RETURN(
+        cnnlGetMatMulAlgoHeuristic(query.cnnl_handle, query.matmul_desc,
+                                   query.a_desc, query.b_desc, query.c_desc,
+                                   query.c_desc, nullptr, 1, &query.result,
+                                   &returned_algo_count),
+        CNNL_STATUS_SUCCESS, "Internal get matmul heuristic failed.",
+        CNNL_STATUS_INTERNAL_ERROR);
+    CHECK_FUNC_RETURN(cnnlGetMatMulHeuristicResult(query.result, query.algo,
+                                                   &entry->workspace_size),
+                      CNNL_STATUS_SUCCESS,
+                      "Internal get matmul heuristic result failed.",
+                      CNNL_STATUS_INTERNAL_ERROR);
+  }
+  entry->algo = query.algo;
+  query.algo = nullptr;
+  return CNNL_STATUS_SUCCESS;
+}
+
+}  // anonymous namespace
+
+cnnlStatus_t mluOpGetMatMulAlgo(mluOpHandle_t handle,
+                                const mluOpMatMulAlgoKey &key,
+                                cnnlMatMulAlgo_t *algo,
+                                size_t *workspace_size) {
+  mluOpCnnlResources *resources = handle->cnnl_resources;
+  if (resources == nullptr) {
+    LOG(ERROR) << "CNNL_HELPER: handle has no CNNL resources.";
+    return CNNL_STATUS_INTERNAL_ERROR;
+  }
+  {
+    std::lock_guard<std::mutex> guard(resources->mutex);
+    auto iter = resources->matmul_algos.find(key);
+    if (iter != resources->matmul_algos.end()) {
+      *algo = iter->second.algo;
+      *workspace_size = iter->second.workspace_size;
+      return CNNL_STATUS_SUCCESS;
+    }
+  }
+  // the query takes the CNNL handle and descriptors of resources, so it
+  // runs unlocked
+  MatMulAlgoEntry entry;
+  cnnlStatus_t ret = queryMatMulAlgo(handle, key, &entry);
+  if (ret != CNNL_STATUS_SUCCESS) {
+    return ret;
+  }
+  std::lock_guard<std::mutex> guard(resources->mutex);
+  auto inserted = resources->matmul_algos.emplace(key, entry);
+  if (!inserted.second) {
+    // picked concurrently by another thread, keep the first one
+    cnnlDestroyMatMulAlgo(entry.algo);
+  }
+  *algo = inserted.first->second.algo;
+  *workspace_size = inserted.first->second.workspace_size;
+  return CNNL_STATUS_SUCCESS;
+}
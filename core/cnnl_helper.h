@@ -65,6 +65,77 @@ cnnlStatus_t mluOpConvertDescriptor_v2(mluOpTensorDescriptor_t desc,
 
 cnnlStatus_t mluOpConvertHandle(mluOpHandle_t handle, cnnlHandle_t _handle);
 
+// CNNL objects reused across internal CNNL calls.
+//
+// Each mluOp handle owns a lazily created CNNL handle, which is rebound to
+// handle->queue whenever the queue changed since the last call, and
+// freelists of matmul and transpose descriptors. CNNL tensor descriptors do
+// not know the mluOp handle at the call sites, they come from a bounded
+// per-thread freelist instead. Released objects are reset before being handed
+// out again.
+//
+// MLUOP_CNNL_RESOURCE_CACHE=0 creates and destroys every object on each call.
+#define CNNL_DESCRIPTOR_FREELIST_SIZE 64
+
+struct mluOpCnnlResources;
+
+mluOpCnnlResources *mluOpCreateCnnlResources();
+void mluOpDestroyCnnlResources(mluOpCnnlResources *resources);
+void mluOpClearMatMulAlgos(mluOpCnnlResources *resources);
+
+cnnlStatus_t mluOpAcquireCnnlHandle(mluOpHandle_t handle,
+                                    cnnlHandle_t *_handle);
+cnnlStatus_t mluOpReleaseCnnlHandle(cnnlHandle_t _handle);
+
+cnnlStatus_t mluOpAcquireCnnlTensorDescriptor(cnnlTensorDescriptor_t *_desc);
+cnnlStatus_t mluOpReleaseCnnlTensorDescriptor(cnnlTensorDescriptor_t _desc);
+
+cnnlStatus_t mluOpAcquireCnnlMatMulDescriptor(mluOpHandle_t handle,
+                                              cnnlMatMulDescriptor_t *_desc);
+cnnlStatus_t mluOpReleaseCnnlMatMulDescriptor(mluOpHandle_t handle,
+                                              cnnlMatMulDescriptor_t _desc);
+
+cnnlStatus_t mluOpAcquireCnnlTransposeDescriptor(
+    mluOpHandle_t handle, cnnlTransposeDescriptor_t *_desc);
+cnnlStatus_t mluOpReleaseCnnlTransposeDescriptor(
+    mluOpHandle_t handle, cnnlTransposeDescriptor_t _desc);
+
+// Matmul computing c[m, n] = op(a) * op(b), where op(a) is [m, k] and a is
+// stored as [k, m] when trans_a is set, and op(b) is [k, n] and b is stored
+// as [n, k] when trans_b is set. A negative compute_type keeps the default
+// compute type of the matmul descriptor. A positive batch selects the
+// cnnlBatchMatMulEx algorithm of batch such products.
+struct mluOpMatMulAlgoKey {
+  int64_t m;
+  int64_t k;
+  int64_t n;
+  int32_t trans_a;
+  int32_t trans_b;
+  mluOpDataType_t a_dtype;
+  mluOpDataType_t b_dtype;
+  mluOpDataType_t c_dtype;
+  int32_t compute_type;
+  int32_t allow_tf32;
+  int64_t batch;
+
+  bool operator<(const mluOpMatMulAlgoKey &other) const;
+};
+
+// Rounds a matmul dimension that changes from call to call, such as the
+// number of active points of a sparse convolution, up to a power of two.
+int64_t mluOpMatMulDimBucket(int64_t dim);
+
+// Gets the algorithm cnnlGetMatMulAlgoHeuristic picks for key and the
+// workspace size it needs. Results are memoized in the handle until
+// mluOpInvalidateMatMulAlgoCache or mluOpDestroy, algo stays owned by the
+// handle. Callers round the varying dimension with mluOpMatMulDimBucket so
+// that a few entries cover all calls: the algorithm and workspace picked
+// for the rounded shape are used for every shape of the bucket.
+cnnlStatus_t mluOpGetMatMulAlgo(mluOpHandle_t handle,
+                                const mluOpMatMulAlgoKey &key,
+                                cnnlMatMulAlgo_t *algo,
+                                size_t *workspace_size);
+
 // Pointer type force convert
 template <typename STYPE, typename DTYPE>
 DTYPE mluOpPointerForceConvert(STYPE ptr);
@@ -74,7 +145,7 @@ DTYPE mluOpPointerForceConvert(STYPE ptr);
   cnnlTensorDescriptor_t _desc;                                              \
   {                                                                          \
     if (desc != NULL) {                                                      \
-      cnnlStatus_t ret = cnnlCreateTensorDescriptor(&_desc);                 \
+      cnnlStatus_t ret = mluOpAcquireCnnlTensorDescriptor(&_desc);           \
       if (ret != CNNL_STATUS_SUCCESS) {                                      \
         LOG(ERROR) << "CNNL_HELPER: CNNL creates tensor descriptor failed."; \
         return MLUOP_STATUS_INTERNAL_ERROR;                                  \
@@ -95,7 +166,7 @@ DTYPE mluOpPointerForceConvert(STYPE ptr);
   cnnlTensorDescriptor_t _desc;                                              \
   {                                                                          \
     if (desc != NULL) {                                                      \
-      cnnlStatus_t ret = cnnlCreateTensorDescriptor(&_desc);                 \
+      cnnlStatus_t ret = mluOpAcquireCnnlTensorDescriptor(&_desc);           \
       if (ret != CNNL_STATUS_SUCCESS) {                                      \
         LOG(ERROR) << "CNNL_HELPER: CNNL creates tensor descriptor failed."; \
         return MLUOP_STATUS_INTERNAL_ERROR;                                  \
@@ -113,7 +184,7 @@ DTYPE mluOpPointerForceConvert(STYPE ptr);
 
 #define CREATE_AND_SET_CNNL_TENSOR_DESCRIPTOR(desc, _desc)                     \
   {                                                                            \
-    cnnlStatus_t ret = cnnlCreateTensorDescriptor(&_desc);                     \
+    cnnlStatus_t ret = mluOpAcquireCnnlTensorDescriptor(&_desc);               \
     if (ret != CNNL_STATUS_SUCCESS) {                                          \
       LOG(ERROR) << "CNNL_HELPER: CNNL creates tensor descriptor failed.";     \
       return MLUOP_STATUS_INTERNAL_ERROR;                                      \
@@ -128,7 +199,7 @@ DTYPE mluOpPointerForceConvert(STYPE ptr);
 #define DESTROY_CNNL_TENSOR_DESCRIPTOR(_desc)                                \
   {                                                                          \
     if (_desc != NULL) {                                                     \
-      cnnlStatus_t ret = cnnlDestroyTensorDescriptor(_desc);                 \
+      cnnlStatus_t ret = mluOpReleaseCnnlTensorDescriptor(_desc);            \
       if (ret != CNNL_STATUS_SUCCESS) {                                      \
         LOG(ERROR) << "CNNL_HELPER: CNNL destroy tensor descriptor failed."; \
         return MLUOP_STATUS_INTERNAL_ERROR;                                  \
@@ -141,12 +212,7 @@ DTYPE mluOpPointerForceConvert(STYPE ptr);
   cnnlHandle_t _handle;                                               \
   {                                                                   \
     if (handle != NULL) {                                             \
-      cnnlStatus_t ret = cnnlCreate(&_handle);                        \
-      if (ret != CNNL_STATUS_SUCCESS) {                               \
-        LOG(ERROR) << "CNNL_HELPER: CNNL create handle failed.";      \
-        return MLUOP_STATUS_INTERNAL_ERROR;                           \
-      }                                                               \
-      ret = mluOpConvertHandle(handle, _handle);                      \
+      cnnlStatus_t ret = mluOpAcquireCnnlHandle(handle, &_handle);    \
       if (ret != CNNL_STATUS_SUCCESS) {                               \
         LOG(ERROR) << "CNNL_HELPER: Internal convert handle failed."; \
         return MLUOP_STATUS_INTERNAL_ERROR;                           \
@@ -154,20 +220,15 @@ DTYPE mluOpPointerForceConvert(STYPE ptr);
     }                                                                 \
   }
 
-#define DESTROY_CNNL_HANDLE(_handle)                                    \
-  {                                                                     \
-    if (_handle != NULL) {                                              \
-      cnnlStatus_t ret = cnnlSetQueue(_handle, nullptr);                \
-      if (ret != CNNL_STATUS_SUCCESS) {                                 \
-        LOG(ERROR) << "CNNL_HELPER: Internal set handle queue failed."; \
-        return MLUOP_STATUS_INTERNAL_ERROR;                             \
-      }                                                                 \
-      ret = cnnlDestroy(_handle);                                       \
-      if (ret != CNNL_STATUS_SUCCESS) {                                 \
-        LOG(ERROR) << "CNNL_HELPER: Internal destroy handle failed.";   \
-        return MLUOP_STATUS_INTERNAL_ERROR;                             \
-      }                                                                 \
-    }                                                                   \
+#define DESTROY_CNNL_HANDLE(_handle)                                  \
+  {                                                                   \
+    if (_handle != NULL) {                                            \
+      cnnlStatus_t ret = mluOpReleaseCnnlHandle(_handle);             \
+      if (ret != CNNL_STATUS_SUCCESS) {                               \
+        LOG(ERROR) << "CNNL_HELPER: Internal destroy handle failed."; \
+        return MLUOP_STATUS_INTERNAL_ERROR;                           \
+      }                                                               \
+    }                                                                 \
   }
 
 #endif  // KERNELS_UTILS_CNNL_HELPER_H_
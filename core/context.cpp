@@ -21,6 +21,7 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  *************************************************************************/
 #include "cstring"
+#include "core/cnnl_helper.h"
 #include "core/context.h"
 #include "core/logging.h"
 #include "core/mlu_env.h"
@@ -302,6 +303,8 @@ mluOpStatus_t MLUOP_WIN_API mluOpCreate(mluOpHandle_t *handle) {
   }
   ctx->atomics_mode =
       MLUOP_ATOMICS_NOT_ALLOWED;  // note: mluop disallows atomics by defalut.
+  ctx->cnnl_resources = mluOpCreateCnnlResources();
+  INTERNAL_CHECK("[mluOpCreate]", ctx->cnnl_resources != nullptr);
   *handle = ctx;
   return MLUOP_STATUS_SUCCESS;
 }
@@ -329,6 +332,15 @@ mluOpUpdateContextInformation(mluOpHandle_t handle) {
       handle->initJobNum(drv_ctx, "[mluOpUpdateContextInformation]")) {
     return MLUOP_STATUS_INTERNAL_ERROR;
   }
+  // algorithms were picked for the previous cluster number
+  mluOpClearMatMulAlgos(handle->cnnl_resources);
+  return MLUOP_STATUS_SUCCESS;
+}
+
+mluOpStatus_t MLUOP_WIN_API
+mluOpInvalidateMatMulAlgoCache(mluOpHandle_t handle) {
+  PARAM_CHECK("[mluOpInvalidateMatMulAlgoCache]", handle != NULL);
+  mluOpClearMatMulAlgos(handle->cnnl_resources);
   return MLUOP_STATUS_SUCCESS;
 }
 
@@ -354,6 +366,7 @@ mluOpGetAtomicsMode(mluOpHandle_t handle, mluOpAtomicsMode_t *atomics_mode) {
 mluOpStatus_t MLUOP_WIN_API mluOpDestroy(mluOpHandle_t handle) {
   PARAM_CHECK("[mluOpDestroy]", handle != NULL);
 
+  mluOpDestroyCnnlResources(handle->cnnl_resources);
   delete handle;
 
   return MLUOP_STATUS_SUCCESS;
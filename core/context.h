@@ -62,6 +62,10 @@ typedef enum {
   MLUOP_MLU290 = 290,
 } mluOpDevType_t;
 
+// CNNL handle and descriptors reused by internal CNNL calls, see
+// core/cnnl_helper.h
+struct mluOpCnnlResources;
+
 // for handle->arch
 struct deviceName {
   char name[CONTEXT_DEVICENAME_BUFFER_SIZE];
@@ -94,6 +98,7 @@ struct mluOpContext {
   double memory_band_width;            // the memory bandwidth in GB/s
   mluOpQuantizeRoundMode_t round_mode;
   mluOpAtomicsMode_t atomics_mode;
+  mluOpCnnlResources *cnnl_resources = nullptr;
   int32_t getJobNum(cnrtFunctionType_t function_type) {
     switch (function_type) {
       default:
@@ -29,13 +29,18 @@
 #include <limits.h>
 
 #include <algorithm>
+#include <atomic>
+#include <deque>
 #include <iterator>
 #include <fstream>
+#include <memory>
 #include <regex>  // NOLINT
 #include <mutex>  // NOLINT
 #include <unordered_map>
 #include <utility>
 
+#include "core/gen_case_policy.h"
+#include "core/gen_case_writer.h"
 #include "core/type.h"
 #include "core/logging.h"
 #include "core/platform/env_time.h"
@@ -47,14 +52,23 @@ namespace gen_case {
 #define IS_DUMP_DATA (genCaseModeGet(false) == 2)
 #define IS_ONLY_SHOW (genCaseModeGet(false) == 3)
 
-// mode_stacks_ is used for eliminate internal prototxt in mluOp interface
-__attribute__((__unused__)) std::unordered_map<std::string, std::vector<int>>
-    mode_stacks_;
-// nodes_ is like mode_stacks, keep nodes_vector for each thread
-__attribute__((__unused__)) std::unordered_map<std::string, std::vector<PbNode>>
-    nodes_;
-
-// create directory and modify mode_stacks_ should be thread-safe
+// gen_case state of one thread, so that api calls of different threads
+// never share a lock:
+// mode_stack is used for eliminate internal prototxt in mluOp interface
+// nodes keeps the PbNode of the nested api calls, a deque so that nodes of
+// outer calls stay in place when inner ones are added
+struct ThreadState {
+  std::vector<int> mode_stack;
+  std::deque<PbNode> nodes;
+  uint64_t mode_epoch = 0;  // value of mode_epoch_ seen by mode_stack
+};
+thread_local ThreadState thread_state_;
+
+// bumped by genCaseModeSet, threads rewrite their mode_stack when they see
+// a new value
+std::atomic<uint64_t> mode_epoch_(0);
+
+// create directory should be thread-safe
 __attribute__((__unused__)) std::mutex stacks_mutex_;
 
 // details of environment description can be found on Wiki
@@ -64,8 +78,8 @@ __attribute__((__unused__)) std::mutex stacks_mutex_;
 // MLUOP_GEN_CASE=1: Generate gen_case file without input data
 // MLUOP_GEN_CASE=2: Generate gen_case file with input data
 // MLUOP_GEN_CASE=3: Print gen_case simple infomation on screen
-__attribute__((__unused__)) int gen_case_mode_ =
-    mluop::getUintEnvVar("MLUOP_GEN_CASE", 0);
+__attribute__((__unused__)) std::atomic<int> gen_case_mode_(
+    mluop::getUintEnvVar("MLUOP_GEN_CASE", 0));
 
 // MLUOP_GEN_CASE_DIR control where the prototxt file is stored
 // default value of MLUOP_GEN_CASE_DIR is curdir + '/gen_case'
@@ -102,35 +116,44 @@ __attribute__((__unused__)) int dump_data_file_ =
 
 bool isGenCaseOn() { return gen_case_mode_ > 0; }
 
+// mode_stack of current thread, updated by the last genCaseModeSet
+inline std::vector<int> &threadModeStack() {
+  ThreadState &state = thread_state_;
+  const uint64_t epoch = mode_epoch_.load(std::memory_order_acquire);
+  if (state.mode_epoch != epoch) {
+    state.mode_epoch = epoch;
+    std::fill(state.mode_stack.begin(), state.mode_stack.end(),
+              gen_case_mode_.load());
+  }
+  return state.mode_stack;
+}
+
 int genCaseModeGet(bool first) {
+  if (first) {
+    // a case waiting for its outputs whose api call returned before
+    // GEN_CASE_END, e.g. on an error, is written without them. The case of
+    // an outer api calling this one loses its outputs the same way.
+    for (auto &node : thread_state_.nodes) {
+      node.submitOutputJob();
+    }
+  }
   if (gen_case_mode_ > 0) {
     // genCaseModeGet(false) just return gen_case_mode_ for IS_DUMP_DATA
     if (!first) {
       return gen_case_mode_;
     }
-    std::lock_guard<std::mutex> guard(stacks_mutex_);
-    std::string tid(std::to_string(syscall(SYS_gettid)));
-    int mode = dump_internal_ ? gen_case_mode_ : 0;
-    auto it = mode_stacks_.find(tid);
-    if (it != mode_stacks_.end()) {
-      auto &mode_stack = it->second;
-      // the top of mode_stack store the gen_case mode for current thread
-
-      // TODO(None): redundant first truth check
-      if (first) {
-        mode_stack.push_back(mode_stack.front());
-        mode_stack.front() = mode;
-      }
-
-      // during current mluOpapi, gen_case mode is on the bottom
-      return mode_stack.back();
-    } else {
-      std::vector<int> mode_stack(1, gen_case_mode_);
-      mode_stack.push_back(mode_stack.front());
-      mode_stack.front() = mode;
-      mode_stacks_.emplace(tid, mode_stack);
-      return gen_case_mode_;
+    int mode = dump_internal_ ? gen_case_mode_.load() : 0;
+    auto &mode_stack = threadModeStack();
+    if (mode_stack.empty()) {
+      // first call in this thread
+      mode_stack.push_back(gen_case_mode_);
     }
+    // the top of mode_stack store the gen_case mode for current thread
+    mode_stack.push_back(mode_stack.front());
+    mode_stack.front() = mode;
+
+    // during current mluOpapi, gen_case mode is on the bottom
+    return mode_stack.back();
   } else {
     return 0;
   }
@@ -138,11 +161,8 @@ int genCaseModeGet(bool first) {
 
 void genCaseModeRestore() {
   if (gen_case_mode_ > 0) {
-    std::lock_guard<std::mutex> guard(stacks_mutex_);
-    std::string tid(std::to_string(syscall(SYS_gettid)));
-    auto it = mode_stacks_.find(tid);
-    if (it != mode_stacks_.end()) {
-      auto &mode_stack = it->second;
+    auto &mode_stack = threadModeStack();
+    if (mode_stack.size() > 1) {
       // use gen_case mode of current mluOpapi to restore current thread
       mode_stack.front() = mode_stack.back();
       mode_stack.pop_back();
@@ -152,19 +172,13 @@ void genCaseModeRestore() {
   }
 }
 
-// should update mode in mode_stacks_
+// mode_stack of every thread is updated lazily through mode_epoch_
 void genCaseModeSet(int mode) {
   if (mode < 0 && mode > 4) {
     mode = 0;
   }
-  std::lock_guard<std::mutex> guard(stacks_mutex_);
-  for (auto &mode_stacks_it : mode_stacks_) {
-    auto &mode_stack = mode_stacks_it.second;
-    for (int i = 0; i < mode_stack.size(); i++) {
-      mode_stack[i] = mode;
-    }
-  }
   gen_case_mode_ = mode;
+  mode_epoch_.fetch_add(1, std::memory_order_release);
   LOG(INFO) << "[gen_case] Set GEN_CASE mode to " << mode << ".";
 }
 
@@ -245,30 +259,19 @@ inline int getOpNameMask(const std::string op_name_,
 }
 
 PbNode *genCaseStart(std::string op_name, std::string op_type) {
-  std::lock_guard<std::mutex> guard(stacks_mutex_);
-  std::string tid(std::to_string(syscall(SYS_gettid)));
-  auto it = nodes_.find(tid);
-  if (it != nodes_.end()) {
-    auto &nodes_vector = it->second;
-    // find empty slot of node
-    for (int i = 0; i < nodes_vector.size(); i++) {
-      // so after serialization, node should be reset
-      if (nodes_vector[i].op_name == "") {
-        nodes_vector[i].setOpNameAndType(op_name, op_type);
-        return &nodes_vector[i];
-      }
+  auto &nodes = thread_state_.nodes;
+  // find empty slot of node
+  for (auto &node : nodes) {
+    // so after serialization, node should be reset
+    if (node.op_name == "") {
+      node.setOpNameAndType(op_name, op_type);
+      return &node;
     }
-    // if there is no empty node, should new PbNode
-    nodes_vector.push_back(PbNode());
-    nodes_vector.back().setOpNameAndType(op_name, op_type);
-    return &nodes_vector.back();
-  } else {
-    // first call in this thread, just set a vector of PbNode
-    nodes_.emplace(tid, std::vector<PbNode>(1));
-    PbNode &node = nodes_[tid].front();
-    node.setOpNameAndType(op_name, op_type);
-    return &node;
   }
+  // if there is no empty node, should new PbNode
+  nodes.emplace_back();
+  nodes.back().setOpNameAndType(op_name, op_type);
+  return &nodes.back();
 }
 
 void genCaseData(PbNode *node, bool is_input, std::string id,
@@ -380,23 +383,22 @@ void genCaseHandleParam(PbNode *node) {
 void genCaseEnd() {
   // serialize protxt and restore gen case mode
   if (gen_case_mode_ > 0) {
-    std::string tid(std::to_string(syscall(SYS_gettid)));
-    auto it = mode_stacks_.find(tid);
-    auto &mode_stack = it->second;
-    if (mode_stack.back() > 0) {
-      auto nodes_it = nodes_.find(tid);
-      auto &nodes_vector = nodes_it->second;
+    auto &mode_stack = threadModeStack();
+    if (!mode_stack.empty() && mode_stack.back() > 0) {
+      auto &nodes = thread_state_.nodes;
       // find the last used slot
       int slot_num = 0;
-      for (int i = 0; i < nodes_vector.size(); i++) {
-        if (nodes_vector[i].op_name != "") {
+      for (const auto &node : nodes) {
+        if (node.op_name != "") {
           slot_num++;
         }
       }
-      if (dump_data_output_ != 0) {
-        nodes_vector[slot_num - 1].dumpOutputFile();
+      if (slot_num > 0) {
+        if (dump_data_output_ != 0) {
+          nodes[slot_num - 1].dumpOutputFile();
+        }
+        nodes[slot_num - 1].reset();
       }
-      nodes_vector[slot_num - 1].reset();
     }
   }
   genCaseModeRestore();
@@ -501,8 +503,57 @@ int PbNode::mkdir() {
   return error_number;
 }
 
+bool PbNode::acceptCase(bool valueDump) {
+  if (!casePolicyOn()) {
+    return true;
+  }
+  uint64_t signature = signatureMix(GEN_CASE_SIGNATURE_SEED, op_name);
+  for (const auto &tensor : tensors) {
+    const mluOpTensorDescriptor_t desc = tensor.desc;
+    const int dim = desc->getDim();
+    const int header[4] = {tensor.is_input, desc->getDtype(),
+                           desc->getLayout(), dim};
+    signature = signatureMix(signature, header, sizeof(header));
+    signature = signatureMix(signature, desc->getDims(), dim * sizeof(int64_t));
+    signature =
+        signatureMix(signature, desc->getStrides(), dim * sizeof(int64_t));
+  }
+  for (const auto &param : op_param.params) {
+    signature = signatureMix(signature, param.first);
+    signature = signatureMix(signature, param.second);
+  }
+  for (const auto &child : op_param.childs) {
+    for (const auto &param : child.params) {
+      signature = signatureMix(signature, param.first);
+      signature = signatureMix(signature, param.second);
+    }
+  }
+  if (casePolicySeen(signature)) {
+    return false;
+  }
+
+  // tensor data the case writes, as decided in dumpToFile
+  uint64_t bytes = 0;
+  for (const auto &tensor : tensors) {
+    if (tensor.device_ptr == nullptr) {
+      continue;
+    }
+    if (tensor.is_input ? (valueDump || IS_DUMP_DATA) &&
+                              (tensor.dump_data || dump_data_ > 0)
+                        : dump_data_output_ != 0) {
+      bytes += tensor.desc->getTotalTensorSize();
+    }
+  }
+  return casePolicyAccept(op_name, signature, bytes);
+}
+
 void PbNode::serialize() {
   int state = getOpNameMask(op_name_, op_name);
+  if (state == 1 || state == 2) {
+    if (!acceptCase(state == 2)) {
+      return;
+    }
+  }
   if (state != -1) {
     if (state == 1) {
       if (IS_ONLY_SHOW) {
@@ -534,7 +585,7 @@ void PbNode::printOnScreen() {
 }
 
 void PbNode::dumpDataFile(std::string file_name, std::string folder_name,
-                          int index, std::ofstream &case_file,
+                          int index, std::ostream &case_file,
                           enum DATASTATE data_state) {
   cnrtQueue_t queue;
   mluOpGetQueue(handle, &queue);
@@ -585,6 +636,25 @@ void PbNode::dumpDataFile(std::string file_name, std::string folder_name,
   }
 }
 
+// Async counterpart of dumpDataFile: the data always goes to a binary file,
+// copied on the queue of the handle behind the work already enqueued.
+bool PbNode::captureDataFile(CaseJob *job, cnrtQueue_t queue,
+                             const std::string &file_name,
+                             const std::string &folder_name, int index,
+                             enum DATASTATE data_state) {
+  std::string dataState = data_state == INPUT ? "input" : "output";
+  std::string tensor_file_name = folder_name + "/" + file_name + "_data" +
+                                 std::to_string(index) + "_" + dataState;
+  mluOpDataType_t dtype;
+  mluOpGetTensorDescriptor(tensors[index].desc, nullptr, &dtype, nullptr,
+                           nullptr);
+  uint64_t data_size = getTensorSize(index) * mluop::getSizeOfDataType(dtype);
+  bool on_host =
+      tensors[index].desc->getPointerMode() == MLUOP_POINTER_MODE_HOST;
+  return asyncWriterCopy(job, queue, tensor_file_name,
+                         tensors[index].device_ptr, data_size, on_host);
+}
+
 void PbNode::debugTensorAddress() {
   if (VLOG_IS_ON(1)) {
     std::ostringstream fmt_oss;
@@ -606,6 +676,31 @@ void PbNode::dumpOutputFile() {
   // st <=0 means gen_case do not work on this op_name
   if (st <= 0) return;
 
+  // file_name is empty when the case was not captured
+  if (this->file_name == "") return;
+
+  if (asyncWriterOn()) {
+    if (output_job_ == nullptr) {
+      return;
+    }
+    cnrtQueue_t queue = output_job_->queue;
+    std::string folder_name = getFolderName();
+    std::string &prototxt = output_job_->prototxt;
+    // from the last output on, so that the positions before stay valid
+    for (auto pos = output_path_pos_.rbegin(); pos != output_path_pos_.rend();
+         ++pos) {
+      int i = pos->second;
+      if (captureDataFile(output_job_.get(), queue, this->file_name,
+                          folder_name, i, OUTPUT)) {
+        prototxt.insert(pos->first, "  path: \"" + this->file_name + "_data" +
+                                        std::to_string(i) + "_output\"\n");
+      }
+    }
+    asyncWriterMark(output_job_.get(), queue);
+    submitOutputJob();
+    return;
+  }
+
   for (int i = 0; i < tensors.size(); i++) {
     if (!tensors[i].is_input) {
       // sync queue to dump output if necessary
@@ -641,6 +736,19 @@ void PbNode::dumpOutputFile() {
   }
 }
 
+void PbNode::submitOutputJob() {
+  if (output_job_ == nullptr) {
+    return;
+  }
+  // marked by dumpToFile or dumpOutputFile already: this also runs after the
+  // api call returned, when its handle and queue may be destroyed
+  asyncWriterSubmit(
+      std::unique_ptr<CaseJob>(new CaseJob(std::move(*output_job_))),
+      nullptr);
+  output_job_.reset();
+  output_path_pos_.clear();
+}
+
 void PbNode::dumpToFile(bool valueDump) {
   std::string folder_name = getFolderName();
   int error_number = mkdir();
@@ -650,6 +758,18 @@ void PbNode::dumpToFile(bool valueDump) {
                << " ! (" << errno << ": " << strerror(errno) << ")";
     return;
   }
+  std::unique_ptr<CaseJob> job;
+  cnrtQueue_t queue = nullptr;
+  if (asyncWriterOn()) {
+    // a case held for its outputs is complete once dumped again
+    submitOutputJob();
+    if (!asyncWriterReserve()) {
+      return;
+    }
+    job.reset(new CaseJob);
+    mluOpGetQueue(handle, &queue);
+    job->queue = queue;
+  }
   std::string file_name = "";
   std::string case_file_name = "";
   if (this->file_name == "") {
@@ -662,9 +782,16 @@ void PbNode::dumpToFile(bool valueDump) {
     file_name = this->file_name;
     case_file_name = this->case_file_name;
   }
-  std::ofstream case_file;
-  if (!case_file.is_open()) {
-    case_file.open(case_file_name.c_str(), std::ios::ate | std::ios::out);
+  std::ofstream file;
+  std::ostringstream text;
+  if (job == nullptr) {
+    file.open(case_file_name.c_str(), std::ios::ate | std::ios::out);
+  }
+  // the async writer gets the prototxt as text, formatted here since the
+  // tensor descriptors may be destroyed as soon as the api returns
+  std::ostream &case_file = job == nullptr ? static_cast<std::ostream &>(file)
+                                           : static_cast<std::ostream &>(text);
+  if (job != nullptr || file.is_open()) {
     if (case_file) {
       case_file << "op_name: \"" + op_name + "\"\n";
       case_file << "op_type: " + op_type << "\n";
@@ -681,7 +808,15 @@ void PbNode::dumpToFile(bool valueDump) {
             if ((tensors[i].dump_data || dump_data_ > 0) &&
                 tensors[i].device_ptr != nullptr) {
               // TO DO : should consider malloc failure
-              dumpDataFile(file_name, folder_name, i, case_file, INPUT);
+              if (job == nullptr) {
+                dumpDataFile(file_name, folder_name, i, case_file, INPUT);
+              } else if (captureDataFile(job.get(), queue, file_name,
+                                         folder_name, i, INPUT)) {
+                case_file << "  path: \"" << file_name << "_data" << i
+                          << "_input\"\n";
+              } else {
+                case_file << get_tensor_random_string(i);
+              }
             } else {
               case_file << get_tensor_random_string(i);
             }
@@ -690,7 +825,13 @@ void PbNode::dumpToFile(bool valueDump) {
           }
         } else {
           if (dump_data_output_ != 0) {
-            dumpDataFile(file_name, folder_name, i, case_file, OUTPUT);
+            if (job == nullptr) {
+              dumpDataFile(file_name, folder_name, i, case_file, OUTPUT);
+            } else if (tensors[i].device_ptr != nullptr) {
+              // the data is captured by dumpOutputFile after the kernel,
+              // which also writes the path if the capture succeeds
+              output_path_pos_.push_back({(size_t)text.tellp(), i});
+            }
           }
         }
         case_file << "}\n";
@@ -732,7 +873,18 @@ void PbNode::dumpToFile(bool valueDump) {
       }
       case_file << "  baseline_device: CPU\n}";
     }
-    case_file.close();
+  }
+  if (job != nullptr) {
+    job->case_file_name = case_file_name;
+    job->prototxt = text.str();
+    if (output_path_pos_.empty()) {
+      asyncWriterSubmit(std::move(job), queue);
+    } else {
+      // the writer slot of the case stays reserved until the outputs are
+      // captured, or until the case is submitted without them
+      asyncWriterMark(job.get(), queue);
+      output_job_.reset(job.release());
+    }
   }
 }
 
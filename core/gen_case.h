@@ -27,6 +27,7 @@
 #include <iomanip>
 #include <string>
 #include <limits>
+#include <memory>
 #include <utility>
 
 #include "mlu_op.h"
@@ -200,6 +201,8 @@ struct TensorNode {
 
 enum DATASTATE { INPUT, OUTPUT };
 
+struct CaseJob;
+
 class PbNode {
  public:
   std::string op_name;
@@ -216,6 +219,7 @@ class PbNode {
   PbNode() {}
   ~PbNode() { reset(); }
   void reset() {
+    submitOutputJob();
     op_name = "";
     op_type = "";
     file_name = "";
@@ -513,12 +517,28 @@ class PbNode {
   void setHandle(mluOpHandle_t handle) { this->handle = handle; }
   void getHandleParam();
   void dumpDataFile(std::string file_name, std::string folder_name, int index,
-                    std::ofstream &case_file, enum DATASTATE data_state);
+                    std::ostream &case_file, enum DATASTATE data_state);
+  bool captureDataFile(CaseJob *job, cnrtQueue_t queue,
+                       const std::string &file_name,
+                       const std::string &folder_name, int index,
+                       enum DATASTATE data_state);
   void dumpOutputFile();
+  // hands the case held for its output data to the async writer, with the
+  // output paths captured so far
+  void submitOutputJob();
   void dumpToFile(bool valueDump = false);
   void printOnScreen();
+  // applies the capture policy of MLUOP_GEN_CASE_SAMPLE_RATE and co.
+  bool acceptCase(bool valueDump);
   void serialize();
   void debugTensorAddress();
+
+ private:
+  // async writer only: the case whose output data is captured by
+  // dumpOutputFile, and where the path of each output tensor goes in its
+  // prototxt once the capture succeeded
+  std::shared_ptr<CaseJob> output_job_;
+  std::vector<std::pair<size_t, int>> output_path_pos_;
 };
 
 class genCaseConfig {
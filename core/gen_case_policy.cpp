@@ -0,0 +1,255 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include "core/gen_case_policy.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <unordered_map>
+#include "core/logging.h"
+#include "core/tool.h"
+
+namespace mluop {
+namespace gen_case {
+namespace {
+
+// Open addressing set of 64-bit keys, 0 marks an empty slot. Keys are only
+// inserted, so a lookup never takes a lock and never sees a torn entry.
+class KeyTable {
+ public:
+  explicit KeyTable(size_t size) : mask_(size - 1), keys_(new Slot[size]) {}
+
+  // Returns the slot holding key, inserting it when insert is true, or -1
+  // when key is absent or the probed slots are full.
+  int64_t find(uint64_t key, bool insert, bool *inserted) {
+    key = std::max<uint64_t>(key, 1);
+    *inserted = false;
+    for (size_t p = 0; p < GEN_CASE_TABLE_PROBES; p++) {
+      const size_t slot = (key + p) & mask_;
+      uint64_t current = keys_[slot].key.load(std::memory_order_acquire);
+      if (current == 0 && insert) {
+        if (keys_[slot].key.compare_exchange_strong(current, key)) {
+          *inserted = true;
+          return slot;
+        }
+        // lost the slot, current now holds the key of the winner
+      }
+      if (current == key) {
+        return slot;
+      }
+      if (current == 0) {
+        return -1;
+      }
+    }
+    return -1;
+  }
+
+  std::atomic<uint64_t> &counter(int64_t slot, int index) {
+    return keys_[slot].counters[index];
+  }
+
+ private:
+  struct Slot {
+    std::atomic<uint64_t> key{0};
+    std::atomic<uint64_t> counters[2] = {{0}, {0}};
+  };
+  const size_t mask_;
+  std::unique_ptr<Slot[]> keys_;
+};
+
+class CasePolicy {
+ public:
+  CasePolicy()
+      : dedup_(mluop::getBoolEnvVar("MLUOP_GEN_CASE_DEDUP", false)),
+        signatures_(dedup_ ? GEN_CASE_DEDUP_TABLE_SIZE : 1),
+        ops_(GEN_CASE_OP_TABLE_SIZE) {
+    parseSampleRate(mluop::getStringEnvVar("MLUOP_GEN_CASE_SAMPLE_RATE"));
+    max_cases_ = mluop::getUintEnvVar("MLUOP_GEN_CASE_MAX_CASES_PER_OP", 0);
+    max_bytes_ =
+        mluop::getUintEnvVar("MLUOP_GEN_CASE_MAX_MB_PER_MIN", 0) << 20;
+    on_ = dedup_ || max_cases_ > 0 || max_bytes_ > 0 ||
+          default_rate_ < 1.0 || !rates_.empty();
+  }
+
+  // Never destroyed: api calls of detached threads may still come in at
+  // exit.
+  static CasePolicy &instance() {
+    static CasePolicy *policy = new CasePolicy();
+    return *policy;
+  }
+
+  inline bool on() const { return on_; }
+
+  bool seen(uint64_t signature) {
+    bool inserted;
+    return dedup_ && signatures_.find(signature, false, &inserted) >= 0;
+  }
+
+  bool accept(const std::string &op_name, uint64_t signature,
+              uint64_t bytes) {
+    bool inserted;
+    const int64_t op = ops_.find(
+        signatureMix(GEN_CASE_SIGNATURE_SEED, op_name), true, &inserted);
+    if (op < 0) {
+      LOG_FIRST_N(WARNING, 1) << "[gen_case] Too many ops for the capture "
+                                 "policy, the others are not captured.";
+      return false;
+    }
+
+    // sampling: the n-th call is taken when floor(n * rate) steps
+    const double rate = sampleRate(op_name);
+    const uint64_t call = ops_.counter(op, 0).fetch_add(1);
+    if (std::floor((call + 1) * rate) <= std::floor(call * rate)) {
+      return false;
+    }
+
+    std::atomic<uint64_t> &cases = ops_.counter(op, 1);
+    if (max_cases_ > 0 && cases.fetch_add(1) >= max_cases_) {
+      return false;
+    }
+    uint64_t minute = 0;
+    if (max_bytes_ > 0 && !chargeBytes(bytes, &minute)) {
+      if (max_cases_ > 0) {
+        cases.fetch_sub(1);
+      }
+      return false;
+    }
+
+    if (dedup_) {
+      if (signatures_.find(signature, true, &inserted) < 0) {
+        LOG_FIRST_N(WARNING, 1)
+            << "[gen_case] Too many distinct cases for MLUOP_GEN_CASE_DEDUP, "
+               "the others are not captured.";
+      }
+      if (!inserted) {
+        // captured concurrently by another thread, or not recorded: the
+        // case is not captured, so it is not charged either
+        if (max_cases_ > 0) {
+          cases.fetch_sub(1);
+        }
+        if (max_bytes_ > 0) {
+          refundBytes(bytes, minute);
+        }
+        return false;
+      }
+    }
+    return true;
+  }
+
+ private:
+  void parseSampleRate(const std::string &config) {
+    size_t begin = 0;
+    while (begin < config.size()) {
+      size_t end = config.find(';', begin);
+      end = end == std::string::npos ? config.size() : end;
+      const std::string token = config.substr(begin, end - begin);
+      begin = end + 1;
+      if (token.empty()) {
+        continue;
+      }
+      const size_t colon = token.find(':');
+      const std::string value =
+          colon == std::string::npos ? token : token.substr(colon + 1);
+      char *value_end = nullptr;
+      const double rate = std::strtod(value.c_str(), &value_end);
+      if (value.empty() || *value_end != '\0' || !(rate >= 0.0)) {
+        LOG(WARNING) << "[gen_case] Invalid MLUOP_GEN_CASE_SAMPLE_RATE item \""
+                     << token << "\" is ignored.";
+        continue;
+      }
+      if (colon == std::string::npos) {
+        default_rate_ = std::min(rate, 1.0);
+      } else {
+        rates_[token.substr(0, colon)] = std::min(rate, 1.0);
+      }
+    }
+  }
+
+  // rates_ is not modified after construction, so it is read without lock
+  double sampleRate(const std::string &op_name) const {
+    auto iter = rates_.find(op_name);
+    return iter == rates_.end() ? default_rate_ : iter->second;
+  }
+
+  // Charges bytes to the window of the current minute, stored in
+  // minute_charged.
+  bool chargeBytes(uint64_t bytes, uint64_t *minute_charged) {
+    const uint64_t minute =
+        std::chrono::duration_cast<std::chrono::minutes>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    uint64_t window = window_.load();
+    if (window != minute && window_.compare_exchange_strong(window, minute)) {
+      window_bytes_.store(0);
+    }
+    const uint64_t used = window_bytes_.fetch_add(bytes);
+    if (used + bytes > max_bytes_) {
+      window_bytes_.fetch_sub(bytes);
+      return false;
+    }
+    *minute_charged = minute;
+    return true;
+  }
+
+  // Takes back bytes charged in minute, unless its window is over.
+  void refundBytes(uint64_t bytes, uint64_t minute) {
+    if (window_.load() != minute) {
+      return;
+    }
+    // the window may be reset meanwhile, so never go below 0
+    uint64_t used = window_bytes_.load();
+    while (!window_bytes_.compare_exchange_weak(
+        used, used > bytes ? used - bytes : 0)) {
+    }
+  }
+
+  const bool dedup_;
+  bool on_ = false;
+  uint64_t max_cases_ = 0;
+  uint64_t max_bytes_ = 0;
+  double default_rate_ = 1.0;
+  std::unordered_map<std::string, double> rates_;
+  KeyTable signatures_;
+  KeyTable ops_;  // counters: calls, captured cases
+  std::atomic<uint64_t> window_{0};
+  std::atomic<uint64_t> window_bytes_{0};
+};
+
+}  // anonymous namespace
+
+bool casePolicyOn() { return CasePolicy::instance().on(); }
+
+bool casePolicySeen(uint64_t signature) {
+  return CasePolicy::instance().seen(signature);
+}
+
+bool casePolicyAccept(const std::string &op_name, uint64_t signature,
+                      uint64_t bytes) {
+  return CasePolicy::instance().accept(op_name, signature, bytes);
+}
+
+}  // namespace gen_case
+}  // namespace mluop
@@ -0,0 +1,79 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef CORE_GEN_CASE_POLICY_H_
+#define CORE_GEN_CASE_POLICY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Capture policy applied to every case that passes MLUOP_GEN_CASE_OP_NAME:
+//   MLUOP_GEN_CASE_SAMPLE_RATE="0.01;conv:0.5" captures 1 of every 100 calls
+//     of each op, and 1 of every 2 calls of conv. Default 1.
+//   MLUOP_GEN_CASE_DEDUP=1 captures each signature (op, tensor dtypes,
+//     layouts, dims and strides, op params) only once. Once the table of
+//     signatures is full, new signatures are not captured.
+//   MLUOP_GEN_CASE_MAX_CASES_PER_OP bounds the cases of each op, 0 is no
+//     bound.
+//   MLUOP_GEN_CASE_MAX_MB_PER_MIN bounds the tensor data captured per minute
+//     over all ops, 0 is no bound.
+// Signatures are kept in a fixed lock-free table, a repeated signature is
+// rejected by a few atomic loads.
+#define GEN_CASE_DEDUP_TABLE_SIZE (64 * 1024)
+#define GEN_CASE_OP_TABLE_SIZE 1024
+// slots probed before a signature is considered not seen
+#define GEN_CASE_TABLE_PROBES 32
+
+namespace mluop {
+namespace gen_case {
+
+// Incremental FNV-1a hash used to build case signatures.
+inline uint64_t signatureMix(uint64_t hash, const void *data, size_t size) {
+  const unsigned char *bytes = static_cast<const unsigned char *>(data);
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+inline uint64_t signatureMix(uint64_t hash, const std::string &value) {
+  return signatureMix(hash, value.data(), value.size() + 1);
+}
+
+#define GEN_CASE_SIGNATURE_SEED 0xcbf29ce484222325ULL
+
+// false when no policy variable is set, the checks below are then skipped.
+bool casePolicyOn();
+
+// Whether a case with this signature has already been captured.
+bool casePolicySeen(uint64_t signature);
+
+// Decides whether a case not seen yet is captured, charging it to the
+// budgets of op_name. bytes is the tensor data the case will write.
+bool casePolicyAccept(const std::string &op_name, uint64_t signature,
+                      uint64_t bytes);
+
+}  // namespace gen_case
+}  // namespace mluop
+
+#endif  // CORE_GEN_CASE_POLICY_H_
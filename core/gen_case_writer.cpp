@@ -0,0 +1,213 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include "core/gen_case_writer.h"
+
+#include <algorithm>
+#include <condition_variable>  // NOLINT
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
+#include <utility>
+#include "core/logging.h"
+#include "core/tool.h"
+
+namespace mluop {
+namespace gen_case {
+namespace {
+
+class CaseWriter {
+ public:
+  CaseWriter(int mode, size_t capacity)
+      : mode_(mode), capacity_(std::max<size_t>(1, capacity)) {
+    if (mode_ > 0) {
+      std::thread(&CaseWriter::work, this).detach();
+      std::atexit([] { CaseWriter::instance().flush(); });
+    }
+  }
+
+  // Never destroyed: the detached writer may still wait on the members at
+  // exit, and pinned buffers must be freed before the runtime is torn down.
+  static CaseWriter &instance() {
+    static CaseWriter *writer = new CaseWriter(
+        mluop::getUintEnvVar("MLUOP_GEN_CASE_ASYNC", 0),
+        mluop::getUintEnvVar("MLUOP_GEN_CASE_ASYNC_QUEUE_SIZE",
+                             GEN_CASE_ASYNC_QUEUE_DEFAULT_SIZE));
+    return *writer;
+  }
+
+  inline bool enabled() const { return mode_ > 0; }
+
+  bool reserve() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (pending_ >= capacity_) {
+      if (mode_ == 2) {
+        if (dropped_++ % 1000 == 0) {
+          LOG(WARNING) << "[gen_case] Writer queue is full, " << dropped_
+                       << " case(s) dropped so far.";
+        }
+        return false;
+      }
+      done_.wait(lock, [&] { return pending_ < capacity_; });
+    }
+    ++pending_;
+    return true;
+  }
+
+  void submit(std::unique_ptr<CaseJob> job) {
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      jobs_.push_back(std::move(job));
+      ++submitted_;
+    }
+    wake_.notify_one();
+  }
+
+  void flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [&] { return submitted_ == 0; });
+  }
+
+ private:
+  void work() {
+    while (true) {
+      std::unique_ptr<CaseJob> job;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait(lock, [&] { return !jobs_.empty(); });
+        job = std::move(jobs_.front());
+        jobs_.pop_front();
+      }
+      write(job.get());
+      {
+        std::lock_guard<std::mutex> guard(mutex_);
+        --pending_;
+        --submitted_;
+      }
+      done_.notify_all();
+    }
+  }
+
+  static void write(CaseJob *job) {
+    if (job->notifier != nullptr) {
+      cnrtSetDevice(job->device);
+      if (cnrtSuccess != cnrtWaitNotifier(job->notifier)) {
+        LOG(ERROR) << "[gen_case] Wait for the data copies failed.";
+      }
+      cnrtNotifierDestroy(job->notifier);
+    }
+    for (const auto &buffer : job->buffers) {
+      std::ofstream data_file(buffer.file_name.c_str(), std::ios::binary);
+      data_file.write(reinterpret_cast<const char *>(buffer.host_data),
+                      buffer.size);
+      if (!data_file) {
+        LOG(ERROR) << "[gen_case] Write " << buffer.file_name << " failed.";
+      }
+      cnrtFreeHost(buffer.host_data);
+    }
+    if (!job->case_file_name.empty()) {
+      std::ofstream case_file(job->case_file_name.c_str(), std::ios::out);
+      case_file << job->prototxt;
+      if (!case_file) {
+        LOG(ERROR) << "[gen_case] Write " << job->case_file_name
+                   << " failed.";
+      }
+    }
+  }
+
+  const int mode_;
+  const size_t capacity_;
+  size_t pending_ = 0;  // reserved and not written yet, guarded by mutex_
+  // submitted and not written yet, guarded by mutex_. A case whose api
+  // call returned early keeps its slot reserved until the next api call of
+  // its thread, which may never come.
+  size_t submitted_ = 0;
+  size_t dropped_ = 0;
+  std::deque<std::unique_ptr<CaseJob>> jobs_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+};
+
+}  // anonymous namespace
+
+bool asyncWriterOn() { return CaseWriter::instance().enabled(); }
+
+bool asyncWriterReserve() { return CaseWriter::instance().reserve(); }
+
+bool asyncWriterCopy(CaseJob *job, cnrtQueue_t queue,
+                     const std::string &file_name, const void *data,
+                     size_t size, bool on_host) {
+  void *host_data = nullptr;
+  if (cnrtSuccess != cnrtHostMalloc(&host_data, std::max<size_t>(size, 1))) {
+    LOG(ERROR) << "[gen_case] Dump data failed! cnrtHostMalloc size is "
+               << size << " byte.";
+    return false;
+  }
+  if (on_host) {
+    memcpy(host_data, data, size);
+  } else if (size > 0 &&
+             cnrtSuccess != cnrtMemcpyAsync(host_data, const_cast<void *>(data),
+                                            size, queue,
+                                            cnrtMemcpyDevToHost)) {
+    LOG(ERROR) << "[gen_case] Dump data failed! cnrtMemcpyAsync data size is "
+               << size << " byte.";
+    cnrtFreeHost(host_data);
+    return false;
+  }
+  job->buffers.push_back({file_name, host_data, size});
+  return true;
+}
+
+void asyncWriterMark(CaseJob *job, cnrtQueue_t queue) {
+  if (job->buffers.empty()) {
+    return;
+  }
+  cnrtGetDevice(&job->device);
+  if (job->notifier == nullptr &&
+      cnrtSuccess != cnrtNotifierCreate(&job->notifier)) {
+    job->notifier = nullptr;
+  } else if (cnrtSuccess != cnrtPlaceNotifier(job->notifier, queue)) {
+    cnrtNotifierDestroy(job->notifier);
+    job->notifier = nullptr;
+  }
+  if (job->notifier == nullptr) {
+    // the writer cannot tell when the copies end, finish them here
+    LOG(WARNING) << "[gen_case] Place notifier failed, sync queue instead.";
+    cnrtQueueSync(queue);
+  }
+}
+
+void asyncWriterSubmit(std::unique_ptr<CaseJob> job, cnrtQueue_t queue) {
+  if (queue != nullptr) {
+    asyncWriterMark(job.get(), queue);
+  }
+  CaseWriter::instance().submit(std::move(job));
+}
+
+void asyncWriterFlush() { CaseWriter::instance().flush(); }
+
+}  // namespace gen_case
+}  // namespace mluop
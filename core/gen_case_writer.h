@@ -0,0 +1,87 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef CORE_GEN_CASE_WRITER_H_
+#define CORE_GEN_CASE_WRITER_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "cnrt.h"
+
+// MLUOP_GEN_CASE_ASYNC moves the writing of gen_case files off the api thread:
+//   0: prototxt and data are written by the api thread (default)
+//   1: written by a background thread, api threads wait when the queue is full
+//   2: written by a background thread, cases are dropped when the queue is full
+// MLUOP_GEN_CASE_ASYNC_QUEUE_SIZE bounds the number of cases not written yet.
+#define GEN_CASE_ASYNC_QUEUE_DEFAULT_SIZE 64
+
+namespace mluop {
+namespace gen_case {
+
+// Tensor data copied into a pinned host buffer, written as a binary file.
+struct CaseBuffer {
+  std::string file_name;
+  void *host_data;
+  size_t size;
+};
+
+// Everything the writer thread needs for one case. The prototxt text is
+// formatted on the api thread since tensor descriptors belong to the user,
+// only the copies and the file writes are deferred.
+struct CaseJob {
+  std::string case_file_name;  // empty when the case only has data files
+  std::string prototxt;
+  std::vector<CaseBuffer> buffers;
+  cnrtQueue_t queue = nullptr;        // of the api call, runs the copies
+  cnrtNotifier_t notifier = nullptr;  // placed after the copies
+  int device = -1;
+};
+
+bool asyncWriterOn();
+
+// Takes a slot of the writer queue, waiting for one or returning false when
+// the case must be dropped. Every successful call is followed by one
+// asyncWriterSubmit.
+bool asyncWriterReserve();
+
+// Enqueues a copy of size bytes at data to a pinned buffer on queue, without
+// synchronizing the queue. Returns false if the copy could not be started.
+bool asyncWriterCopy(CaseJob *job, cnrtQueue_t queue,
+                     const std::string &file_name, const void *data,
+                     size_t size, bool on_host);
+
+// Places the notifier of job behind its copies enqueued so far on queue.
+void asyncWriterMark(CaseJob *job, cnrtQueue_t queue);
+
+// Marks job on queue, unless queue is nullptr when every copy of job is
+// marked already, and hands it to the writer.
+void asyncWriterSubmit(std::unique_ptr<CaseJob> job, cnrtQueue_t queue);
+
+// Waits until every submitted case is on disk, also run at exit. Slots
+// reserved and not submitted yet are not waited for.
+void asyncWriterFlush();
+
+}  // namespace gen_case
+}  // namespace mluop
+
+#endif  // CORE_GEN_CASE_WRITER_H_
@@ -23,6 +23,7 @@
 #include <iomanip>
 #include <algorithm>
 #include <deque>
+#include <mutex>  // NOLINT
 #include "core/tensor.h"
 #include "core/logging.h"
 #include "core/type.h"
@@ -202,46 +203,287 @@ namespace {
 #define MLUOP_TENSOR_QUEUE_ENABLE 1
 
 #if MLUOP_TENSOR_QUEUE_ENABLE
-struct mluOpTensorDescriptorQueueStruct {
-  mluOpTensorDescriptorQueueStruct() {
-    extend(extend_num);
-    extend_num *= 2;
+/* Tensor descriptor pool.
+ *
+ * Descriptors are carved out of naturally aligned slabs, so the slab header
+ * (which records the thread that handed each slot out) can be found from a
+ * descriptor pointer by masking. Every thread owns a small cache of free
+ * descriptors and only talks to the global depot once per
+ * TENSOR_MAGAZINE_SIZE create/destroy calls, moving a whole magazine at a
+ * time. The depot keeps full and empty magazines on two lock-free stacks;
+ * a mutex is taken only when a new slab or magazine has to be allocated.
+ */
+constexpr size_t TENSOR_SLAB_BYTES = 64 * 1024;
+constexpr size_t TENSOR_MAGAZINE_SIZE = 32;
+constexpr size_t TENSOR_MAGAZINE_CHUNK = 1024;
+constexpr size_t TENSOR_MAGAZINE_CHUNK_NUM = 4096;
+constexpr uint32_t TENSOR_NULL_INDEX = 0xffffffffu;
+
+constexpr size_t TENSOR_SLAB_SLOT_NUM =
+    (TENSOR_SLAB_BYTES - alignof(mluOpTensorStruct)) /
+    (sizeof(mluOpTensorStruct) + sizeof(uint32_t));
+constexpr size_t TENSOR_SLAB_HEADER_BYTES =
+    (TENSOR_SLAB_SLOT_NUM * sizeof(uint32_t) + alignof(mluOpTensorStruct) -
+     1) /
+    alignof(mluOpTensorStruct) * alignof(mluOpTensorStruct);
+static_assert(TENSOR_SLAB_HEADER_BYTES +
+                      TENSOR_SLAB_SLOT_NUM * sizeof(mluOpTensorStruct) <=
+                  TENSOR_SLAB_BYTES,
+              "tensor descriptors do not fit into one slab");
+
+struct mluOpTensorSlabStruct {
+  inline mluOpTensorDescriptor_t slot(size_t i) {
+    return reinterpret_cast<mluOpTensorDescriptor_t>(
+               reinterpret_cast<char *>(this) + TENSOR_SLAB_HEADER_BYTES) +
+           i;
+  }
+  inline uint32_t &owner(mluOpTensorDescriptor_t desc) {
+    return owners[desc - slot(0)];
+  }
+  static inline mluOpTensorSlabStruct *of(mluOpTensorDescriptor_t desc) {
+    return reinterpret_cast<mluOpTensorSlabStruct *>(
+        reinterpret_cast<uintptr_t>(desc) & ~(TENSOR_SLAB_BYTES - 1));
+  }
+  uint32_t owners[TENSOR_SLAB_SLOT_NUM];
+};
+
+struct mluOpTensorMagazineStruct {
+  std::atomic<uint32_t> next{TENSOR_NULL_INDEX};
+  uint32_t index = TENSOR_NULL_INDEX;
+  size_t count = 0;
+  mluOpTensorDescriptor_t slots[TENSOR_MAGAZINE_SIZE];
+};
+
+struct mluOpTensorDescriptorCacheStruct;
+
+struct mluOpTensorDescriptorDepotStruct {
+  mluOpTensorDescriptorDepotStruct() = default;
+
+  // cleanup slabs and magazines
+  ~mluOpTensorDescriptorDepotStruct() {
+    alive.store(false, std::memory_order_release);
+    for (auto slab : slabs) {
+      free(slab);
+    }
+    for (auto &chunk : magazine_chunks) {
+      delete[] chunk.load(std::memory_order_relaxed);
+    }
   }
-  explicit mluOpTensorDescriptorQueueStruct(size_t n) {
-    extend_num = n;
-    extend(extend_num);
-    extend_num *= 2;
+
+  inline mluOpTensorMagazineStruct *at(uint32_t index) const {
+    return magazine_chunks[index / TENSOR_MAGAZINE_CHUNK].load(
+               std::memory_order_acquire) +
+           index % TENSOR_MAGAZINE_CHUNK;
   }
 
-  // cleanup headers
-  ~mluOpTensorDescriptorQueueStruct() {
-    for (auto header : headers) {
-      free(header);
+  // Treiber stack, the upper 32 bits of head are an ABA tag.
+  inline mluOpTensorMagazineStruct *pop(std::atomic<uint64_t> &head) {
+    uint64_t old_head = head.load(std::memory_order_acquire);
+    while (true) {
+      uint32_t index = static_cast<uint32_t>(old_head);
+      if (index == TENSOR_NULL_INDEX) {
+        return nullptr;
+      }
+      mluOpTensorMagazineStruct *magazine = at(index);
+      uint64_t new_head = (((old_head >> 32) + 1) << 32) |
+                          magazine->next.load(std::memory_order_relaxed);
+      if (head.compare_exchange_weak(old_head, new_head,
+                                     std::memory_order_acq_rel,
+                                     std::memory_order_acquire)) {
+        return magazine;
+      }
     }
   }
 
-  inline void lock() {
-    while (flag.test_and_set(std::memory_order_acquire)) {
+  inline void push(std::atomic<uint64_t> &head,
+                   mluOpTensorMagazineStruct *magazine) {
+    uint64_t old_head = head.load(std::memory_order_relaxed);
+    uint64_t new_head = 0;
+    do {
+      magazine->next.store(static_cast<uint32_t>(old_head),
+                           std::memory_order_relaxed);
+      new_head = (((old_head >> 32) + 1) << 32) | magazine->index;
+    } while (!head.compare_exchange_weak(old_head, new_head,
+                                         std::memory_order_release,
+                                         std::memory_order_relaxed));
+  }
+
+  // Caller must hold grow_mutex.
+  mluOpTensorMagazineStruct *newMagazine() {
+    auto magazine = pop(empty_head);
+    if (magazine != nullptr) {
+      return magazine;
     }
+    size_t chunk = magazine_num / TENSOR_MAGAZINE_CHUNK;
+    CHECK(chunk < TENSOR_MAGAZINE_CHUNK_NUM);
+    if (magazine_num % TENSOR_MAGAZINE_CHUNK == 0) {
+      auto magazines =
+          new (std::nothrow) mluOpTensorMagazineStruct[TENSOR_MAGAZINE_CHUNK];
+      CHECK(magazines != nullptr);
+      for (size_t i = 0; i < TENSOR_MAGAZINE_CHUNK; ++i) {
+        magazines[i].index = chunk * TENSOR_MAGAZINE_CHUNK + i;
+      }
+      magazine_chunks[chunk].store(magazines, std::memory_order_release);
+    }
+    return at(magazine_num++);
   }
-  inline void unlock() { flag.clear(std::memory_order_release); }
-  inline void extend(size_t n) {
-    auto header = malloc(sizeof(mluOpTensorStruct) * n);
-    for (size_t i = 0; i < n; ++i) {
-      queue.push_front((mluOpTensorDescriptor_t)header + i);
+
+  // Allocate one more slab, return its first magazine and publish the others.
+  mluOpTensorMagazineStruct *grow() {
+    std::lock_guard<std::mutex> guard(grow_mutex);
+    // another thread may have refilled the depot while we were waiting
+    auto magazine = pop(full_head);
+    if (magazine != nullptr) {
+      return magazine;
+    }
+    auto slab = static_cast<mluOpTensorSlabStruct *>(
+        aligned_alloc(TENSOR_SLAB_BYTES, TENSOR_SLAB_BYTES));
+    CHECK(slab != nullptr);
+    slabs.push_back(slab);
+    slab_num.fetch_add(1, std::memory_order_relaxed);
+    for (size_t begin = 0; begin < TENSOR_SLAB_SLOT_NUM;
+         begin += TENSOR_MAGAZINE_SIZE) {
+      auto filled = newMagazine();
+      filled->count =
+          std::min(TENSOR_MAGAZINE_SIZE, TENSOR_SLAB_SLOT_NUM - begin);
+      for (size_t i = 0; i < filled->count; ++i) {
+        filled->slots[i] = slab->slot(begin + i);
+      }
+      if (magazine == nullptr) {
+        magazine = filled;
+      } else {
+        push(full_head, filled);
+      }
     }
-    headers.push_back(header);
+    return magazine;
   }
-  size_t extend_num = 128;
-  std::deque<mluOpTensorDescriptor_t> queue;
-  std::vector<void *> headers;
-  std::atomic_flag flag = ATOMIC_FLAG_INIT;
+
+  inline void refill(mluOpTensorDescriptorCacheStruct *cache);
+  inline void release(mluOpTensorDescriptorCacheStruct *cache, size_t num);
+
+  std::atomic<uint64_t> full_head{TENSOR_NULL_INDEX};
+  std::atomic<uint64_t> empty_head{TENSOR_NULL_INDEX};
+  std::atomic<mluOpTensorMagazineStruct *>
+      magazine_chunks[TENSOR_MAGAZINE_CHUNK_NUM] = {};
+  size_t magazine_num = 0;
+  std::vector<void *> slabs;
+  std::mutex grow_mutex;
+
+  std::atomic<uint64_t> hits{0};
+  std::atomic<uint64_t> misses{0};
+  std::atomic<uint64_t> cross_thread_frees{0};
+  std::atomic<uint64_t> slab_num{0};
+  // stays readable after the depot is destroyed, see ~CacheStruct
+  static std::atomic<bool> alive;
 };
 
-static mluOpTensorDescriptorQueueStruct queue_array;
+std::atomic<bool> mluOpTensorDescriptorDepotStruct::alive{true};
+static mluOpTensorDescriptorDepotStruct depot;
+static std::atomic<uint32_t> next_cache_id{1};
+
+struct mluOpTensorDescriptorCacheStruct {
+  mluOpTensorDescriptorCacheStruct()
+      : id(next_cache_id.fetch_add(1, std::memory_order_relaxed)) {}
+
+  // hand every cached descriptor back to the depot when the thread exits
+  ~mluOpTensorDescriptorCacheStruct() {
+    if (!mluOpTensorDescriptorDepotStruct::alive.load(
+            std::memory_order_acquire)) {
+      return;
+    }
+    while (count > 0) {
+      depot.release(this, std::min(count, TENSOR_MAGAZINE_SIZE));
+    }
+    flushStats();
+  }
+
+  inline void flushStats() {
+    depot.hits.fetch_add(hits, std::memory_order_relaxed);
+    depot.misses.fetch_add(misses, std::memory_order_relaxed);
+    depot.cross_thread_frees.fetch_add(cross_thread_frees,
+                                       std::memory_order_relaxed);
+    hits = misses = cross_thread_frees = 0;
+  }
+
+  inline mluOpTensorDescriptor_t get() {
+    if MLUOP_PREDICT_FALSE (count == 0) {
+      ++misses;
+      depot.refill(this);
+    } else {
+      ++hits;
+    }
+    auto desc = slots[--count];
+    mluOpTensorSlabStruct::of(desc)->owner(desc) = id;
+    return ::new (desc) mluOpTensorStruct;
+  }
+
+  inline void put(mluOpTensorDescriptor_t desc) {
+    desc->~mluOpTensorStruct();
+    if MLUOP_PREDICT_FALSE (mluOpTensorSlabStruct::of(desc)->owner(desc) !=
+                            id) {
+      ++cross_thread_frees;
+    }
+    if MLUOP_PREDICT_FALSE (count == 2 * TENSOR_MAGAZINE_SIZE) {
+      depot.release(this, TENSOR_MAGAZINE_SIZE);
+    }
+    slots[count++] = desc;
+  }
+
+  uint32_t id;
+  size_t count = 0;
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t cross_thread_frees = 0;
+  mluOpTensorDescriptor_t slots[2 * TENSOR_MAGAZINE_SIZE];
+};
+
+inline void mluOpTensorDescriptorDepotStruct::refill(
+    mluOpTensorDescriptorCacheStruct *cache) {
+  auto magazine = pop(full_head);
+  if MLUOP_PREDICT_FALSE (magazine == nullptr) {
+    magazine = grow();
+  }
+  memcpy(cache->slots + cache->count, magazine->slots,
+         sizeof(mluOpTensorDescriptor_t) * magazine->count);
+  cache->count += magazine->count;
+  magazine->count = 0;
+  push(empty_head, magazine);
+  cache->flushStats();
+}
+
+inline void mluOpTensorDescriptorDepotStruct::release(
+    mluOpTensorDescriptorCacheStruct *cache, size_t num) {
+  auto magazine = pop(empty_head);
+  if MLUOP_PREDICT_FALSE (magazine == nullptr) {
+    std::lock_guard<std::mutex> guard(grow_mutex);
+    magazine = newMagazine();
+  }
+  cache->count -= num;
+  memcpy(magazine->slots, cache->slots + cache->count,
+         sizeof(mluOpTensorDescriptor_t) * num);
+  magazine->count = num;
+  push(full_head, magazine);
+  cache->flushStats();
+}
+
+static thread_local mluOpTensorDescriptorCacheStruct tensor_cache;
 #endif
 }  // anonymous namespace
 
+namespace mluop {
+void getTensorDescriptorPoolStats(TensorDescriptorPoolStats *stats) {
+#if MLUOP_TENSOR_QUEUE_ENABLE
+  stats->hits = depot.hits.load(std::memory_order_relaxed);
+  stats->misses = depot.misses.load(std::memory_order_relaxed);
+  stats->cross_thread_frees =
+      depot.cross_thread_frees.load(std::memory_order_relaxed);
+  stats->slab_num = depot.slab_num.load(std::memory_order_relaxed);
+#else
+  *stats = TensorDescriptorPoolStats();
+#endif
+}
+}  // namespace mluop
+
 void mluOpTensorStruct::setTensorDescriptorDimBase(int dimNb) {
   if (dimNb != this->dim) {
     if MLUOP_PREDICT_FALSE (this->dims != this->normal_dims) {
@@ -560,14 +802,7 @@ mluOpStatus_t MLUOP_WIN_API
 mluOpCreateTensorDescriptor(mluOpTensorDescriptor_t *desc) {
   PARAM_CHECK("[mluOpCreateTensorDescriptor]", desc != NULL);
 #if MLUOP_TENSOR_QUEUE_ENABLE
-  queue_array.lock();
-  if MLUOP_PREDICT_FALSE (queue_array.queue.empty()) {
-    queue_array.extend(queue_array.extend_num);
-    queue_array.extend_num *= 2;
-  }
-  *desc = ::new (queue_array.queue.front()) mluOpTensorStruct;
-  queue_array.queue.pop_front();
-  queue_array.unlock();
+  *desc = tensor_cache.get();
 #else
   mluOpTensorStruct *ts = new (std::nothrow) mluOpTensorStruct;
   *desc = ts;
@@ -579,17 +814,9 @@ mluOpStatus_t MLUOP_WIN_API mluOpCreateGroupTensorDescriptors(
   PARAM_CHECK("[mluOpCreateGroupTensorDescriptors]", group_desc != NULL);
   PARAM_CHECK("[mluOpCreateGroupTensorDescriptors]", desc_num > 0);
 #if MLUOP_TENSOR_QUEUE_ENABLE
-  queue_array.lock();
-  if MLUOP_PREDICT_FALSE (queue_array.queue.size() < desc_num) {
-    queue_array.extend(std::max(queue_array.extend_num, (size_t)desc_num));
-    queue_array.extend_num =
-        2 * std::max(queue_array.extend_num, (size_t)desc_num);
-  }
   for (int i = 0; i < desc_num; ++i) {
-    *(group_desc[i]) = queue_array.queue.front();
-    queue_array.queue.pop_front();
+    *(group_desc[i]) = tensor_cache.get();
   }
-  queue_array.unlock();
 #else
   for (int i = 0; i < desc_num; ++i) {
     mluOpTensorStruct *ts = new (std::nothrow) mluOpTensorStruct;
@@ -818,10 +1045,7 @@ mluOpDestroyTensorDescriptor(mluOpTensorDescriptor_t desc) {
   PARAM_CHECK("[mluOpDestroyTensorDescriptor]", desc != NULL);
 
 #if MLUOP_TENSOR_QUEUE_ENABLE
-  queue_array.lock();
-  desc->~mluOpTensorStruct();
-  queue_array.queue.push_front(desc);
-  queue_array.unlock();
+  tensor_cache.put(desc);
 #else
   delete desc;
 #endif
@@ -835,12 +1059,9 @@ mluOpStatus_t MLUOP_WIN_API mluOpDestroyGroupTensorDescriptors(
   PARAM_CHECK("[mluOpDestroyGroupTensorDescriptors]", desc_num > 0);
 
 #if MLUOP_TENSOR_QUEUE_ENABLE
-  queue_array.lock();
   for (int i = 0; i < desc_num; ++i) {
-    group_desc[i][0]->~mluOpTensorStruct();
-    queue_array.queue.push_front(group_desc[i][0]);
+    tensor_cache.put(group_desc[i][0]);
   }
-  queue_array.unlock();
 #else
   for (int i = 0; i < desc_num; ++i) {
     delete group_desc[i][0];
@@ -598,6 +598,20 @@ inline bool mluOpTensorStruct::isCpuScalar() const {
   }
   return false;
 }
+namespace mluop {
+// Counters of the descriptor pool behind mluOpCreateTensorDescriptor.
+// Per-thread counters are folded in whenever a thread exchanges a magazine
+// with the global depot and when the thread exits.
+struct TensorDescriptorPoolStats {
+  uint64_t hits = 0;                // served from the thread local cache
+  uint64_t misses = 0;              // had to refill from the global depot
+  uint64_t cross_thread_frees = 0;  // destroyed by another thread
+  uint64_t slab_num = 0;            // slabs allocated so far
+};
+
+void getTensorDescriptorPoolStats(TensorDescriptorPoolStats *stats);
+}  // namespace mluop
+
 // Attention: Do not put operator data structures in this header file.
 
 #endif  // CORE_TENSOR_H_
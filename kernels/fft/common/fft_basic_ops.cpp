@@ -108,7 +108,7 @@ mluOpStatus_t fftGetMatMulWorkspaceSize(mluOpHandle_t handle,
   cnnlDataType_t cnnl_compute_type = CNNL_DTYPE_FLOAT;  // (TODO)
 
   DEFINE_CREATE_AND_SET_CNNL_TENSOR_DESCRIPTOR(c_desc, cnnl_d_desc);
-  CALL_CNNL(cnnlCreateMatMulDescriptor(&matmul_desc));
+  CALL_CNNL(mluOpAcquireCnnlMatMulDescriptor(handle, &matmul_desc));
   CALL_CNNL(cnnlSetMatMulDescAttr(matmul_desc, CNNL_MATMUL_DESC_TRANSA,
                                   &trans_a_int, sizeof(int32_t)));
   CALL_CNNL(cnnlSetMatMulDescAttr(matmul_desc, CNNL_MATMUL_DESC_TRANSB,
@@ -129,7 +129,7 @@ mluOpStatus_t fftGetMatMulWorkspaceSize(mluOpHandle_t handle,
   CALL_CNNL(cnnlGetMatMulHeuristicResult(heuristic_result, matmul_algo,
                                          &workspace_size));
   DESTROY_CNNL_TENSOR_DESCRIPTOR(cnnl_d_desc);
-  CALL_CNNL(cnnlDestroyMatMulDescriptor(matmul_desc));
+  CALL_CNNL(mluOpReleaseCnnlMatMulDescriptor(handle, matmul_desc));
   CALL_CNNL(cnnlDestroyMatMulAlgo(matmul_algo));
   CALL_CNNL(cnnlDestroyMatMulHeuristicResult(heuristic_result));
   status = mluOpDestroyTensorDescriptor(a_desc);
@@ -222,7 +222,7 @@ mluOpStatus_t fftMatMul(mluOpHandle_t handle, int m, int k, int n, void *a_ptr,
   bool allow_tf32 = false;
   cnnlDataType_t cnnl_compute_type = CNNL_DTYPE_FLOAT;  // (TODO)
 
-  CALL_CNNL(cnnlCreateMatMulDescriptor(&matmul_desc));
+  CALL_CNNL(mluOpAcquireCnnlMatMulDescriptor(handle, &matmul_desc));
   CALL_CNNL(cnnlSetMatMulDescAttr(matmul_desc, CNNL_MATMUL_DESC_TRANSA,
                                   &trans_a_int, sizeof(int32_t)));
   CALL_CNNL(cnnlSetMatMulDescAttr(matmul_desc, CNNL_MATMUL_DESC_TRANSB,
@@ -247,7 +247,7 @@ mluOpStatus_t fftMatMul(mluOpHandle_t handle, int m, int k, int n, void *a_ptr,
                           cnnl_c_desc, c_ptr, workspace, workspace_size,
                           cnnl_d_desc, c_ptr));
   DESTROY_CNNL_TENSOR_DESCRIPTOR(cnnl_d_desc);
-  CALL_CNNL(cnnlDestroyMatMulDescriptor(matmul_desc));
+  CALL_CNNL(mluOpReleaseCnnlMatMulDescriptor(handle, matmul_desc));
   CALL_CNNL(cnnlDestroyMatMulAlgo(matmul_algo));
   CALL_CNNL(cnnlDestroyMatMulHeuristicResult(heuristic_result));
 
@@ -334,7 +334,7 @@ mluOpStatus_t fftGetBatchMatMulBcastWorkspaceSize(
   CALL_CNNL(cnnlCreateMatMulAlgo(&algo));
   cnnlMatMulDescriptor_t bmm_bcast_desc;
   bool use_stride = false;
-  CALL_CNNL(cnnlCreateMatMulDescriptor(&bmm_bcast_desc));
+  CALL_CNNL(mluOpAcquireCnnlMatMulDescriptor(handle, &bmm_bcast_desc));
   CALL_CNNL(cnnlSetMatMulDescAttr(bmm_bcast_desc, CNNL_MATMUL_DESC_TRANSA,
                                   &trans_a_int, sizeof(int32_t)));
   CALL_CNNL(cnnlSetMatMulDescAttr(bmm_bcast_desc, CNNL_MATMUL_DESC_TRANSB,
@@ -358,7 +358,7 @@ mluOpStatus_t fftGetBatchMatMulBcastWorkspaceSize(
   DESTROY_CNNL_TENSOR_DESCRIPTOR(cnnl_a_desc);
   DESTROY_CNNL_TENSOR_DESCRIPTOR(cnnl_b_desc);
   DESTROY_CNNL_TENSOR_DESCRIPTOR(cnnl_c_desc);
-  CALL_CNNL(cnnlDestroyMatMulDescriptor(bmm_bcast_desc));
+  CALL_CNNL(mluOpReleaseCnnlMatMulDescriptor(handle, bmm_bcast_desc));
   CALL_CNNL(cnnlDestroyMatMulAlgo(algo));
   CALL_CNNL(cnnlDestroyMatMulHeuristicResult(heuristic_result));
 
@@ -436,7 +436,7 @@ mluOpStatus_t fftBatchMatMulBcast(
   CALL_CNNL(cnnlCreateMatMulAlgo(&algo));
   cnnlMatMulDescriptor_t bmm_bcast_desc;
   bool use_stride = false;
-  CALL_CNNL(cnnlCreateMatMulDescriptor(&bmm_bcast_desc));
+  CALL_CNNL(mluOpAcquireCnnlMatMulDescriptor(handle, &bmm_bcast_desc));
   CALL_CNNL(cnnlSetMatMulDescAttr(bmm_bcast_desc, CNNL_MATMUL_DESC_TRANSA,
                                   &trans_a_int, sizeof(int32_t)));
   CALL_CNNL(cnnlSetMatMulDescAttr(bmm_bcast_desc, CNNL_MATMUL_DESC_TRANSB,
@@ -472,7 +472,7 @@ mluOpStatus_t fftBatchMatMulBcast(
   DESTROY_CNNL_TENSOR_DESCRIPTOR(cnnl_a_desc);
   DESTROY_CNNL_TENSOR_DESCRIPTOR(cnnl_b_desc);
   DESTROY_CNNL_TENSOR_DESCRIPTOR(cnnl_c_desc);
-  CALL_CNNL(cnnlDestroyMatMulDescriptor(bmm_bcast_desc));
+  CALL_CNNL(mluOpReleaseCnnlMatMulDescriptor(handle, bmm_bcast_desc));
   CALL_CNNL(cnnlDestroyMatMulAlgo(algo));
   CALL_CNNL(cnnlDestroyMatMulHeuristicResult(heuristic_result));
 
@@ -493,7 +493,7 @@ mluOpStatus_t fftGetTransposeWorkspaceSize(mluOpHandle_t handle,
   CHECK_RETURN(api, status);
 
   cnnlTransposeDescriptor_t trans_desc = nullptr;
-  CALL_CNNL(cnnlCreateTransposeDescriptor(&trans_desc));
+  CALL_CNNL(mluOpAcquireCnnlTransposeDescriptor(handle, &trans_desc));
 
   DEFINE_CREATE_AND_SET_CNNL_HANDLE(handle,
                                     cnnl_handle);  // convert to cnnl_handle
@@ -511,7 +511,7 @@ mluOpStatus_t fftGetTransposeWorkspaceSize(mluOpHandle_t handle,
   CHECK_RETURN(api, status);
   // destroy descriptor
   DESTROY_CNNL_TENSOR_DESCRIPTOR(cnnl_input_desc);
-  CALL_CNNL(cnnlDestroyTransposeDescriptor(trans_desc));
+  CALL_CNNL(mluOpReleaseCnnlTransposeDescriptor(handle, trans_desc));
   DESTROY_CNNL_HANDLE(cnnl_handle);
   return status;
 }
@@ -552,7 +552,7 @@ mluOpStatus_t fftTranspose(mluOpHandle_t handle, int dim_num,
                                                   cnnl_transed_input_desc);
   // compute transpose
   cnnlTransposeDescriptor_t trans_desc = nullptr;
-  CALL_CNNL(cnnlCreateTransposeDescriptor(&trans_desc));
+  CALL_CNNL(mluOpAcquireCnnlTransposeDescriptor(handle, &trans_desc));
   CALL_CNNL(cnnlSetTransposeDescriptor(trans_desc, dim_num, permute));
 
   CALL_CNNL(cnnlTranspose_v2(cnnl_handle, trans_desc, cnnl_input_desc, ori_ptr,
@@ -564,7 +564,7 @@ mluOpStatus_t fftTranspose(mluOpHandle_t handle, int dim_num,
   // destroy descriptor
   DESTROY_CNNL_TENSOR_DESCRIPTOR(cnnl_input_desc);
   DESTROY_CNNL_TENSOR_DESCRIPTOR(cnnl_transed_input_desc);
-  CALL_CNNL(cnnlDestroyTransposeDescriptor(trans_desc));
+  CALL_CNNL(mluOpReleaseCnnlTransposeDescriptor(handle, trans_desc));
 
   DESTROY_CNNL_HANDLE(cnnl_handle);
 
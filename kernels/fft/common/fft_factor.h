@@ -0,0 +1,68 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef KERNELS_FFT_COMMON_FFT_FACTOR_H_
+#define KERNELS_FFT_COMMON_FFT_FACTOR_H_
+
+// Radix of the next stage of a length _n transform when n of it is left,
+// as chosen by fftFactor: a tuned pair or triple for the sizes listed below,
+// the whole length up to 64, otherwise the largest divisor of n up to 64.
+// Returns 0 when no radix divides n, i.e. all prime factors of n are above
+// 64. Header-only so that host references can factor lengths the same way.
+inline int fftFactorRadix(const int _n, const int n) {
+  struct TunedRadix {
+    int len;
+    int radix[3];
+  };
+  static const TunedRadix tuned[] = {
+      {128, {16, 8, 0}},   {12, {4, 3, 0}},      {140, {14, 10, 0}},
+      {160, {16, 10, 0}},  {200, {20, 10, 0}},   {275, {25, 11, 0}},
+      {280, {20, 14, 0}},  {256, {32, 8, 0}},    {300, {30, 10, 0}},
+      {320, {20, 16, 0}},  {350, {25, 14, 0}},   {400, {25, 16, 0}},
+      {500, {25, 20, 0}},  {32 * 17, {32, 17, 0}}, {600, {30, 20, 0}},
+      {650, {25, 26, 0}},  {512, {64, 8, 0}},    {1024, {32, 0, 0}},
+      {2048, {16, 8, 0}},  {4096, {16, 0, 0}},   {6000, {30, 20, 10}},
+      {7000, {50, 14, 10}},
+  };
+  for (const TunedRadix &t : tuned) {
+    if (t.len != _n) {
+      continue;
+    }
+    for (int r : t.radix) {
+      if (r > 0 && n % r == 0) {
+        return r;
+      }
+    }
+    return 0;
+  }
+  if (_n <= 64) {
+    return _n;
+  }
+  for (int r = 64; r > 1; r--) {
+    if (n % r == 0) {
+      return r;
+    }
+  }
+  return 0;
+}
+
+#endif  // KERNELS_FFT_COMMON_FFT_FACTOR_H_
@@ -0,0 +1,148 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include "kernels/fft/common/fft_host_sincos.h"
+
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <mutex>               // NOLINT
+#include <thread>              // NOLINT
+#include "core/tool.h"
+
+// Upper bound of host threads used by default, plan creation should not
+// take over a machine shared by several processes.
+#define FFT_HOST_THREAD_NUM_MAX 8
+
+namespace mluop {
+namespace fft {
+namespace {
+
+class HostWorkerPool {
+ public:
+  explicit HostWorkerPool(size_t thread_num) : worker_num_(thread_num - 1) {
+    for (size_t i = 0; i < worker_num_; i++) {
+      std::thread(&HostWorkerPool::work, this).detach();
+    }
+  }
+
+  // Never destroyed: detached workers may still wait on the members at exit.
+  static HostWorkerPool &instance() {
+    static HostWorkerPool *pool = new HostWorkerPool(threadNum());
+    return *pool;
+  }
+
+  void run(size_t task_num, const std::function<void(size_t)> &task) {
+    // plans made concurrently by several threads do not queue up behind
+    // each other, the ones not getting the pool run on their own thread
+    std::unique_lock<std::mutex> busy(run_mutex_, std::try_to_lock);
+    if (worker_num_ == 0 || task_num <= 1 || !busy.owns_lock()) {
+      for (size_t i = 0; i < task_num; i++) {
+        task(i);
+      }
+      return;
+    }
+
+    Job job(task, task_num);
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      job_ = &job;
+      ++generation_;
+    }
+    wake_.notify_all();
+    drain(&job);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [&] { return job.done == task_num && job.users == 0; });
+    job_ = nullptr;
+  }
+
+ private:
+  struct Job {
+    Job(const std::function<void(size_t)> &task, size_t task_num)
+        : task(task), task_num(task_num) {}
+    const std::function<void(size_t)> &task;
+    const size_t task_num;
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> done{0};
+    size_t users = 0;  // workers inside drain(), guarded by mutex_
+  };
+
+  static size_t threadNum() {
+    size_t hardware = std::max(1u, std::thread::hardware_concurrency());
+    size_t num = mluop::getUintEnvVar(
+        "MLUOP_FFT_HOST_THREAD_NUM",
+        std::min<size_t>(hardware, FFT_HOST_THREAD_NUM_MAX));
+    return std::max<size_t>(1, num);
+  }
+
+  void drain(Job *job) {
+    size_t i;
+    while ((i = job->next.fetch_add(1)) < job->task_num) {
+      job->task(i);
+      if (job->done.fetch_add(1) + 1 == job->task_num) {
+        std::lock_guard<std::mutex> guard(mutex_);
+        done_.notify_all();
+      }
+    }
+  }
+
+  void work() {
+    uint64_t seen = 0;
+    while (true) {
+      Job *job = nullptr;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait(lock, [&] { return generation_ != seen; });
+        seen = generation_;
+        job = job_;
+        if (job == nullptr) {
+          continue;
+        }
+        ++job->users;
+      }
+      drain(job);
+      {
+        std::lock_guard<std::mutex> guard(mutex_);
+        --job->users;
+      }
+      done_.notify_all();
+    }
+  }
+
+  const size_t worker_num_;
+  std::mutex run_mutex_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  Job *job_ = nullptr;
+  uint64_t generation_ = 0;
+};
+
+}  // anonymous namespace
+
+void hostParallelFor(size_t task_num,
+                     const std::function<void(size_t)> &task) {
+  HostWorkerPool::instance().run(task_num, task);
+}
+
+}  // namespace fft
+}  // namespace mluop
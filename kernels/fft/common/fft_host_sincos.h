@@ -0,0 +1,179 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef KERNELS_FFT_COMMON_FFT_HOST_SINCOS_H_
+#define KERNELS_FFT_COMMON_FFT_HOST_SINCOS_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Number of consecutive elements rotated together, sized so that the
+// recurrence below maps onto full SIMD registers of doubles.
+#define FFT_SINCOS_LANES 8
+// Recurrence steps between two exact evaluations. The rotation error grows
+// linearly with the steps, 64 keeps it around 1e-14, far below float eps.
+#define FFT_SINCOS_RESYNC 64
+// Elements handled by one host task, and the smallest table worth threads.
+#define FFT_SINCOS_GRAIN (16 * 1024)
+#define FFT_SINCOS_PARALLEL_MIN (64 * 1024)
+
+namespace mluop {
+namespace fft {
+
+// Runs task(0) ... task(task_num - 1) on the bounded host worker pool of FFT
+// plan creation. The calling thread takes part and the call returns when all
+// tasks are done. MLUOP_FFT_HOST_THREAD_NUM bounds the number of threads, 1
+// runs everything on the calling thread.
+void hostParallelFor(size_t task_num, const std::function<void(size_t)> &task);
+
+// One row of a twiddle or DFT table:
+//   re[t * stride] = scale_re * cos(2 * pi * (t * step mod n) / n)
+//   im[t * stride] = scale_im * sign * sin(2 * pi * (t * step mod n) / n)
+// for t in [0, count).
+template <typename DT>
+struct SincosLine {
+  DT *re;
+  DT *im;
+  int64_t count;
+  int64_t step;
+  int64_t n;
+  int64_t stride;
+  int sign;
+  double scale_re;
+  double scale_im;
+};
+
+inline void exactUnitRoot(const int64_t index, const int64_t n, const int sign,
+                          double *c, double *s) {
+  const double phase = 2.0 * 3.1415926535897932384626433832795 *
+                       (double)index / (double)n;
+  *c = std::cos(phase);
+  *s = sign * std::sin(phase);
+}
+
+// Fills elements [begin, end) of a line. Every FFT_SINCOS_LANES * RESYNC
+// elements the lanes are reloaded from exact sin/cos of the integer-reduced
+// angle, in between they are advanced by a complex rotation, which turns
+// the per-element libm calls into a few multiply-adds the compiler
+// vectorizes.
+template <typename DT>
+void fillSincosLine(const SincosLine<DT> &line, int64_t begin,
+                    const int64_t end) {
+  const int64_t n = line.n;
+  const int64_t step = line.step % n;
+  double rot_c, rot_s;
+  exactUnitRoot((FFT_SINCOS_LANES * step) % n, n, line.sign, &rot_c, &rot_s);
+
+  double c[FFT_SINCOS_LANES], s[FFT_SINCOS_LANES];
+  while (begin < end) {
+    const int64_t index = ((begin % n) * step) % n;
+    for (int l = 0; l < FFT_SINCOS_LANES; l++) {
+      exactUnitRoot((index + l * step) % n, n, line.sign, c + l, s + l);
+    }
+    const int64_t block_end =
+        std::min(end, begin + FFT_SINCOS_LANES * FFT_SINCOS_RESYNC);
+    for (; begin + FFT_SINCOS_LANES <= block_end; begin += FFT_SINCOS_LANES) {
+      DT *re = line.re + begin * line.stride;
+      DT *im = line.im + begin * line.stride;
+      for (int l = 0; l < FFT_SINCOS_LANES; l++) {
+        re[l * line.stride] = (DT)(line.scale_re * c[l]);
+        im[l * line.stride] = (DT)(line.scale_im * s[l]);
+      }
+      for (int l = 0; l < FFT_SINCOS_LANES; l++) {
+        const double next_c = c[l] * rot_c - s[l] * rot_s;
+        s[l] = c[l] * rot_s + s[l] * rot_c;
+        c[l] = next_c;
+      }
+    }
+    for (int l = 0; begin < block_end; l++, begin++) {
+      line.re[begin * line.stride] = (DT)(line.scale_re * c[l]);
+      line.im[begin * line.stride] = (DT)(line.scale_im * s[l]);
+    }
+  }
+}
+
+// Collects the lines of one or more tables and generates them in one go, so
+// that the small stages of a plan share tasks and the large ones are split
+// by butterfly across the host workers.
+template <typename DT>
+class SincosBatch {
+ public:
+  void add(DT *re, DT *im, const int64_t count, const int64_t step,
+           const int64_t n, const int sign, const int64_t stride = 1,
+           const double scale_re = 1.0, const double scale_im = 1.0) {
+    if (count > 0) {
+      lines_.push_back(
+          {re, im, count, step, n, stride, sign, scale_re, scale_im});
+      total_ += count;
+    }
+  }
+
+  void run() {
+    if (total_ < FFT_SINCOS_PARALLEL_MIN) {
+      for (const auto &line : lines_) {
+        fillSincosLine(line, 0, line.count);
+      }
+    } else {
+      // split long lines, then pack consecutive pieces into tasks
+      std::vector<Piece> pieces;
+      std::vector<size_t> task_begin;
+      int64_t task_size = FFT_SINCOS_GRAIN;
+      for (size_t i = 0; i < lines_.size(); i++) {
+        for (int64_t b = 0; b < lines_[i].count; b += FFT_SINCOS_GRAIN) {
+          const int64_t e = std::min(lines_[i].count, b + FFT_SINCOS_GRAIN);
+          if (task_size >= FFT_SINCOS_GRAIN) {
+            task_begin.push_back(pieces.size());
+            task_size = 0;
+          }
+          pieces.push_back({i, b, e});
+          task_size += e - b;
+        }
+      }
+      task_begin.push_back(pieces.size());
+      hostParallelFor(task_begin.size() - 1, [&](size_t task) {
+        for (size_t p = task_begin[task]; p < task_begin[task + 1]; p++) {
+          fillSincosLine(lines_[pieces[p].line], pieces[p].begin,
+                         pieces[p].end);
+        }
+      });
+    }
+    lines_.clear();
+    total_ = 0;
+  }
+
+ private:
+  struct Piece {
+    size_t line;
+    int64_t begin;
+    int64_t end;
+  };
+  std::vector<SincosLine<DT>> lines_;
+  int64_t total_ = 0;
+};
+
+}  // namespace fft
+}  // namespace mluop
+
+#endif  // KERNELS_FFT_COMMON_FFT_HOST_SINCOS_H_
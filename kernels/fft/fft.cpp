@@ -22,6 +22,8 @@
  *************************************************************************/
 #include <string>
 #include "kernels/fft/fft.h"
+#include "kernels/fft/common/fft_factor.h"
+#include "kernels/fft/common/fft_host_sincos.h"
 #include "kernels/fft/rfft/rfft.h"
 #include "kernels/fft/irfft/irfft.h"
 #include "kernels/fft/c2c_fft/c2c_fft.h"
@@ -116,61 +118,66 @@ mluOpStatus_t MLUOP_WIN_API mluOpCreateFFTPlan(mluOpFFTPlan_t *fft_plan) {
 template <typename DT>
 mluOpStatus_t MLUOP_WIN_API fftGenerateTwiddlesLine(
     void *_twiddles, const int butterfly_num, const int section_num,
-    const int radix, const int nfft, const int dir) {
-  int j, k;
-  DT phase;
+    const int radix, const int nfft, const int dir,
+    mluop::fft::SincosBatch<DT> *batch = nullptr) {
+  mluop::fft::SincosBatch<DT> local_batch;
+  mluop::fft::SincosBatch<DT> &lines = batch ? *batch : local_batch;
   DT *twiddles = (DT *)_twiddles;
   const int sign = (dir == FFT_FORWARD) ? -1 : 1;
-  for (j = 0; j < butterfly_num; j++) {
-    // phase = 1 when k = 0
-    for (k = 1; k < radix; k++) {
-      phase = sign * 2 * (DT)FFT_PI * section_num * k * j / nfft;
-      twiddles[(butterfly_num * (k - 1) + j)] = (DT)cos(phase);  // r
-      twiddles[(butterfly_num * (k - 1) + j) + butterfly_num * (radix - 1)] =
-          (DT)sin(phase);  // i
-    }                      // radix
-  }                        // butterfly_num
+  // phase = 1 when k = 0
+  for (int k = 1; k < radix; k++) {
+    // twiddles[k - 1][j] = exp(sign * i * 2 * pi * section_num * k * j / nfft)
+    DT *line = twiddles + butterfly_num * (k - 1);
+    lines.add(line, line + butterfly_num * (radix - 1), butterfly_num,
+              (int64_t)section_num * k, nfft, sign);
+  }  // radix
+  if (batch == nullptr) {
+    local_batch.run();
+  }
   return MLUOP_STATUS_SUCCESS;
 }
 
 template <typename DT>
 mluOpStatus_t MLUOP_WIN_API fftGenerateR2CTwiddlesLine(
     void *_twiddles, const int butterfly_num, const int section_num,
-    const int radix, const int nfft, const int dir) {
-  int j, k;
-  DT phase;
+    const int radix, const int nfft, const int dir,
+    mluop::fft::SincosBatch<DT> *batch = nullptr) {
+  mluop::fft::SincosBatch<DT> local_batch;
+  mluop::fft::SincosBatch<DT> &lines = batch ? *batch : local_batch;
   DT *twiddles = (DT *)_twiddles;
+  const int half_butterfly_num = (butterfly_num + 2) / 2;
   const int sign = (dir == FFT_FORWARD) ? -1 : 1;
-  for (j = 0; j < (butterfly_num + 2) / 2; j++) {
-    // phase = 1 when k = 0
-    for (k = 1; k < radix; k++) {
-      phase = sign * 2 * (DT)FFT_PI * section_num * k * j / nfft;
-      twiddles[(((butterfly_num + 2) / 2) * (k - 1) + j)] =
-          (DT)cos(phase);  // r
-      twiddles[(((butterfly_num + 2) / 2) * (k - 1) + j) +
-               ((butterfly_num + 2) / 2) * (radix - 1)] = (DT)sin(phase);  // i
-    }  // radix
-  }    // butterfly_num
+  // phase = 1 when k = 0
+  for (int k = 1; k < radix; k++) {
+    DT *line = twiddles + half_butterfly_num * (k - 1);
+    lines.add(line, line + half_butterfly_num * (radix - 1),
+              half_butterfly_num, (int64_t)section_num * k, nfft, sign);
+  }  // radix
+  if (batch == nullptr) {
+    local_batch.run();
+  }
   return MLUOP_STATUS_SUCCESS;
 }
 
 template <typename DT>
 mluOpStatus_t MLUOP_WIN_API fftGenerateTwiddlesLineColumn(
     void *_twiddles, const int butterfly_num, const int section_num,
-    const int radix, const int nfft, const int dir) {
-  int j, k;
-  DT phase;
+    const int radix, const int nfft, const int dir,
+    mluop::fft::SincosBatch<DT> *batch = nullptr) {
+  mluop::fft::SincosBatch<DT> local_batch;
+  mluop::fft::SincosBatch<DT> &lines = batch ? *batch : local_batch;
   DT *twiddles = (DT *)_twiddles;
   const int sign = (dir == FFT_FORWARD) ? -1 : 1;
-  for (j = 1; j < radix; j++) {
-    // phase = 1 when k = 0
-    for (k = 0; k < butterfly_num; k++) {
-      phase = sign * 2 * (DT)FFT_PI * section_num * k * j / nfft;
-      twiddles[((radix - 1) * k + (j - 1))] = (DT)cos(phase);  // r
-      twiddles[((radix - 1) * k + (j - 1)) + butterfly_num * (radix - 1)] =
-          (DT)sin(phase);  // i
-    }                      // radix
-  }                        // butterfly_num
+  // phase = 1 when j = 0
+  for (int j = 1; j < radix; j++) {
+    // twiddles[k][j - 1], strided by radix - 1 along the butterflies
+    DT *line = twiddles + (j - 1);
+    lines.add(line, line + butterfly_num * (radix - 1), butterfly_num,
+              (int64_t)section_num * j, nfft, sign, radix - 1);
+  }  // radix
+  if (batch == nullptr) {
+    local_batch.run();
+  }
   return MLUOP_STATUS_SUCCESS;
 }
 
@@ -186,6 +193,8 @@ mluOpStatus_t MLUOP_WIN_API fftGenerateTwiddles(mluOpFFTPlan_t fft_plan,
       cnrtHostMalloc((void **)&twiddles,
                      (_nfft * 2 * 2) * sizeof(DT)));  // complex *2(large+small)
   _twiddles = twiddles;
+  // all stages are generated together by the host workers
+  mluop::fft::SincosBatch<DT> lines;
   int stage_count = factors[0];
   int cur_large_radix, cur_small_radix, section_num, butterfly_num,
       loop_stage;  // current radix
@@ -199,7 +208,7 @@ mluOpStatus_t MLUOP_WIN_API fftGenerateTwiddles(mluOpFFTPlan_t fft_plan,
     butterfly_num = factors[5 * loop_stage + 2];
 
     fftGenerateTwiddlesLine<DT>(twiddles, butterfly_num, section_num,
-                                cur_large_radix, _nfft, dir);
+                                cur_large_radix, _nfft, dir, &lines);
 
     twiddles += butterfly_num * (cur_large_radix - 1) * 2;
     tw_offset += butterfly_num * (cur_large_radix - 1);
@@ -218,7 +227,8 @@ mluOpStatus_t MLUOP_WIN_API fftGenerateTwiddles(mluOpFFTPlan_t fft_plan,
       section_num = factors[small_factors_offset + 4 * small_loop_stage + 1];
       butterfly_num = factors[small_factors_offset + 4 * small_loop_stage + 2];
       fftGenerateTwiddlesLine<DT>(twiddles, butterfly_num, section_num,
-                                  cur_small_radix, cur_large_radix, dir);
+                                  cur_small_radix, cur_large_radix, dir,
+                                  &lines);
       twiddles += butterfly_num * (cur_small_radix - 1) * 2;
       tw_offset +=
           butterfly_num * (cur_small_radix - 1);  // complex element offset
@@ -227,6 +237,7 @@ mluOpStatus_t MLUOP_WIN_API fftGenerateTwiddles(mluOpFFTPlan_t fft_plan,
         (tw_offset - factors[small_factors_offset + 1]) * sizeof(DT) * 2;
   }  // stage_count
 
+  lines.run();
   _twiddles_end = (void *)((DT *)_twiddles + tw_offset * 2);
   return MLUOP_STATUS_SUCCESS;
 }
@@ -244,6 +255,8 @@ mluOpStatus_t MLUOP_WIN_API fftGenerateR2CTwiddles(void *&_twiddles,
                      (_nfft * 2 * 2) * sizeof(DT)));  // complex *2(large+small)
 
   _twiddles = twiddles;
+  // all stages are generated together by the host workers
+  mluop::fft::SincosBatch<DT> lines;
   int stage_count = factors[0];
   int cur_large_radix, cur_small_radix, section_num, butterfly_num,
       loop_stage;  // current radix
@@ -257,7 +270,7 @@ mluOpStatus_t MLUOP_WIN_API fftGenerateR2CTwiddles(void *&_twiddles,
     butterfly_num = factors[5 * loop_stage + 2];
 
     fftGenerateR2CTwiddlesLine<DT>(twiddles, butterfly_num, section_num,
-                                   cur_large_radix, _nfft, dir);
+                                   cur_large_radix, _nfft, dir, &lines);
     twiddles += ((butterfly_num + 2) / 2) * (cur_large_radix - 1) * 2;
     tw_offset += ((butterfly_num + 2) / 2) * (cur_large_radix - 1);
   }  // stage_count
@@ -277,7 +290,8 @@ mluOpStatus_t MLUOP_WIN_API fftGenerateR2CTwiddles(void *&_twiddles,
         butterfly_num =
             factors[small_factors_offset + 4 * small_loop_stage + 2];
         fftGenerateR2CTwiddlesLine<DT>(twiddles, butterfly_num, section_num,
-                                       cur_small_radix, cur_large_radix, dir);
+                                       cur_small_radix, cur_large_radix, dir,
+                                       &lines);
         twiddles += ((butterfly_num + 2) / 2) * (cur_small_radix - 1) * 2;
         tw_offset += ((butterfly_num + 2) / 2) *
                      (cur_small_radix - 1);  // complex element offset
@@ -290,7 +304,8 @@ mluOpStatus_t MLUOP_WIN_API fftGenerateR2CTwiddles(void *&_twiddles,
         butterfly_num =
             factors[small_factors_offset + 4 * small_loop_stage + 2];
         fftGenerateTwiddlesLine<DT>(twiddles, butterfly_num, section_num,
-                                    cur_small_radix, cur_large_radix, dir);
+                                    cur_small_radix, cur_large_radix, dir,
+                                    &lines);
         twiddles += butterfly_num * (cur_small_radix - 1) * 2;
         tw_offset +=
             butterfly_num * (cur_small_radix - 1);  // complex element offset
@@ -299,6 +314,7 @@ mluOpStatus_t MLUOP_WIN_API fftGenerateR2CTwiddles(void *&_twiddles,
     factors[small_factors_offset + 2] =
         (tw_offset - factors[small_factors_offset + 1]) * sizeof(DT) * 2;
   }  // stage_count
+  lines.run();
   _twiddles_end = (void *)((DT *)_twiddles + tw_offset * 2);
 
   return MLUOP_STATUS_SUCCESS;
@@ -315,6 +331,8 @@ mluOpStatus_t MLUOP_WIN_API fftGenerateTwiddlesC2R(
                      (_nfft * 2 * 2) * sizeof(DT)));  // complex *2(large+small)
 
   _twiddles = twiddles;
+  // all stages are generated together by the host workers
+  mluop::fft::SincosBatch<DT> lines;
   int stage_count = factors[0];
   int cur_large_radix, cur_small_radix, section_num, butterfly_num,
       loop_stage;  // current radix
@@ -329,7 +347,7 @@ mluOpStatus_t MLUOP_WIN_API fftGenerateTwiddlesC2R(
     butterfly_num = butterfly_num / 2 + 1;
 
     fftGenerateTwiddlesLine<DT>(twiddles, butterfly_num, section_num,
-                                cur_large_radix, _nfft, dir);
+                                cur_large_radix, _nfft, dir, &lines);
 
     twiddles += butterfly_num * (cur_large_radix - 1) * 2;
     tw_offset += butterfly_num * (cur_large_radix - 1);
@@ -348,7 +366,8 @@ mluOpStatus_t MLUOP_WIN_API fftGenerateTwiddlesC2R(
       section_num = factors[small_factors_offset + 4 * small_loop_stage + 1];
       butterfly_num = factors[small_factors_offset + 4 * small_loop_stage + 2];
       fftGenerateTwiddlesLine<DT>(twiddles, butterfly_num, section_num,
-                                  cur_small_radix, cur_large_radix, dir);
+                                  cur_small_radix, cur_large_radix, dir,
+                                  &lines);
       twiddles += butterfly_num * (cur_small_radix - 1) * 2;
       tw_offset +=
           butterfly_num * (cur_small_radix - 1);  // complex element offset
@@ -357,6 +376,7 @@ mluOpStatus_t MLUOP_WIN_API fftGenerateTwiddlesC2R(
         (tw_offset - factors[small_factors_offset + 1]) * sizeof(DT) * 2;
   }  // stage_count
 
+  lines.run();
   _twiddles_end = (void *)((DT *)_twiddles + tw_offset * 2);
   return MLUOP_STATUS_SUCCESS;
 }
@@ -372,6 +392,8 @@ mluOpStatus_t MLUOP_WIN_API fftGenerateTwiddlesColumn(
                      (_nfft * 2 * 2) * sizeof(DT)));  // complex *2(large+small)
 
   _twiddles = twiddles;
+  // all stages are generated together by the host workers
+  mluop::fft::SincosBatch<DT> lines;
   int stage_count = factors[0];
   int cur_large_radix, cur_small_radix, section_num, butterfly_num,
       loop_stage;  // current radix
@@ -384,7 +406,7 @@ mluOpStatus_t MLUOP_WIN_API fftGenerateTwiddlesColumn(
     section_num = factors[5 * loop_stage + 1];
     butterfly_num = factors[5 * loop_stage + 2];
     fftGenerateTwiddlesLineColumn<DT>(twiddles, butterfly_num, section_num,
-                                      cur_large_radix, _nfft, dir);
+                                      cur_large_radix, _nfft, dir, &lines);
     twiddles += butterfly_num * (cur_large_radix - 1) * 2;
     tw_offset += butterfly_num * (cur_large_radix - 1);
   }  // stage_count
@@ -402,7 +424,8 @@ mluOpStatus_t MLUOP_WIN_API fftGenerateTwiddlesColumn(
       section_num = factors[small_factors_offset + 4 * small_loop_stage + 1];
       butterfly_num = factors[small_factors_offset + 4 * small_loop_stage + 2];
       fftGenerateTwiddlesLine<DT>(twiddles, butterfly_num, section_num,
-                                  cur_small_radix, cur_large_radix, dir);
+                                  cur_small_radix, cur_large_radix, dir,
+                                  &lines);
       twiddles += butterfly_num * (cur_small_radix - 1) * 2;
       tw_offset +=
           butterfly_num * (cur_small_radix - 1);  // complex element offset
@@ -410,31 +433,31 @@ mluOpStatus_t MLUOP_WIN_API fftGenerateTwiddlesColumn(
     factors[small_factors_offset + 2] =
         (tw_offset - factors[small_factors_offset + 1]) * sizeof(DT) * 2;
   }  // stage_count
+  lines.run();
   _twiddles_end = (void *)((DT *)_twiddles + tw_offset * 2);
   return MLUOP_STATUS_SUCCESS;
 }
 
 template <typename DT>
-mluOpStatus_t MLUOP_WIN_API fftGenerateDftMatrixKernel(DT *dft_matrix,
-                                                       const int radix,
-                                                       const int dir) {
-  int j, k;
-  DT phase;
+mluOpStatus_t MLUOP_WIN_API
+fftGenerateDftMatrixKernel(DT *dft_matrix, const int radix, const int dir,
+                           mluop::fft::SincosBatch<DT> *batch = nullptr) {
+  mluop::fft::SincosBatch<DT> local_batch;
+  mluop::fft::SincosBatch<DT> &lines = batch ? *batch : local_batch;
   const int K_num = 64 / sizeof(DT);
   const int align_K = K_num * ((radix + K_num - 1) / K_num);
   const int sign = (dir == FFT_FORWARD) ? -1 : 1;
-  for (k = 0; k < radix; k++) {
-    for (j = 0; j < align_K; j++) {
-      if (j < radix) {
-        phase = sign * 2 * (DT)FFT_PI * k * j / radix;
-        dft_matrix[align_K * k + j] = (DT)cos(phase);                    // r
-        dft_matrix[align_K * k + j + align_K * radix] = (DT)sin(phase);  // i
-      } else {
-        dft_matrix[align_K * k + j] = (DT)0.0;                    // r
-        dft_matrix[align_K * k + j + align_K * radix] = (DT)0.0;  // i
-      }
-    }  // radix
-  }    // butterfly_num
+  for (int k = 0; k < radix; k++) {
+    DT *row = dft_matrix + align_K * k;
+    lines.add(row, row + align_K * radix, radix, k, radix, sign);
+    for (int j = radix; j < align_K; j++) {
+      row[j] = (DT)0.0;                    // r
+      row[j + align_K * radix] = (DT)0.0;  // i
+    }
+  }  // butterfly_num
+  if (batch == nullptr) {
+    local_batch.run();
+  }
   return MLUOP_STATUS_SUCCESS;
 }
 
@@ -442,39 +465,37 @@ template <typename DT>
 mluOpStatus_t MLUOP_WIN_API fftGenerateDftMatrixKernelNoPad(DT *dft_matrix,
                                                             const int radix,
                                                             const int dir) {
-  int j, k;
-  DT phase;
-
+  mluop::fft::SincosBatch<DT> lines;
   const int sign = (dir == FFT_FORWARD) ? -1 : 1;
-  for (k = 0; k < radix; k++) {
-    for (j = 0; j < radix; j++) {
-      phase = sign * 2 * (DT)FFT_PI * k * j / radix;
-      dft_matrix[radix * k + j] = (DT)cos(phase);                  // r
-      dft_matrix[radix * k + j + radix * radix] = (DT)sin(phase);  // i
-    }                                                              // radix
+  for (int k = 0; k < radix; k++) {
+    DT *row = dft_matrix + radix * k;
+    lines.add(row, row + radix * radix, radix, k, radix, sign);
   }  // butterfly_num
+  lines.run();
   return MLUOP_STATUS_SUCCESS;
 }
 
 template <typename DT>
 mluOpStatus_t MLUOP_WIN_API
 fftGenerateC2RDftMatrixKernelNoPad(DT *dft_matrix, const int radix) {
-  int j, k;
-  DT phase;
+  mluop::fft::SincosBatch<DT> lines;
   int half = (radix / 2 + 1);
   const int sign = 1;  // backward
-  for (k = 0; k < radix; k++) {
-    for (j = 0; j < half; j++) {
-      phase = sign * 2 * (DT)FFT_PI * k * j / radix;
-      if (j == 0 || j == half - 1) {
-        dft_matrix[2 * half * k + j] = (DT)cos(phase);          // r
-        dft_matrix[2 * half * k + j + half] = -(DT)sin(phase);  // i neg
-      } else {
-        dft_matrix[2 * half * k + j] = 2 * (DT)cos(phase);          // r
-        dft_matrix[2 * half * k + j + half] = -2 * (DT)sin(phase);  // i neg
-      }
-    }  // radix
-  }    // butterfly_num
+  for (int k = 0; k < radix; k++) {
+    // 2 * r and i neg, except for the first and the last column
+    DT *row = dft_matrix + 2 * half * k;
+    lines.add(row, row + half, half, k, radix, sign, 1, 2.0, -2.0);
+  }  // butterfly_num
+  lines.run();
+  for (int k = 0; k < radix; k++) {
+    DT *row = dft_matrix + 2 * half * k;
+    row[0] /= 2;
+    row[half] /= 2;
+    if (half > 1) {
+      row[half - 1] /= 2;
+      row[2 * half - 1] /= 2;
+    }
+  }
   return MLUOP_STATUS_SUCCESS;
 }
 
@@ -482,17 +503,14 @@ template <typename DT>
 mluOpStatus_t MLUOP_WIN_API fftGenerateHalfDftMatrixKernelNoPad(DT *dft_matrix,
                                                                 const int radix,
                                                                 const int dir) {
-  int j, k;
-  DT phase;
+  mluop::fft::SincosBatch<DT> lines;
   int rows = radix / 2 + 1;
   const int sign = (dir == FFT_FORWARD) ? -1 : 1;
-  for (k = 0; k < rows; k++) {
-    for (j = 0; j < radix; j++) {
-      phase = sign * 2 * (DT)FFT_PI * k * j / radix;
-      dft_matrix[radix * k + j] = (DT)cos(phase);                 // r
-      dft_matrix[radix * k + j + radix * rows] = (DT)sin(phase);  // i
-    }                                                             // radix
+  for (int k = 0; k < rows; k++) {
+    DT *row = dft_matrix + radix * k;
+    lines.add(row, row + radix * rows, radix, k, radix, sign);
   }  // butterfly_num
+  lines.run();
   return MLUOP_STATUS_SUCCESS;
 }
 
@@ -602,194 +620,9 @@ mluOpStatus_t MLUOP_WIN_API fftFactor(const int _n, int *facbuf,
   int large_radix = 1;
   facbuf += small_factors_offset;
   while (n > 1) {
-    switch (_n) {
-      case 128:
-        if (n % 16 == 0) {
-          r = 16;
-        } else if ((n % 8) == 0) {
-          r = 8;
-        }
-        break;
-
-      case 12:
-        if (n % 4 == 0) {
-          r = 4;
-        } else if ((n % 3) == 0) {
-          r = 3;
-        }
-        break;
-
-      case 140:
-        if (n % 14 == 0) {
-          r = 14;
-        } else if ((n % 10) == 0) {
-          r = 10;
-        }
-        break;
-
-      case 160:
-        if (n % 16 == 0) {
-          r = 16;
-        } else if ((n % 10) == 0) {
-          r = 10;
-        }
-        break;
-
-      case 200:
-        if (n % 20 == 0) {
-          r = 20;
-        } else if ((n % 10) == 0) {
-          r = 10;
-        }
-        break;
-
-      case 275:
-        if (n % 25 == 0) {
-          r = 25;
-        } else if ((n % 11) == 0) {
-          r = 11;
-        }
-        break;
-
-      case 280:
-        if (n % 20 == 0) {
-          r = 20;
-        } else if ((n % 14) == 0) {
-          r = 14;
-        }
-        break;
-      case 256:
-        if (n % 32 == 0) {
-          r = 32;
-        } else if ((n % 8) == 0) {
-          r = 8;
-        }
-        break;
-
-      case 300:
-        if (n % 30 == 0) {
-          r = 30;
-        } else if ((n % 10) == 0) {
-          r = 10;
-        }
-        break;
-
-      case 320:
-        if (n % 20 == 0) {
-          r = 20;
-        } else if ((n % 16) == 0) {
-          r = 16;
-        }
-        break;
-
-      case 350:
-        if (n % 25 == 0) {
-          r = 25;
-        } else if ((n % 14) == 0) {
-          r = 14;
-        }
-        break;
-
-      case 400:
-        if (n % 25 == 0) {
-          r = 25;
-        } else if ((n % 16) == 0) {
-          r = 16;
-        }
-        break;
-
-      case 500:
-        if (n % 25 == 0) {
-          r = 25;
-        } else if ((n % 20) == 0) {
-          r = 20;
-        }
-        break;
-
-      case (32 * 17):
-        if (n % 32 == 0) {
-          r = 32;
-        } else if ((n % 17) == 0) {
-          r = 17;
-        }
-        break;
-
-      case 600:
-        if (n % 30 == 0) {
-          r = 30;
-        } else if ((n % 20) == 0) {
-          r = 20;
-        }
-        break;
-
-      case 650:
-        if (n % 25 == 0) {
-          r = 25;
-        } else if ((n % 26) == 0) {
-          r = 26;
-        }
-        break;
-      case 512:
-        if (n % 64 == 0) {
-          r = 64;
-        } else if ((n % 8) == 0) {
-          r = 8;
-        }
-        break;
-
-      case 1024:
-        if (n % 32 == 0) {
-          r = 32;
-        }
-        break;
-      case 2048:
-        if (n % 16 == 0) {
-          r = 16;
-        } else if ((n % 8) == 0) {
-          r = 8;
-        }
-        break;
-
-      case 4096:
-        if (n % 16 == 0) {
-          r = 16;
-        }
-        break;
-
-      case 6000:
-        if (n % 30 == 0) {
-          r = 30;
-        } else if ((n % 20) == 0) {
-          r = 20;
-        } else if ((n % 10) == 0) {
-          r = 10;
-        }
-        break;
-
-      case 7000:
-        if (n % 50 == 0) {
-          r = 50;
-        } else if ((n % 14) == 0) {
-          r = 14;
-        } else if ((n % 10) == 0) {
-          r = 10;
-        }
-        break;
-
-      default:
-        if (_n <= 64) {
-          r = _n;
-          break;
-        } else {
-          for (int cur_r = 64; cur_r > 1; cur_r--) {
-            if (n % cur_r == 0) {
-              r = cur_r;
-              break;
-            }
-          }
-        }
-
-        break;
+    const int radix = fftFactorRadix(_n, n);
+    if (radix > 0) {
+      r = radix;
     }
 
     n /= r;
@@ -2708,6 +2541,19 @@ mluOpStatus_t MLUOP_WIN_API mluOpMakeFFTPlanMany(
   fft_plan->input_desc = fft_input_desc;
   fft_plan->output_desc = fft_output_desc;
 
+  // plans of the same shape share factors, twiddles and DFT matrices
+  std::string plan_key;
+  if (mluop::fft::planCacheEnabled()) {
+    plan_key =
+        mluop::fft::planCacheKey(handle, rank, n, input_desc, output_desc);
+    if (mluop::fft::planCacheLookup(plan_key, fft_plan)) {
+      *reservespace_size = fft_plan->reservespace_size;
+      *workspace_size = fft_plan->workspace_size;
+      VLOG(5) << "mluOpMakeFFTPlanMany finished, hit plan cache";
+      return MLUOP_STATUS_SUCCESS;
+    }
+  }
+
   // VLOG(5) << "into make FFT1d Policy";
   fft_plan->prime = 0;
 
@@ -2889,6 +2735,10 @@ mluOpStatus_t MLUOP_WIN_API mluOpMakeFFTPlanMany(
     return status;
   }
 
+  if (!plan_key.empty()) {
+    mluop::fft::planCacheInsert(plan_key, fft_plan);
+  }
+
   *reservespace_size = fft_plan->reservespace_size;
   *workspace_size = fft_plan->workspace_size;
 
@@ -3025,6 +2875,11 @@ mluOpStatus_t MLUOP_WIN_API mluOpDestroyFFTPlan(mluOpFFTPlan_t fft_plan) {
                  mluOpDestroyTensorDescriptor(fft_plan->output_desc));
   }
   mluOpStatus_t status = MLUOP_STATUS_SUCCESS;
+  if (fft_plan->tables != nullptr) {
+    // host tables are owned by the plan cache
+    delete fft_plan;
+    return status;
+  }
   switch (fft_plan->fft_type) {
     // r2c
     case CNFFT_HALF2COMPLEX_HALF:
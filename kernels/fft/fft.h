@@ -23,6 +23,7 @@
 #ifndef KERNELS_FFT_FFT_H_
 #define KERNELS_FFT_FFT_H_
 
+#include <memory>
 #include <string>
 #include "core/context.h"
 #include "core/logging.h"
@@ -34,6 +35,7 @@
 #include "kernels/tensor_stride_process/tensor_stride_process_host.h"
 #include "kernels/fft/common/fft_basic_ops.h"
 #include "kernels/fft/common/fft_common_kernels.h"
+#include "kernels/fft/fft_plan_cache.h"
 #include "kernels/debug.h"
 #include "kernels/kernel.h"
 
@@ -255,6 +257,9 @@ struct mluOpFFTStruct {
   void *bluestein_aux_signal_column;
   void *bluestein_input;
   void *bluestein_output;
+
+  // set when the host tables above are shared through the plan cache
+  std::shared_ptr<mluop::fft::PlanTables> tables;
 };
 
 struct ParamNode {
@@ -0,0 +1,211 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include "kernels/fft/fft_plan_cache.h"
+
+#include <algorithm>
+#include <list>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <unordered_map>
+#include <utility>
+#include "kernels/fft/fft.h"
+
+namespace mluop {
+namespace fft {
+
+PlanTables::~PlanTables() {
+  for (auto buffer : buffers_) {
+    CNRT_CHECK(cnrtFreeHost(buffer));
+  }
+}
+
+void PlanTables::adopt(void *buffer) {
+  if (buffer == nullptr ||
+      std::find(buffers_.begin(), buffers_.end(), buffer) != buffers_.end()) {
+    return;
+  }
+  buffers_.push_back(buffer);
+}
+
+namespace {
+
+class PlanCache {
+ public:
+  explicit PlanCache(size_t capacity) : capacity_(capacity) {}
+
+  // Never destroyed: cached tables are freed by cnrtFreeHost, which must not
+  // run after the runtime has been torn down at exit.
+  static PlanCache &instance() {
+    static PlanCache *cache = new PlanCache(mluop::getUintEnvVar(
+        "MLUOP_FFT_PLAN_CACHE_SIZE", FFT_PLAN_CACHE_DEFAULT_SIZE));
+    return *cache;
+  }
+
+  inline size_t capacity() const { return capacity_; }
+
+  bool lookup(const std::string &key, mluOpFFTStruct *plan) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto iter = index_.find(key);
+    if (iter == index_.end()) {
+      ++misses_;
+      return false;
+    }
+    ++hits_;
+    entries_.splice(entries_.begin(), entries_, iter->second);
+    *plan = iter->second->second;
+    return true;
+  }
+
+  void insert(const std::string &key, const mluOpFFTStruct &plan) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (index_.find(key) != index_.end()) {
+      // built concurrently by another thread, keep the first one
+      return;
+    }
+    entries_.emplace_front(key, plan);
+    index_[key] = entries_.begin();
+    while (entries_.size() > capacity_) {
+      index_.erase(entries_.back().first);
+      entries_.pop_back();
+    }
+  }
+
+  void stats(size_t *hits, size_t *misses, size_t *cached_plans) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (hits != nullptr) {
+      *hits = hits_;
+    }
+    if (misses != nullptr) {
+      *misses = misses_;
+    }
+    if (cached_plans != nullptr) {
+      *cached_plans = entries_.size();
+    }
+  }
+
+ private:
+  typedef std::list<std::pair<std::string, mluOpFFTStruct>> EntryList;
+  const size_t capacity_;
+  EntryList entries_;  // most recently used first
+  std::unordered_map<std::string, EntryList::iterator> index_;
+  size_t hits_ = 0;
+  size_t misses_ = 0;
+  std::mutex mutex_;
+};
+
+template <typename T>
+inline void appendKey(std::string *key, const T &value) {
+  key->append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+inline void appendTensorKey(std::string *key, mluOpTensorDescriptor_t desc) {
+  appendKey(key, desc->getDtype());
+  appendKey(key, desc->getOnchipDtype());
+  appendKey(key, desc->getDim());
+  key->append(reinterpret_cast<const char *>(desc->getDims()),
+              sizeof(int64_t) * desc->getDim());
+  key->append(reinterpret_cast<const char *>(desc->getStrides()),
+              sizeof(int64_t) * desc->getDim());
+}
+
+}  // anonymous namespace
+
+bool planCacheEnabled() { return PlanCache::instance().capacity() > 0; }
+
+std::string planCacheKey(mluOpHandle_t handle, const int rank, const int *n,
+                         mluOpTensorDescriptor_t input_desc,
+                         mluOpTensorDescriptor_t output_desc) {
+  std::string key;
+  key.reserve(256);
+  appendKey(&key, handle->arch);
+  appendKey(&key, handle->core_num_per_cluster);
+  appendKey(&key, handle->capability_cluster_num);
+  appendKey(&key, handle->nram_size);
+  appendKey(&key, handle->sram_size);
+  appendKey(&key, rank);
+  key.append(reinterpret_cast<const char *>(n), sizeof(int) * rank);
+  appendTensorKey(&key, input_desc);
+  appendTensorKey(&key, output_desc);
+  return key;
+}
+
+bool planCacheLookup(const std::string &key, mluOpFFTPlan_t fft_plan) {
+  mluOpTensorDescriptor_t input_desc = fft_plan->input_desc;
+  mluOpTensorDescriptor_t output_desc = fft_plan->output_desc;
+  int *factors = fft_plan->factors;
+  int *factors_2d = fft_plan->factors_2d;
+  // keep the tables of a re-made plan alive until we are done with them
+  std::shared_ptr<PlanTables> tables = fft_plan->tables;
+
+  if (PlanCache::instance().lookup(key, fft_plan)) {
+    fft_plan->input_desc = input_desc;
+    fft_plan->output_desc = output_desc;
+    if (tables == nullptr) {
+      // factor buffers allocated by mluOpCreateFFTPlan are not needed anymore
+      CNRT_CHECK(cnrtFreeHost(factors));
+      CNRT_CHECK(cnrtFreeHost(factors_2d));
+    }
+    return true;
+  }
+
+  if (tables != nullptr) {
+    // the factors still belong to a cache entry, build into fresh buffers
+    fft_plan->tables.reset();
+    CNRT_CHECK(cnrtHostMalloc((void **)&(fft_plan->factors),
+                              FFT_MAXFACTORS * sizeof(int)));
+    CNRT_CHECK(cnrtHostMalloc((void **)&(fft_plan->factors_2d),
+                              FFT_MAXFACTORS * sizeof(int)));
+  }
+  return false;
+}
+
+void planCacheInsert(const std::string &key, mluOpFFTPlan_t fft_plan) {
+  auto tables = std::make_shared<PlanTables>();
+  tables->adopt(fft_plan->factors);
+  tables->adopt(fft_plan->factors_2d);
+  tables->adopt(fft_plan->twiddles);
+  tables->adopt(fft_plan->twiddles_2d);
+  tables->adopt(fft_plan->twiddles_inv);
+  tables->adopt(fft_plan->twiddles_inv_2d);
+  tables->adopt(fft_plan->dft_matrix);
+  tables->adopt(fft_plan->dft_matrix_2d);
+  tables->adopt(fft_plan->idft_matrix);
+  tables->adopt(fft_plan->idft_matrix_2d);
+  fft_plan->tables = tables;
+
+  mluOpFFTStruct cached = *fft_plan;
+  cached.input_desc = nullptr;
+  cached.output_desc = nullptr;
+  cached.reservespace_addr = nullptr;
+  PlanCache::instance().insert(key, cached);
+}
+
+}  // namespace fft
+}  // namespace mluop
+
+mluOpStatus_t MLUOP_WIN_API mluOpGetFFTPlanCacheStats(size_t *hits,
+                                                      size_t *misses,
+                                                      size_t *cached_plans) {
+  mluop::fft::PlanCache::instance().stats(hits, misses, cached_plans);
+  return MLUOP_STATUS_SUCCESS;
+}
@@ -0,0 +1,79 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef KERNELS_FFT_FFT_PLAN_CACHE_H_
+#define KERNELS_FFT_FFT_PLAN_CACHE_H_
+
+#include <string>
+#include <vector>
+#include "mlu_op.h"
+
+// Default number of plans kept by the process-wide plan cache, can be
+// overridden by MLUOP_FFT_PLAN_CACHE_SIZE. 0 disables the cache.
+#ifndef FFT_PLAN_CACHE_DEFAULT_SIZE
+#define FFT_PLAN_CACHE_DEFAULT_SIZE 64
+#endif
+
+namespace mluop {
+namespace fft {
+
+// Host tables generated while making a plan: factors, twiddles and DFT
+// matrices. They are never written after mluOpMakeFFTPlanMany, so every plan
+// built from the same cache entry shares one instance, and the buffers are
+// released when the last plan and the cache entry drop their reference.
+class PlanTables {
+ public:
+  PlanTables() = default;
+  PlanTables(const PlanTables &) = delete;
+  PlanTables &operator=(const PlanTables &) = delete;
+  ~PlanTables();
+
+  // Takes ownership of a buffer allocated by cnrtHostMalloc.
+  void adopt(void *buffer);
+
+ private:
+  std::vector<void *> buffers_;
+};
+
+bool planCacheEnabled();
+
+// Builds the cache key of a plan. Everything mluOpMakeFFTPlanMany derives the
+// plan from is part of the key: the device resources of the handle, rank, n[],
+// and the dtypes, dims and strides of both tensors (which carry batch,
+// inembed/onembed and istride/idist).
+std::string planCacheKey(mluOpHandle_t handle, const int rank, const int *n,
+                         mluOpTensorDescriptor_t input_desc,
+                         mluOpTensorDescriptor_t output_desc);
+
+// On hit, copies the cached plan into fft_plan, keeping the tensor
+// descriptors of fft_plan, and returns true. On miss, makes sure fft_plan
+// owns private factor buffers that can be written while the plan is built.
+bool planCacheLookup(const std::string &key, mluOpFFTPlan_t fft_plan);
+
+// Moves the host tables of a freshly built plan into shared storage and
+// publishes the plan, evicting the least recently used entry when full.
+void planCacheInsert(const std::string &key, mluOpFFTPlan_t fft_plan);
+
+}  // namespace fft
+}  // namespace mluop
+
+#endif  // KERNELS_FFT_FFT_PLAN_CACHE_H_
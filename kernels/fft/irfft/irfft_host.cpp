@@ -1487,7 +1487,7 @@ mluOpStatus_t computeFFT2dMatMulColumnC2R(mluOpHandle_t handle,
   cnnlMatMulHeuristicResult_t heuristic_result;
   size_t matmul_ws_size = 0, workspace_size = 0;
 
-  CALL_CNNL(cnnlCreateMatMulDescriptor(&matmul_desc));
+  CALL_CNNL(mluOpAcquireCnnlMatMulDescriptor(handle, &matmul_desc));
   CALL_CNNL(cnnlCreateMatMulAlgo(&matmul_algo));
   CALL_CNNL(cnnlCreateMatMulHeuristicResult(&heuristic_result));
   int32_t requested_algo_count = 1, return_algo_count = 0;
@@ -1521,7 +1521,7 @@ mluOpStatus_t computeFFT2dMatMulColumnC2R(mluOpHandle_t handle,
   status = mluOpDestroyTensorDescriptor(c_desc);
   CHECK_RETURN(api, status);
   // destroy cnnl descriptor
-  CALL_CNNL(cnnlDestroyMatMulDescriptor(matmul_desc));
+  CALL_CNNL(mluOpReleaseCnnlMatMulDescriptor(handle, matmul_desc));
   CALL_CNNL(cnnlDestroyMatMulAlgo(matmul_algo));
   CALL_CNNL(cnnlDestroyMatMulHeuristicResult(heuristic_result));
   DESTROY_CNNL_TENSOR_DESCRIPTOR(cnnl_a_desc);
@@ -1607,7 +1607,7 @@ mluOpStatus_t computeFFT2dMatMulRowC2R(mluOpHandle_t handle,
   cnnlMatMulAlgo_t algo;
   CALL_CNNL(cnnlCreateMatMulAlgo(&algo));
   cnnlMatMulDescriptor_t bmm_bcast_desc;
-  CALL_CNNL(cnnlCreateMatMulDescriptor(&bmm_bcast_desc));
+  CALL_CNNL(mluOpAcquireCnnlMatMulDescriptor(handle, &bmm_bcast_desc));
 
   cnnlMatMulHeuristicResult_t heuristic_result;
   CALL_CNNL(cnnlCreateMatMulHeuristicResult(&heuristic_result));
@@ -1639,7 +1639,7 @@ mluOpStatus_t computeFFT2dMatMulRowC2R(mluOpHandle_t handle,
   status = mluOpDestroyTensorDescriptor(c_desc);
   CHECK_RETURN(api, status);
   // destroy cnnl descriptor
-  CALL_CNNL(cnnlDestroyMatMulDescriptor(bmm_bcast_desc));
+  CALL_CNNL(mluOpReleaseCnnlMatMulDescriptor(handle, bmm_bcast_desc));
   CALL_CNNL(cnnlDestroyMatMulAlgo(algo));
   CALL_CNNL(cnnlDestroyMatMulHeuristicResult(heuristic_result));
   DESTROY_CNNL_TENSOR_DESCRIPTOR(cnnl_a_desc);
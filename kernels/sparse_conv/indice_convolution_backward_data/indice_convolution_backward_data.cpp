@@ -29,6 +29,7 @@
 #include "core/context.h"
 #include "core/gen_case.h"
 #include "kernels/sparse_conv/get_indice_pairs/get_indice_pairs_structs.h"
+#include "kernels/sparse_conv/indice_convolution_grouped/indice_convolution_grouped.h"
 #include "mlu_op.h"
 
 static mluOpStatus_t foolCheckNoPtr(
@@ -331,6 +332,80 @@ static void spconvbpdataGencase(
   GEN_CASE_TEST_PARAM_NEW(true, true, false, 0.003, 0.003, 0);
 }
 
+// grouped path, workspace composition after the transposed filters:
+// | gather_indices | scatter_indices | output_grad_condence |
+// | input_grad_condence | matmul_workspace | scatter_workspace |
+static mluOpStatus_t groupedIndiceConvolutionBackwardData(
+    const std::string api_name, mluOpHandle_t handle,
+    const IndiceConvGroups &groups, const int dyc, const int dxc,
+    const mluOpTensorDescriptor_t output_grad_desc, const void *output_grad,
+    const mluOpTensorDescriptor_t filters_desc, const void *filter_transpose,
+    const mluOpTensorDescriptor_t indice_pairs_desc, const void *indice_pairs,
+    void *workspace, size_t *workspace_size,
+    const mluOpTensorDescriptor_t input_grad_desc, void *input_grad) {
+  const int64_t slot_num = (int64_t)groups.offset_num * groups.pad_rows;
+  const int64_t num_act_in = input_grad_desc->getDimIndex(0);
+  mluOpMatMulAlgoKey shape = {groups.pad_rows,
+                              dyc,
+                              dxc,
+                              0,
+                              1,
+                              output_grad_desc->getDtype(),
+                              filters_desc->getDtype(),
+                              input_grad_desc->getDtype(),
+                              -1,
+                              0,
+                              groups.offset_num};
+  mluOpMatMulAlgoKey algo_key = shape;
+  algo_key.m = mluOpMatMulDimBucket(shape.m);
+  cnnlMatMulAlgo_t matmul_algo;
+  size_t matmul_workspace_size = 0;
+  CALL_CNNL(mluOpGetMatMulAlgo(handle, algo_key, &matmul_algo,
+                               &matmul_workspace_size));
+
+  uint64_t indices_size = slot_num * sizeof(int32_t);
+  uint64_t output_grad_condence_size =
+      slot_num * dyc * mluOpDataTypeBytes(output_grad_desc->getDtype());
+  uint64_t input_grad_condence_size =
+      slot_num * dxc * mluOpDataTypeBytes(input_grad_desc->getDtype());
+  uint64_t scatter_workspace_size =
+      (num_act_in + 1) * dxc * mluOpDataTypeBytes(input_grad_desc->getDtype());
+  if (workspace_size != nullptr) {
+    *workspace_size =
+        (size_t)(2 * indices_size + output_grad_condence_size +
+                 input_grad_condence_size + matmul_workspace_size +
+                 scatter_workspace_size);
+    return MLUOP_STATUS_SUCCESS;
+  }
+  int8_t *gather_indices = (int8_t *)workspace;
+  int8_t *scatter_indices = gather_indices + indices_size;
+  int8_t *output_grad_condence = scatter_indices + indices_size;
+  int8_t *input_grad_condence =
+      output_grad_condence + output_grad_condence_size;
+  int8_t *workspace_matmul = input_grad_condence + input_grad_condence_size;
+  int8_t *workspace_scatter = workspace_matmul + matmul_workspace_size;
+
+  // gather rows of output_grad, padding slots gather row 0 and scatter into
+  // the dummy row num_act_in
+  CHECK_RETURN(api_name,
+               packIndicePairs(handle, api_name, indice_pairs,
+                               indice_pairs_desc->getDimIndex(2), groups, 1, 0,
+                               num_act_in, gather_indices, scatter_indices));
+  CHECK_RETURN(api_name, groupedGather(handle, api_name, output_grad_desc,
+                                       output_grad, gather_indices, slot_num,
+                                       output_grad_condence));
+  // [K, pad_rows, dyc] * [K, dxc, dyc]^T = [K, pad_rows, dxc]
+  CHECK_RETURN(api_name,
+               groupedBatchMatMul(handle, api_name, shape, algo_key,
+                                  output_grad_condence, filter_transpose,
+                                  input_grad_condence, workspace_matmul));
+  CHECK_RETURN(api_name,
+               groupedScatterAdd(handle, api_name, scatter_indices, slot_num,
+                                 input_grad_condence, input_grad_desc,
+                                 input_grad, workspace_scatter));
+  return MLUOP_STATUS_SUCCESS;
+}
+
 /*
  *   [output_grad]              [filters]
  *         |                       |
@@ -354,6 +429,9 @@ static void spconvbpdataGencase(
  *                     |
  *                     V
  *               [input_grad]
+ *
+ * The grouped path, see indice_convolution_grouped.h, runs the gather, the
+ * matmul and the scatter once for all of the K filter offsets.
  */
 mluOpStatus_t MLUOP_WIN_API mluOpGetIndiceConvolutionBackwardDataWorkspaceSize(
     mluOpHandle_t handle, const mluOpTensorDescriptor_t output_grad_desc,
@@ -411,7 +489,7 @@ mluOpStatus_t MLUOP_WIN_API mluOpGetIndiceConvolutionBackwardDataWorkspaceSize(
     // get cnnlTranspose_v2 workspace workspace_size
     size_t transpose_workspace_size_ = 0;
     cnnlTransposeDescriptor_t trans_desc;
-    CALL_CNNL(cnnlCreateTransposeDescriptor(&trans_desc));
+    CALL_CNNL(mluOpAcquireCnnlTransposeDescriptor(handle, &trans_desc));
     int permute[5] = {0, 1, 2, 3, 4};
     getPermuteArray(filters_desc->getLayout(), permute);
     CALL_CNNL(cnnlSetTransposeDescriptor(trans_desc, filters_desc->getDim(),
@@ -424,94 +502,47 @@ mluOpStatus_t MLUOP_WIN_API mluOpGetIndiceConvolutionBackwardDataWorkspaceSize(
       DESTROY_CNNL_TENSOR_DESCRIPTOR(cnnl_x_desc);
       DESTROY_CNNL_HANDLE(cnnl_handle);
     }
-    CALL_CNNL(cnnlDestroyTransposeDescriptor(trans_desc));
+    CALL_CNNL(mluOpReleaseCnnlTransposeDescriptor(handle, trans_desc));
     transpose_workspace_size = (uint64_t)transpose_workspace_size_;
   }
+  IndiceConvGroups groups;
+  if (useGroupedIndiceConv(handle, indice_num, K, &groups)) {
+    size_t grouped_workspace_size = 0;
+    CHECK_RETURN(api_name,
+                 groupedIndiceConvolutionBackwardData(
+                     api_name, handle, groups, dyc, dxc, output_grad_desc,
+                     nullptr, filters_desc, nullptr, indice_pairs_desc,
+                     nullptr, nullptr, &grouped_workspace_size,
+                     input_grad_desc, nullptr));
+    *workspace_size =
+        (size_t)(filter_transpose_size + transpose_workspace_size +
+                 grouped_workspace_size);
+    VLOG(5) << "[mluOpIndiceConvolutionBackwardData] grouped workspace "
+            << "workspace_size: " << *workspace_size;
+    return MLUOP_STATUS_SUCCESS;
+  }
   output_grad_condence_size = max_indice_num *
                               output_grad_desc->getDimIndex(1) *
                               mluOpDataTypeBytes(filters_desc->getDtype());
   input_grad_condence_size = max_indice_num * input_grad_desc->getDimIndex(1) *
                              mluOpDataTypeBytes(filters_desc->getDtype());
 
-  // matmul workspace
+  // matmul workspace, the compute loop uses the same algo for every kk
   {
-    mluOpTensorDescriptor_t sub_filters_desc;
-    mluOpTensorDescriptor_t output_grad_condence_desc;
-    mluOpTensorDescriptor_t input_grad_condence_desc;
-
-    cnnlMatMulDescriptor_t cnnl_matmul_desc;
-    cnnlMatMulHeuristicResult_t cnnl_heuristic_result;
-    cnnlMatMulAlgo_t cnnl_matmul_algo;
-
-    CHECK_RETURN(api_name, mluOpCreateTensorDescriptor(&sub_filters_desc));
-    // CHECK_RETURN(api_name, mluOpCreateTensorDescriptor(&sub_filters_desc));
-    int sub_filter_dims[2] = {(int)(dxc), (int)(dyc)};
-    CHECK_RETURN(api_name, mluOpSetTensorDescriptor(
-                               sub_filters_desc, MLUOP_LAYOUT_ARRAY,
-                               filters_desc->getDtype(), 2, sub_filter_dims));
-    int is_trans_a = 0, is_trans_b = 1;
-    int tf32_flag_int = 0;
-    CALL_CNNL(cnnlCreateMatMulDescriptor(&cnnl_matmul_desc));
-    CALL_CNNL(cnnlSetMatMulDescAttr(cnnl_matmul_desc, CNNL_MATMUL_DESC_TRANSA,
-                                    &(is_trans_a), sizeof(is_trans_a)));
-    CALL_CNNL(cnnlSetMatMulDescAttr(cnnl_matmul_desc, CNNL_MATMUL_DESC_TRANSB,
-                                    &(is_trans_b), sizeof(is_trans_b)));
-    CALL_CNNL(cnnlSetMatMulDescAttr(cnnl_matmul_desc, CNNL_MATMUL_ALLOW_TF32,
-                                    &(tf32_flag_int), sizeof(tf32_flag_int)));
-    CHECK_RETURN(api_name,
-                 mluOpCreateTensorDescriptor(&output_grad_condence_desc));
-    int output_grad_condence_dims[2] = {(int)(max_indice_num), (int)(dyc)};
-    CHECK_RETURN(api_name, mluOpSetTensorDescriptor(
-                               output_grad_condence_desc, MLUOP_LAYOUT_ARRAY,
-                               output_grad_desc->getDtype(), 2,
-                               output_grad_condence_dims));
-    CHECK_RETURN(api_name,
-                 mluOpCreateTensorDescriptor(&input_grad_condence_desc));
-    int input_grad_condence_dims[2] = {(int)(max_indice_num), (int)(dxc)};
-    CHECK_RETURN(api_name,
-                 mluOpSetTensorDescriptor(
-                     input_grad_condence_desc, MLUOP_LAYOUT_ARRAY,
-                     input_grad_desc->getDtype(), 2, input_grad_condence_dims));
-
-    DEFINE_CREATE_AND_SET_CNNL_HANDLE(handle, cnnl_handle);
-    DEFINE_CREATE_AND_SET_CNNL_TENSOR_DESCRIPTOR(sub_filters_desc,
-                                                 cnnl_sub_filters_desc);
-    DEFINE_CREATE_AND_SET_CNNL_TENSOR_DESCRIPTOR(
-        output_grad_condence_desc, cnnl_output_grad_condence_desc);
-    DEFINE_CREATE_AND_SET_CNNL_TENSOR_DESCRIPTOR(input_grad_condence_desc,
-                                                 cnnl_input_grad_condence_desc);
-
-    CALL_CNNL(cnnlCreateMatMulHeuristicResult(&cnnl_heuristic_result));
-    CALL_CNNL(cnnlCreateMatMulAlgo(&cnnl_matmul_algo));
-
-    // set matmul heuristic_result & algorithm
-    int requested_algo_count = 1, return_algo_count = 0;
-    CALL_CNNL(cnnlGetMatMulAlgoHeuristic(
-        cnnl_handle, cnnl_matmul_desc, cnnl_output_grad_condence_desc,
-        cnnl_sub_filters_desc, cnnl_input_grad_condence_desc,
-        cnnl_input_grad_condence_desc, NULL, requested_algo_count,
-        &cnnl_heuristic_result, &return_algo_count));
-
-    // launch matmul
     size_t workspace_size_matmul = 0;
-    float alpha_gemm = 1.0f, beta_gemm = 0.0f;
-    CALL_CNNL(cnnlGetMatMulHeuristicResult(
-        cnnl_heuristic_result, cnnl_matmul_algo, &workspace_size_matmul));
-
-    // destroy descriptors
-    CALL_CNNL(cnnlDestroyMatMulHeuristicResult(cnnl_heuristic_result));
-    CALL_CNNL(cnnlDestroyMatMulDescriptor(cnnl_matmul_desc));
-    CALL_CNNL(cnnlDestroyMatMulAlgo(cnnl_matmul_algo));
-    DESTROY_CNNL_TENSOR_DESCRIPTOR(cnnl_output_grad_condence_desc);
-    DESTROY_CNNL_TENSOR_DESCRIPTOR(cnnl_sub_filters_desc);
-    DESTROY_CNNL_TENSOR_DESCRIPTOR(cnnl_input_grad_condence_desc);
-    DESTROY_CNNL_HANDLE(cnnl_handle);
-
-    CHECK_RETURN(api_name,
-                 mluOpDestroyTensorDescriptor(output_grad_condence_desc));
-    CHECK_RETURN(api_name, mluOpDestroyTensorDescriptor(sub_filters_desc));
-    CHECK_RETURN(api_name,
-                 mluOpDestroyTensorDescriptor(input_grad_condence_desc));
+    cnnlMatMulAlgo_t matmul_algo;
+    mluOpMatMulAlgoKey matmul_key = {mluOpMatMulDimBucket(max_indice_num),
+                                     dyc,
+                                     dxc,
+                                     0,
+                                     1,
+                                     output_grad_desc->getDtype(),
+                                     filters_desc->getDtype(),
+                                     input_grad_desc->getDtype(),
+                                     -1,
+                                     0};
+    CALL_CNNL(mluOpGetMatMulAlgo(handle, matmul_key, &matmul_algo,
+                                 &workspace_size_matmul));
     matmul_workspace_size = (uint64_t)workspace_size_matmul;
   }
   // scatter to input_grad_tmp_workspace_size workspace
@@ -624,10 +655,11 @@ mluOpStatus_t MLUOP_WIN_API mluOpIndiceConvolutionBackwardData(
     filter_transpose_size = mluOpGetTensorElementNum(filters_desc) * cal_dwidth;
     VLOG(5) << "host invoke: filter_transpose_size " << filter_transpose_size;
   }
-  output_grad_condence_size = getMaxNumInArray(indice_num, K) *
-                              output_grad_desc->getDimIndex(1) * cal_dwidth;
-  input_grad_condence_size = getMaxNumInArray(indice_num, K) *
-                             input_grad_desc->getDimIndex(1) * cal_dwidth;
+  int max_indice_num = getMaxNumInArray(indice_num, K);
+  output_grad_condence_size =
+      max_indice_num * output_grad_desc->getDimIndex(1) * cal_dwidth;
+  input_grad_condence_size =
+      max_indice_num * input_grad_desc->getDimIndex(1) * cal_dwidth;
   int8_t *filter_transpose = (int8_t *)filters;
   int8_t *workspace_base = (int8_t *)workspace;
 
@@ -639,7 +671,7 @@ mluOpStatus_t MLUOP_WIN_API mluOpIndiceConvolutionBackwardData(
     workspace_base += filter_transpose_size;
     cnnlTransposeDescriptor_t trans_desc;
     CHECK_RETURN(api_name, mluOpCreateTensorDescriptor(&filter_transpose_desc));
-    CALL_CNNL(cnnlCreateTransposeDescriptor(&trans_desc));
+    CALL_CNNL(mluOpAcquireCnnlTransposeDescriptor(handle, &trans_desc));
     int permute[5] = {0, 1, 2, 3, 4};
     int filter_transpose_dims[5];
     getPermuteArray(filters_desc->getLayout(), permute);
@@ -676,11 +708,22 @@ mluOpStatus_t MLUOP_WIN_API mluOpIndiceConvolutionBackwardData(
       DESTROY_CNNL_TENSOR_DESCRIPTOR(cnnl_y_desc);
       DESTROY_CNNL_HANDLE(cnnl_handle);
     }
-    CALL_CNNL(cnnlDestroyTransposeDescriptor(trans_desc));
+    CALL_CNNL(mluOpReleaseCnnlTransposeDescriptor(handle, trans_desc));
     CHECK_RETURN(api_name, mluOpDestroyTensorDescriptor(filter_transpose_desc));
   } else {
     filter_transpose_desc = filters_desc;
   }
+  IndiceConvGroups groups;
+  if (useGroupedIndiceConv(handle, indice_num, K, &groups)) {
+    CHECK_RETURN(api_name,
+                 groupedIndiceConvolutionBackwardData(
+                     api_name, handle, groups, dyc, dxc, output_grad_desc,
+                     output_grad, filters_desc, filter_transpose,
+                     indice_pairs_desc, indice_pairs, workspace_base, nullptr,
+                     input_grad_desc, input_grad));
+    GEN_CASE_END();
+    return MLUOP_STATUS_SUCCESS;
+  }
   int8_t *output_grad_condence = workspace_base;
   workspace_base += output_grad_condence_size;
   int8_t *input_grad_condence = workspace_base;
@@ -767,7 +810,7 @@ mluOpStatus_t MLUOP_WIN_API mluOpIndiceConvolutionBackwardData(
     cnnlMatMulDescriptor_t matmul_desc;
     int is_trans_a = 0, is_trans_b = 1;
     int tf32_flag_int = 0;
-    CALL_CNNL(cnnlCreateMatMulDescriptor(&matmul_desc));
+    CALL_CNNL(mluOpAcquireCnnlMatMulDescriptor(handle, &matmul_desc));
     CALL_CNNL(cnnlSetMatMulDescAttr(matmul_desc, CNNL_MATMUL_DESC_TRANSA,
                                     &(is_trans_a), sizeof(is_trans_a)));
     CALL_CNNL(cnnlSetMatMulDescAttr(matmul_desc, CNNL_MATMUL_DESC_TRANSB,
@@ -782,39 +825,25 @@ mluOpStatus_t MLUOP_WIN_API mluOpIndiceConvolutionBackwardData(
                  mluOpSetTensorDescriptor(
                      input_grad_condence_desc, MLUOP_LAYOUT_ARRAY,
                      input_grad_desc->getDtype(), 2, input_grad_condence_dims));
-    cnnlMatMulHeuristicResult_t heuristic_result;
-    CALL_CNNL(cnnlCreateMatMulHeuristicResult(&heuristic_result));
+    // same cache entry as the workspace query, whose workspace is reserved
+    // once for all kk
     cnnlMatMulAlgo_t matmul_algo;
-    CALL_CNNL(cnnlCreateMatMulAlgo(&matmul_algo));
-
-    // set matmul heuristic_result & algorithm
-    int requested_algo_count = 1, return_algo_count = 0;
-    {
-      DEFINE_CREATE_AND_SET_CNNL_HANDLE(handle, cnnl_handle);
-      DEFINE_CREATE_AND_SET_CNNL_TENSOR_DESCRIPTOR(output_grad_condence_desc,
-                                                   cnnl_a_desc);
-      DEFINE_CREATE_AND_SET_CNNL_TENSOR_DESCRIPTOR(sub_filters_desc,
-                                                   cnnl_b_desc);
-      DEFINE_CREATE_AND_SET_CNNL_TENSOR_DESCRIPTOR(input_grad_condence_desc,
-                                                   cnnl_c_desc);
-      DEFINE_CREATE_AND_SET_CNNL_TENSOR_DESCRIPTOR(input_grad_condence_desc,
-                                                   cnnl_d_desc);
-      CALL_CNNL(cnnlGetMatMulAlgoHeuristic(
-          cnnl_handle, matmul_desc, cnnl_a_desc, cnnl_b_desc, cnnl_c_desc,
-          cnnl_d_desc, NULL, requested_algo_count, &heuristic_result,
-          &return_algo_count));
-      DESTROY_CNNL_TENSOR_DESCRIPTOR(cnnl_a_desc);
-      DESTROY_CNNL_TENSOR_DESCRIPTOR(cnnl_b_desc);
-      DESTROY_CNNL_TENSOR_DESCRIPTOR(cnnl_c_desc);
-      DESTROY_CNNL_TENSOR_DESCRIPTOR(cnnl_d_desc);
-      DESTROY_CNNL_HANDLE(cnnl_handle);
-    }
+    size_t workspace_size_matmul = 0;
+    mluOpMatMulAlgoKey matmul_key = {mluOpMatMulDimBucket(max_indice_num),
+                                     dyc,
+                                     dxc,
+                                     is_trans_a,
+                                     is_trans_b,
+                                     output_grad_desc->getDtype(),
+                                     filters_desc->getDtype(),
+                                     input_grad_desc->getDtype(),
+                                     -1,
+                                     tf32_flag_int};
+    CALL_CNNL(mluOpGetMatMulAlgo(handle, matmul_key, &matmul_algo,
+                                 &workspace_size_matmul));
 
     // launch matmul
-    size_t workspace_size_matmul = 0;
     float alpha_gemm = 1.0f, beta_gemm = 0.0f;
-    CALL_CNNL(cnnlGetMatMulHeuristicResult(heuristic_result, matmul_algo,
-                                           &workspace_size_matmul));
     if (kk_count == 0) {
       workspace_matmul = workspace_size_matmul == 0
                              ? NULL
@@ -844,9 +873,7 @@ mluOpStatus_t MLUOP_WIN_API mluOpIndiceConvolutionBackwardData(
       DESTROY_CNNL_HANDLE(cnnl_handle);
     }
     // destroy descriptors
-    CALL_CNNL(cnnlDestroyMatMulHeuristicResult(heuristic_result));
-    CALL_CNNL(cnnlDestroyMatMulDescriptor(matmul_desc));
-    CALL_CNNL(cnnlDestroyMatMulAlgo(matmul_algo));
+    CALL_CNNL(mluOpReleaseCnnlMatMulDescriptor(handle, matmul_desc));
 
     // fill workspace_input_grad_tmp
     uint64_t input_grad_tmp_workspace_size =
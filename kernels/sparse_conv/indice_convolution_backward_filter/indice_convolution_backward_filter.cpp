@@ -30,6 +30,7 @@
 #include "core/mlu_env.h"
 #include "core/tensor.h"
 #include "kernels/sparse_conv/get_indice_pairs/get_indice_pairs_structs.h"
+#include "kernels/sparse_conv/indice_convolution_grouped/indice_convolution_grouped.h"
 #include "mlu_op.h"
 
 inline bool isFloatDtype(const mluOpDataType_t &dtype) {
@@ -281,7 +282,7 @@ static mluOpStatus_t insertTranspose(
   cnnlTransposeDescriptor_t trans_desc;
   CHECK_RETURN(api_name, mluOpCreateTensorDescriptor(&trans_in_desc));
   CHECK_RETURN(api_name, mluOpCreateTensorDescriptor(&trans_out_desc));
-  CALL_CNNL(cnnlCreateTransposeDescriptor(&trans_desc));
+  CALL_CNNL(mluOpAcquireCnnlTransposeDescriptor(handle, &trans_desc));
   CHECK_RETURN(api_name, mluOpSetTensorDescriptor(
                              trans_in_desc, MLUOP_LAYOUT_ARRAY,
                              filters_grad_desc->getDtype(), 3, trans_in_shape));
@@ -314,7 +315,108 @@ static mluOpStatus_t insertTranspose(
 
   CHECK_RETURN(api_name, mluOpDestroyTensorDescriptor(trans_in_desc));
   CHECK_RETURN(api_name, mluOpDestroyTensorDescriptor(trans_out_desc));
-  CALL_CNNL(cnnlDestroyTransposeDescriptor(trans_desc));
+  CALL_CNNL(mluOpReleaseCnnlTransposeDescriptor(handle, trans_desc));
+  return MLUOP_STATUS_SUCCESS;
+}
+
+// grouped path, padding slots gather the appended zero rows of features and
+// output_grad, so that they add nothing to filters_grad, even when other
+// rows of features hold inf or nan.
+/*| input indice | diffy indice | padded features | padded output_grad | */
+/*| temp features | temp output_grad | matmul_ws | */
+static mluOpStatus_t groupedIndiceConvBackwardFilter(
+    const std::string api_name, mluOpHandle_t handle,
+    const IndiceConvGroups &groups,
+    const mluOpTensorDescriptor_t features_desc, const void *features,
+    const mluOpTensorDescriptor_t output_grad_desc, const void *output_grad,
+    const mluOpTensorDescriptor_t indice_pairs_desc, const void *indice_pairs,
+    void *workspace, size_t *workspace_size,
+    const mluOpTensorDescriptor_t filters_grad_desc, void *filters_grad_temp) {
+  int32_t ci = features_desc->getDimIndex(1);
+  int32_t co = output_grad_desc->getDimIndex(1);
+  int64_t in_active_num = features_desc->getDimIndex(0);
+  int64_t out_active_num = output_grad_desc->getDimIndex(0);
+  int64_t slot_num = (int64_t)groups.offset_num * groups.pad_rows;
+  mluOpMatMulAlgoKey shape = {ci,
+                              groups.pad_rows,
+                              co,
+                              1,
+                              0,
+                              features_desc->getDtype(),
+                              output_grad_desc->getDtype(),
+                              filters_grad_desc->getDtype(),
+                              (int32_t)getOnchipDataType(filters_grad_desc),
+                              0,
+                              groups.offset_num};
+  mluOpMatMulAlgoKey algo_key = shape;
+  algo_key.k = mluOpMatMulDimBucket(shape.k);
+  cnnlMatMulAlgo_t matmul_algo;
+  size_t matmul_ws_size = 0;
+  CALL_CNNL(
+      mluOpGetMatMulAlgo(handle, algo_key, &matmul_algo, &matmul_ws_size));
+
+  int64_t indice_size = slot_num * sizeof(int32_t);
+  int64_t padded_input_size =
+      (in_active_num + 1) * ci *
+      mluop::getSizeOfDataType(features_desc->getDtype());
+  int64_t padded_diffy_size =
+      (out_active_num + 1) * co *
+      mluop::getSizeOfDataType(output_grad_desc->getDtype());
+  int64_t input_size =
+      slot_num * ci * mluop::getSizeOfDataType(features_desc->getDtype());
+  int64_t diffy_size =
+      slot_num * co * mluop::getSizeOfDataType(output_grad_desc->getDtype());
+  if (workspace_size != nullptr) {
+    *workspace_size = 2 * indice_size + padded_input_size +
+                      padded_diffy_size + input_size + diffy_size +
+                      matmul_ws_size;
+    return MLUOP_STATUS_SUCCESS;
+  }
+  void *input_indice = workspace;
+  void *diffy_indice = (int8_t *)input_indice + indice_size;
+  void *padded_input = (int8_t *)diffy_indice + indice_size;
+  void *padded_diffy = (int8_t *)padded_input + padded_input_size;
+  void *input_temp = (int8_t *)padded_diffy + padded_diffy_size;
+  void *diffy_temp = (int8_t *)input_temp + input_size;
+  void *matmul_ws = (int8_t *)diffy_temp + diffy_size;
+
+  mluOpTensorDescriptor_t padded_input_desc, padded_diffy_desc;
+  CHECK_RETURN(api_name, mluOpCreateTensorDescriptor(&padded_input_desc));
+  CHECK_RETURN(api_name, mluOpCreateTensorDescriptor(&padded_diffy_desc));
+  int64_t padded_input_dims[2] = {in_active_num + 1, ci};
+  CHECK_RETURN(api_name, mluOpSetTensorDescriptor_v2(
+                             padded_input_desc, MLUOP_LAYOUT_ARRAY,
+                             features_desc->getDtype(), 2, padded_input_dims));
+  int64_t padded_diffy_dims[2] = {out_active_num + 1, co};
+  CHECK_RETURN(api_name, mluOpSetTensorDescriptor_v2(
+                             padded_diffy_desc, MLUOP_LAYOUT_ARRAY,
+                             output_grad_desc->getDtype(), 2,
+                             padded_diffy_dims));
+  CHECK_RETURN(api_name,
+               packIndicePairs(handle, api_name, indice_pairs,
+                               indice_pairs_desc->getDimIndex(2), groups, 0,
+                               in_active_num, out_active_num, input_indice,
+                               diffy_indice));
+  CHECK_RETURN(api_name,
+               groupedAppendZeroRow(handle, api_name, features_desc, features,
+                                    padded_input));
+  CHECK_RETURN(api_name,
+               groupedAppendZeroRow(handle, api_name, output_grad_desc,
+                                    output_grad, padded_diffy));
+  // gather activate input data [K * pad_rows, ci]
+  CHECK_RETURN(api_name,
+               groupedGather(handle, api_name, padded_input_desc, padded_input,
+                             input_indice, slot_num, input_temp));
+  // gather activate diffy data [K * pad_rows, co]
+  CHECK_RETURN(api_name,
+               groupedGather(handle, api_name, padded_diffy_desc, padded_diffy,
+                             diffy_indice, slot_num, diffy_temp));
+  // [K, pad_rows, ci]^T * [K, pad_rows, co] = [K, ci, co]
+  CHECK_RETURN(api_name, groupedBatchMatMul(handle, api_name, shape, algo_key,
+                                            input_temp, diffy_temp,
+                                            filters_grad_temp, matmul_ws));
+  CHECK_RETURN(api_name, mluOpDestroyTensorDescriptor(padded_input_desc));
+  CHECK_RETURN(api_name, mluOpDestroyTensorDescriptor(padded_diffy_desc));
   return MLUOP_STATUS_SUCCESS;
 }
 
@@ -352,24 +454,46 @@ static mluOpStatus_t internalIndiceConvBackwardFilter(
   void *diffy_temp = (int8_t *)input_temp + max_input_size;
   void *matmul_ws = (int8_t *)diffy_temp + max_diffy_size;
 
+  IndiceConvGroups groups;
+  if (useGroupedIndiceConv(handle, indice_num, kernel_volume, &groups)) {
+    size_t grouped_ws_size = 0;
+    CHECK_RETURN(api_name,
+                 groupedIndiceConvBackwardFilter(
+                     api_name, handle, groups, features_desc, features,
+                     output_grad_desc, output_grad, indice_pairs_desc,
+                     indice_pairs, input_temp,
+                     is_get_workspace ? &grouped_ws_size : nullptr,
+                     filters_grad_desc, filters_grad_temp));
+    uint64_t trans_ws_size = 0;
+    if (filters_grad_need_trans) {
+      CHECK_RETURN(
+          api_name,
+          insertTranspose(api_name, handle, filters_grad_desc,
+                          filters_grad_temp, filters_grad, input_temp,
+                          &trans_ws_size, is_get_workspace, kernel_volume, ci,
+                          co));
+    }
+    if (is_get_workspace) {
+      *workspace_size =
+          filters_grad_trans_size + std::max(trans_ws_size, grouped_ws_size);
+    }
+    return MLUOP_STATUS_SUCCESS;
+  }
+
   // create temp tensor for gather and matmul
   mluOpTensorDescriptor_t active_indice_desc;
   mluOpTensorDescriptor_t matmul_a_desc, matmul_b_desc, matmul_c_desc;
   cnnlMatMulDescriptor_t matmul_desc;
   cnnlMatMulAlgo_t matmul_algo;
-  cnnlMatMulHeuristicResult_t heuristic_result;
   CHECK_RETURN(api_name, mluOpCreateTensorDescriptor(&active_indice_desc));
   CHECK_RETURN(api_name, mluOpCreateTensorDescriptor(&matmul_a_desc));
   CHECK_RETURN(api_name, mluOpCreateTensorDescriptor(&matmul_b_desc));
   CHECK_RETURN(api_name, mluOpCreateTensorDescriptor(&matmul_c_desc));
-  CALL_CNNL(cnnlCreateMatMulDescriptor(&matmul_desc));
-  CALL_CNNL(cnnlCreateMatMulAlgo(&matmul_algo));
-  CALL_CNNL(cnnlCreateMatMulHeuristicResult(&heuristic_result));
+  CALL_CNNL(mluOpAcquireCnnlMatMulDescriptor(handle, &matmul_desc));
   CHECK_RETURN(
       api_name,
       setMatmulDescInfo(api_name, matmul_desc, 1, 0,
                         (uint32_t)getOnchipDataType(filters_grad_desc), 0));
-  int32_t requested_algo_count = 1, return_algo_count = 0;
   float alpha = 1.0, beta = 0.0, fill_value = 0;
   size_t matmul_ws_size = 0, temp_matmul_size = 0;
 
@@ -413,24 +537,21 @@ static mluOpStatus_t internalIndiceConvBackwardFilter(
     CHECK_RETURN(api_name, mluOpSetTensorDescriptor(
                                matmul_c_desc, MLUOP_LAYOUT_ARRAY,
                                filters_grad_desc->getDtype(), 2, c_desc_dims));
-    {
-      DEFINE_CREATE_AND_SET_CNNL_HANDLE(handle, cnnl_handle);
-      DEFINE_CREATE_AND_SET_CNNL_TENSOR_DESCRIPTOR(matmul_a_desc, cnnl_a_desc);
-      DEFINE_CREATE_AND_SET_CNNL_TENSOR_DESCRIPTOR(matmul_b_desc, cnnl_b_desc);
-      DEFINE_CREATE_AND_SET_CNNL_TENSOR_DESCRIPTOR(matmul_c_desc, cnnl_c_desc);
-      DEFINE_CREATE_AND_SET_CNNL_TENSOR_DESCRIPTOR(matmul_c_desc, cnnl_d_desc);
-      CALL_CNNL(cnnlGetMatMulAlgoHeuristic(
-          cnnl_handle, matmul_desc, cnnl_a_desc, cnnl_b_desc, cnnl_c_desc,
-          cnnl_d_desc, nullptr, requested_algo_count, &heuristic_result,
-          &return_algo_count));
-      DESTROY_CNNL_TENSOR_DESCRIPTOR(cnnl_a_desc);
-      DESTROY_CNNL_TENSOR_DESCRIPTOR(cnnl_b_desc);
-      DESTROY_CNNL_TENSOR_DESCRIPTOR(cnnl_c_desc);
-      DESTROY_CNNL_TENSOR_DESCRIPTOR(cnnl_d_desc);
-      DESTROY_CNNL_HANDLE(cnnl_handle);
-    }
-    CALL_CNNL(cnnlGetMatMulHeuristicResult(heuristic_result, matmul_algo,
-                                           &temp_matmul_size));
+    // a is [active_point_num, ci] used transposed, the reduced dimension
+    // varies with the kernel position
+    mluOpMatMulAlgoKey matmul_key = {
+        ci,
+        mluOpMatMulDimBucket(active_point_num),
+        co,
+        1,
+        0,
+        features_desc->getDtype(),
+        output_grad_desc->getDtype(),
+        filters_grad_desc->getDtype(),
+        (int32_t)getOnchipDataType(filters_grad_desc),
+        0};
+    CALL_CNNL(mluOpGetMatMulAlgo(handle, matmul_key, &matmul_algo,
+                                 &temp_matmul_size));
 
     if (is_get_workspace) {
       matmul_ws_size =
@@ -522,9 +643,7 @@ static mluOpStatus_t internalIndiceConvBackwardFilter(
   CHECK_RETURN(api_name, mluOpDestroyTensorDescriptor(matmul_a_desc));
   CHECK_RETURN(api_name, mluOpDestroyTensorDescriptor(matmul_b_desc));
   CHECK_RETURN(api_name, mluOpDestroyTensorDescriptor(matmul_c_desc));
-  CALL_CNNL(cnnlDestroyMatMulDescriptor(matmul_desc));
-  CALL_CNNL(cnnlDestroyMatMulAlgo(matmul_algo));
-  CALL_CNNL(cnnlDestroyMatMulHeuristicResult(heuristic_result));
+  CALL_CNNL(mluOpReleaseCnnlMatMulDescriptor(handle, matmul_desc));
   return MLUOP_STATUS_SUCCESS;
 }
 
@@ -533,6 +652,8 @@ static mluOpStatus_t internalIndiceConvBackwardFilter(
 /*| temp filters_grad | transpose_ws | */
 /* multiplexing of space:(transpose_ws, temp_input + temp_diffy +
  * matmul_ws) */
+/* the grouped path uses groupedIndiceConvBackwardFilter's composition
+ * after temp filters_grad */
 mluOpStatus_t MLUOP_WIN_API
 mluOpGetIndiceConvolutionBackwardFilterWorkspaceSize(
     mluOpHandle_t handle, const mluOpTensorDescriptor_t features_desc,
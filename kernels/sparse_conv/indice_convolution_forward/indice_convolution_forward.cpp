@@ -33,6 +33,7 @@
 #include "kernels/kernel.h"
 #include "mlu_op.h"
 #include "kernels/sparse_conv/get_indice_pairs/get_indice_pairs_structs.h"
+#include "kernels/sparse_conv/indice_convolution_grouped/indice_convolution_grouped.h"
 
 static mluOpStatus_t foolProof(
     const std::string api_name, mluOpHandle_t handle,
@@ -168,6 +169,70 @@ static mluOpStatus_t foolProof(
   return MLUOP_STATUS_SUCCESS;
 }
 
+// grouped path, workspace composition after the transposed filters:
+// | gather_indices | scatter_indices | gather_result | matmul_result |
+// | matmul_extra | scatter_result |
+static mluOpStatus_t groupedIndiceConvolutionForward(
+    const std::string api_name, mluOpHandle_t handle,
+    const IndiceConvGroups &groups, const mluOpMatMulAlgoKey &shape,
+    const mluOpTensorDescriptor_t features_desc, const void *features,
+    const void *filters, const void *indice_pairs, const int64_t num_act_in,
+    void *workspace, size_t *workspace_size,
+    const mluOpTensorDescriptor_t features_out_desc, void *features_out) {
+  const int64_t num_act_out = features_out_desc->getDimIndex(0);
+  const int64_t slot_num = (int64_t)groups.offset_num * groups.pad_rows;
+  mluOpMatMulAlgoKey algo_key = shape;
+  algo_key.m = mluOpMatMulDimBucket(shape.m);
+  cnnlMatMulAlgo_t matmul_algo;
+  size_t workspaceSize_matmulExtra = 0;
+  CALL_CNNL(mluOpGetMatMulAlgo(handle, algo_key, &matmul_algo,
+                               &workspaceSize_matmulExtra));
+
+  size_t workspaceSize_indices = slot_num * sizeof(int32_t);
+  size_t workspaceSize_gather =
+      slot_num * shape.k * mluop::getSizeOfDataType(features_desc->getDtype());
+  size_t workspaceSize_matmul =
+      slot_num * shape.n *
+      mluop::getSizeOfDataType(features_out_desc->getDtype());
+  size_t workspaceSize_scatter =
+      (num_act_out + 1) * shape.n *
+      mluop::getSizeOfDataType(features_out_desc->getDtype());
+  if (workspace_size != nullptr) {
+    *workspace_size = 2 * workspaceSize_indices + workspaceSize_gather +
+                      workspaceSize_matmul + workspaceSize_matmulExtra +
+                      workspaceSize_scatter;
+    return MLUOP_STATUS_SUCCESS;
+  }
+  void *gatherIndice_ptr = workspace;
+  void *scatterIndice_ptr = (int8_t *)gatherIndice_ptr + workspaceSize_indices;
+  void *gatherResult_ptr = (int8_t *)scatterIndice_ptr + workspaceSize_indices;
+  void *matmulResult_ptr = (int8_t *)gatherResult_ptr + workspaceSize_gather;
+  void *matmulExtra_ptr = (int8_t *)matmulResult_ptr + workspaceSize_matmul;
+  void *scatterResult_ptr =
+      (int8_t *)matmulExtra_ptr + workspaceSize_matmulExtra;
+
+  // padding slots gather row 0 and scatter into the dummy row num_act_out
+  CHECK_RETURN(api_name,
+               packIndicePairs(handle, api_name, indice_pairs, num_act_in,
+                               groups, 0, 0, num_act_out, gatherIndice_ptr,
+                               scatterIndice_ptr));
+  // [num_act_in, ci] -> [num_filter * pad_rows, ci]
+  CHECK_RETURN(api_name,
+               groupedGather(handle, api_name, features_desc, features,
+                             gatherIndice_ptr, slot_num, gatherResult_ptr));
+  // [num_filter, pad_rows, ci] * [num_filter, ci, co]
+  //   = [num_filter, pad_rows, co]
+  CHECK_RETURN(api_name, groupedBatchMatMul(handle, api_name, shape, algo_key,
+                                            gatherResult_ptr, filters,
+                                            matmulResult_ptr, matmulExtra_ptr));
+  // [num_filter * pad_rows, co] -> [num_act_out, co]
+  CHECK_RETURN(api_name, groupedScatterAdd(handle, api_name,
+                                           scatterIndice_ptr, slot_num,
+                                           matmulResult_ptr, features_out_desc,
+                                           features_out, scatterResult_ptr));
+  return MLUOP_STATUS_SUCCESS;
+}
+
 static mluOpStatus_t mainIndiceConvolutionForward(
     const std::string api_name, mluOpHandle_t handle,
     const mluOpTensorDescriptor_t features_desc, const void *features,
@@ -226,8 +291,6 @@ static mluOpStatus_t mainIndiceConvolutionForward(
 
   float matmul_alpha = 1.0;
   float matmul_beta = 0.0;
-  int matmul_requested_algo = 1;
-  int matmul_recieved_algo = 0;
   int matmul_is_transA = 0;
   int matmul_is_transB = 0;
   uint32_t matmul_allow_TF32 = 0;
@@ -254,14 +317,11 @@ static mluOpStatus_t mainIndiceConvolutionForward(
   // mluOpTensorDescriptor_t addN_descriptors[2] = {features_out_desc,
   //                                                features_out_desc};
   cnnlMatMulAlgo_t matmul_algo;
-  cnnlMatMulHeuristicResult_t heuristic_result;
   CHECK_RETURN(api_name, mluOpCreateTensorDescriptor(&active_indice_desc));
   CHECK_RETURN(api_name, mluOpCreateTensorDescriptor(&matmul_a_desc));
   CHECK_RETURN(api_name, mluOpCreateTensorDescriptor(&matmul_b_desc));
   CHECK_RETURN(api_name, mluOpCreateTensorDescriptor(&matmul_c_desc));
-  CALL_CNNL(cnnlCreateMatMulDescriptor(&matmul_desc));
-  CALL_CNNL(cnnlCreateMatMulAlgo(&matmul_algo));
-  CALL_CNNL(cnnlCreateMatMulHeuristicResult(&heuristic_result));
+  CALL_CNNL(mluOpAcquireCnnlMatMulDescriptor(handle, &matmul_desc));
 
   CALL_CNNL(cnnlSetMatMulDescAttr(matmul_desc, CNNL_MATMUL_DESC_TRANSA,
                                   &matmul_is_transA, sizeof(int32_t)));
@@ -297,7 +357,7 @@ static mluOpStatus_t mainIndiceConvolutionForward(
     cnnlTransposeDescriptor_t trans_desc;
     CHECK_RETURN(api_name, mluOpCreateTensorDescriptor(&trans_in_desc));
     CHECK_RETURN(api_name, mluOpCreateTensorDescriptor(&trans_out_desc));
-    CALL_CNNL(cnnlCreateTransposeDescriptor(&trans_desc));
+    CALL_CNNL(mluOpAcquireCnnlTransposeDescriptor(handle, &trans_desc));
     CHECK_RETURN(api_name, mluOpSetTensorDescriptor(
                                trans_in_desc, MLUOP_LAYOUT_ARRAY,
                                filters_desc->getDtype(), 3, trans_in_shape));
@@ -326,7 +386,42 @@ static mluOpStatus_t mainIndiceConvolutionForward(
     }
     CHECK_RETURN(api_name, mluOpDestroyTensorDescriptor(trans_in_desc));
     CHECK_RETURN(api_name, mluOpDestroyTensorDescriptor(trans_out_desc));
-    CALL_CNNL(cnnlDestroyTransposeDescriptor(trans_desc));
+    CALL_CNNL(mluOpReleaseCnnlTransposeDescriptor(handle, trans_desc));
+  }
+
+  IndiceConvGroups groups;
+  if (useGroupedIndiceConv(handle, indice_num, num_filter, &groups)) {
+    mluOpMatMulAlgoKey shape = {groups.pad_rows,
+                                ci,
+                                co,
+                                matmul_is_transA,
+                                matmul_is_transB,
+                                features_desc->getDtype(),
+                                features_out_desc->getDtype(),
+                                features_desc->getDtype(),
+                                (int32_t)matmul_computetype,
+                                (int32_t)matmul_allow_TF32,
+                                num_filter};
+    size_t workspaceSize_grouped = 0;
+    CHECK_RETURN(api_name,
+                 groupedIndiceConvolutionForward(
+                     api_name, handle, groups, shape, features_desc, features,
+                     validFilters_ptr, indice_pairs, num_act_in,
+                     (int8_t *)workspace + workspaceSize_transpose,
+                     is_workspace_compute ? &workspaceSize_grouped : nullptr,
+                     features_out_desc, features_out));
+    if (is_workspace_compute) {
+      *workspace_size =
+          workspaceSize_transpose +
+          std::max(workspaceSize_addN_tmp + workspaceSize_transposeExtra,
+                   workspaceSize_grouped);
+    }
+    CHECK_RETURN(api_name, mluOpDestroyTensorDescriptor(active_indice_desc));
+    CHECK_RETURN(api_name, mluOpDestroyTensorDescriptor(matmul_a_desc));
+    CHECK_RETURN(api_name, mluOpDestroyTensorDescriptor(matmul_b_desc));
+    CHECK_RETURN(api_name, mluOpDestroyTensorDescriptor(matmul_c_desc));
+    CALL_CNNL(mluOpReleaseCnnlMatMulDescriptor(handle, matmul_desc));
+    return MLUOP_STATUS_SUCCESS;
   }
 
   // invoke gather_nd and matmul to finish indice conv
@@ -383,24 +478,19 @@ static mluOpStatus_t mainIndiceConvolutionForward(
     CHECK_RETURN(api_name, mluOpSetTensorDescriptor(
                                matmul_c_desc, MLUOP_LAYOUT_ARRAY,
                                features_desc->getDtype(), 2, matmul_c_shape));
-    {
-      DEFINE_CREATE_AND_SET_CNNL_HANDLE(handle, cnnl_handle);
-      DEFINE_CREATE_AND_SET_CNNL_TENSOR_DESCRIPTOR(matmul_a_desc, cnnl_a_desc);
-      DEFINE_CREATE_AND_SET_CNNL_TENSOR_DESCRIPTOR(matmul_b_desc, cnnl_b_desc);
-      DEFINE_CREATE_AND_SET_CNNL_TENSOR_DESCRIPTOR(matmul_c_desc, cnnl_c_desc);
-      DEFINE_CREATE_AND_SET_CNNL_TENSOR_DESCRIPTOR(matmul_c_desc, cnnl_d_desc);
-      CALL_CNNL(cnnlGetMatMulAlgoHeuristic(
-          cnnl_handle, matmul_desc, cnnl_a_desc, cnnl_b_desc, cnnl_c_desc,
-          cnnl_d_desc, nullptr, matmul_requested_algo, &heuristic_result,
-          &matmul_recieved_algo));
-      DESTROY_CNNL_TENSOR_DESCRIPTOR(cnnl_a_desc);
-      DESTROY_CNNL_TENSOR_DESCRIPTOR(cnnl_b_desc);
-      DESTROY_CNNL_TENSOR_DESCRIPTOR(cnnl_c_desc);
-      DESTROY_CNNL_TENSOR_DESCRIPTOR(cnnl_d_desc);
-      DESTROY_CNNL_HANDLE(cnnl_handle);
-    }
-    CALL_CNNL(cnnlGetMatMulHeuristicResult(heuristic_result, matmul_algo,
-                                           &tempSize_matmulExtra));
+    // workspace query and compute pick the algo from the same cache entry
+    mluOpMatMulAlgoKey matmul_key = {mluOpMatMulDimBucket(active_point_num),
+                                     ci,
+                                     co,
+                                     matmul_is_transA,
+                                     matmul_is_transB,
+                                     features_desc->getDtype(),
+                                     features_out_desc->getDtype(),
+                                     features_desc->getDtype(),
+                                     (int32_t)matmul_computetype,
+                                     (int32_t)matmul_allow_TF32};
+    CALL_CNNL(mluOpGetMatMulAlgo(handle, matmul_key, &matmul_algo,
+                                 &tempSize_matmulExtra));
     uint32_t addn_num = 2;
     {
       DEFINE_CREATE_AND_SET_CNNL_HANDLE(handle, cnnl_handle);
@@ -564,13 +654,12 @@ static mluOpStatus_t mainIndiceConvolutionForward(
   CHECK_RETURN(api_name, mluOpDestroyTensorDescriptor(matmul_a_desc));
   CHECK_RETURN(api_name, mluOpDestroyTensorDescriptor(matmul_b_desc));
   CHECK_RETURN(api_name, mluOpDestroyTensorDescriptor(matmul_c_desc));
-  CALL_CNNL(cnnlDestroyMatMulDescriptor(matmul_desc));
-  CALL_CNNL(cnnlDestroyMatMulAlgo(matmul_algo));
-  CALL_CNNL(cnnlDestroyMatMulHeuristicResult(heuristic_result));
+  CALL_CNNL(mluOpReleaseCnnlMatMulDescriptor(handle, matmul_desc));
   return MLUOP_STATUS_SUCCESS;
 }
 
-// workspace composition:
+// workspace composition, see groupedIndiceConvolutionForward for the
+// grouped path:
 // | transposed filters | transpose_extra |
 //                      ||
 //                      \/
@@ -0,0 +1,290 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include "kernels/sparse_conv/indice_convolution_grouped/indice_convolution_grouped.h"
+
+#include <algorithm>
+#include <climits>
+
+#include "core/context.h"
+#include "core/logging.h"
+#include "core/runtime/device.h"
+#include "core/tensor.h"
+#include "core/type.h"
+#include "kernels/kernel.h"
+
+bool useGroupedIndiceConv(mluOpHandle_t handle, const int64_t indice_num[],
+                          const int32_t kernel_volume,
+                          IndiceConvGroups *groups) {
+  if (handle->atomics_mode != MLUOP_ATOMICS_ALLOWED ||
+      kernel_volume > INDICE_CONV_GROUPED_MAX_OFFSETS) {
+    return false;
+  }
+  int64_t total_rows = 0;
+  int64_t pad_rows = 0;
+  for (int32_t k = 0; k < kernel_volume; ++k) {
+    total_rows += indice_num[k];
+    pad_rows = std::max(pad_rows, indice_num[k]);
+  }
+  const int64_t padded_rows = kernel_volume * pad_rows;
+  if (total_rows == 0 || padded_rows > INT32_MAX) {
+    return false;
+  }
+  if (padded_rows > INDICE_CONV_GROUPED_PAD_RATIO * total_rows &&
+      padded_rows > INDICE_CONV_GROUPED_SMALL_ROWS) {
+    return false;
+  }
+  groups->offset_num = kernel_volume;
+  groups->pad_rows = (int32_t)pad_rows;
+  for (int32_t k = 0; k < kernel_volume; ++k) {
+    groups->count[k] = (int32_t)indice_num[k];
+  }
+  return true;
+}
+
+static void policyFuncPackPairs(const mluOpHandle_t handle,
+                                const int64_t slot_num, cnrtDim3_t *k_dim,
+                                cnrtFunctionType_t *k_type) {
+  k_dim->x = mluop::runtime::getCoreNumOfEachUnionCapability(handle);
+  const int64_t cluster_num =
+      mluop::runtime::getClusterLimitCapability(handle);
+  k_dim->y = std::min((slot_num + k_dim->x - 1) / k_dim->x, cluster_num);
+  k_dim->z = 1;
+  *k_type = cnrtFuncTypeUnion1;
+}
+
+mluOpStatus_t packIndicePairs(mluOpHandle_t handle, const std::string api_name,
+                              const void *indice_pairs,
+                              const int32_t num_act_in,
+                              const IndiceConvGroups &groups,
+                              const int32_t gather_side,
+                              const int32_t gather_pad,
+                              const int32_t scatter_pad, void *gather_indices,
+                              void *scatter_indices) {
+  cnrtDim3_t k_dim;
+  cnrtFunctionType_t k_type;
+  policyFuncPackPairs(handle, (int64_t)groups.offset_num * groups.pad_rows,
+                      &k_dim, &k_type);
+  VLOG(5) << api_name << " Launch KernelIndiceConvPackPairs <<<Union"
+          << k_type / CORE_DIM << ", " << k_dim.x << ", " << k_dim.y << ", "
+          << k_dim.z << ">>>.";
+  CHECK_RETURN(api_name,
+               KernelIndiceConvPackPairs(
+                   k_dim, k_type, handle->queue, indice_pairs, num_act_in,
+                   groups, gather_side, gather_pad, scatter_pad,
+                   gather_indices, scatter_indices));
+  return MLUOP_STATUS_SUCCESS;
+}
+
+mluOpStatus_t groupedGather(mluOpHandle_t handle, const std::string api_name,
+                            const mluOpTensorDescriptor_t src_desc,
+                            const void *src, const void *indices,
+                            const int64_t rows, void *output) {
+  mluOpTensorDescriptor_t indices_desc, output_desc;
+  CHECK_RETURN(api_name, mluOpCreateTensorDescriptor(&indices_desc));
+  CHECK_RETURN(api_name, mluOpCreateTensorDescriptor(&output_desc));
+  int64_t indices_dims[2] = {rows, 1};
+  int64_t output_dims[2] = {rows, src_desc->getDimIndex(1)};
+  CHECK_RETURN(api_name, mluOpSetTensorDescriptor_v2(
+                             indices_desc, MLUOP_LAYOUT_ARRAY,
+                             MLUOP_DTYPE_INT32, 2, indices_dims));
+  CHECK_RETURN(api_name, mluOpSetTensorDescriptor_v2(
+                             output_desc, MLUOP_LAYOUT_ARRAY,
+                             src_desc->getDtype(), 2, output_dims));
+  {
+    DEFINE_CREATE_AND_SET_CNNL_HANDLE(handle, cnnl_handle);
+    DEFINE_CREATE_AND_SET_CNNL_TENSOR_DESCRIPTOR(src_desc, cnnl_params_desc);
+    DEFINE_CREATE_AND_SET_CNNL_TENSOR_DESCRIPTOR(indices_desc,
+                                                 cnnl_indices_desc);
+    DEFINE_CREATE_AND_SET_CNNL_TENSOR_DESCRIPTOR(output_desc,
+                                                 cnnl_output_desc);
+    CALL_CNNL(cnnlGatherNd_v2(cnnl_handle, 0, cnnl_params_desc, src,
+                              cnnl_indices_desc, indices, cnnl_output_desc,
+                              output));
+    DESTROY_CNNL_TENSOR_DESCRIPTOR(cnnl_params_desc);
+    DESTROY_CNNL_TENSOR_DESCRIPTOR(cnnl_indices_desc);
+    DESTROY_CNNL_TENSOR_DESCRIPTOR(cnnl_output_desc);
+    DESTROY_CNNL_HANDLE(cnnl_handle);
+  }
+  CHECK_RETURN(api_name, mluOpDestroyTensorDescriptor(indices_desc));
+  CHECK_RETURN(api_name, mluOpDestroyTensorDescriptor(output_desc));
+  return MLUOP_STATUS_SUCCESS;
+}
+
+// Fills the [rows + 1, cols] padded with zeros and copies the [rows, cols]
+// src_desc over its first rows unless src is nullptr.
+static mluOpStatus_t fillPaddedRows(mluOpHandle_t handle,
+                                    const std::string api_name,
+                                    const mluOpTensorDescriptor_t src_desc,
+                                    const void *src, void *padded) {
+  mluOpTensorDescriptor_t padded_desc;
+  CHECK_RETURN(api_name, mluOpCreateTensorDescriptor(&padded_desc));
+  int64_t padded_dims[2] = {src_desc->getDimIndex(0) + 1,
+                            src_desc->getDimIndex(1)};
+  CHECK_RETURN(api_name, mluOpSetTensorDescriptor_v2(
+                             padded_desc, MLUOP_LAYOUT_ARRAY,
+                             src_desc->getDtype(), 2, padded_dims));
+  float init_val = 0;
+  {
+    DEFINE_CREATE_AND_SET_CNNL_HANDLE(handle, cnnl_handle);
+    DEFINE_CREATE_AND_SET_CNNL_TENSOR_DESCRIPTOR(padded_desc,
+                                                 cnnl_padded_desc);
+    DEFINE_CREATE_AND_SET_CNNL_TENSOR_DESCRIPTOR(src_desc, cnnl_src_desc);
+    CALL_CNNL(cnnlFill_v3(cnnl_handle, CNNL_POINTER_MODE_HOST, &init_val,
+                          cnnl_padded_desc, padded));
+    if (src != nullptr) {
+      CALL_CNNL(cnnlCopy_v2(cnnl_handle, cnnl_src_desc, src, cnnl_src_desc,
+                            padded, NULL, 0));
+    }
+    DESTROY_CNNL_TENSOR_DESCRIPTOR(cnnl_padded_desc);
+    DESTROY_CNNL_TENSOR_DESCRIPTOR(cnnl_src_desc);
+    DESTROY_CNNL_HANDLE(cnnl_handle);
+  }
+  CHECK_RETURN(api_name, mluOpDestroyTensorDescriptor(padded_desc));
+  return MLUOP_STATUS_SUCCESS;
+}
+
+mluOpStatus_t groupedScatterAdd(mluOpHandle_t handle,
+                                const std::string api_name,
+                                const void *indices, const int64_t rows,
+                                const void *updates,
+                                const mluOpTensorDescriptor_t output_desc,
+                                void *output, void *scatter_buffer) {
+  const int64_t output_rows = output_desc->getDimIndex(0);
+  const int64_t channels = output_desc->getDimIndex(1);
+  CHECK_RETURN(api_name, fillPaddedRows(handle, api_name, output_desc,
+                                        nullptr, scatter_buffer));
+
+  mluOpTensorDescriptor_t indices_desc, updates_desc, buffer_desc;
+  CHECK_RETURN(api_name, mluOpCreateTensorDescriptor(&indices_desc));
+  CHECK_RETURN(api_name, mluOpCreateTensorDescriptor(&updates_desc));
+  CHECK_RETURN(api_name, mluOpCreateTensorDescriptor(&buffer_desc));
+  int64_t indices_dims[2] = {rows, 1};
+  int64_t updates_dims[2] = {rows, channels};
+  int64_t buffer_dims[2] = {output_rows + 1, channels};
+  CHECK_RETURN(api_name, mluOpSetTensorDescriptor_v2(
+                             indices_desc, MLUOP_LAYOUT_ARRAY,
+                             MLUOP_DTYPE_INT32, 2, indices_dims));
+  CHECK_RETURN(api_name, mluOpSetTensorDescriptor_v2(
+                             updates_desc, MLUOP_LAYOUT_ARRAY,
+                             output_desc->getDtype(), 2, updates_dims));
+  CHECK_RETURN(api_name, mluOpSetTensorDescriptor_v2(
+                             buffer_desc, MLUOP_LAYOUT_ARRAY,
+                             output_desc->getDtype(), 2, buffer_dims));
+  {
+    DEFINE_CREATE_AND_SET_CNNL_HANDLE(handle, cnnl_handle);
+    DEFINE_CREATE_AND_SET_CNNL_TENSOR_DESCRIPTOR(indices_desc,
+                                                 cnnl_indices_desc);
+    DEFINE_CREATE_AND_SET_CNNL_TENSOR_DESCRIPTOR(updates_desc,
+                                                 cnnl_updates_desc);
+    DEFINE_CREATE_AND_SET_CNNL_TENSOR_DESCRIPTOR(buffer_desc,
+                                                 cnnl_buffer_desc);
+    DEFINE_CREATE_AND_SET_CNNL_TENSOR_DESCRIPTOR(output_desc,
+                                                 cnnl_output_desc);
+    CALL_CNNL(cnnlScatterNd_v2(cnnl_handle, CNNL_SCATTERND_ADD,
+                               cnnl_indices_desc, indices, cnnl_updates_desc,
+                               updates, cnnl_buffer_desc, scatter_buffer,
+                               cnnl_buffer_desc, scatter_buffer));
+    // the dummy row is last, the others are laid out as output
+    CALL_CNNL(cnnlCopy_v2(cnnl_handle, cnnl_output_desc, scatter_buffer,
+                          cnnl_output_desc, output, NULL, 0));
+    DESTROY_CNNL_TENSOR_DESCRIPTOR(cnnl_indices_desc);
+    DESTROY_CNNL_TENSOR_DESCRIPTOR(cnnl_updates_desc);
+    DESTROY_CNNL_TENSOR_DESCRIPTOR(cnnl_buffer_desc);
+    DESTROY_CNNL_TENSOR_DESCRIPTOR(cnnl_output_desc);
+    DESTROY_CNNL_HANDLE(cnnl_handle);
+  }
+  CHECK_RETURN(api_name, mluOpDestroyTensorDescriptor(indices_desc));
+  CHECK_RETURN(api_name, mluOpDestroyTensorDescriptor(updates_desc));
+  CHECK_RETURN(api_name, mluOpDestroyTensorDescriptor(buffer_desc));
+  return MLUOP_STATUS_SUCCESS;
+}
+
+mluOpStatus_t groupedAppendZeroRow(mluOpHandle_t handle,
+                                   const std::string api_name,
+                                   const mluOpTensorDescriptor_t src_desc,
+                                   const void *src, void *padded) {
+  return fillPaddedRows(handle, api_name, src_desc, src, padded);
+}
+
+mluOpStatus_t groupedBatchMatMul(mluOpHandle_t handle,
+                                 const std::string api_name,
+                                 const mluOpMatMulAlgoKey &shape,
+                                 const mluOpMatMulAlgoKey &algo_key,
+                                 const void *a, const void *b, void *c,
+                                 void *workspace) {
+  int64_t a_dims[3] = {shape.batch, shape.trans_a ? shape.k : shape.m,
+                       shape.trans_a ? shape.m : shape.k};
+  int64_t b_dims[3] = {shape.batch, shape.trans_b ? shape.n : shape.k,
+                       shape.trans_b ? shape.k : shape.n};
+  int64_t c_dims[3] = {shape.batch, shape.m, shape.n};
+  mluOpTensorDescriptor_t a_desc, b_desc, c_desc;
+  CHECK_RETURN(api_name, mluOpCreateTensorDescriptor(&a_desc));
+  CHECK_RETURN(api_name, mluOpCreateTensorDescriptor(&b_desc));
+  CHECK_RETURN(api_name, mluOpCreateTensorDescriptor(&c_desc));
+  CHECK_RETURN(api_name,
+               mluOpSetTensorDescriptor_v2(a_desc, MLUOP_LAYOUT_ARRAY,
+                                           shape.a_dtype, 3, a_dims));
+  CHECK_RETURN(api_name,
+               mluOpSetTensorDescriptor_v2(b_desc, MLUOP_LAYOUT_ARRAY,
+                                           shape.b_dtype, 3, b_dims));
+  CHECK_RETURN(api_name,
+               mluOpSetTensorDescriptor_v2(c_desc, MLUOP_LAYOUT_ARRAY,
+                                           shape.c_dtype, 3, c_dims));
+
+  cnnlMatMulDescriptor_t matmul_desc;
+  CALL_CNNL(mluOpAcquireCnnlMatMulDescriptor(handle, &matmul_desc));
+  CALL_CNNL(cnnlSetMatMulDescAttr(matmul_desc, CNNL_MATMUL_DESC_TRANSA,
+                                  &shape.trans_a, sizeof(int32_t)));
+  CALL_CNNL(cnnlSetMatMulDescAttr(matmul_desc, CNNL_MATMUL_DESC_TRANSB,
+                                  &shape.trans_b, sizeof(int32_t)));
+  if (shape.compute_type >= 0) {
+    CALL_CNNL(cnnlSetMatMulDescAttr(matmul_desc,
+                                    CNNL_MATMUL_DESC_COMPUTE_TYPE,
+                                    &shape.compute_type, sizeof(int32_t)));
+  }
+  CALL_CNNL(cnnlSetMatMulDescAttr(matmul_desc, CNNL_MATMUL_ALLOW_TF32,
+                                  &shape.allow_tf32, sizeof(int32_t)));
+  cnnlMatMulAlgo_t algo;
+  size_t workspace_size = 0;
+  CALL_CNNL(mluOpGetMatMulAlgo(handle, algo_key, &algo, &workspace_size));
+
+  float alpha = 1.0f, beta = 0.0f;
+  {
+    DEFINE_CREATE_AND_SET_CNNL_HANDLE(handle, cnnl_handle);
+    DEFINE_CREATE_AND_SET_CNNL_TENSOR_DESCRIPTOR(a_desc, cnnl_a_desc);
+    DEFINE_CREATE_AND_SET_CNNL_TENSOR_DESCRIPTOR(b_desc, cnnl_b_desc);
+    DEFINE_CREATE_AND_SET_CNNL_TENSOR_DESCRIPTOR(c_desc, cnnl_c_desc);
+    CALL_CNNL(cnnlBatchMatMulEx(cnnl_handle, matmul_desc, algo, &alpha,
+                                cnnl_a_desc, a, cnnl_b_desc, b, &beta,
+                                cnnl_c_desc, c, workspace, workspace_size));
+    DESTROY_CNNL_TENSOR_DESCRIPTOR(cnnl_a_desc);
+    DESTROY_CNNL_TENSOR_DESCRIPTOR(cnnl_b_desc);
+    DESTROY_CNNL_TENSOR_DESCRIPTOR(cnnl_c_desc);
+    DESTROY_CNNL_HANDLE(cnnl_handle);
+  }
+  CALL_CNNL(mluOpReleaseCnnlMatMulDescriptor(handle, matmul_desc));
+  CHECK_RETURN(api_name, mluOpDestroyTensorDescriptor(a_desc));
+  CHECK_RETURN(api_name, mluOpDestroyTensorDescriptor(b_desc));
+  CHECK_RETURN(api_name, mluOpDestroyTensorDescriptor(c_desc));
+  return MLUOP_STATUS_SUCCESS;
+}
@@ -0,0 +1,120 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef KERNELS_SPARSE_CONV_INDICE_CONVOLUTION_GROUPED_INDICE_CONVOLUTION_GROUPED_H_  // NOLINT
+#define KERNELS_SPARSE_CONV_INDICE_CONVOLUTION_GROUPED_INDICE_CONVOLUTION_GROUPED_H_  // NOLINT
+
+#include <string>
+
+#include "core/cnnl_helper.h"
+#include "mlu_op.h"
+
+// Grouped execution of the indice convolutions.
+//
+// The default path runs a gather, a matmul and a scatter for every kernel
+// offset. The grouped path lays the rows of all offsets out in
+// [kernel_volume, pad_rows] slots, pad_rows being the largest indice_num,
+// packs the indices of indice_pairs accordingly with one kernel, and then
+// runs one gather, one cnnlBatchMatMulEx over the offsets and one
+// scatter-add. Padding slots gather any valid row and scatter into a dummy
+// row past the output, or gather a zero row when the padded dimension is
+// summed over.
+//
+// The scatter-add accumulates the rows of all offsets at once, in no fixed
+// order, so the grouped path is only taken when the handle allows atomics.
+// It is also skipped when padding would cost more than the launches it
+// saves, see useGroupedIndiceConv.
+#define INDICE_CONV_GROUPED_MAX_OFFSETS 128
+// padded rows allowed per real row
+#define INDICE_CONV_GROUPED_PAD_RATIO 2
+// below this many padded rows launches dominate and padding is free
+#define INDICE_CONV_GROUPED_SMALL_ROWS (64 * 1024)
+
+struct IndiceConvGroups {
+  int32_t offset_num;
+  int32_t pad_rows;
+  int32_t count[INDICE_CONV_GROUPED_MAX_OFFSETS];
+};
+
+// Fills groups from indice_num and tells whether the grouped path is used.
+// The answer only depends on the handle and its arguments, so that the
+// workspace query and the computation agree.
+bool useGroupedIndiceConv(mluOpHandle_t handle, const int64_t indice_num[],
+                          const int32_t kernel_volume,
+                          IndiceConvGroups *groups);
+
+mluOpStatus_t MLUOP_WIN_API KernelIndiceConvPackPairs(
+    cnrtDim3_t k_dim, cnrtFunctionType_t k_type, cnrtQueue_t queue,
+    const void *indice_pairs, const int32_t num_act_in,
+    const IndiceConvGroups groups, const int32_t gather_side,
+    const int32_t gather_pad, const int32_t scatter_pad, void *gather_indices,
+    void *scatter_indices);
+
+// For every offset k and slot r < pad_rows:
+//   gather_indices[k * pad_rows + r] = indice_pairs[k][gather_side][r]
+//   scatter_indices[k * pad_rows + r] = indice_pairs[k][1 - gather_side][r]
+// when r < count[k], and gather_pad, scatter_pad otherwise. Both outputs
+// hold offset_num * pad_rows int32.
+mluOpStatus_t packIndicePairs(mluOpHandle_t handle, const std::string api_name,
+                              const void *indice_pairs,
+                              const int32_t num_act_in,
+                              const IndiceConvGroups &groups,
+                              const int32_t gather_side,
+                              const int32_t gather_pad,
+                              const int32_t scatter_pad, void *gather_indices,
+                              void *scatter_indices);
+
+// output[i] = src[indices[i]] for rows rows of src_desc.
+mluOpStatus_t groupedGather(mluOpHandle_t handle, const std::string api_name,
+                            const mluOpTensorDescriptor_t src_desc,
+                            const void *src, const void *indices,
+                            const int64_t rows, void *output);
+
+// output = 0, then output[indices[i]] += updates[i] for rows rows of the
+// [output_rows, channels] output_desc. Indices equal to output_rows address
+// a dummy row: the sums are made in scatter_buffer, which holds
+// output_rows + 1 rows, and its first output_rows rows are copied out.
+mluOpStatus_t groupedScatterAdd(mluOpHandle_t handle,
+                                const std::string api_name,
+                                const void *indices, const int64_t rows,
+                                const void *updates,
+                                const mluOpTensorDescriptor_t output_desc,
+                                void *output, void *scatter_buffer);
+
+// Copies the [rows, cols] src_desc to padded, which holds rows + 1 rows,
+// the last one zero, for padding slots to gather.
+mluOpStatus_t groupedAppendZeroRow(mluOpHandle_t handle,
+                                   const std::string api_name,
+                                   const mluOpTensorDescriptor_t src_desc,
+                                   const void *src, void *padded);
+
+// Batched matmul with the shape of shape, run with the memoized algorithm
+// of algo_key, which differs from shape by its bucketed dimension. The
+// workspace must hold the size mluOpGetMatMulAlgo returns for algo_key.
+mluOpStatus_t groupedBatchMatMul(mluOpHandle_t handle,
+                                 const std::string api_name,
+                                 const mluOpMatMulAlgoKey &shape,
+                                 const mluOpMatMulAlgoKey &algo_key,
+                                 const void *a, const void *b, void *c,
+                                 void *workspace);
+
+#endif  // KERNELS_SPARSE_CONV_INDICE_CONVOLUTION_GROUPED_INDICE_CONVOLUTION_GROUPED_H_  // NOLINT
@@ -493,6 +493,52 @@ mluOpCreate(mluOpHandle_t *handle);
 mluOpStatus_t MLUOP_WIN_API
 mluOpUpdateContextInformation(mluOpHandle_t handle);
 
+// Group: Runtime Management
+/*!
+ * @brief Drops the matmul algorithms memoized in the MLU-OPS handle \b handle
+ * by the sparse indice convolution operations, so that the next calls query
+ * cnnlGetMatMulAlgoHeuristic again.
+ *
+ * @param[in] handle
+ * Handle to an MLU-OPS context that is used to manage MLU devices and
+ * queues.
+ *
+ * @par Return
+ * - ::MLUOP_STATUS_SUCCESS, ::MLUOP_STATUS_BAD_PARAM
+ *
+ * @par Data Type
+ * - None.
+ *
+ * @par Data Layout
+ * - None.
+ *
+ * @par Scale Limitation
+ * - None.
+ *
+ * @par API Dependency
+ * - None.
+ *
+ * @par Note
+ * - The algorithms are kept per handle and keyed by the matmul shapes, data
+ *   types and attributes, with the number of active points rounded up to a
+ *   power of two. The workspace size returned by the GetWorkspaceSize
+ *   functions comes from the same entries.
+ * - ::mluOpUpdateContextInformation already drops the algorithms. Call this
+ *   function after other changes of the device configuration it does not
+ *   see.
+ * - Workspace sizes got before the call may not be valid anymore, query them
+ *   again.
+ * - Must not be called while another thread runs an operation on \b handle.
+ *
+ * @par Example
+ * - None.
+ *
+ * @par Reference
+ * - None.
+ */
+mluOpStatus_t MLUOP_WIN_API
+mluOpInvalidateMatMulAlgoCache(mluOpHandle_t handle);
+
 // Group: Runtime Management
 /*!
  * @brief Releases the resources of the specified MLU-OPS handle \b handle that was
@@ -9749,6 +9795,9 @@ mluOpGetIndiceConvolutionBackwardDataWorkspaceSize(mluOpHandle_t handle,
  *   than the dims[0] of \b input_grad.
  * - The data values of tensor slices indice_pairs[:,1,:] should be no larger
  *   than the dims[0] of \b output_grad.
+ * - When the atomics mode of \b handle is ::MLUOP_ATOMICS_ALLOWED, all the
+ *   kernel offsets may be computed by one batched matrix multiplication,
+ *   in which case the rows are summed in no fixed order.
  *
  * @par Example
  * - None.
@@ -9917,6 +9966,8 @@ mluOpGetIndiceConvolutionBackwardFilterWorkspaceSize(mluOpHandle_t handle,
  * @par Note
  * - This function is only supported on compute_50 or above.
  * - This function does not support setting tensor onchip data type with fixed-point type.
+ * - When the atomics mode of \b handle is ::MLUOP_ATOMICS_ALLOWED, all the
+ *   kernel offsets may be computed by one batched matrix multiplication.
  *
  * @par Example
  * - The example of the operation is as follows:
@@ -10423,6 +10474,9 @@ mluOpGetIndiceConvolutionForwardWorkspaceSize(mluOpHandle_t handle,
  * - The input indices used to generate \b indice_pairs tensor should not point to
  *   the same location of \b features. Such value is illegal and not checked, the
  *   output result is not guaranteed.
+ * - When the atomics mode of \b handle is ::MLUOP_ATOMICS_ALLOWED, all the
+ *   kernel offsets may be computed by one batched matrix multiplication,
+ *   in which case the rows are summed in no fixed order.
  *
  * @par Example
  * - None.
@@ -14498,6 +14552,51 @@ mluOpExecFFT(mluOpHandle_t handle,
 mluOpStatus_t MLUOP_WIN_API
 mluOpDestroyFFTPlan(mluOpFFTPlan_t fft_plan);
 
+// Group:FFT
+/*!
+ * @brief Gets the statistics of the process-wide FFT plan cache used by
+ * ::mluOpMakeFFTPlanMany. Plans made with the same handle device, FFT size, data types,
+ * dimensions and strides share their factors, twiddles and DFT matrices, so a cache hit
+ * skips the host-side generation of these tables.
+ *
+ * @param[out] hits
+ * Pointer to the host memory that holds the number of ::mluOpMakeFFTPlanMany calls served
+ * from the cache. It can be NULL.
+ * @param[out] misses
+ * Pointer to the host memory that holds the number of ::mluOpMakeFFTPlanMany calls that
+ * built a new plan. It can be NULL.
+ * @param[out] cached_plans
+ * Pointer to the host memory that holds the number of plans currently kept in the cache.
+ * It can be NULL.
+ *
+ * @par Return
+ * - ::MLUOP_STATUS_SUCCESS
+ *
+ * @par Data Type
+ * - None.
+ *
+ * @par Data Layout
+ * - None.
+ *
+ * @par Scale Limitation
+ * - None.
+ *
+ * @par API Dependency
+ * - None.
+ *
+ * @par Note
+ * - The cache keeps the least recently used 64 plans by default. The capacity can be set by
+ *   the environment variable MLUOP_FFT_PLAN_CACHE_SIZE, and 0 disables the cache.
+ *
+ * @par Example.
+ * - None.
+ *
+ * @par Reference.
+ * - None.
+ */
+mluOpStatus_t MLUOP_WIN_API
+mluOpGetFFTPlanCacheStats(size_t *hits, size_t *misses, size_t *cached_plans);
+
 // Group:Lgamma
 /*!
  * @brief Computes the lgamma value for every element of the input tensor \b x
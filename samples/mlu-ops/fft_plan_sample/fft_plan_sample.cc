@@ -0,0 +1,162 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+
+// Measures the host time of mluOpMakeFFTPlanMany, which is dominated by the
+// generation of twiddles and DFT matrices for large FFT sizes. Run it once
+// with MLUOP_FFT_HOST_THREAD_NUM=1 and once with the default thread number,
+// or against an older libmluops.so, to compare plan-build times.
+
+#include <stdlib.h>
+#include <time.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "cnrt.h"
+#include "mlu_op.h"
+
+void mluOpCheck(mluOpStatus_t result, char const *const func,
+                const char *const file, int const line) {
+  if (result) {
+    std::string error = "\"" + std::string(mluOpGetErrorString(result)) +
+                        " in " + std::string(func) + "\"";
+    throw std::runtime_error(error);
+  }
+}
+
+#define MLUOP_CHECK(val) mluOpCheck((val), #val, __FILE__, __LINE__)
+
+struct HostTimer {
+  struct timespec t0 = {0, 0};
+  struct timespec t1 = {0, 0};
+  double tv_nsec = 0.0;
+  double tv_sec = 0.0;
+  double tv_usec = 0.0;
+  void start() { clock_gettime(CLOCK_MONOTONIC, &t0); }
+  void stop() {
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    tv_nsec = (double)t1.tv_nsec - (double)t0.tv_nsec;
+    tv_sec = (double)t1.tv_sec - (double)t0.tv_sec;
+    tv_usec = tv_nsec / 1000 + tv_sec * 1000 * 1000;
+  }
+};
+
+struct PlanCase {
+  const char *name;
+  mluOpDataType_t input_dtype;
+  mluOpDataType_t output_dtype;
+  int n;
+};
+
+void initDevice(int &dev, cnrtQueue_t &queue, mluOpHandle_t &handle) {
+  CNRT_CHECK(cnrtGetDevice(&dev));
+  CNRT_CHECK(cnrtSetDevice(dev));
+
+  CNRT_CHECK(cnrtQueueCreate(&queue));
+
+  mluOpCreate(&handle);
+  mluOpSetQueue(handle, queue);
+}
+
+double makePlanTime(mluOpHandle_t handle, const PlanCase &param,
+                    const int repeat) {
+  const int batch = 1;
+  const int input_len =
+      param.input_dtype == MLUOP_DTYPE_COMPLEX_FLOAT &&
+              param.output_dtype == MLUOP_DTYPE_FLOAT
+          ? param.n / 2 + 1
+          : param.n;
+  const int output_len =
+      param.input_dtype == MLUOP_DTYPE_FLOAT ? param.n / 2 + 1 : param.n;
+  int input_dims[2] = {batch, input_len};
+  int output_dims[2] = {batch, output_len};
+
+  mluOpTensorDescriptor_t input_desc, output_desc;
+  MLUOP_CHECK(mluOpCreateTensorDescriptor(&input_desc));
+  MLUOP_CHECK(mluOpCreateTensorDescriptor(&output_desc));
+  MLUOP_CHECK(mluOpSetTensorDescriptor(input_desc, MLUOP_LAYOUT_ARRAY,
+                                       param.input_dtype, 2, input_dims));
+  MLUOP_CHECK(mluOpSetTensorDescriptor(output_desc, MLUOP_LAYOUT_ARRAY,
+                                       param.output_dtype, 2, output_dims));
+  MLUOP_CHECK(mluOpSetTensorDescriptorOnchipDataType(input_desc,
+                                                     param.input_dtype));
+
+  HostTimer timer;
+  double total_usec = 0.0;
+  for (int i = 0; i < repeat; ++i) {
+    mluOpFFTPlan_t fft_plan;
+    size_t reservespace_size = 0, workspace_size = 0;
+    MLUOP_CHECK(mluOpCreateFFTPlan(&fft_plan));
+    timer.start();
+    MLUOP_CHECK(mluOpMakeFFTPlanMany(handle, fft_plan, input_desc,
+                                     output_desc, 1, &param.n,
+                                     &reservespace_size, &workspace_size));
+    timer.stop();
+    total_usec += timer.tv_usec;
+    MLUOP_CHECK(mluOpDestroyFFTPlan(fft_plan));
+  }
+
+  MLUOP_CHECK(mluOpDestroyTensorDescriptor(input_desc));
+  MLUOP_CHECK(mluOpDestroyTensorDescriptor(output_desc));
+  return total_usec / repeat;
+}
+
+int main(int argc, char *argv[]) {
+  const int repeat = argc > 1 ? atoi(argv[1]) : 5;
+  if (repeat <= 0) {
+    printf("Please enter correct parameters.\n");
+    printf("e.g.\n./fft_plan_sample [repeat]\n");
+    return 0;
+  }
+  // every plan must be built from scratch to be measured
+  setenv("MLUOP_FFT_PLAN_CACHE_SIZE", "0", 1);
+  const char *thread_num = getenv("MLUOP_FFT_HOST_THREAD_NUM");
+  printf("MLUOP_FFT_HOST_THREAD_NUM: %s\n",
+         thread_num == nullptr ? "default" : thread_num);
+
+  int dev;
+  mluOpHandle_t handle = nullptr;
+  cnrtQueue_t queue = nullptr;
+  initDevice(dev, queue, handle);
+
+  std::vector<PlanCase> cases;
+  for (int n : {4096, 65536, 1048576, 3000000}) {
+    cases.push_back(
+        {"rfft", MLUOP_DTYPE_FLOAT, MLUOP_DTYPE_COMPLEX_FLOAT, n});
+    cases.push_back(
+        {"irfft", MLUOP_DTYPE_COMPLEX_FLOAT, MLUOP_DTYPE_FLOAT, n});
+    cases.push_back(
+        {"c2c", MLUOP_DTYPE_COMPLEX_FLOAT, MLUOP_DTYPE_COMPLEX_FLOAT, n});
+  }
+
+  printf("---------------------------------\n");
+  for (const auto &param : cases) {
+    double usec = makePlanTime(handle, param, repeat);
+    printf("[%-5s n = %-8d]: %12.1lf us\n", param.name, param.n, usec);
+  }
+
+  CNRT_CHECK(cnrtQueueDestroy(queue));
+  MLUOP_CHECK(mluOpDestroy(handle));
+  return 0;
+}
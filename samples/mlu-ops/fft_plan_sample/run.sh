@@ -0,0 +1,7 @@
+#!/bin/bash
+
+# plan-build time on the calling thread only
+MLUOP_FFT_HOST_THREAD_NUM=1 ./build/bin/fft_plan_sample 5
+
+# plan-build time with the default host workers
+./build/bin/fft_plan_sample 5
@@ -44,6 +44,8 @@ fi
 # Test all operators cases.
 cd build/test/
 ./mluop_gtest
+# grouped indice convolutions run only when atomics are allowed
+MLUOP_GTEST_ATOMICS_MODE=ON ./mluop_gtest --gtest_filter="indice_convolution_*"
   
 if [[ -n "${CASES_DIR}" && -a "${CASES_DIR}" ]]; then
     ./mluop_gtest --cases_dir="${CASES_DIR}"
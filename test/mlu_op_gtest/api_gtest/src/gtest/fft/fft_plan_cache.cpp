@@ -0,0 +1,235 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <stdlib.h>
+#include <iostream>
+#include <vector>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "mlu_op.h"
+#include "api_test_tools.h"
+#include "core/context.h"
+#include "core/logging.h"
+#include "kernels/fft/fft.h"
+
+namespace mluopapitest {
+// The plan cache is process-wide and sized when it is first used, so every
+// test runs in a new process with a cache of FFT_PLAN_CACHE_TEST_SIZE plans
+// that no other test has filled.
+#define FFT_PLAN_CACHE_TEST_SIZE "2"
+
+class fft_plan_cache : public testing::Test {
+ public:
+  // Makes a plan of 2 batches of n points. r2c for MLUOP_DTYPE_FLOAT, c2c
+  // for MLUOP_DTYPE_COMPLEX_FLOAT, dist is the distance between the input
+  // batches.
+  mluOpFFTPlan_t makePlan(int n, int64_t dist, mluOpDataType_t dtype) {
+    mluOpFFTPlan_t fft_plan = nullptr;
+    mluOpTensorDescriptor_t input_desc = nullptr;
+    mluOpTensorDescriptor_t output_desc = nullptr;
+    const int64_t output_n = dtype == MLUOP_DTYPE_FLOAT ? n / 2 + 1 : n;
+    std::vector<int64_t> input_dims{2, n};
+    std::vector<int64_t> input_dim_stride{dist, 1};
+    std::vector<int64_t> output_dims{2, output_n};
+    std::vector<int64_t> output_dim_stride{output_n, 1};
+    MLUOP_CHECK(mluOpCreateTensorDescriptor(&input_desc));
+    MLUOP_CHECK(mluOpSetTensorDescriptorEx_v2(
+        input_desc, MLUOP_LAYOUT_ARRAY, dtype, input_dims.size(),
+        input_dims.data(), input_dim_stride.data()));
+    MLUOP_CHECK(mluOpSetTensorDescriptorOnchipDataType(input_desc,
+                                                       MLUOP_DTYPE_FLOAT));
+    MLUOP_CHECK(mluOpCreateTensorDescriptor(&output_desc));
+    MLUOP_CHECK(mluOpSetTensorDescriptorEx_v2(
+        output_desc, MLUOP_LAYOUT_ARRAY, MLUOP_DTYPE_COMPLEX_FLOAT,
+        output_dims.size(), output_dims.data(), output_dim_stride.data()));
+
+    int rank = 1;
+    int fft_n[1] = {n};
+    size_t reservespace_size = 0;
+    size_t workspace_size = 0;
+    MLUOP_CHECK(mluOpCreateFFTPlan(&fft_plan));
+    MLUOP_CHECK(mluOpMakeFFTPlanMany(handle_, fft_plan, input_desc,
+                                     output_desc, rank, fft_n,
+                                     &reservespace_size, &workspace_size));
+    MLUOP_CHECK(mluOpDestroyTensorDescriptor(input_desc));
+    MLUOP_CHECK(mluOpDestroyTensorDescriptor(output_desc));
+    plans_.push_back(fft_plan);
+    return fft_plan;
+  }
+
+  void destroyPlan(mluOpFFTPlan_t fft_plan) {
+    for (auto iter = plans_.begin(); iter != plans_.end(); ++iter) {
+      if (*iter == fft_plan) {
+        plans_.erase(iter);
+        break;
+      }
+    }
+    MLUOP_CHECK(mluOpDestroyFFTPlan(fft_plan));
+  }
+
+  // Counters of the plan cache since the previous call.
+  void expectStats(size_t hits, size_t misses, size_t cached_plans) {
+    size_t total_hits = 0;
+    size_t total_misses = 0;
+    size_t total_cached_plans = 0;
+    MLUOP_CHECK(mluOpGetFFTPlanCacheStats(&total_hits, &total_misses,
+                                          &total_cached_plans));
+    EXPECT_EQ(hits, total_hits - hits_);
+    EXPECT_EQ(misses, total_misses - misses_);
+    EXPECT_EQ(cached_plans, total_cached_plans);
+    hits_ = total_hits;
+    misses_ = total_misses;
+  }
+
+  // Runs test with a new plan cache in this process, and exits with the
+  // result of its expectations.
+  template <typename Func>
+  void runWithNewCache(Func test) {
+    try {
+      MLUOP_CHECK(mluOpCreate(&handle_));
+      MLUOP_CHECK(mluOpGetFFTPlanCacheStats(&hits_, &misses_, nullptr));
+      test();
+      destroy();
+    } catch (const std::exception &e) {
+      std::cerr << "MLUOPAPIGTEST: catched " << e.what()
+                << " in fft_plan_cache" << std::endl;
+      exit(1);
+    }
+    exit(HasFailure() ? 1 : 0);
+  }
+
+ protected:
+  virtual void SetUp() {
+    ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+    setenv("MLUOP_FFT_PLAN_CACHE_SIZE", FFT_PLAN_CACHE_TEST_SIZE, 1);
+  }
+
+  virtual void TearDown() { unsetenv("MLUOP_FFT_PLAN_CACHE_SIZE"); }
+
+  void destroy() {
+    while (!plans_.empty()) {
+      destroyPlan(plans_.back());
+    }
+    if (handle_) {
+      CNRT_CHECK(cnrtQueueSync(handle_->queue));
+      VLOG(4) << "Destroy handle_";
+      MLUOP_CHECK(mluOpDestroy(handle_));
+      handle_ = nullptr;
+    }
+  }
+
+ private:
+  mluOpHandle_t handle_ = nullptr;
+  std::vector<mluOpFFTPlan_t> plans_;
+  size_t hits_ = 0;
+  size_t misses_ = 0;
+};
+
+TEST_F(fft_plan_cache, hit_on_identical_plan) {
+  EXPECT_EXIT(runWithNewCache([this]() {
+                mluOpFFTPlan_t first = makePlan(400, 400, MLUOP_DTYPE_FLOAT);
+                expectStats(0, 1, 1);
+                mluOpFFTPlan_t second = makePlan(400, 400, MLUOP_DTYPE_FLOAT);
+                expectStats(1, 0, 1);
+                ASSERT_NE(nullptr, first->tables);
+                EXPECT_EQ(first->tables, second->tables);
+                EXPECT_EQ(first->twiddles, second->twiddles);
+                EXPECT_EQ(first->factors, second->factors);
+                EXPECT_EQ(first->workspace_size, second->workspace_size);
+                EXPECT_EQ(first->reservespace_size,
+                          second->reservespace_size);
+                EXPECT_NE(first->input_desc, second->input_desc);
+              }),
+              ::testing::ExitedWithCode(0), "");
+}
+
+TEST_F(fft_plan_cache, miss_on_changed_n_stride_or_dtype) {
+  EXPECT_EXIT(runWithNewCache([this]() {
+                mluOpFFTPlan_t plan = makePlan(400, 400, MLUOP_DTYPE_FLOAT);
+                expectStats(0, 1, 1);
+                mluOpFFTPlan_t other_n = makePlan(256, 400, MLUOP_DTYPE_FLOAT);
+                expectStats(0, 1, 2);
+                EXPECT_NE(plan->tables, other_n->tables);
+                mluOpFFTPlan_t other_stride =
+                    makePlan(400, 416, MLUOP_DTYPE_FLOAT);
+                expectStats(0, 1, 2);
+                EXPECT_NE(plan->tables, other_stride->tables);
+                mluOpFFTPlan_t other_dtype =
+                    makePlan(400, 400, MLUOP_DTYPE_COMPLEX_FLOAT);
+                expectStats(0, 1, 2);
+                EXPECT_NE(plan->tables, other_dtype->tables);
+              }),
+              ::testing::ExitedWithCode(0), "");
+}
+
+TEST_F(fft_plan_cache, evict_least_recently_used_at_capacity) {
+  EXPECT_EXIT(runWithNewCache([this]() {
+                makePlan(256, 256, MLUOP_DTYPE_FLOAT);
+                makePlan(400, 400, MLUOP_DTYPE_FLOAT);
+                expectStats(0, 2, 2);
+                // 256 becomes the most recently used
+                makePlan(256, 256, MLUOP_DTYPE_FLOAT);
+                expectStats(1, 0, 2);
+                // evicts 400
+                makePlan(512, 512, MLUOP_DTYPE_FLOAT);
+                expectStats(0, 1, 2);
+                makePlan(256, 256, MLUOP_DTYPE_FLOAT);
+                expectStats(1, 0, 2);
+                makePlan(400, 400, MLUOP_DTYPE_FLOAT);
+                expectStats(0, 1, 2);
+              }),
+              ::testing::ExitedWithCode(0), "");
+}
+
+TEST_F(fft_plan_cache, destroy_plan_sharing_tables) {
+  EXPECT_EXIT(runWithNewCache([this]() {
+                mluOpFFTPlan_t first = makePlan(400, 400, MLUOP_DTYPE_FLOAT);
+                mluOpFFTPlan_t second = makePlan(400, 400, MLUOP_DTYPE_FLOAT);
+                expectStats(1, 1, 1);
+                // the cache entry and the second plan keep the tables
+                std::shared_ptr<mluop::fft::PlanTables> tables =
+                    second->tables;
+                void *twiddles = second->twiddles;
+                destroyPlan(first);
+                EXPECT_EQ(3, tables.use_count());
+                mluOpFFTPlan_t third = makePlan(400, 400, MLUOP_DTYPE_FLOAT);
+                expectStats(1, 0, 1);
+                EXPECT_EQ(twiddles, third->twiddles);
+                destroyPlan(second);
+                destroyPlan(third);
+                EXPECT_EQ(2, tables.use_count());
+
+                // once the entry is evicted, the last plan frees the tables
+                mluOpFFTPlan_t last = makePlan(400, 400, MLUOP_DTYPE_FLOAT);
+                makePlan(256, 256, MLUOP_DTYPE_FLOAT);
+                makePlan(512, 512, MLUOP_DTYPE_FLOAT);
+                expectStats(1, 2, 2);
+                EXPECT_EQ(2, tables.use_count());
+                tables.reset();
+                destroyPlan(last);
+                makePlan(400, 400, MLUOP_DTYPE_FLOAT);
+                expectStats(0, 1, 2);
+              }),
+              ::testing::ExitedWithCode(0), "");
+}
+}  // namespace mluopapitest
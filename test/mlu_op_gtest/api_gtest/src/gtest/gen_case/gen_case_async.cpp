@@ -0,0 +1,119 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <stdlib.h>
+#include <chrono>  // NOLINT
+#include <future>  // NOLINT
+#include <iostream>
+#include <vector>
+#include <string>
+#include <thread>  // NOLINT
+
+#include "gtest/gtest.h"
+#include "mlu_op.h"
+#include "api_test_tools.h"
+#include "core/context.h"
+#include "core/gen_case.h"
+#include "core/logging.h"
+
+namespace mluopapitest {
+// An api whose kernel fails after its case is serialized, so that it
+// returns before GEN_CASE_END and leaves its case waiting for the outputs.
+static mluOpStatus_t failAfterSerialize(mluOpHandle_t handle,
+                                        const mluOpTensorDescriptor_t desc,
+                                        const void *input, void *output) {
+  if (MLUOP_GEN_CASE_ON_NEW) {
+    GEN_CASE_START("gen_case_async", "GEN_CASE_ASYNC");
+    GEN_CASE_HANDLE(handle);
+    GEN_CASE_DATA(true, "input", input, desc, 1, -1);
+    GEN_CASE_DATA(false, "output", output, desc, 0, 0);
+    GEN_CASE_TEST_PARAM_NEW(true, true, false, 0.003, 0.003, 0);
+  }
+  CHECK_RETURN("[failAfterSerialize]", MLUOP_STATUS_EXECUTION_FAILED);
+  GEN_CASE_END();
+  return MLUOP_STATUS_SUCCESS;
+}
+
+// Runs failAfterSerialize calls times on a new handle and queue. A call
+// submits the case the previous one left waiting.
+static void runFailingCases(int calls) {
+  const int count = 64;
+  mluOpHandle_t handle = nullptr;
+  cnrtQueue_t queue = nullptr;
+  mluOpTensorDescriptor_t desc = nullptr;
+  void *input = nullptr;
+  void *output = nullptr;
+  MLUOP_CHECK(mluOpCreate(&handle));
+  CNRT_CHECK(cnrtQueueCreate(&queue));
+  MLUOP_CHECK(mluOpSetQueue(handle, queue));
+  MLUOP_CHECK(mluOpCreateTensorDescriptor(&desc));
+  MLUOP_CHECK(mluOpSetTensorDescriptor(desc, MLUOP_LAYOUT_ARRAY,
+                                       MLUOP_DTYPE_FLOAT, 1, &count));
+  CNRT_CHECK(cnrtMalloc(&input, count * sizeof(float)));
+  CNRT_CHECK(cnrtMalloc(&output, count * sizeof(float)));
+  for (int i = 0; i < calls; ++i) {
+    EXPECT_EQ(MLUOP_STATUS_EXECUTION_FAILED,
+              failAfterSerialize(handle, desc, input, output));
+  }
+  CNRT_CHECK(cnrtQueueSync(queue));
+  CNRT_CHECK(cnrtFree(input));
+  CNRT_CHECK(cnrtFree(output));
+  MLUOP_CHECK(mluOpDestroyTensorDescriptor(desc));
+  MLUOP_CHECK(mluOpDestroy(handle));
+  CNRT_CHECK(cnrtQueueDestroy(queue));
+}
+
+static void exitAfterFailingCases() {
+  runFailingCases(2);
+  // the waiting case of this thread is submitted when the thread exits,
+  // after its handle and queue are destroyed
+  std::thread worker(runFailingCases, 1);
+  worker.join();
+  // the waiting case of a thread still alive at exit is never submitted,
+  // the writer flushed at exit must not wait for it
+  std::promise<void> failed;
+  std::thread([&failed]() {
+    runFailingCases(1);
+    failed.set_value();
+    while (true) {
+      std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+  }).detach();
+  failed.get_future().wait();
+  exit(::testing::Test::HasFailure() ? 1 : 0);
+}
+
+TEST(gen_case_async, exit_after_error_of_serialized_case) {
+  // the gen_case environment is read when the library is loaded, so the
+  // cases run in a new process
+  ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+  setenv("MLUOP_GEN_CASE", "2", 1);
+  setenv("MLUOP_GEN_CASE_ASYNC", "1", 1);
+  setenv("MLUOP_GEN_CASE_DUMP_DATA_OUTPUT", "1", 1);
+  setenv("MLUOP_GEN_CASE_DIR", "gen_case_async_test", 1);
+  EXPECT_EXIT(exitAfterFailingCases(), ::testing::ExitedWithCode(0), "");
+  unsetenv("MLUOP_GEN_CASE");
+  unsetenv("MLUOP_GEN_CASE_ASYNC");
+  unsetenv("MLUOP_GEN_CASE_DUMP_DATA_OUTPUT");
+  unsetenv("MLUOP_GEN_CASE_DIR");
+}
+}  // namespace mluopapitest
@@ -95,6 +95,43 @@ class indice_convolution_forward_workspace : public testing::Test {
     return status;
   }
 
+  // Queries the workspace size on the default queue, on a new queue and on
+  // the default queue again, the CNNL handle kept by handle_ has to follow.
+  mluOpStatus_t computeAcrossQueues(size_t sizes[3]) {
+    cnrtQueue_t default_queue = handle_->queue;
+    cnrtQueue_t queue = nullptr;
+    GTEST_CHECK(cnrtSuccess == cnrtQueueCreate(&queue));
+    mluOpStatus_t status = MLUOP_STATUS_SUCCESS;
+    for (int i = 0; i < 3 && status == MLUOP_STATUS_SUCCESS; ++i) {
+      MLUOP_CHECK(mluOpSetQueue(handle_, i == 1 ? queue : default_queue));
+      status = mluOpGetIndiceConvolutionForwardWorkspaceSize(
+          handle_, features_desc_, filters_desc_, indice_pairs_desc_,
+          features_out_desc_, indice_num_.data(), num_act_out_, inverse_,
+          sub_m_, &sizes[i]);
+    }
+    MLUOP_CHECK(mluOpSetQueue(handle_, default_queue));
+    GTEST_CHECK(cnrtSuccess == cnrtQueueDestroy(queue));
+    destroy();
+    return status;
+  }
+
+  // Queries the workspace size before and after dropping the matmul
+  // algorithms memoized in handle_, both have to agree.
+  mluOpStatus_t computeAcrossInvalidation(size_t sizes[2]) {
+    mluOpStatus_t status = MLUOP_STATUS_SUCCESS;
+    for (int i = 0; i < 2 && status == MLUOP_STATUS_SUCCESS; ++i) {
+      if (i == 1) {
+        MLUOP_CHECK(mluOpInvalidateMatMulAlgoCache(handle_));
+      }
+      status = mluOpGetIndiceConvolutionForwardWorkspaceSize(
+          handle_, features_desc_, filters_desc_, indice_pairs_desc_,
+          features_out_desc_, indice_num_.data(), num_act_out_, inverse_,
+          sub_m_, &sizes[i]);
+    }
+    destroy();
+    return status;
+  }
+
  protected:
   void destroy() {
     if (handle_) {
@@ -211,4 +248,34 @@ TEST_F(indice_convolution_forward_workspace, BAD_PARAM_workspace_size_null) {
            << " in indice_convolution_forward_workspace";
   }
 }
+
+TEST_F(indice_convolution_forward_workspace, SUCCESS_set_queue) {
+  try {
+    setParam(true, true, true, true, true, true, true);
+    size_t sizes[3] = {0, 0, 0};
+    EXPECT_TRUE(MLUOP_STATUS_SUCCESS == computeAcrossQueues(sizes));
+    EXPECT_EQ(sizes[0], sizes[1]);
+    EXPECT_EQ(sizes[0], sizes[2]);
+  } catch (std::exception &e) {
+    FAIL() << "MLUOPAPIGTEST: catched " << e.what()
+           << " in indice_convolution_forward_workspace";
+  }
+}
+
+TEST_F(indice_convolution_forward_workspace, SUCCESS_invalidate_algo_cache) {
+  try {
+    setParam(true, true, true, true, true, true, true);
+    size_t sizes[2] = {0, 0};
+    EXPECT_TRUE(MLUOP_STATUS_SUCCESS == computeAcrossInvalidation(sizes));
+    EXPECT_EQ(sizes[0], sizes[1]);
+  } catch (std::exception &e) {
+    FAIL() << "MLUOPAPIGTEST: catched " << e.what()
+           << " in indice_convolution_forward_workspace";
+  }
+}
+
+TEST_F(indice_convolution_forward_workspace,
+       BAD_PARAM_invalidate_algo_cache_handle_null) {
+  EXPECT_TRUE(MLUOP_STATUS_BAD_PARAM == mluOpInvalidateMatMulAlgoCache(NULL));
+}
 }  // namespace mluopapitest
@@ -0,0 +1,61 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_PHILOX_RANDOM_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_PHILOX_RANDOM_H_
+
+#include <cstddef>
+#include <cstdint>
+
+// Counter-based random numbers for the random_data of pb cases.
+//
+// Philox4x32-10 with the constants of kernels/utils/philox_generator.h: the
+// key is the 64-bit seed, the counter is {block, 0}, and every block gives
+// four 32-bit words. Element i of a tensor only depends on the seed and i,
+// so the fills below are split across the cpu threads and produce the same
+// data whatever the thread number.
+//
+// MLUOP_GTEST_LEGACY_RANDOM=ON switches generateRandomData back to the
+// sequence of std::default_random_engine, for cases whose stored baselines
+// were computed on it.
+
+namespace mluoptest {
+
+void philoxBlock(uint64_t seed, uint64_t block, uint32_t out[4]);
+
+// data[i] uniform in [lower, upper).
+void philoxUniform(float *data, size_t count, uint64_t seed, float lower,
+                   float upper);
+void philoxUniform(double *data, size_t count, uint64_t seed, double lower,
+                   double upper);
+
+// data[i] normal with mean mu and standard deviation sigma, by Box-Muller.
+void philoxGaussian(float *data, size_t count, uint64_t seed, float mu,
+                    float sigma);
+void philoxGaussian(double *data, size_t count, uint64_t seed, double mu,
+                    double sigma);
+
+bool useLegacyRandom();
+
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_PHILOX_RANDOM_H_
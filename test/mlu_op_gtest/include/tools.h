@@ -41,6 +41,7 @@
 #include "math_half.h"
 #include "mlu_op.h"
 #include "mlu_op_test.pb.h"
+#include "philox_random.h"
 
 // failed tests in GoogleTest will have RUN_ALL_TEST() return 1, so to
 // distinguish it from mluOp, choose a different exit code
@@ -191,6 +192,7 @@ void generateRandomData(T *data, size_t count, const RandomData *random_param,
   }
   // generate random data
   std::default_random_engine re(seed);  // re for random engine
+  const bool legacy = useLegacyRandom();
   bool is_lower_equal_upper = false;
 
   if (random_param->distribution() == mluoptest::UNIFORM) {
@@ -210,10 +212,14 @@ void generateRandomData(T *data, size_t count, const RandomData *random_param,
       }
     } else {
       // uniform_real_distribution is [lower, upper)
-      upper = std::nexttoward(upper, -std::numeric_limits<T>::infinity());
-      std::uniform_real_distribution<T> dis(lower, upper);
-      for (size_t i = 0; i < count; ++i) {
-        data[i] = dis(re);
+      if (legacy) {
+        upper = std::nexttoward(upper, -std::numeric_limits<T>::infinity());
+        std::uniform_real_distribution<T> dis(lower, upper);
+        for (size_t i = 0; i < count; ++i) {
+          data[i] = dis(re);
+        }
+      } else {
+        philoxUniform(data, count, (uint64_t)(int64_t)seed, lower, upper);
       }
     }
   } else if (random_param->distribution() == mluoptest::GAUSSIAN) {
@@ -226,9 +232,13 @@ void generateRandomData(T *data, size_t count, const RandomData *random_param,
       mu = (T)random_param->mu();
       sigma = (T)random_param->sigma();
     }
-    std::normal_distribution<T> dis(mu, sigma);
-    for (size_t i = 0; i < count; ++i) {
-      data[i] = dis(re);
+    if (legacy) {
+      std::normal_distribution<T> dis(mu, sigma);
+      for (size_t i = 0; i < count; ++i) {
+        data[i] = dis(re);
+      }
+    } else {
+      philoxGaussian(data, count, (uint64_t)(int64_t)seed, mu, sigma);
     }
   }
 
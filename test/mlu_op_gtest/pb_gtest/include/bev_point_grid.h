@@ -0,0 +1,120 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_BEV_POINT_GRID_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_BEV_POINT_GRID_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Points tested together by BevPointGrid::query(), small enough for the
+// inside mask to stay on the stack.
+#define BEV_POINT_GRID_SPAN 256
+
+// Bird's-eye-view grid over a point cloud for cpuCompute() of the executors
+// testing points against rotated 3d boxes.
+//
+// Points are bucketed by the cell of their (x, y) with a counting sort and
+// stored cell by cell in SoA arrays, the cells of a grid row being adjacent.
+// A box only visits the rows covered by its axis-aligned bounding rectangle,
+// widened beyond the rounding error of the float tests of the executors, and
+// runs its own exact test on those spans in a loop the compiler vectorizes.
+// Points whose x or y is not finite are tested by every box, and boxes whose
+// rectangle is not finite test every point, so the points found are exactly
+// the ones a scan over all points would find.
+
+namespace mluoptest {
+
+class BevPointGrid {
+ public:
+  // points: (num, stride) floats starting with x, y, z
+  BevPointGrid(const float *points, int64_t num, int64_t stride = 3);
+
+  // Ascending indices of the points for which inside(x, y, z) holds, among
+  // the ones whose (x, y) may lie in the rectangle of half sizes half_x and
+  // half_y centered at (cx, cy) and rotated by rz.
+  template <typename Inside>
+  void query(float cx, float cy, double half_x, double half_y, float rz,
+             Inside &&inside, std::vector<int32_t> *result) const {
+    result->clear();
+    int64_t col_begin, col_end, row_begin, row_end;
+    if (!cellRange(cx, cy, half_x, half_y, rz, &col_begin, &col_end,
+                   &row_begin, &row_end)) {
+      testSpan(0, (int64_t)index_.size(), inside, result);
+    } else {
+      for (int64_t row = row_begin; row < row_end; ++row) {
+        testSpan(cell_begin_[row * col_num_ + col_begin],
+                 cell_begin_[row * col_num_ + col_end], inside, result);
+      }
+      testSpan(cell_begin_.back(), (int64_t)index_.size(), inside, result);
+    }
+    std::sort(result->begin(), result->end());
+  }
+
+ private:
+  // cells [col_begin, col_end) x [row_begin, row_end) holding every point of
+  // the rectangle, false if all points must be tested
+  bool cellRange(float cx, float cy, double half_x, double half_y, float rz,
+                 int64_t *col_begin, int64_t *col_end, int64_t *row_begin,
+                 int64_t *row_end) const;
+  int64_t col(double x) const;
+  int64_t row(double y) const;
+
+  template <typename Inside>
+  void testSpan(int64_t begin, int64_t end, Inside &inside,
+                std::vector<int32_t> *result) const {
+    uint8_t mask[BEV_POINT_GRID_SPAN];
+    for (; begin < end; begin += BEV_POINT_GRID_SPAN) {
+      const int64_t num = std::min<int64_t>(BEV_POINT_GRID_SPAN, end - begin);
+      const float *x = x_.data() + begin;
+      const float *y = y_.data() + begin;
+      const float *z = z_.data() + begin;
+      for (int64_t i = 0; i < num; ++i) {
+        mask[i] = inside(x[i], y[i], z[i]) ? 1 : 0;
+      }
+      for (int64_t i = 0; i < num; ++i) {
+        if (mask[i]) {
+          result->push_back(index_[begin + i]);
+        }
+      }
+    }
+  }
+
+  double x_min_ = 0.0;
+  double y_min_ = 0.0;
+  double inv_cell_ = 0.0;  // cells per unit length
+  int64_t col_num_ = 1;
+  int64_t row_num_ = 1;
+  // points of cell (col, row) are [cell_begin_[row * col_num_ + col],
+  // cell_begin_[row * col_num_ + col + 1]), the last entry starts the
+  // points with non-finite x or y
+  std::vector<int64_t> cell_begin_;
+  std::vector<float> x_;
+  std::vector<float> y_;
+  std::vector<float> z_;
+  std::vector<int32_t> index_;
+};
+
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_BEV_POINT_GRID_H_
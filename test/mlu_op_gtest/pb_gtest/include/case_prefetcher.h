@@ -0,0 +1,84 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_CASE_PREFETCHER_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_CASE_PREFETCHER_H_
+
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <memory>
+#include <mutex>   // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+#include "parser.h"
+
+namespace mluoptest {
+
+// Reads the cases of one op ahead of the single thread test loop, so that
+// reading, decompressing and parsing the next cases overlaps with the
+// device run, baseline and evaluation of the current one.
+//
+// At most case_num cases are held ahead, and no new case is started while
+// the cases held (including the one being tested) take more than
+// mem_budget bytes of host memory, unless nothing is held at all.
+class CasePrefetcher {
+ public:
+  CasePrefetcher(const std::vector<std::string> &case_paths, size_t case_num,
+                 size_t mem_budget);
+  ~CasePrefetcher();
+  CasePrefetcher(const CasePrefetcher &) = delete;
+  CasePrefetcher &operator=(const CasePrefetcher &) = delete;
+
+  // Returns the prefetched parser of case index, waiting for it if it is
+  // being read, or nullptr if it could not be prefetched or is older than
+  // the cases held. Also tells the prefetcher that the case taken
+  // previously is done and its memory released.
+  std::shared_ptr<Parser> take(size_t index);
+
+ private:
+  struct Slot {
+    size_t index;
+    std::shared_ptr<Parser> parser;  // nullptr if prefetch failed
+    size_t size = 0;
+    bool done = false;
+  };
+
+  void work();
+
+  const std::vector<std::string> case_paths_;
+  const size_t case_num_;
+  const size_t mem_budget_;
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::deque<Slot> slots_;   // cases read or being read, in case order
+  size_t next_ = 0;          // next case to read
+  size_t held_size_ = 0;     // bytes of slots_ and of the case under test
+  size_t running_size_ = 0;  // bytes of the case under test
+  bool stop_ = false;
+  std::thread worker_;
+};
+
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_CASE_PREFETCHER_H_
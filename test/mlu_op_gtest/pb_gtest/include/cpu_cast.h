@@ -0,0 +1,58 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_CPU_CAST_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_CPU_CAST_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "math_half.h"
+
+// Vectorized cores of the host dtype casts in tools.cpp.
+//
+// Each function converts [0, num) on the calling thread and returns exactly
+// the bits of the scalar conversion it replaces, arrayCast* split large
+// arrays across cpuParallelChunks. On x86_64 the AVX2/F16C versions are
+// picked at runtime from cpuid, other cpus use the scalar loops.
+
+// elements converted by one task of the threaded array casts
+#define CPU_CAST_GRAIN (256 * 1024)
+
+namespace mluoptest {
+
+// whether castHalfToFloatSpan() has a vectorized version of algo
+bool castHalfToFloatVectorized(AlgoHalfToFloat algo);
+
+// dst[i] = cvtHalfToFloatImpl<algo>(src[i]), for the SOPA, MLUOPGTEST2 and
+// CPU_INTRINSIC algos.
+void castHalfToFloatSpan(float *dst, const uint16_t *src, size_t num,
+                         AlgoHalfToFloat algo);
+
+// float to bf16, rounding to nearest even, NaN becoming 0x7FC0
+void castFloatToBF16Span(uint16_t *dst, const float *src, size_t num);
+
+void castBF16ToFloatSpan(float *dst, const uint16_t *src, size_t num);
+
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_CPU_CAST_H_
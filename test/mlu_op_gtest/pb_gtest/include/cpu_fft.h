@@ -0,0 +1,135 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_CPU_FFT_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_CPU_FFT_H_
+
+#include <complex>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Double precision host FFT behind cpuCompute() of the fft executor.
+//
+// A CpuFftLine transforms one line of n points by a mixed-radix Stockham
+// FFT, whose stages follow the radices fftFactor picks for the device,
+// each split into radix 4, 2, 3 and other prime butterflies. Lengths left
+// with a prime factor above 64 go through Bluestein's chirp-z convolution
+// over a power of two instead.
+//
+// A CpuFft runs a batch of rank 1 to 3 transforms with the layouts of
+// mluOpMakeFFTPlanMany, one axis after the other on a dense double buffer.
+// Every pass is cut into tasks of whole lines, which may run on any
+// threads and give the same bits whatever the number of threads.
+
+#define CPU_FFT_RANK_MAX 3
+// points transformed by one task of a pass
+#define CPU_FFT_TASK_POINTS (64 * 1024)
+
+namespace mluoptest {
+
+enum CpuFftType { CPU_FFT_R2C, CPU_FFT_C2C, CPU_FFT_C2R };
+
+// Elements of one side of a transform, complex numbers counting as one.
+// Element idx of transform b is at b * dist + sum(idx[i] * stride[i]), only
+// idx[i] < embed[i] are stored.
+struct CpuFftLayout {
+  std::vector<int64_t> embed;
+  std::vector<int64_t> stride;
+  int64_t dist;
+};
+
+// packed row-major layout of embed
+CpuFftLayout cpuFftPackedLayout(const std::vector<int64_t> &embed);
+
+class CpuFftLine {
+ public:
+  explicit CpuFftLine(int64_t n);
+
+  inline int64_t size() const { return n_; }
+  // complex numbers of work needed by run()
+  inline int64_t workSize() const {
+    return bluestein_ ? m_ + bluestein_->workSize() : n_;
+  }
+
+  // x[k] = sum(x[j] * exp(sign * 2 * pi * i * j * k / n)) for sign -1 or 1
+  void run(std::complex<double> *x, int sign, std::complex<double> *work) const;
+
+ private:
+  struct Stage {
+    int radix;
+    // length of the transforms merged by the stage
+    int64_t span;
+    // exp(-2 * pi * i * r * k / (span * radix)) at twiddle + k * radix + r
+    int64_t twiddle;
+    // exp(-2 * pi * i * t / radix) at root + t
+    int64_t root;
+  };
+
+  void forward(std::complex<double> *x, std::complex<double> *work) const;
+
+  int64_t n_;
+  std::vector<Stage> stages_;
+  std::vector<std::complex<double>> twiddles_;
+  // chirp exp(-pi * i * k * k / n), the spectrum of its conjugate over m_
+  // points divided by m_, and the plan of m_ points
+  int64_t m_ = 0;
+  std::vector<std::complex<double>> chirp_;
+  std::vector<std::complex<double>> kernel_;
+  std::unique_ptr<CpuFftLine> bluestein_;
+};
+
+class CpuFft {
+ public:
+  // Tasks are run by run_tasks(task_num, task), which calls task(begin, end)
+  // on ranges covering [0, task_num) and returns when all are done.
+  using TaskRunner = std::function<void(
+      int64_t, const std::function<void(int64_t, int64_t)> &)>;
+
+  // n holds the lengths of the rank dims. r2c stores n[rank - 1] / 2 + 1
+  // points along the last dim of out and c2r reads as many from in. Inputs
+  // are truncated or zero-padded to the transform size, outputs beyond it
+  // are left untouched.
+  CpuFft(CpuFftType type, const std::vector<int64_t> &n, int64_t batch,
+         const CpuFftLayout &in, const CpuFftLayout &out);
+
+  // Transforms batch inputs of interleaved complex or real floats and scales
+  // the results. As in mluOpExecFFT, direction 0 is forward and 1 backward,
+  // it only matters for c2c: r2c is forward and c2r backward.
+  void run(const float *input, float *output, int direction, double scale,
+           const TaskRunner &run_tasks = nullptr) const;
+
+ private:
+  CpuFftType type_;
+  int rank_;
+  int64_t batch_;
+  CpuFftLayout in_;
+  CpuFftLayout out_;
+  // dims of the double buffer, the last is halved for r2c and c2r
+  std::vector<int64_t> shape_;
+  std::vector<CpuFftLine> lines_;
+};
+
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_CPU_FFT_H_
@@ -0,0 +1,73 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_CPU_GEMM_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_CPU_GEMM_H_
+
+#include <cstdint>
+
+// Blocked GEMM for cpuCompute() of executors, used when the baseline is not
+// built against a BLAS library.
+//
+// Row-major, with the cblas_?gemm semantics:
+//   C = alpha * op(A) * op(B) + beta * C
+// where op(A) is m x k (A is stored k x m when trans_a), op(B) is k x n (B is
+// stored n x k when trans_b) and C is m x n. beta == 0 overwrites C without
+// reading it.
+//
+// A and B are packed into panels and multiplied by a register-blocked
+// microkernel picked once at runtime (AVX-512, AVX2 + FMA or portable). The
+// tiles of C are spread over cpuParallelFor, every element of C is computed
+// by one thread in a fixed order, so the result does not depend on
+// --cpu_thread.
+
+namespace mluoptest {
+
+void cpuGemm(bool trans_a, bool trans_b, int64_t m, int64_t n, int64_t k,
+             float alpha, const float *a, int64_t lda, const float *b,
+             int64_t ldb, float beta, float *c, int64_t ldc);
+
+void cpuGemm(bool trans_a, bool trans_b, int64_t m, int64_t n, int64_t k,
+             double alpha, const double *a, int64_t lda, const double *b,
+             int64_t ldb, double beta, double *c, int64_t ldc);
+
+// batch independent products, the i-th one reads a + i * stride_a and
+// b + i * stride_b and writes c + i * stride_c. The tiles of all products
+// are spread over the threads together.
+void cpuBatchGemm(int64_t batch, bool trans_a, bool trans_b, int64_t m,
+                  int64_t n, int64_t k, float alpha, const float *a,
+                  int64_t lda, int64_t stride_a, const float *b, int64_t ldb,
+                  int64_t stride_b, float beta, float *c, int64_t ldc,
+                  int64_t stride_c);
+
+void cpuBatchGemm(int64_t batch, bool trans_a, bool trans_b, int64_t m,
+                  int64_t n, int64_t k, double alpha, const double *a,
+                  int64_t lda, int64_t stride_a, const double *b, int64_t ldb,
+                  int64_t stride_b, double beta, double *c, int64_t ldc,
+                  int64_t stride_c);
+
+// name of the microkernel in use: "avx512", "avx2" or "generic"
+const char *cpuGemmIsa();
+
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_CPU_GEMM_H_
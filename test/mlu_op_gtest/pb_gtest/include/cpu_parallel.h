@@ -0,0 +1,104 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_CPU_PARALLEL_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_CPU_PARALLEL_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+// Parallel helpers for cpuCompute() of executors.
+//
+// All of them split [begin, end) into chunks that depend only on the range
+// and the grain, never on the number of threads, so a baseline computed with
+// --cpu_thread=1 and --cpu_thread=64 is bit-identical. Loops whose iterations
+// write disjoint outputs can use cpuParallelFor directly. Accumulations must
+// go through cpuParallelReduce, which combines the chunk results in chunk
+// order on the calling thread.
+//
+// The chunks run on one process-wide mluoptest::ThreadPool shared by all
+// executors, so --thread=N does not multiply the number of cpu threads.
+// Calls made from inside a chunk run serially on the current thread.
+
+namespace mluoptest {
+
+// number of threads available to cpuParallelFor, set by --cpu_thread
+size_t cpuParallelThreadNum();
+
+// Runs chunk(chunk_begin, chunk_end) for consecutive chunks of at most
+// grain iterations covering [begin, end), and returns when all are done.
+void cpuParallelChunks(int64_t begin, int64_t end, int64_t grain,
+                       const std::function<void(int64_t, int64_t)> &chunk);
+
+// Grain giving every thread a few chunks, for loops whose iterations cost
+// about the same.
+inline int64_t cpuParallelGrain(int64_t begin, int64_t end,
+                                int64_t min_grain = 1) {
+  const int64_t chunk_num = 4 * (int64_t)cpuParallelThreadNum();
+  return std::max(min_grain, (end - begin + chunk_num - 1) / chunk_num);
+}
+
+// Runs func(i) for every i in [begin, end).
+template <typename Func>
+void cpuParallelFor(int64_t begin, int64_t end, int64_t grain, Func &&func) {
+  cpuParallelChunks(begin, end, grain, [&](int64_t b, int64_t e) {
+    for (int64_t i = b; i < e; ++i) {
+      func(i);
+    }
+  });
+}
+
+template <typename Func>
+void cpuParallelFor(int64_t begin, int64_t end, Func &&func) {
+  cpuParallelFor(begin, end, cpuParallelGrain(begin, end),
+                 std::forward<Func>(func));
+}
+
+// Computes combine(...combine(combine(init, map(c0)), map(c1))..., map(ck))
+// where map(b, e) reduces the chunk [b, e). The chunks only depend on
+// grain, which must therefore be a constant of the executor and not derived
+// from the thread number.
+template <typename T, typename Map, typename Combine>
+T cpuParallelReduce(int64_t begin, int64_t end, int64_t grain, T init,
+                    Map &&map, Combine &&combine) {
+  if (end <= begin) {
+    return init;
+  }
+  grain = std::max<int64_t>(grain, 1);
+  const int64_t chunk_num = (end - begin + grain - 1) / grain;
+  std::vector<T> partial(chunk_num, init);
+  cpuParallelChunks(begin, end, grain, [&](int64_t b, int64_t e) {
+    partial[(b - begin) / grain] = map(b, e);
+  });
+  T result = init;
+  for (const auto &value : partial) {
+    result = combine(result, value);
+  }
+  return result;
+}
+
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_CPU_PARALLEL_H_
@@ -39,14 +39,10 @@
 #include <utility>
 #include <map>
 #include <set>
-#include <unordered_set>
-
-#ifdef _OPENMP
-#include <omp.h>
-#endif
 
 #include "core/logging.h"
 #include "tools.h"
+#include "cpu_parallel.h"
 #include "cpu_dtype.h"
 #include "internal_perf.h"
 #include "variable.h"
@@ -214,6 +210,229 @@ static void resetNanOrInfAsZero(T *a, T *b, size_t count) {
   }
 }
 
+// Elements of one chunk of the parallel passes of the evaluator. Constant,
+// so the sums do not depend on --cpu_thread.
+#define EVALUATOR_DIFF_GRAIN (64 * 1024)
+// Consecutive elements accumulated in separate lanes, so that the
+// compensated sums below map onto SIMD registers of doubles.
+#define EVALUATOR_DIFF_LANES 8
+#ifndef KL_EPSILON
+#define KL_EPSILON (1e-10)
+#endif
+
+// NaN/Inf in either output, checked chunk by chunk in parallel.
+template <typename T>
+bool hasNanOrInfParallel(T *a, T *b, size_t count) {
+  return cpuParallelReduce(
+      0, (int64_t)count, EVALUATOR_DIFF_GRAIN, 0,
+      [&](int64_t begin, int64_t end) -> int {
+        return hasNanOrInf(a + begin, end - begin) ||
+               hasNanOrInf(b + begin, end - begin);
+      },
+      [](int x, int y) { return x | y; });
+}
+
+// Kahan summation, value() = sum - comp.
+struct KahanSum {
+  double sum = 0;
+  double comp = 0;
+  inline void add(double value) {
+    const double y = value - comp;
+    const double t = sum + y;
+    comp = (t - sum) - y;
+    sum = t;
+  }
+  inline void add(const KahanSum &other) {
+    add(other.sum);
+    add(-other.comp);
+  }
+  inline double value() const { return sum - comp; }
+};
+
+// Sums and maxima of one part (real or imaginary) of the outputs, from
+// which DIFF1, DIFF2, DIFF3, DIFF3_2 and DIFF_KL are derived.
+struct DiffStats {
+  KahanSum abs_diff;     // sum |mlu - base|
+  KahanSum abs_base;     // sum |base|
+  KahanSum sqr_diff;     // sum (mlu - base)^2
+  KahanSum sqr_base;     // sum base^2
+  double max_ratio = 0;  // max |mlu - base| / |base|, see computeDiff3
+  double max_diff = 0;   // max |mlu - base|
+  // x' = max(|x|, KL_EPSILON). The real and imaginary parts form a single
+  // distribution, so these are only gathered in the stats of the real part.
+  KahanSum kl_base;      // sum base'
+  KahanSum kl_mlu;       // sum mlu'
+  KahanSum kl_base_log;  // sum base' * log(base' / mlu')
+  KahanSum kl_mlu_log;   // sum mlu' * log(base' / mlu')
+
+  void merge(const DiffStats &other) {
+    abs_diff.add(other.abs_diff);
+    abs_base.add(other.abs_base);
+    sqr_diff.add(other.sqr_diff);
+    sqr_base.add(other.sqr_base);
+    max_ratio = std::max(max_ratio, other.max_ratio);
+    max_diff = std::max(max_diff, other.max_diff);
+    kl_base.add(other.kl_base);
+    kl_mlu.add(other.kl_mlu);
+    kl_base_log.add(other.kl_base_log);
+    kl_mlu_log.add(other.kl_mlu_log);
+  }
+};
+
+// N Kahan sums kept per lane.
+template <int N>
+struct LaneSums {
+  double sum[N][EVALUATOR_DIFF_LANES] = {};
+  double comp[N][EVALUATOR_DIFF_LANES] = {};
+  inline void add(int k, int l, double value) {
+    const double y = value - comp[k][l];
+    const double t = sum[k][l] + y;
+    comp[k][l] = (t - sum[k][l]) - y;
+    sum[k][l] = t;
+  }
+  inline void addTo(int k, KahanSum *total) const {
+    for (int l = 0; l < EVALUATOR_DIFF_LANES; ++l) {
+      total->add(sum[k][l]);
+      total->add(-comp[k][l]);
+    }
+  }
+};
+
+// Accumulates elements [begin, end) of base[i * stride] and mlu[i * stride]
+// into stats, and into the DIFF_KL sums of kl_stats if with_kl.
+template <typename T>
+void accumulateDiffStats(const T *base, const T *mlu, int64_t begin,
+                         const int64_t end, const int stride,
+                         const double eps, const bool with_kl,
+                         DiffStats *stats, DiffStats *kl_stats) {
+  const int L = EVALUATOR_DIFF_LANES;
+  enum { ABS_DIFF, ABS_BASE, SQR_DIFF, SQR_BASE };
+  LaneSums<4> sums;
+  double max_ratio[L] = {}, max_diff[L] = {};
+  auto lane = [&](int l, double x, double y) {
+    const double diff = std::abs(y - x);
+    const double abs_base = std::abs(x);
+    sums.add(ABS_DIFF, l, diff);
+    sums.add(ABS_BASE, l, abs_base);
+    sums.add(SQR_DIFF, l, (y - x) * (y - x));
+    sums.add(SQR_BASE, l, x * x);
+    const double ratio =
+        (abs_base < eps) ? diff : diff / (abs_base + EPSILON);
+    max_ratio[l] = std::max(max_ratio[l], ratio);
+    max_diff[l] = std::max(max_diff[l], diff);
+  };
+  enum { KL_BASE, KL_MLU, KL_BASE_LOG, KL_MLU_LOG };
+  LaneSums<4> kl_sums;
+  auto kl_lane = [&](int l, double x, double y) {
+    const double x_abs = std::max(std::abs(x), (double)KL_EPSILON);
+    const double y_abs = std::max(std::abs(y), (double)KL_EPSILON);
+    const double log_ratio = std::log(x_abs / y_abs);
+    kl_sums.add(KL_BASE, l, x_abs);
+    kl_sums.add(KL_MLU, l, y_abs);
+    kl_sums.add(KL_BASE_LOG, l, x_abs * log_ratio);
+    kl_sums.add(KL_MLU_LOG, l, y_abs * log_ratio);
+  };
+
+  double x[L], y[L];
+  for (int64_t i = begin; i < end; i += L) {
+    const int n = (int)std::min<int64_t>(L, end - i);
+    for (int l = 0; l < n; ++l) {
+      x[l] = double(base[(i + l) * stride]);
+      y[l] = double(mlu[(i + l) * stride]);
+    }
+    if (n == L) {
+      for (int l = 0; l < L; ++l) {
+        lane(l, x[l], y[l]);
+      }
+      if (with_kl) {
+        for (int l = 0; l < L; ++l) {
+          kl_lane(l, x[l], y[l]);
+        }
+      }
+    } else {
+      for (int l = 0; l < n; ++l) {
+        lane(l, x[l], y[l]);
+        if (with_kl) {
+          kl_lane(l, x[l], y[l]);
+        }
+      }
+    }
+  }
+
+  sums.addTo(ABS_DIFF, &stats->abs_diff);
+  sums.addTo(ABS_BASE, &stats->abs_base);
+  sums.addTo(SQR_DIFF, &stats->sqr_diff);
+  sums.addTo(SQR_BASE, &stats->sqr_base);
+  for (int l = 0; l < L; ++l) {
+    stats->max_ratio = std::max(stats->max_ratio, max_ratio[l]);
+    stats->max_diff = std::max(stats->max_diff, max_diff[l]);
+  }
+  if (with_kl) {
+    kl_sums.addTo(KL_BASE, &kl_stats->kl_base);
+    kl_sums.addTo(KL_MLU, &kl_stats->kl_mlu);
+    kl_sums.addTo(KL_BASE_LOG, &kl_stats->kl_base_log);
+    kl_sums.addTo(KL_MLU_LOG, &kl_stats->kl_mlu_log);
+  }
+}
+
+// Type the pairs of DIFF4 are sorted as. half and bfloat16 compare through
+// float, converting them once instead of in every comparison is much faster.
+template <typename T>
+struct DiffPairKey {
+  typedef T type;
+};
+template <>
+struct DiffPairKey<half> {
+  typedef float type;
+};
+template <>
+struct DiffPairKey<bfloat16> {
+  typedef float type;
+};
+
+// Distinct pairs (mlu[i * stride], base[i * stride]) with mlu != base, and
+// how many of them have mlu < base. Every chunk is sorted and deduplicated
+// in parallel, then the runs are merged.
+template <typename T>
+void countDistinctPairs(const T *mlu, const T *base, const int64_t count,
+                        const int stride, double *num, double *less) {
+  typedef typename DiffPairKey<T>::type Key;
+  typedef std::pair<Key, Key> Pair;
+  const int64_t grain = EVALUATOR_DIFF_GRAIN;
+  std::vector<std::vector<Pair>> runs((count + grain - 1) / grain);
+  cpuParallelChunks(0, count, grain, [&](int64_t begin, int64_t end) {
+    std::vector<Pair> &run = runs[begin / grain];
+    for (int64_t i = begin; i < end; ++i) {
+      if (mlu[i * stride] != base[i * stride]) {
+        run.emplace_back(Key(mlu[i * stride]), Key(base[i * stride]));
+      }
+    }
+    std::sort(run.begin(), run.end());
+    run.erase(std::unique(run.begin(), run.end()), run.end());
+  });
+
+  std::vector<Pair> pairs;
+  std::vector<size_t> bounds(1, 0);
+  for (auto &run : runs) {
+    pairs.insert(pairs.end(), run.begin(), run.end());
+    bounds.push_back(pairs.size());
+    std::vector<Pair>().swap(run);
+  }
+  const size_t run_num = runs.size();
+  for (size_t width = 1; width < run_num; width *= 2) {
+    for (size_t r = 0; r + width < run_num; r += 2 * width) {
+      std::inplace_merge(pairs.begin() + bounds[r],
+                         pairs.begin() + bounds[r + width],
+                         pairs.begin() + bounds[std::min(r + 2 * width,
+                                                         run_num)]);
+    }
+  }
+  pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+  *num = pairs.size();
+  *less = std::count_if(pairs.begin(), pairs.end(),
+                        [](const Pair &p) { return p.first < p.second; });
+}
+
 enum StorageDtype {
   FLOAT = 0,
   VOID = 1,
@@ -355,8 +574,11 @@ class Evaluator {
       nanInfRemain<T>();
       return;
     }
-    // TODO(None): have vector.push_back() in for loop, open it after
-    // modify code logic #pragma omp parallel for schedule(guided)
+    // positions are only recorded when there is some NaN/Inf, which is rare,
+    // so look for it in parallel first
+    if (!hasNanOrInfParallel(a, b, count_total_)) {
+      return;
+    }
     for (size_t i = 0; i < count_total_; ++i) {
       if (isNanOrInf(a[i]) || isNanOrInf(b[i])) {
         skip_compute_diff_ = true;
@@ -401,24 +623,17 @@ class Evaluator {
       return;
     }
     switch (func_) {
-      case Evaluator::Formula::DIFF1: {
-        computeDiff1<T>();
-      } break;
-      case Evaluator::Formula::DIFF2: {
-        computeDiff2<T>();
-      } break;
-      case Evaluator::Formula::DIFF3: {
-        computeDiff3<T>();
-      } break;
-      case Evaluator::Formula::DIFF3_2: {
-        computeDiff3_2<T>();
+      case Evaluator::Formula::DIFF1:
+      case Evaluator::Formula::DIFF2:
+      case Evaluator::Formula::DIFF3:
+      case Evaluator::Formula::DIFF3_2:
+      case Evaluator::Formula::DIFF_KL: {
+        computeDiffStats<T>();
+        computeDiffFromStats();
       } break;
       case Evaluator::Formula::DIFF4: {
         computeDiff4<T>();
       } break;
-      case Evaluator::Formula::DIFF_KL: {
-        computeDiffKl<T>();
-      } break;
       default: {
         GTEST_CHECK(false,
                     "Evaluator: found unsupported criterion when compute "
@@ -427,207 +642,67 @@ class Evaluator {
     }
   }
 
+  // one pass over the outputs for all the criteria of this tensor, except
+  // DIFF4.
   template <typename T>
-  void computeDiff1() {
-    double numerator_sum = 0.0;
-    double numerator_sum_imag = 0.0;
-    double denominator_sum = 0.0;
-    double denominator_sum_imag = 0.0;
-    T *base_array = reinterpret_cast<T *>(base_array_);
-    T *mlu_array = reinterpret_cast<T *>(mlu_array_);
-#pragma omp parallel for reduction \
-        (+:numerator_sum, denominator_sum, numerator_sum_imag, \
-         denominator_sum_imag) schedule(guided)
-    for (size_t i = 0; i < count_total_; i += stride_) {
-      numerator_sum += std::abs(double(mlu_array[i]) - double(base_array[i]));
-      denominator_sum += std::abs(double(base_array[i]));
-      if (is_complex_) {
-        numerator_sum_imag +=
-            std::abs(double(mlu_array[i + 1]) - double(base_array[i + 1]));
-        denominator_sum_imag += std::abs(double(base_array[i + 1]));
-      }
-    }  // end omp parallel block
-    error_ = numerator_sum / (denominator_sum + EPSILON);
-    if (is_complex_) {
-      error_imag_ = numerator_sum_imag / (denominator_sum_imag + EPSILON);
-    }
-  }
-
-  template <typename T>
-  void computeDiff2() {
-    double numerator_sum = 0.0;
-    double numerator_sum_imag = 0.0;
-    double denominator_sum = 0.0;
-    double denominator_sum_imag = 0.0;
-    T *base_array = reinterpret_cast<T *>(base_array_);
-    T *mlu_array = reinterpret_cast<T *>(mlu_array_);
-#pragma omp parallel for reduction \
-        (+:numerator_sum, denominator_sum, numerator_sum_imag, \
-        denominator_sum_imag) schedule(guided)
-    for (size_t i = 0; i < count_total_; i += stride_) {
-      numerator_sum +=
-          std::pow(double(mlu_array[i]) - double(base_array[i]), 2);
-      denominator_sum += std::pow(double(base_array[i]), 2);
-      if (is_complex_) {
-        numerator_sum_imag +=
-            std::pow(double(mlu_array[i + 1]) - double(base_array[i + 1]), 2);
-        denominator_sum_imag += std::pow(double(base_array[i + 1]), 2);
-      }
-    }  // end omp parallel block
-    error_ = std::sqrt(numerator_sum / (denominator_sum + EPSILON));
-    if (is_complex_) {
-      error_imag_ =
-          std::sqrt(numerator_sum_imag / (denominator_sum_imag + EPSILON));
-    }
-  }
-
-  template <typename T>
-  void computeDiff3() {
-    T *base_array = reinterpret_cast<T *>(base_array_);
-    T *mlu_array = reinterpret_cast<T *>(mlu_array_);
-    double max_ratio = 0;
-    double max_ratio_imag = 0;
-    double EPS = 0;
-    if (dtype_ == MLUOP_DTYPE_HALF || dtype_ == MLUOP_DTYPE_COMPLEX_HALF) {
-      EPS = EPSILON_HALF;
-    } else if (dtype_ == MLUOP_DTYPE_FLOAT ||
-               dtype_ == MLUOP_DTYPE_COMPLEX_FLOAT) {
-      EPS = EPSILON_FLOAT;
-    }
-#pragma omp parallel for reduction(max                          \
-                                   : max_ratio, max_ratio_imag) \
-    schedule(guided)
-    for (size_t i = 0; i < count_total_; i += stride_) {
-      double numerator = std::abs(double(mlu_array[i]) - double(base_array[i]));
-      double denominator = std::abs(double(base_array[i]));
-      double ratio =
-          (denominator < EPS) ? numerator : numerator / (denominator + EPSILON);
-      max_ratio = (ratio > max_ratio) ? ratio : max_ratio;
-      if (is_complex_) {
-        numerator =
-            std::abs(double(mlu_array[i + 1]) - double(base_array[i + 1]));
-        denominator = std::abs(double(base_array[i + 1]));
-        ratio = (denominator < EPS) ? numerator
-                                    : numerator / (denominator + EPSILON);
-        max_ratio_imag = (ratio > max_ratio_imag) ? ratio : max_ratio_imag;
-      }
-    }  // end omp parallel block
-    error_ = max_ratio;
-    if (is_complex_) {
-      error_imag_ = max_ratio_imag;
+  void computeDiffStats() {
+    if (stats_ready_) {
+      return;
     }
-  }
-
-  template <typename T>
-  void computeDiff3_2() {
+    stats_ready_ = true;
     T *base_array = reinterpret_cast<T *>(base_array_);
     T *mlu_array = reinterpret_cast<T *>(mlu_array_);
-    double max_ratio = 0;
-    double max_ratio_imag = 0;
-#pragma omp parallel for reduction(max                          \
-                                   : max_ratio, max_ratio_imag) \
-    schedule(guided)
-    for (size_t i = 0; i < count_total_; i += stride_) {
-      double ratio = std::abs(double(mlu_array[i]) - double(base_array[i]));
-      max_ratio = (ratio > max_ratio) ? ratio : max_ratio;
-      if (is_complex_) {
-        ratio = std::abs(double(mlu_array[i + 1]) - double(base_array[i + 1]));
-        max_ratio_imag = (ratio > max_ratio_imag) ? ratio : max_ratio_imag;
-      }
-    }  // end omp parallel block
-    error_ = max_ratio;
-    if (is_complex_) {
-      error_imag_ = max_ratio_imag;
-    }
-  }
-
-  template <typename T>
-  struct TupleHash {
-    size_t operator()(const std::tuple<T, T> &t) const {
-      size_t seed;
-      hash_combine(seed, (T)std::get<0>(t));
-      hash_combine(seed, (T)std::get<1>(t));
-      return seed;
-    }
-  };
-
-#ifndef KL_EPSILON
-#define KL_EPSILON (1e-10)
-  template <typename T>
-  double diff_kl(T *data1, T *data2, size_t elem_num) {
-    double data1_sum = 0.0;
-    double data2_sum = 0.0;
-#pragma omp parallel for reduction(+ : data1_sum, data2_sum) schedule(guided)
-    for (size_t i = 0; i < elem_num; i++) {
-      data1_sum += std::max(std::abs((double)data1[i]), (double)KL_EPSILON);
-      data2_sum += std::max(std::abs((double)data2[i]), (double)KL_EPSILON);
-    }  // end omp parallel block
-    double entropy = 0.0;
-#pragma omp parallel for reduction(+ : entropy) schedule(guided)
-    for (size_t i = 0; i < elem_num; i++) {
-      double data1_prob =
-          std::max(std::abs((double)data1[i]), (double)KL_EPSILON) / data1_sum;
-      double data2_prob =
-          std::max(std::abs((double)data2[i]), (double)KL_EPSILON) / data2_sum;
-      entropy += 0.5 * data1_prob * log(data1_prob / data2_prob) +
-                 0.5 * data2_prob * log(data2_prob / data1_prob);
-    }  // end omp parallel block
-    return entropy;
+    const int stride = stride_;
+    const double eps = diff3Epsilon();
+    // diff_kl needs count_total_ <= INT64_MAX because of the length in python
+    // func is int64 diff_kl skips the data with too less quantity
+    const bool with_kl = criterions_.count(Criterion(DIFF_KL, 0)) &&
+                         count_total_ >= (size_t)1000 &&
+                         count_total_ <= (size_t)INT64_MAX;
+    struct Stats {
+      DiffStats part[2];
+    };
+    Stats stats = cpuParallelReduce(
+        0, (int64_t)(count_total_ / stride), EVALUATOR_DIFF_GRAIN, Stats(),
+        [&](int64_t begin, int64_t end) {
+          Stats chunk;
+          for (int p = 0; p < stride; ++p) {
+            accumulateDiffStats(base_array + p, mlu_array + p, begin, end,
+                                stride, eps, with_kl, &chunk.part[p],
+                                &chunk.part[0]);
+          }
+          return chunk;
+        },
+        [](Stats total, const Stats &chunk) {
+          total.part[0].merge(chunk.part[0]);
+          total.part[1].merge(chunk.part[1]);
+          return total;
+        });
+    stats_[0] = stats.part[0];
+    stats_[1] = stats.part[1];
+    kl_valid_ = with_kl;
   }
-#endif
 
   template <typename T>
   void computeDiff4() {
     T *base_array = reinterpret_cast<T *>(base_array_);
     T *mlu_array = reinterpret_cast<T *>(mlu_array_);
+    const int64_t count = count_total_ / stride_;
     double max_count = 0;
     double num_count = 0;
-    double max_count_imag = 0;
-    double num_count_imag = 0;
-    std::unordered_set<std::tuple<T, T>, TupleHash<T>> unrepeat_res;
-    std::unordered_set<std::tuple<T, T>, TupleHash<T>> unrepeat_res_imag;
-    for (size_t i = 0; i < count_total_; i += stride_) {
-      if (is_complex_) {
-        if (mlu_array[i + 1] != base_array[i + 1]) {
-          auto unrepeat_tuple =
-              std::make_tuple(mlu_array[i + 1], base_array[i + 1]);
-          if (unrepeat_res_imag.end() ==
-              unrepeat_res_imag.find(unrepeat_tuple)) {
-            max_count_imag += mlu_array[i + 1] < base_array[i + 1];
-            num_count_imag++;
-            unrepeat_res_imag.emplace(unrepeat_tuple);
-          }
-        }
-      }
-      if (mlu_array[i] != base_array[i]) {
-        auto unrepeat_tuple = std::make_tuple(mlu_array[i], base_array[i]);
-        if (unrepeat_res.end() == unrepeat_res.find(unrepeat_tuple)) {
-          max_count += mlu_array[i] < base_array[i];
-          num_count++;
-          unrepeat_res.emplace(unrepeat_tuple);
-        }
-      }
-    }
+    countDistinctPairs(mlu_array, base_array, count, stride_, &num_count,
+                       &max_count);
     error_ = (num_count < 100) ? -1 : max_count / num_count;
     if (is_complex_) {
+      double max_count_imag = 0;
+      double num_count_imag = 0;
+      countDistinctPairs(mlu_array + 1, base_array + 1, count, stride_,
+                         &num_count_imag, &max_count_imag);
       error_imag_ =
           (num_count_imag < 100) ? -1 : max_count_imag / num_count_imag;
     }
   }
 
-  template <typename T>
-  void computeDiffKl() {
-    T *base_array = reinterpret_cast<T *>(base_array_);
-    T *mlu_array = reinterpret_cast<T *>(mlu_array_);
-    // diff_kl needs count_total_ <= INT64_MAX because of the length in python
-    // func is int64 diff_kl skips the data with too less quantity
-    if (count_total_ < (size_t)1000 || count_total_ > (size_t)INT64_MAX) {
-      error_ = -1;
-    } else {
-      error_ = diff_kl(base_array, mlu_array, count_total_);
-    }
-  }
-
   template <typename T>
   void check_nan_inf() {
     skip_compute_diff_ = false;
@@ -656,6 +731,8 @@ class Evaluator {
             const mluOpDataType_t dtype);
 
   void computeDiffForOneCriterion();
+  void computeDiffFromStats();
+  double diff3Epsilon();
   void computeDiffFloatAndDouble();
   void computeDiffByDtype();
   void thresholdLevel1();
@@ -686,6 +763,10 @@ class Evaluator {
   size_t count_total_ = -1;
   double error_ = -1;
   double error_imag_ = -1;
+  // gathered by computeDiffStats for the real and the imaginary part
+  DiffStats stats_[2];
+  bool stats_ready_ = false;
+  bool kl_valid_ = false;
   bool skip_compute_diff_ = false;
   bool is_complex_ = false;
   bool threshold_l1_ = false;
@@ -367,6 +367,11 @@ class Executor {
                 ctx);  // set config param by init().
   // set execute variable by setup().
   void setup(std::string file, const std::shared_ptr<ExecuteConfig> ecfg);
+  // use a parser which already read the case (see CasePrefetcher), call it
+  // between init() and setup().
+  inline void setPrefetchedParser(std::shared_ptr<Parser> parser) {
+    parser_ = parser;
+  }
   void launch();
   bool ready();
   void sync();
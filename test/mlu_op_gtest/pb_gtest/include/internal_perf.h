@@ -43,6 +43,10 @@ std::string timeseries_to_array_str(const TimeSeries_t&);
 struct GtestInternal {
   size_t parsed_file_size = 0;
   double parsed_cost_seconds = 0.;
+  size_t parsed_value_size = 0;
+  double parsed_value_seconds = 0.;
+  double prefetch_seconds = 0.;       // reading ahead, hidden behind others
+  double prefetch_wait_seconds = 0.;  // waiting for the prefetched case
   TimeSeries_t time_costs_ms;  // cumulative time on different time point
 };
 
@@ -30,10 +30,12 @@
 #include <string>
 #include <vector>
 #include <set>
+#include <unordered_map>
 #include <algorithm>
 #include <sstream>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include "mlu_op_test.pb.h"
 #include "gtest/gtest.h"
 #include "mlu_op.h"
@@ -41,6 +43,7 @@
 #include "core/tensor.h"
 #include "core/type.h"
 #include "evaluator.h"
+#include "payload_file.h"
 #include "tools.h"
 
 namespace mluoptest {
@@ -130,6 +133,17 @@ class Parser {
   virtual ~Parser();
   // parse prototxt
   void parse(const std::string &file);
+  // Reads *pb/*prototxt and the data files of its tensors ahead of parse(),
+  // on a prefetch thread. Never fails a test: anything that goes wrong is
+  // left to parse() and getTensorValue() of the test thread, which report it.
+  bool prefetch(const std::string &file);
+  // host bytes held by prefetch()
+  inline size_t getPrefetchedSize() const { return prefetched_size_; }
+  inline double getPrefetchSeconds() const { return prefetch_seconds_; }
+  inline void setPrefetchWaitSeconds(double s) { prefetch_wait_seconds_ = s; }
+  inline double getPrefetchWaitSeconds() const {
+    return prefetch_wait_seconds_;
+  }
 
   bool negative_scale_ = getEnv("MLUOP_GTEST_NEGATIVE_SCALE", false);
 
@@ -140,6 +154,10 @@ class Parser {
 
   void getInputTensorValue(size_t index, void *data, size_t count);
   void getOutputTensorValue(size_t index, void *data, size_t count);
+  // Zero-copy view of an input stored in a payload file (see
+  // payload_file.h), laid out as getInputTensorValue() would write it.
+  // Returns nullptr if the input comes from any other value source.
+  const void *getInputTensorView(size_t index, size_t count);
 
   // op params
   inline Node *node() { return proto_node_; }
@@ -261,6 +279,8 @@ class Parser {
   inline int getOpTf32Param() { return is_support_TF32_; }
   inline size_t getParsedFileSize() const { return parsed_file_size; }
   inline double getParsedCostSeconds() const { return parsed_cost_seconds; }
+  inline size_t getParsedValueSize() const { return parsed_value_size; }
+  inline double getParsedValueSeconds() const { return parsed_value_seconds; }
 
  private:
   Node *proto_node_ = nullptr;
@@ -270,12 +290,22 @@ class Parser {
   // mutex/atomic primitive is safe
   double parsed_cost_seconds =
       0.;  ///< record total file reading and deserialization time
+  size_t parsed_value_size =
+      0;  ///< record bytes decoded from value_h/f/i/l/ui/ul of pb/prototxt
+  double parsed_value_seconds = 0.;  ///< record total value decoding time
   int is_support_TF32_;
   std::vector<MetaTensor> inputs_;
   std::vector<MetaTensor> outputs_;
   std::set<Evaluator::Criterion> criterions_;
   std::string op_name_;
   std::string pb_path_;
+  std::shared_ptr<PayloadFile> payload_;  ///< mapped on first use
+  bool prefetched_ = false;  ///< proto_node_ was read by prefetch()
+  ///< data files read by prefetch(), released once copied out
+  std::unordered_map<const Tensor *, std::vector<char>> prefetched_values_;
+  size_t prefetched_size_ = 0;
+  double prefetch_seconds_ = 0.;
+  double prefetch_wait_seconds_ = 0.;
   std::vector<std::string> list_rely_real_data_;
   Device device_ = CPU;
 
@@ -290,6 +320,7 @@ class Parser {
   void getTensorValueUL(const Tensor *pt, void *data, size_t count);
   void getTensorValueRandom(Tensor *pt, void *data, size_t count);
   void getTensorValueByFile(Tensor *pt, void *data, size_t count);
+  const void *getTensorPayloadView(Tensor *pt, size_t count);
 
   void checkTensorValid(MetaTensor *mt, Tensor *t);
   void checkOutputStrideOverlap();
@@ -304,6 +335,7 @@ class Parser {
   Evaluator::Formula cvtProtoEvaluationCriterion(int c);
   bool readMessageFromFile(const std::string &filename, Node *proto);
   size_t getTensorSize(Tensor *pt);
+  static size_t getDtypeWidth(DataType dtype);  // 0 if unknown
   void setCurPbPath(const std::string &file);
   void isSupportTF32(Node *protoNode);
   inline std::string getApiName() {
@@ -0,0 +1,89 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_PAYLOAD_FILE_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_PAYLOAD_FILE_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+// Sidecar payload of a test case. The *pb keeps the case description only,
+// and the raw tensor data lives in one "<case>.payload" file next to it:
+//
+//   PayloadHeader
+//   index:  entry_num * {uint64 offset, uint64 length, uint32 name_length,
+//                        char name[name_length]}
+//   data:   every tensor at a PAYLOAD_ALIGN aligned offset of the file
+//
+// A tensor stored in the payload has its "path" set to the payload file
+// name and is looked up by its id. Its bytes are laid out exactly as
+// Parser::getTensorValue() returns them, so the Parser can map the file and
+// hand out pointers into it instead of decoding repeated fields.
+// Files are written by the pb2payload tool.
+
+#define PAYLOAD_MAGIC "MLUOPPLD"
+#define PAYLOAD_VERSION 1
+#define PAYLOAD_ALIGN 4096
+#define PAYLOAD_EXTENSION "payload"
+
+namespace mluoptest {
+
+struct PayloadHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t entry_num;
+  uint64_t index_size;  // bytes of the index following the header
+};
+
+// Read-only mapping of a payload file.
+class PayloadFile {
+ public:
+  ~PayloadFile();
+  PayloadFile(const PayloadFile &) = delete;
+  PayloadFile &operator=(const PayloadFile &) = delete;
+
+  // Maps the file and reads its index, throws if it is not a valid payload.
+  static std::shared_ptr<PayloadFile> open(const std::string &path);
+
+  // Returns the data of tensor name and its length in bytes, or nullptr if
+  // the payload does not hold this tensor.
+  const void *find(const std::string &name, size_t *length) const;
+
+  inline const std::string &path() const { return path_; }
+  inline size_t size() const { return size_; }
+
+ private:
+  PayloadFile() = default;
+
+  std::string path_;
+  const uint8_t *data_ = nullptr;
+  size_t size_ = 0;
+  // name -> (offset, length)
+  std::unordered_map<std::string, std::pair<uint64_t, uint64_t>> index_;
+};
+
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_PAYLOAD_FILE_H_
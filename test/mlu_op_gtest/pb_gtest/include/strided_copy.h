@@ -0,0 +1,100 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_STRIDED_COPY_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_STRIDED_COPY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// N-d permute/stride engine behind mluOpTransposeCpu and tensor_stride_in/out.
+//
+// A StridedCopy copies dst[sum(idx[i] * dst_stride[i])] =
+// src[sum(idx[i] * src_stride[i])] for every index of shape, strides being
+// counted in elements. The plan drops unit dims, orders the others by
+// decreasing dst stride and merges dims that are contiguous in both tensors.
+// When the innermost dst dim is not the innermost src dim, the plane of the
+// two is copied by cache-oblivious blocks of 16-byte SIMD micro-transposes,
+// otherwise rows are copied by memcpy or a strided loop.
+//
+// The copy is cut into tasks writing disjoint parts of dst, which may run
+// on any threads. If several indices write the same dst element, e.g. a
+// stride of 0, the plan keeps the index order instead and its tasks must
+// run in order on one thread, so that the last write wins as before.
+
+// bytes copied by one task, and the smallest copy worth threads
+#define STRIDED_COPY_TASK_BYTES (256 * 1024)
+
+namespace mluoptest {
+
+class StridedCopy {
+ public:
+  StridedCopy(const std::vector<size_t> &shape,
+              const std::vector<size_t> &dst_stride,
+              const std::vector<size_t> &src_stride, size_t sizeof_dtype);
+
+  inline int64_t taskNum() const { return task_num_; }
+  // about the bytes copied by one task
+  inline size_t taskBytes() const { return task_bytes_; }
+  // whether the tasks may run concurrently and in any order
+  inline bool parallel() const { return parallel_; }
+
+  // copies tasks [task_begin, task_end)
+  void run(void *dst, const void *src, int64_t task_begin,
+           int64_t task_end) const;
+
+ private:
+  enum Kernel { ROW, TRANSPOSE };
+  struct Dim {
+    size_t size;
+    size_t dst_stride;
+    size_t src_stride;
+  };
+
+  void runTask(char *dst, const char *src, int64_t part) const;
+
+  size_t sizeof_dtype_;
+  Kernel kernel_ = ROW;
+  // inner dims: a is innermost in dst, b is innermost in src for TRANSPOSE
+  Dim a_ = {1, 1, 1};
+  Dim b_ = {1, 1, 1};
+  // outer dims, outermost first, looped over by the tasks
+  std::vector<Dim> outer_;
+  // the inner dims are cut into split_num_ parts of split_ elements of b for
+  // TRANSPOSE and of a for ROW
+  int64_t split_ = 1;
+  int64_t split_num_ = 1;
+  int64_t task_num_ = 0;
+  size_t task_bytes_ = 0;
+  bool parallel_ = true;
+};
+
+// Runs a StridedCopy on the cpuParallelChunks threads, or on the calling
+// thread for copies below STRIDED_COPY_TASK_BYTES. Defined in stride.cpp.
+void stridedCopy(void *dst, const void *src, const std::vector<size_t> &shape,
+                 const std::vector<size_t> &dst_stride,
+                 const std::vector<size_t> &src_stride, size_t sizeof_dtype);
+
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_STRIDED_COPY_H_
@@ -53,6 +53,7 @@ class GlobalVar {
   int repeat_ = 1;   // perf-repeat repeat * kernel enqueue cnrtQueue_t, and get
                      // ave hw_time
   int thread_num_ = 1;    // thread num
+  int cpu_thread_num_ = 0;  // threads of cpuParallelFor, 0 for all cores
   bool shuffle_ = false;  // shuffle cases.
   unsigned int half2float_algo_ = getEnvInt(
       "MLUOP_GTEST_EXPERIMENT_HALF2FLOAT_ALGO",
@@ -0,0 +1,78 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_VOXEL_HASH_GRID_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_VOXEL_HASH_GRID_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Sparse voxel grid for cpuCompute() of the voxelization and
+// dynamic_point_to_voxel executors.
+//
+// Voxels are keyed by their coordinates linearized in row-major order, so
+// that sorting keys sorts voxels like their coordinates, and get dense ids
+// in order of first insertion from an open-addressing table. Inserting the
+// points in index order therefore keeps the first-come order of the former
+// scans over the previous points, in O(1) per point instead of O(N).
+
+namespace mluoptest {
+
+class VoxelHashGrid {
+ public:
+  // coordinate i of a voxel is in [0, extent[i]), the product of the extents
+  // must fit in int64_t. expected_num presizes the table.
+  explicit VoxelHashGrid(const std::vector<int64_t> &extent,
+                         size_t expected_num = 0);
+
+  template <typename T>
+  inline int64_t key(const T *coor) const {
+    int64_t key = 0;
+    for (size_t i = 0; i < extent_.size(); ++i) {
+      key = key * extent_[i] + (int64_t)coor[i];
+    }
+    return key;
+  }
+
+  // id of key, which is added with id size() if new
+  int32_t insert(int64_t key);
+  // id of key, -1 if absent
+  int32_t find(int64_t key) const;
+
+  inline size_t size() const { return keys_.size(); }
+  // key of every voxel, by id
+  inline const std::vector<int64_t> &keys() const { return keys_; }
+
+ private:
+  size_t slot(int64_t key) const;
+  void rehash(size_t capacity);
+
+  std::vector<int64_t> extent_;
+  std::vector<int32_t> table_;  // voxel id of each slot, -1 if empty
+  std::vector<int64_t> keys_;
+  size_t mask_ = 0;
+};
+
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_VOXEL_HASH_GRID_H_
@@ -0,0 +1,135 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include "bev_point_grid.h"
+
+#include <cmath>
+#include "gtest/gtest.h"
+#include "check_tools.h"
+
+// Points per cell the grid is sized for.
+#define BEV_POINT_GRID_CELL_POINTS 4
+#define BEV_POINT_GRID_CELL_NUM_MAX (1 << 22)
+
+namespace mluoptest {
+
+BevPointGrid::BevPointGrid(const float *points, int64_t num, int64_t stride) {
+  GTEST_CHECK(num >= 0 && num <= INT32_MAX,
+              "BevPointGrid: point indices do not fit in int32_t.");
+  int64_t finite_num = 0;
+  double x_max = 0.0, y_max = 0.0;
+  for (int64_t i = 0; i < num; ++i) {
+    const double x = points[i * stride], y = points[i * stride + 1];
+    if (!std::isfinite(x) || !std::isfinite(y)) {
+      continue;
+    }
+    if (finite_num++ == 0) {
+      x_min_ = x_max = x;
+      y_min_ = y_max = y;
+    } else {
+      x_min_ = std::min(x_min_, x);
+      x_max = std::max(x_max, x);
+      y_min_ = std::min(y_min_, y);
+      y_max = std::max(y_max, y);
+    }
+  }
+
+  // square cells holding a few points each on average, and never more than
+  // about 3 * cell_num cells for clouds much longer than wide
+  const double width = x_max - x_min_, height = y_max - y_min_;
+  const double cell_num = std::min<double>(
+      BEV_POINT_GRID_CELL_NUM_MAX,
+      std::max<double>(1.0, finite_num / BEV_POINT_GRID_CELL_POINTS));
+  const double cell = std::max(std::sqrt(width * height / cell_num),
+                               std::max(width, height) / cell_num);
+  if (cell > 0.0 && std::isfinite(cell)) {
+    inv_cell_ = 1.0 / cell;
+    col_num_ = (int64_t)std::min(width * inv_cell_ + 1.0, cell_num + 1.0);
+    row_num_ = (int64_t)std::min(height * inv_cell_ + 1.0, cell_num + 1.0);
+  }
+
+  // counting sort by cell, stable so that points of a cell keep their order
+  const int64_t grid_size = col_num_ * row_num_;
+  std::vector<int64_t> cell_of(num);
+  cell_begin_.assign(grid_size + 2, 0);
+  for (int64_t i = 0; i < num; ++i) {
+    const double x = points[i * stride], y = points[i * stride + 1];
+    cell_of[i] = (std::isfinite(x) && std::isfinite(y))
+                     ? row(y) * col_num_ + col(x)
+                     : grid_size;
+    ++cell_begin_[cell_of[i] + 1];
+  }
+  for (int64_t c = 0; c <= grid_size; ++c) {
+    cell_begin_[c + 1] += cell_begin_[c];
+  }
+  x_.resize(num);
+  y_.resize(num);
+  z_.resize(num);
+  index_.resize(num);
+  std::vector<int64_t> next(cell_begin_.begin(), cell_begin_.end() - 1);
+  for (int64_t i = 0; i < num; ++i) {
+    const int64_t pos = next[cell_of[i]]++;
+    x_[pos] = points[i * stride];
+    y_[pos] = points[i * stride + 1];
+    z_[pos] = points[i * stride + 2];
+    index_[pos] = (int32_t)i;
+  }
+  cell_begin_.pop_back();
+}
+
+int64_t BevPointGrid::col(double x) const {
+  const double c = (x - x_min_) * inv_cell_;
+  return (int64_t)std::min(std::max(c, 0.0), (double)(col_num_ - 1));
+}
+
+int64_t BevPointGrid::row(double y) const {
+  const double r = (y - y_min_) * inv_cell_;
+  return (int64_t)std::min(std::max(r, 0.0), (double)(row_num_ - 1));
+}
+
+bool BevPointGrid::cellRange(float cx, float cy, double half_x, double half_y,
+                             float rz, int64_t *col_begin, int64_t *col_end,
+                             int64_t *row_begin, int64_t *row_end) const {
+  const double c = std::fabs(std::cos((double)rz));
+  const double s = std::fabs(std::sin((double)rz));
+  half_x = std::fabs(half_x);
+  half_y = std::fabs(half_y);
+  const double extent_x = c * half_x + s * half_y;
+  const double extent_y = s * half_x + c * half_y;
+  // the float tests round local coordinates by a few ulp of the distance to
+  // the center, the margin is orders of magnitude above that
+  const double slack = 1e-4 * (extent_x + extent_y) +
+                       1e-9 * (std::fabs((double)cx) + std::fabs((double)cy));
+  const double x_lo = cx - extent_x - slack, x_hi = cx + extent_x + slack;
+  const double y_lo = cy - extent_y - slack, y_hi = cy + extent_y + slack;
+  if (!std::isfinite(x_lo) || !std::isfinite(x_hi) || !std::isfinite(y_lo) ||
+      !std::isfinite(y_hi)) {
+    return false;
+  }
+  *col_begin = col(x_lo);
+  *col_end = col(x_hi) + 1;
+  *row_begin = row(y_lo);
+  *row_end = row(y_hi) + 1;
+  return true;
+}
+
+}  // namespace mluoptest
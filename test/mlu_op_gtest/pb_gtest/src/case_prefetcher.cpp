@@ -0,0 +1,126 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include "case_prefetcher.h"
+
+#include <chrono>  // NOLINT
+#include <utility>
+
+namespace mluoptest {
+
+CasePrefetcher::CasePrefetcher(const std::vector<std::string> &case_paths,
+                               size_t case_num, size_t mem_budget)
+    : case_paths_(case_paths), case_num_(case_num), mem_budget_(mem_budget) {
+  worker_ = std::thread(&CasePrefetcher::work, this);
+}
+
+CasePrefetcher::~CasePrefetcher() {
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    stop_ = true;
+  }
+  cond_.notify_all();
+  worker_.join();
+}
+
+void CasePrefetcher::work() {
+  while (true) {
+    size_t index;
+    {
+      std::unique_lock<std::mutex> lk(mutex_);
+      cond_.wait(lk, [this]() {
+        return stop_ ||
+               (next_ < case_paths_.size() && slots_.size() < case_num_ &&
+                (held_size_ < mem_budget_ || held_size_ == 0));
+      });
+      if (stop_) {
+        return;
+      }
+      index = next_++;
+      slots_.emplace_back();
+      slots_.back().index = index;
+    }
+
+    auto parser = std::make_shared<Parser>();
+    if (!parser->prefetch(case_paths_[index])) {
+      parser = nullptr;
+    }
+
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      for (auto &slot : slots_) {
+        if (slot.index == index) {
+          slot.parser = parser;
+          slot.size = parser ? parser->getPrefetchedSize() : 0;
+          slot.done = true;
+          held_size_ += slot.size;
+          break;
+        }
+      }
+    }
+    cond_.notify_all();
+  }
+}
+
+std::shared_ptr<Parser> CasePrefetcher::take(size_t index) {
+  auto start = std::chrono::steady_clock::now();
+  std::unique_lock<std::mutex> lk(mutex_);
+  held_size_ -= running_size_;
+  running_size_ = 0;
+
+  auto front_done = [this]() { return slots_.front().done; };
+  // drop cases which were not run, e.g. filtered out
+  while (!slots_.empty() && slots_.front().index < index) {
+    cond_.wait(lk, front_done);
+    held_size_ -= slots_.front().size;
+    slots_.pop_front();
+  }
+
+  if (slots_.empty() && next_ <= index) {
+    // not started yet (held back by the memory budget, or the test loop
+    // jumped ahead), read ahead from this case on
+    next_ = index;
+    cond_.notify_all();
+    cond_.wait(lk, [this]() { return !slots_.empty(); });
+  }
+
+  // a case older than the read-ahead window (e.g. with --gtest_shuffle) is
+  // not held any more, leave it to the normal parse path
+  std::shared_ptr<Parser> parser = nullptr;
+  if (!slots_.empty() && slots_.front().index == index) {
+    cond_.wait(lk, front_done);
+    parser = slots_.front().parser;
+    running_size_ = slots_.front().size;
+    slots_.pop_front();
+  }
+  lk.unlock();
+  cond_.notify_all();
+
+  if (parser != nullptr) {
+    std::chrono::duration<double> wait_s =
+        std::chrono::steady_clock::now() - start;
+    parser->setPrefetchWaitSeconds(wait_s.count());
+  }
+  return parser;
+}
+
+}  // namespace mluoptest
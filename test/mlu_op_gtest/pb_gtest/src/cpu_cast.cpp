@@ -0,0 +1,208 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include "cpu_cast.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace mluoptest {
+
+namespace {
+
+template <AlgoHalfToFloat algo>
+void halfToFloatScalar(float *dst, const uint16_t *src, size_t num) {
+  for (size_t i = 0; i < num; ++i) {
+    dst[i] = cvtHalfToFloatImpl<algo>(src[i]);
+  }
+}
+
+void floatToBF16Scalar(uint16_t *dst, const float *src, size_t num) {
+  for (size_t i = 0; i < num; ++i) {
+    uint32_t src_i;
+    memcpy(&src_i, src + i, sizeof(uint32_t));
+    if (std::isnan(src[i])) {
+      dst[i] = 0x7FC0;
+    } else {
+      uint32_t rounding_bias = ((src_i >> 16) & 1) + (uint32_t)0x7FFF;
+      dst[i] = static_cast<uint16_t>((src_i + rounding_bias) >> 16);
+    }
+  }
+}
+
+void bf16ToFloatScalar(float *dst, const uint16_t *src, size_t num) {
+  for (size_t i = 0; i < num; ++i) {
+    uint32_t dst_i = (uint32_t)src[i] << 16;
+    memcpy(dst + i, &dst_i, sizeof(float));
+  }
+}
+
+#if defined(__x86_64__)
+
+bool hasAvx2F16c() {
+  static const bool supported =
+      __builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c");
+  return supported;
+}
+
+// F16C converts every half exactly. The SOPA and MLUOPGTEST2 algos only
+// differ on inf, which they saturate to +-65504, and on NaN, which they
+// replace by a fixed pattern keeping the sign.
+__attribute__((target("avx2,f16c"))) void halfToFloatAvx2(
+    float *dst, const uint16_t *src, size_t num, const bool fix_special,
+    const uint32_t nan_bits) {
+  const __m256i exp_mask = _mm256_set1_epi32(0x7f800000);
+  const __m256i abs_mask = _mm256_set1_epi32(0x7fffffff);
+  const __m256i sign_mask = _mm256_set1_epi32(0x80000000);
+  const __m256i half_max = _mm256_set1_epi32(0x477fe000);  // 65504.f
+  const __m256i nan = _mm256_set1_epi32(nan_bits);
+  size_t i = 0;
+  for (; i + 8 <= num; i += 8) {
+    __m256 value =
+        _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)(src + i)));
+    if (fix_special) {
+      __m256i bits = _mm256_castps_si256(value);
+      __m256i special =
+          _mm256_cmpeq_epi32(_mm256_and_si256(bits, exp_mask), exp_mask);
+      if (!_mm256_testz_si256(special, special)) {
+        __m256i is_inf =
+            _mm256_cmpeq_epi32(_mm256_and_si256(bits, abs_mask), exp_mask);
+        __m256i fixed = _mm256_or_si256(
+            _mm256_blendv_epi8(nan, half_max, is_inf),
+            _mm256_and_si256(bits, sign_mask));
+        value = _mm256_castsi256_ps(_mm256_blendv_epi8(bits, fixed, special));
+      }
+    }
+    _mm256_storeu_ps(dst + i, value);
+  }
+  if (i < num) {
+    float tail[8];
+    uint16_t tail_src[8] = {0};
+    memcpy(tail_src, src + i, (num - i) * sizeof(uint16_t));
+    halfToFloatAvx2(tail, tail_src, 8, fix_special, nan_bits);
+    memcpy(dst + i, tail, (num - i) * sizeof(float));
+  }
+}
+
+__attribute__((target("avx2"))) void floatToBF16Avx2(uint16_t *dst,
+                                                     const float *src,
+                                                     size_t num) {
+  const __m256i one = _mm256_set1_epi32(1);
+  const __m256i bias = _mm256_set1_epi32(0x7fff);
+  const __m256i abs_mask = _mm256_set1_epi32(0x7fffffff);
+  const __m256i inf = _mm256_set1_epi32(0x7f800000);
+  const __m256i nan = _mm256_set1_epi32(0x7fc0);
+  size_t i = 0;
+  for (; i + 8 <= num; i += 8) {
+    __m256i bits = _mm256_loadu_si256((const __m256i *)(src + i));
+    __m256i lsb = _mm256_and_si256(_mm256_srli_epi32(bits, 16), one);
+    __m256i rounded = _mm256_srli_epi32(
+        _mm256_add_epi32(bits, _mm256_add_epi32(lsb, bias)), 16);
+    __m256i is_nan =
+        _mm256_cmpgt_epi32(_mm256_and_si256(bits, abs_mask), inf);
+    rounded = _mm256_blendv_epi8(rounded, nan, is_nan);
+    // 32 to 16 bits packs within 128-bit lanes, gather lanes 0 and 2
+    __m256i packed = _mm256_permute4x64_epi64(
+        _mm256_packus_epi32(rounded, rounded), 0x08);
+    _mm_storeu_si128((__m128i *)(dst + i), _mm256_castsi256_si128(packed));
+  }
+  floatToBF16Scalar(dst + i, src + i, num - i);
+}
+
+__attribute__((target("avx2"))) void bf16ToFloatAvx2(float *dst,
+                                                     const uint16_t *src,
+                                                     size_t num) {
+  size_t i = 0;
+  for (; i + 8 <= num; i += 8) {
+    __m256i bits =
+        _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(src + i)));
+    _mm256_storeu_si256((__m256i *)(dst + i), _mm256_slli_epi32(bits, 16));
+  }
+  bf16ToFloatScalar(dst + i, src + i, num - i);
+}
+
+#endif  // defined(__x86_64__)
+
+}  // namespace
+
+bool castHalfToFloatVectorized(AlgoHalfToFloat algo) {
+#if defined(__x86_64__)
+  return hasAvx2F16c() &&
+         (algo == AlgoHalfToFloat::SOPA ||
+          algo == AlgoHalfToFloat::MLUOPGTEST2 ||
+          algo == AlgoHalfToFloat::CPU_INTRINSIC);
+#else
+  return false;
+#endif
+}
+
+void castHalfToFloatSpan(float *dst, const uint16_t *src, size_t num,
+                         AlgoHalfToFloat algo) {
+#if defined(__x86_64__)
+  if (castHalfToFloatVectorized(algo)) {
+    // NaN of SOPA is all ones, MLUOPGTEST2 returns std::nanf("")
+    const uint32_t nan_bits =
+        algo == AlgoHalfToFloat::SOPA ? 0x7fffffff : 0x7fc00000;
+    halfToFloatAvx2(dst, src, num, algo != AlgoHalfToFloat::CPU_INTRINSIC,
+                    nan_bits);
+    return;
+  }
+#endif
+  switch (algo) {
+    case AlgoHalfToFloat::SOPA:
+      halfToFloatScalar<AlgoHalfToFloat::SOPA>(dst, src, num);
+      break;
+    case AlgoHalfToFloat::MLUOPGTEST2:
+      halfToFloatScalar<AlgoHalfToFloat::MLUOPGTEST2>(dst, src, num);
+      break;
+#if defined(__x86_64__) || defined(__aarch64__)
+    case AlgoHalfToFloat::CPU_INTRINSIC:
+      halfToFloatScalar<AlgoHalfToFloat::CPU_INTRINSIC>(dst, src, num);
+      break;
+#endif
+    default:
+      halfToFloatScalar<AlgoHalfToFloat::MLUOPGTEST2>(dst, src, num);
+      break;
+  }
+}
+
+void castFloatToBF16Span(uint16_t *dst, const float *src, size_t num) {
+#if defined(__x86_64__)
+  if (hasAvx2F16c()) {
+    floatToBF16Avx2(dst, src, num);
+    return;
+  }
+#endif
+  floatToBF16Scalar(dst, src, num);
+}
+
+void castBF16ToFloatSpan(float *dst, const uint16_t *src, size_t num) {
+#if defined(__x86_64__)
+  if (hasAvx2F16c()) {
+    bf16ToFloatAvx2(dst, src, num);
+    return;
+  }
+#endif
+  bf16ToFloatScalar(dst, src, num);
+}
+
+}  // namespace mluoptest
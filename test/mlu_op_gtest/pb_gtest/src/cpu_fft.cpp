@@ -0,0 +1,437 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include "cpu_fft.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "kernels/fft/common/fft_factor.h"
+
+namespace mluoptest {
+
+namespace {
+
+typedef std::complex<double> Complex;
+
+// exp(-2 * pi * i * t / len) for t in [0, len)
+Complex unitRoot(int64_t t, int64_t len) {
+  const double phase = -2.0 * M_PI * (double)t / (double)len;
+  return Complex(std::cos(phase), std::sin(phase));
+}
+
+// complex product without the inf and nan recovery of operator*, which
+// keeps it out of line unless -ffast-math is on
+inline Complex mul(const Complex &a, const Complex &b) {
+  return Complex(a.real() * b.real() - a.imag() * b.imag(),
+                 a.real() * b.imag() + a.imag() * b.real());
+}
+
+// the butterflies of a forward transform, v is overwritten by its DFT
+inline void butterfly2(Complex *v) {
+  const Complex a = v[0];
+  v[0] = a + v[1];
+  v[1] = a - v[1];
+}
+
+inline void butterfly3(Complex *v) {
+  // sqrt(3) / 2
+  const double s3 = 0.86602540378443864676;
+  const Complex s = v[1] + v[2];
+  const Complex d = v[1] - v[2];
+  const Complex m = v[0] - 0.5 * s;
+  // -i * sqrt(3) / 2 * d
+  const Complex t(s3 * d.imag(), -s3 * d.real());
+  v[0] += s;
+  v[1] = m + t;
+  v[2] = m - t;
+}
+
+inline void butterfly4(Complex *v) {
+  const Complex s02 = v[0] + v[2];
+  const Complex d02 = v[0] - v[2];
+  const Complex s13 = v[1] + v[3];
+  // -i * (v[1] - v[3])
+  const Complex d13(v[1].imag() - v[3].imag(), v[3].real() - v[1].real());
+  v[0] = s02 + s13;
+  v[1] = d02 + d13;
+  v[2] = s02 - s13;
+  v[3] = d02 - d13;
+}
+
+void butterflyGeneric(Complex *v, const int radix, const Complex *root) {
+  Complex y[64];
+  for (int q = 0; q < radix; ++q) {
+    Complex sum = v[0];
+    int t = 0;
+    for (int r = 1; r < radix; ++r) {
+      t += q;
+      t = t >= radix ? t - radix : t;
+      sum += mul(v[r], root[t]);
+    }
+    y[q] = sum;
+  }
+  std::copy(y, y + radix, v);
+}
+
+// One Stockham stage merging transforms of span points into transforms of
+// span * radix points. RADIX 0 stands for any radix up to 64.
+template <int RADIX>
+void radixStage(const Complex *in, Complex *out, const int64_t n,
+                const int64_t span, const Complex *twiddle,
+                const Complex *root, const int any_radix = 0) {
+  const int radix = RADIX > 0 ? RADIX : any_radix;
+  const int64_t quarter = n / radix;
+  Complex v[RADIX > 0 ? RADIX : 64];
+  for (int64_t q = 0; q < quarter / span; ++q) {
+    Complex *dst = out + q * span * radix;
+    for (int64_t k = 0; k < span; ++k) {
+      const int64_t j = q * span + k;
+      const Complex *w = twiddle + k * radix;
+      v[0] = in[j];
+      for (int r = 1; r < radix; ++r) {
+        const Complex &a = in[j + r * quarter];
+        v[r] = span == 1 ? a : mul(a, w[r]);
+      }
+      if (RADIX == 2) {
+        butterfly2(v);
+      } else if (RADIX == 3) {
+        butterfly3(v);
+      } else if (RADIX == 4) {
+        butterfly4(v);
+      } else {
+        butterflyGeneric(v, radix, root);
+      }
+      for (int r = 0; r < radix; ++r) {
+        dst[k + r * span] = v[r];
+      }
+    }
+  }
+}
+
+// appends the butterfly radices of a stage of fftFactor, small ones first
+void splitRadix(int radix, std::vector<int> *radices) {
+  while (radix % 4 == 0) {
+    radices->push_back(4);
+    radix /= 4;
+  }
+  for (int p = 2; p <= radix; ++p) {
+    while (radix % p == 0) {
+      radices->push_back(p);
+      radix /= p;
+    }
+  }
+}
+
+}  // namespace
+
+CpuFftLayout cpuFftPackedLayout(const std::vector<int64_t> &embed) {
+  CpuFftLayout layout;
+  layout.embed = embed;
+  layout.stride.resize(embed.size());
+  int64_t stride = 1;
+  for (int i = (int)embed.size() - 1; i >= 0; --i) {
+    layout.stride[i] = stride;
+    stride *= embed[i];
+  }
+  layout.dist = stride;
+  return layout;
+}
+
+CpuFftLine::CpuFftLine(int64_t n) : n_(n) {
+  std::vector<int> radices;
+  int64_t rest = n;
+  while (rest > 1) {
+    const int radix = fftFactorRadix((int)n, (int)rest);
+    if (radix <= 1 || rest % radix != 0) {
+      break;
+    }
+    splitRadix(radix, &radices);
+    rest /= radix;
+  }
+
+  if (rest > 1) {
+    // convolution of 2 * n - 1 points without wrapping around
+    m_ = 1;
+    while (m_ < 2 * n - 1) {
+      m_ *= 2;
+    }
+    bluestein_.reset(new CpuFftLine(m_));
+    chirp_.resize(n);
+    for (int64_t k = 0; k < n; ++k) {
+      // k * k / n = (k * k mod 2n) / n modulo 2
+      chirp_[k] = unitRoot((k * k) % (2 * n), 2 * n);
+    }
+    kernel_.assign(m_, Complex(0, 0));
+    kernel_[0] = std::conj(chirp_[0]);
+    for (int64_t k = 1; k < n; ++k) {
+      kernel_[k] = std::conj(chirp_[k]);
+      kernel_[m_ - k] = std::conj(chirp_[k]);
+    }
+    std::vector<Complex> work(bluestein_->workSize());
+    bluestein_->forward(kernel_.data(), work.data());
+    for (auto &k : kernel_) {
+      k /= (double)m_;
+    }
+    return;
+  }
+
+  int64_t span = 1;
+  for (int radix : radices) {
+    Stage stage;
+    stage.radix = radix;
+    stage.span = span;
+    stage.twiddle = twiddles_.size();
+    const int64_t len = span * radix;
+    for (int64_t k = 0; k < span; ++k) {
+      for (int r = 0; r < radix; ++r) {
+        twiddles_.push_back(unitRoot((r * k) % len, len));
+      }
+    }
+    stage.root = twiddles_.size();
+    for (int t = 0; t < radix; ++t) {
+      twiddles_.push_back(unitRoot(t, radix));
+    }
+    stages_.push_back(stage);
+    span = len;
+  }
+}
+
+void CpuFftLine::forward(Complex *x, Complex *work) const {
+  if (bluestein_) {
+    Complex *a = work;
+    for (int64_t k = 0; k < n_; ++k) {
+      a[k] = mul(x[k], chirp_[k]);
+    }
+    std::fill(a + n_, a + m_, Complex(0, 0));
+    Complex *sub_work = work + m_;
+    bluestein_->forward(a, sub_work);
+    // the inverse transform of the product, conj(forward(conj(a * kernel)))
+    for (int64_t k = 0; k < m_; ++k) {
+      a[k] = std::conj(mul(a[k], kernel_[k]));
+    }
+    bluestein_->forward(a, sub_work);
+    for (int64_t k = 0; k < n_; ++k) {
+      x[k] = mul(chirp_[k], std::conj(a[k]));
+    }
+    return;
+  }
+
+  // Stockham autosort: every stage reads in and writes out in natural order
+  Complex *in = x;
+  Complex *out = work;
+  for (const Stage &stage : stages_) {
+    const Complex *twiddle = twiddles_.data() + stage.twiddle;
+    const Complex *root = twiddles_.data() + stage.root;
+    switch (stage.radix) {
+      case 2:
+        radixStage<2>(in, out, n_, stage.span, twiddle, root);
+        break;
+      case 3:
+        radixStage<3>(in, out, n_, stage.span, twiddle, root);
+        break;
+      case 4:
+        radixStage<4>(in, out, n_, stage.span, twiddle, root);
+        break;
+      default:
+        radixStage<0>(in, out, n_, stage.span, twiddle, root, stage.radix);
+        break;
+    }
+    std::swap(in, out);
+  }
+  if (in != x) {
+    std::copy(in, in + n_, x);
+  }
+}
+
+void CpuFftLine::run(Complex *x, int sign, Complex *work) const {
+  // the backward transform is conj(forward(conj(x)))
+  if (sign > 0) {
+    for (int64_t k = 0; k < n_; ++k) {
+      x[k] = std::conj(x[k]);
+    }
+  }
+  forward(x, work);
+  if (sign > 0) {
+    for (int64_t k = 0; k < n_; ++k) {
+      x[k] = std::conj(x[k]);
+    }
+  }
+}
+
+CpuFft::CpuFft(CpuFftType type, const std::vector<int64_t> &n, int64_t batch,
+               const CpuFftLayout &in, const CpuFftLayout &out)
+    : type_(type),
+      rank_((int)n.size()),
+      batch_(batch),
+      in_(in),
+      out_(out),
+      shape_(n) {
+  if (type_ != CPU_FFT_C2C) {
+    shape_[rank_ - 1] = n[rank_ - 1] / 2 + 1;
+  }
+  for (int i = 0; i < rank_; ++i) {
+    lines_.emplace_back(n[i]);
+  }
+}
+
+void CpuFft::run(const float *input, float *output, int direction,
+                 double scale, const TaskRunner &run_tasks) const {
+  const int last = rank_ - 1;
+  int sign = direction == 0 ? -1 : 1;
+  if (type_ != CPU_FFT_C2C) {
+    sign = type_ == CPU_FFT_R2C ? -1 : 1;
+  }
+  // inner[i] is the buffer stride of dim i
+  std::vector<int64_t> inner(rank_, 1);
+  for (int i = last - 1; i >= 0; --i) {
+    inner[i] = inner[i + 1] * shape_[i + 1];
+  }
+  std::vector<Complex> buf(batch_ * inner[0] * shape_[0]);
+
+  // runs pass(line_begin, line_end) over line_num lines of len points
+  auto forLines = [&](int64_t line_num, int64_t len,
+                      const std::function<void(int64_t, int64_t)> &pass) {
+    const int64_t lines_per_task =
+        std::max<int64_t>(1, CPU_FFT_TASK_POINTS / std::max<int64_t>(len, 1));
+    const int64_t task_num = (line_num + lines_per_task - 1) / lines_per_task;
+    auto task = [&](int64_t task_begin, int64_t task_end) {
+      pass(task_begin * lines_per_task,
+           std::min(line_num, task_end * lines_per_task));
+    };
+    if (run_tasks) {
+      run_tasks(task_num, task);
+    } else {
+      task(0, task_num);
+    }
+  };
+
+  // Offset in layout of line l along the last dim, -1 when the line lies
+  // beyond embed or beyond the buffer dims.
+  auto lineOffset = [&](const CpuFftLayout &layout, int64_t l) {
+    int64_t offset = 0;
+    for (int i = last - 1; i >= 0; --i) {
+      const int64_t idx = l % shape_[i];
+      l /= shape_[i];
+      if (idx >= layout.embed[i]) {
+        return (int64_t)-1;
+      }
+      offset += idx * layout.stride[i];
+    }
+    return offset + l * layout.dist;
+  };
+
+  const int64_t line_num = (int64_t)buf.size() / shape_[last];
+  const int64_t n_last = lines_[last].size();
+
+  // the last dim is loaded first, and transformed except for c2r
+  forLines(line_num, n_last, [&](int64_t line_begin, int64_t line_end) {
+    std::vector<Complex> line(n_last);
+    std::vector<Complex> work(lines_[last].workSize());
+    const int64_t count = std::min(in_.embed[last], shape_[last]);
+    const int64_t stride = in_.stride[last];
+    for (int64_t l = line_begin; l < line_end; ++l) {
+      Complex *dst = buf.data() + l * shape_[last];
+      const int64_t offset = lineOffset(in_, l);
+      if (offset < 0) {
+        std::fill(dst, dst + shape_[last], Complex(0, 0));
+        continue;
+      }
+      if (type_ == CPU_FFT_R2C) {
+        const int64_t real_count = std::min(in_.embed[last], n_last);
+        const float *src = input + offset;
+        for (int64_t k = 0; k < real_count; ++k) {
+          line[k] = Complex(src[k * stride], 0);
+        }
+        std::fill(line.begin() + real_count, line.end(), Complex(0, 0));
+        lines_[last].run(line.data(), sign, work.data());
+        std::copy(line.begin(), line.begin() + shape_[last], dst);
+        continue;
+      }
+      const float *src = input + 2 * offset;
+      for (int64_t k = 0; k < count; ++k) {
+        dst[k] = Complex(src[2 * k * stride], src[2 * k * stride + 1]);
+      }
+      std::fill(dst + count, dst + shape_[last], Complex(0, 0));
+      if (type_ == CPU_FFT_C2C) {
+        lines_[last].run(dst, sign, work.data());
+      }
+    }
+  });
+
+  for (int axis = last - 1; axis >= 0; --axis) {
+    const int64_t len = shape_[axis];
+    const int64_t stride = inner[axis];
+    auto pass = [&](int64_t line_begin, int64_t line_end) {
+      std::vector<Complex> line(len);
+      std::vector<Complex> work(lines_[axis].workSize());
+      for (int64_t l = line_begin; l < line_end; ++l) {
+        Complex *base = buf.data() + (l / stride) * len * stride + l % stride;
+        for (int64_t k = 0; k < len; ++k) {
+          line[k] = base[k * stride];
+        }
+        lines_[axis].run(line.data(), sign, work.data());
+        for (int64_t k = 0; k < len; ++k) {
+          base[k * stride] = line[k];
+        }
+      }
+    };
+    forLines((int64_t)buf.size() / len, len, pass);
+  }
+
+  // c2r transforms the hermitian extension of the last dim while storing
+  forLines(line_num, n_last, [&](int64_t line_begin, int64_t line_end) {
+    std::vector<Complex> line(type_ == CPU_FFT_C2R ? n_last : 0);
+    std::vector<Complex> work(type_ == CPU_FFT_C2R ? lines_[last].workSize()
+                                                   : 0);
+    const int64_t stride = out_.stride[last];
+    for (int64_t l = line_begin; l < line_end; ++l) {
+      const Complex *src = buf.data() + l * shape_[last];
+      const int64_t offset = lineOffset(out_, l);
+      if (offset < 0) {
+        continue;
+      }
+      if (type_ == CPU_FFT_C2R) {
+        const int64_t half = shape_[last];
+        std::copy(src, src + half, line.begin());
+        for (int64_t k = half; k < n_last; ++k) {
+          line[k] = std::conj(src[n_last - k]);
+        }
+        lines_[last].run(line.data(), sign, work.data());
+        const int64_t count = std::min(out_.embed[last], n_last);
+        float *dst = output + offset;
+        for (int64_t k = 0; k < count; ++k) {
+          dst[k * stride] = (float)(line[k].real() * scale);
+        }
+        continue;
+      }
+      const int64_t count = std::min(out_.embed[last], shape_[last]);
+      float *dst = output + 2 * offset;
+      for (int64_t k = 0; k < count; ++k) {
+        dst[2 * k * stride] = (float)(src[k].real() * scale);
+        dst[2 * k * stride + 1] = (float)(src[k].imag() * scale);
+      }
+    }
+  });
+}
+
+}  // namespace mluoptest
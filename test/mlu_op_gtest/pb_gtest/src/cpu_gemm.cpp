@@ -0,0 +1,342 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include "cpu_gemm.h"
+#include "cpu_parallel.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CPU_GEMM_X86 1
+#else
+#define CPU_GEMM_X86 0
+#endif
+
+// Rows of C computed by one microkernel call, the columns are two vectors.
+#define CPU_GEMM_MR 6
+// Rows of op(A), columns of op(B) and depth packed at a time. MC and NC are
+// multiples of the microkernel tile of every ISA, the packed A block stays in
+// L2 and a kc x nr sliver of B in L1 while a block is multiplied.
+#define CPU_GEMM_MC 120
+#define CPU_GEMM_NC 512
+#define CPU_GEMM_KC_BYTES 1024
+
+namespace mluoptest {
+
+namespace {
+
+// Multiplies a packed MR x kc sliver of A by a packed kc x NR sliver of B,
+// and writes the MR x NR product to tile. NR is two vectors of VB bytes.
+// Written with vector extensions, the ISA comes from the caller below.
+template <typename T, int VB>
+__attribute__((always_inline)) inline void microKernel(int64_t kc,
+                                                        const T *a,
+                                                        const T *b,
+                                                        T *tile) {
+  typedef T V __attribute__((vector_size(VB)));
+  const int lanes = VB / sizeof(T);
+  V acc[CPU_GEMM_MR][2];
+#pragma GCC unroll 8
+  for (int r = 0; r < CPU_GEMM_MR; ++r) {
+    acc[r][0] = V{};
+    acc[r][1] = V{};
+  }
+  for (int64_t p = 0; p < kc; ++p) {
+    V b0, b1;
+    memcpy(&b0, b, VB);
+    memcpy(&b1, b + lanes, VB);
+#pragma GCC unroll 8
+    for (int r = 0; r < CPU_GEMM_MR; ++r) {
+      const V ar = V{} + a[r];
+      acc[r][0] += ar * b0;
+      acc[r][1] += ar * b1;
+    }
+    a += CPU_GEMM_MR;
+    b += 2 * lanes;
+  }
+#pragma GCC unroll 8
+  for (int r = 0; r < CPU_GEMM_MR; ++r) {
+    memcpy(tile + r * 2 * lanes, &acc[r][0], VB);
+    memcpy(tile + r * 2 * lanes + lanes, &acc[r][1], VB);
+  }
+}
+
+template <typename T>
+struct GemmKernel {
+  const char *isa;
+  int nr;
+  void (*run)(int64_t kc, const T *a, const T *b, T *tile);
+};
+
+void kernelGenericF32(int64_t kc, const float *a, const float *b, float *t) {
+  microKernel<float, 16>(kc, a, b, t);
+}
+void kernelGenericF64(int64_t kc, const double *a, const double *b,
+                      double *t) {
+  microKernel<double, 16>(kc, a, b, t);
+}
+
+#if CPU_GEMM_X86
+__attribute__((target("avx2,fma"))) void kernelAvx2F32(int64_t kc,
+                                                       const float *a,
+                                                       const float *b,
+                                                       float *t) {
+  microKernel<float, 32>(kc, a, b, t);
+}
+__attribute__((target("avx2,fma"))) void kernelAvx2F64(int64_t kc,
+                                                       const double *a,
+                                                       const double *b,
+                                                       double *t) {
+  microKernel<double, 32>(kc, a, b, t);
+}
+__attribute__((target("avx512f"))) void kernelAvx512F32(int64_t kc,
+                                                        const float *a,
+                                                        const float *b,
+                                                        float *t) {
+  microKernel<float, 64>(kc, a, b, t);
+}
+__attribute__((target("avx512f"))) void kernelAvx512F64(int64_t kc,
+                                                        const double *a,
+                                                        const double *b,
+                                                        double *t) {
+  microKernel<double, 64>(kc, a, b, t);
+}
+#endif
+
+enum GemmIsa { GEMM_ISA_GENERIC, GEMM_ISA_AVX2, GEMM_ISA_AVX512 };
+
+GemmIsa detectIsa() {
+#if CPU_GEMM_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    return GEMM_ISA_AVX512;
+  }
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    return GEMM_ISA_AVX2;
+  }
+#endif
+  return GEMM_ISA_GENERIC;
+}
+
+GemmIsa gemmIsa() {
+  static const GemmIsa isa = detectIsa();
+  return isa;
+}
+
+template <typename T>
+GemmKernel<T> selectKernel();
+
+template <>
+GemmKernel<float> selectKernel<float>() {
+#if CPU_GEMM_X86
+  switch (gemmIsa()) {
+    case GEMM_ISA_AVX512: return {"avx512", 32, kernelAvx512F32};
+    case GEMM_ISA_AVX2: return {"avx2", 16, kernelAvx2F32};
+    default: break;
+  }
+#endif
+  return {"generic", 8, kernelGenericF32};
+}
+
+template <>
+GemmKernel<double> selectKernel<double>() {
+#if CPU_GEMM_X86
+  switch (gemmIsa()) {
+    case GEMM_ISA_AVX512: return {"avx512", 16, kernelAvx512F64};
+    case GEMM_ISA_AVX2: return {"avx2", 8, kernelAvx2F64};
+    default: break;
+  }
+#endif
+  return {"generic", 4, kernelGenericF64};
+}
+
+template <typename T>
+const GemmKernel<T> &gemmKernel() {
+  static const GemmKernel<T> kernel = selectKernel<T>();
+  return kernel;
+}
+
+// Packs the mc x kc block of op(A) starting at a into slivers of MR rows,
+// stored depth by depth and zero padded past the last row.
+template <typename T>
+void packA(bool trans, const T *a, int64_t lda, int64_t mc, int64_t kc,
+           T *pack) {
+  for (int64_t i = 0; i < mc; i += CPU_GEMM_MR) {
+    const int64_t rows = std::min<int64_t>(CPU_GEMM_MR, mc - i);
+    for (int64_t p = 0; p < kc; ++p) {
+      for (int64_t r = 0; r < rows; ++r) {
+        pack[r] = trans ? a[p * lda + i + r] : a[(i + r) * lda + p];
+      }
+      for (int64_t r = rows; r < CPU_GEMM_MR; ++r) {
+        pack[r] = T(0);
+      }
+      pack += CPU_GEMM_MR;
+    }
+  }
+}
+
+// Packs the kc x nc block of op(B) starting at b into slivers of nr columns,
+// stored depth by depth and zero padded past the last column.
+template <typename T>
+void packB(bool trans, const T *b, int64_t ldb, int64_t kc, int64_t nc,
+           int nr, T *pack) {
+  for (int64_t j = 0; j < nc; j += nr) {
+    const int64_t cols = std::min<int64_t>(nr, nc - j);
+    for (int64_t p = 0; p < kc; ++p) {
+      if (trans) {
+        for (int64_t c = 0; c < cols; ++c) {
+          pack[c] = b[(j + c) * ldb + p];
+        }
+      } else {
+        memcpy(pack, b + p * ldb + j, cols * sizeof(T));
+      }
+      for (int64_t c = cols; c < nr; ++c) {
+        pack[c] = T(0);
+      }
+      pack += nr;
+    }
+  }
+}
+
+template <typename T>
+struct GemmArgs {
+  bool trans_a;
+  bool trans_b;
+  int64_t m, n, k;
+  T alpha;
+  const T *a;
+  int64_t lda, stride_a;
+  const T *b;
+  int64_t ldb, stride_b;
+  T beta;
+  T *c;
+  int64_t ldc, stride_c;
+};
+
+// Computes the mc x nc tile of C at (ic, jc) of one product.
+template <typename T>
+void gemmTile(const GemmArgs<T> &g, const T *a, const T *b, T *c, int64_t ic,
+              int64_t jc) {
+  const GemmKernel<T> &kernel = gemmKernel<T>();
+  const int64_t mc = std::min<int64_t>(CPU_GEMM_MC, g.m - ic);
+  const int64_t nc = std::min<int64_t>(CPU_GEMM_NC, g.n - jc);
+  const int64_t kc_max = CPU_GEMM_KC_BYTES / sizeof(T);
+
+  for (int64_t i = 0; i < mc; ++i) {
+    T *row = c + (ic + i) * g.ldc + jc;
+    if (g.beta == T(0)) {
+      std::fill(row, row + nc, T(0));
+    } else if (g.beta != T(1)) {
+      for (int64_t j = 0; j < nc; ++j) {
+        row[j] *= g.beta;
+      }
+    }
+  }
+  if (g.alpha == T(0)) {
+    return;
+  }
+
+  thread_local std::vector<T> pack_a, pack_b, tile;
+  pack_a.resize(CPU_GEMM_MC * kc_max);
+  pack_b.resize(CPU_GEMM_NC * kc_max);
+  tile.resize(CPU_GEMM_MR * kernel.nr);
+
+  for (int64_t pc = 0; pc < g.k; pc += kc_max) {
+    const int64_t kc = std::min(kc_max, g.k - pc);
+    packA(g.trans_a, g.trans_a ? a + pc * g.lda + ic : a + ic * g.lda + pc,
+          g.lda, mc, kc, pack_a.data());
+    packB(g.trans_b, g.trans_b ? b + jc * g.ldb + pc : b + pc * g.ldb + jc,
+          g.ldb, kc, nc, kernel.nr, pack_b.data());
+    for (int64_t jr = 0; jr < nc; jr += kernel.nr) {
+      const int64_t cols = std::min<int64_t>(kernel.nr, nc - jr);
+      for (int64_t ir = 0; ir < mc; ir += CPU_GEMM_MR) {
+        const int64_t rows = std::min<int64_t>(CPU_GEMM_MR, mc - ir);
+        kernel.run(kc, pack_a.data() + ir * kc, pack_b.data() + jr * kc,
+                   tile.data());
+        for (int64_t r = 0; r < rows; ++r) {
+          T *out = c + (ic + ir + r) * g.ldc + jc + jr;
+          const T *in = tile.data() + r * kernel.nr;
+          for (int64_t j = 0; j < cols; ++j) {
+            out[j] += g.alpha * in[j];
+          }
+        }
+      }
+    }
+  }
+}
+
+template <typename T>
+void batchGemm(int64_t batch, const GemmArgs<T> &g) {
+  if (batch <= 0 || g.m <= 0 || g.n <= 0) {
+    return;
+  }
+  const int64_t m_tiles = (g.m + CPU_GEMM_MC - 1) / CPU_GEMM_MC;
+  const int64_t n_tiles = (g.n + CPU_GEMM_NC - 1) / CPU_GEMM_NC;
+  const int64_t tiles = m_tiles * n_tiles;
+  cpuParallelFor(0, batch * tiles, 1, [&](int64_t task) {
+    const int64_t i = task / tiles;
+    const int64_t tile = task % tiles;
+    gemmTile(g, g.a + i * g.stride_a, g.b + i * g.stride_b,
+             g.c + i * g.stride_c, tile / n_tiles * CPU_GEMM_MC,
+             tile % n_tiles * CPU_GEMM_NC);
+  });
+}
+
+}  // namespace
+
+void cpuGemm(bool trans_a, bool trans_b, int64_t m, int64_t n, int64_t k,
+             float alpha, const float *a, int64_t lda, const float *b,
+             int64_t ldb, float beta, float *c, int64_t ldc) {
+  batchGemm<float>(1, {trans_a, trans_b, m, n, k, alpha, a, lda, 0, b, ldb,
+                       0, beta, c, ldc, 0});
+}
+
+void cpuGemm(bool trans_a, bool trans_b, int64_t m, int64_t n, int64_t k,
+             double alpha, const double *a, int64_t lda, const double *b,
+             int64_t ldb, double beta, double *c, int64_t ldc) {
+  batchGemm<double>(1, {trans_a, trans_b, m, n, k, alpha, a, lda, 0, b, ldb,
+                        0, beta, c, ldc, 0});
+}
+
+void cpuBatchGemm(int64_t batch, bool trans_a, bool trans_b, int64_t m,
+                  int64_t n, int64_t k, float alpha, const float *a,
+                  int64_t lda, int64_t stride_a, const float *b, int64_t ldb,
+                  int64_t stride_b, float beta, float *c, int64_t ldc,
+                  int64_t stride_c) {
+  batchGemm<float>(batch, {trans_a, trans_b, m, n, k, alpha, a, lda, stride_a,
+                           b, ldb, stride_b, beta, c, ldc, stride_c});
+}
+
+void cpuBatchGemm(int64_t batch, bool trans_a, bool trans_b, int64_t m,
+                  int64_t n, int64_t k, double alpha, const double *a,
+                  int64_t lda, int64_t stride_a, const double *b, int64_t ldb,
+                  int64_t stride_b, double beta, double *c, int64_t ldc,
+                  int64_t stride_c) {
+  batchGemm<double>(batch, {trans_a, trans_b, m, n, k, alpha, a, lda,
+                            stride_a, b, ldb, stride_b, beta, c, ldc,
+                            stride_c});
+}
+
+const char *cpuGemmIsa() { return gemmKernel<float>().isa; }
+
+}  // namespace mluoptest
@@ -0,0 +1,117 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <future>  // NOLINT
+#include <memory>
+#include <thread>  // NOLINT
+#include <vector>
+#include "cpu_parallel.h"
+#include "thread_pool.h"
+#include "variable.h"
+
+namespace mluoptest {
+
+namespace {
+
+// set while a thread runs chunks, nested calls then run serially
+thread_local bool in_parallel_region = false;
+
+ThreadPool *cpuThreadPool() {
+  // the calling thread always takes part, the pool holds the others
+  static ThreadPool *pool = cpuParallelThreadNum() > 1
+                                ? new ThreadPool(cpuParallelThreadNum() - 1)
+                                : nullptr;
+  return pool;
+}
+
+}  // namespace
+
+size_t cpuParallelThreadNum() {
+  static size_t thread_num = [] {
+    if (global_var.cpu_thread_num_ > 0) {
+      return (size_t)global_var.cpu_thread_num_;
+    }
+    return (size_t)std::max(1u, std::thread::hardware_concurrency());
+  }();
+  return thread_num;
+}
+
+void cpuParallelChunks(int64_t begin, int64_t end, int64_t grain,
+                       const std::function<void(int64_t, int64_t)> &chunk) {
+  if (end <= begin) {
+    return;
+  }
+  grain = std::max<int64_t>(grain, 1);
+  const int64_t chunk_num = (end - begin + grain - 1) / grain;
+  ThreadPool *pool = cpuThreadPool();
+  if (chunk_num == 1 || pool == nullptr || in_parallel_region) {
+    for (int64_t b = begin; b < end; b += grain) {
+      chunk(b, std::min(end, b + grain));
+    }
+    return;
+  }
+
+  // chunks are claimed in order by whoever is free, the result of a chunk
+  // does not depend on which thread runs it
+  auto next = std::make_shared<std::atomic<int64_t>>(0);
+  auto drain = [=, &chunk]() {
+    struct RegionGuard {
+      RegionGuard() { in_parallel_region = true; }
+      ~RegionGuard() { in_parallel_region = false; }
+    } guard;
+    int64_t i;
+    while ((i = next->fetch_add(1)) < chunk_num) {
+      const int64_t b = begin + i * grain;
+      chunk(b, std::min(end, b + grain));
+    }
+  };
+
+  const int64_t helper_num = std::min<int64_t>(
+      chunk_num - 1, (int64_t)cpuParallelThreadNum() - 1);
+  std::vector<std::future<void>> helpers;
+  helpers.reserve(helper_num);
+  for (int64_t i = 0; i < helper_num; ++i) {
+    helpers.emplace_back(pool->enqueue(drain));
+  }
+  // helpers reference chunk, wait for all of them before any rethrow
+  std::exception_ptr error = nullptr;
+  try {
+    drain();
+  } catch (...) {
+    error = std::current_exception();
+    next->store(chunk_num);
+  }
+  for (auto &helper : helpers) {
+    helper.wait();
+  }
+  if (error != nullptr) {
+    std::rethrow_exception(error);
+  }
+  for (auto &helper : helpers) {
+    helper.get();
+  }
+}
+
+}  // namespace mluoptest
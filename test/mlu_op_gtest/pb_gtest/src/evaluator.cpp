@@ -25,6 +25,7 @@
 #include <limits>
 #endif
 #include <algorithm>
+#include <cmath>
 #include <utility>
 #include <set>
 #include <vector>
@@ -54,6 +55,7 @@ void Evaluator::init(void *baseline_result, void *mlu_result,
   }
   stride_ = is_complex_ ? 2 : 1;
   count_total_ = is_complex_ ? count_ * 2 : count_;
+  stats_ready_ = false;
   thresholdLevel1();
 }
 
@@ -99,6 +101,53 @@ void Evaluator::computeDiffFloatAndDouble() {
   }
 }
 
+double Evaluator::diff3Epsilon() {
+  if (dtype_ == MLUOP_DTYPE_HALF || dtype_ == MLUOP_DTYPE_COMPLEX_HALF) {
+    return EPSILON_HALF;
+  } else if (dtype_ == MLUOP_DTYPE_FLOAT ||
+             dtype_ == MLUOP_DTYPE_COMPLEX_FLOAT) {
+    return EPSILON_FLOAT;
+  }
+  return 0;
+}
+
+void Evaluator::computeDiffFromStats() {
+  auto diff = [this](const DiffStats &stats) -> double {
+    switch (func_) {
+      case DIFF1:
+        return stats.abs_diff.value() / (stats.abs_base.value() + EPSILON);
+      case DIFF2:
+        return std::sqrt(stats.sqr_diff.value() /
+                         (stats.sqr_base.value() + EPSILON));
+      case DIFF3:
+        return stats.max_ratio;
+      case DIFF3_2:
+        return stats.max_diff;
+      default:
+        GTEST_CHECK(false, "Evaluator: criterion is not computed by stats.");
+    }
+  };
+  if (func_ == DIFF_KL) {
+    if (!kl_valid_) {
+      error_ = -1;
+      return;
+    }
+    // with p = base' / S1 and q = mlu' / S2 the symmetric divergence
+    // 0.5 * sum(p * log(p / q)) + 0.5 * sum(q * log(q / p)) reduces to
+    // 0.5 * (sum(base' * log(base' / mlu')) / S1 -
+    //        sum(mlu' * log(base' / mlu')) / S2), the log(S2 / S1) terms
+    // cancel out, so a single pass is enough.
+    const DiffStats &stats = stats_[0];
+    error_ = 0.5 * (stats.kl_base_log.value() / stats.kl_base.value() -
+                    stats.kl_mlu_log.value() / stats.kl_mlu.value());
+    return;
+  }
+  error_ = diff(stats_[0]);
+  if (is_complex_) {
+    error_imag_ = diff(stats_[1]);
+  }
+}
+
 void Evaluator::computeDiffForOneCriterion() {
   if (skip_compute_diff_) {
     return;
@@ -800,6 +800,10 @@ void Executor::getGtestInternalInfo() {
   }
   eva_res_.gtest.parsed_file_size = parser_->getParsedFileSize();
   eva_res_.gtest.parsed_cost_seconds = parser_->getParsedCostSeconds();
+  eva_res_.gtest.parsed_value_size = parser_->getParsedValueSize();
+  eva_res_.gtest.parsed_value_seconds = parser_->getParsedValueSeconds();
+  eva_res_.gtest.prefetch_seconds = parser_->getPrefetchSeconds();
+  eva_res_.gtest.prefetch_wait_seconds = parser_->getPrefetchWaitSeconds();
   global_var.internal_info_.record_case(eva_res_.case_path, eva_res_.gtest);
 }
 
@@ -1200,6 +1204,12 @@ void Executor::setHandle() {
   } else if (round_mode == mluoptest::ROUND_OFF_ZERO) {
     mluOpSetQuantizeRoundMode(handle_, MLUOP_ROUND_HALF_OFF_ZERO);
   }
+  // the handle is shared by the cases of a thread, so set it for every case
+  if (getEnv("MLUOP_GTEST_ATOMICS_MODE", false)) {
+    mluOpSetAtomicsMode(handle_, MLUOP_ATOMICS_ALLOWED);
+  } else {
+    mluOpSetAtomicsMode(handle_, MLUOP_ATOMICS_NOT_ALLOWED);
+  }
 }
 
 // create tensor desc
@@ -1496,6 +1506,12 @@ void Executor::initBaselineInput() {
     if (VALUE_RANDOM == ts->value_type) {
       // generate random or read from path
       parser_->getInputTensorValue(i, cpu_fp32_input_[i], ts->total_count);
+    } else if (const void *view =
+                   parser_->getInputTensorView(i, ts->total_count)) {
+      // payload file, cast straight from the mapped data
+      castDataOut(const_cast<void *>(view), ts->dtype, cpu_fp32_input_[i],
+                  cpu_dtype, ts->total_count, NO_QUANT, ts->position,
+                  ts->scale, ts->offset);
     } else {
       void *temp = cpu_runtime_.allocate(ts->total_count * ts->sizeof_dtype);
       // read in data and (copy/ cast) to cpu_fp32_input_
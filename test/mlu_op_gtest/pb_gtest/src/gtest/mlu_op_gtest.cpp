@@ -43,6 +43,7 @@ std::shared_ptr<mluoptest::ExecuteConfig> TestSuite::ecfg_ =
     std::make_shared<mluoptest::ExecuteConfig>();
 std::shared_ptr<mluoptest::ExecuteContext> TestSuite::ectx_ =
     nullptr;  // depends on thread num.
+std::shared_ptr<mluoptest::CasePrefetcher> TestSuite::prefetcher_ = nullptr;
 
 // setup for 1 op
 void TestSuite::SetUpTestCase() {
@@ -80,11 +81,20 @@ void TestSuite::SetUpTestCase() {
   if (global_var.thread_num_ == 1) {
     ectx_ = std::make_shared<mluoptest::ExecuteContext>();
     ectx_->init();
+
+    // read the next cases while the current one runs
+    int prefetch_num = getEnvInt("MLUOP_GTEST_PREFETCH_CASE_NUM", 2);
+    int prefetch_mb = getEnvInt("MLUOP_GTEST_PREFETCH_MEMORY_MB", 4096);
+    if (prefetch_num > 0 && case_path_vec_.size() > 1) {
+      prefetcher_ = std::make_shared<mluoptest::CasePrefetcher>(
+          case_path_vec_, prefetch_num, (size_t)prefetch_mb << 20);
+    }
   }
 }
 
 // teardown for 1 op
 void TestSuite::TearDownTestCase() {
+  prefetcher_.reset();  // stop reading ahead before the cases go away
   if (ectx_ != nullptr) {  // only for thread 1 actually.
     ectx_->destroy();
     ectx_.reset();
@@ -112,6 +122,12 @@ void TestSuite::Thread1() {
     // TODO(None): modify ctor, set op_name in ctor.
     exe->result()->op_name = op_name_;
     exe->init(ectx_);
+    if (prefetcher_ != nullptr) {
+      auto parser = prefetcher_->take(case_idx);
+      if (parser != nullptr) {
+        exe->setPrefetchedParser(parser);
+      }
+    }
     exe->setup(case_path_vec_[case_idx], ecfg_);
     exe->launch();
     auto res = exe->teardown();
@@ -654,6 +670,18 @@ static std::ostringstream print_log(const mluoptest::EvaluateResult &eva,
         << mluoptest::timeseries_to_array_str(eva.gtest.time_costs_ms) << "\n";
     out << "[GTEST Case FileSize    ]: " << eva.gtest.parsed_file_size
         << " (Bytes)\n";
+    if (eva.gtest.parsed_value_seconds > 0) {
+      out << "[GTEST Value Parse Speed]: "
+          << eva.gtest.parsed_value_size / 1024. / 1024. /
+                 eva.gtest.parsed_value_seconds
+          << " (MB/s), " << eva.gtest.parsed_value_size << " (Bytes) in "
+          << eva.gtest.parsed_value_seconds << " (s)\n";
+    }
+    if (eva.gtest.prefetch_seconds > 0) {
+      out << "[GTEST Case Prefetch    ]: " << eva.gtest.prefetch_seconds
+          << " (s) read ahead, " << eva.gtest.prefetch_wait_seconds
+          << " (s) waited\n";
+    }
   }
 
   out << print_error(eva.errors).str();
@@ -37,6 +37,7 @@
 #include "executor.h"
 #include "evaluator.h"
 #include "case_collector.h"
+#include "case_prefetcher.h"
 #include "thread_pool.h"
 #include "tools.h"
 
@@ -65,6 +66,8 @@ class TestSuite : public TestWithParam<std::tuple<std::string, size_t>> {
   static std::vector<std::string> case_path_vec_;
   static std::shared_ptr<mluoptest::ExecuteContext> ectx_;
   static std::shared_ptr<mluoptest::ExecuteConfig> ecfg_;
+  // single thread only
+  static std::shared_ptr<mluoptest::CasePrefetcher> prefetcher_;
 
  private:
   void Thread1();
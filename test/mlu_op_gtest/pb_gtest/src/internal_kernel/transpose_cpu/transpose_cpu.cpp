@@ -24,60 +24,27 @@
 #include "transpose_cpu.h"
 #include <vector>
 #include "core/tensor.h"
+#include "strided_copy.h"
 
 
-template <typename T>
-static void transposeCpuNd(const int loop_d, T *x, T *y, const uint64_t sum,
-                           uint64_t *dim, uint64_t *DIM, uint64_t *permute) {
-  for (int loop_t = 0; loop_t < loop_d; loop_t++) {
-    T *output = (T *)(y + sum * loop_t);
-    T *input = (T *)(x + sum * loop_t);
-    uint64_t in_index = 0, out_index = 0;
-
-    for (dim[0] = 0; dim[0] < DIM[0]; dim[0]++) {
-      for (dim[1] = 0; dim[1] < DIM[1]; dim[1]++) {
-        for (dim[2] = 0; dim[2] < DIM[2]; dim[2]++) {
-          for (dim[3] = 0; dim[3] < DIM[3]; dim[3]++) {
-            for (dim[4] = 0; dim[4] < DIM[4]; dim[4]++) {
-              for (dim[5] = 0; dim[5] < DIM[5]; dim[5]++) {
-                for (dim[6] = 0; dim[6] < DIM[6]; dim[6]++) {
-                  for (dim[7] = 0; dim[7] < DIM[7]; dim[7]++) {
-                    in_index =
-                        dim[0] * DIM[1] * DIM[2] * DIM[3] * DIM[4] * DIM[5] *
-                            DIM[6] * DIM[7] +
-                        dim[1] * DIM[2] * DIM[3] * DIM[4] * DIM[5] * DIM[6] *
-                            DIM[7] +
-                        dim[2] * DIM[3] * DIM[4] * DIM[5] * DIM[6] * DIM[7] +
-                        dim[3] * DIM[4] * DIM[5] * DIM[6] * DIM[7] +
-                        dim[4] * DIM[5] * DIM[6] * DIM[7] +
-                        dim[5] * DIM[6] * DIM[7] + dim[6] * DIM[7] + dim[7];
-                    out_index =
-                        dim[permute[0]] * DIM[permute[1]] * DIM[permute[2]] *
-                            DIM[permute[3]] * DIM[permute[4]] *
-                            DIM[permute[5]] * DIM[permute[6]] *
-                            DIM[permute[7]] +
-                        dim[permute[1]] * DIM[permute[2]] * DIM[permute[3]] *
-                            DIM[permute[4]] * DIM[permute[5]] *
-                            DIM[permute[6]] * DIM[permute[7]] +
-                        dim[permute[2]] * DIM[permute[3]] * DIM[permute[4]] *
-                            DIM[permute[5]] * DIM[permute[6]] *
-                            DIM[permute[7]] +
-                        dim[permute[3]] * DIM[permute[4]] * DIM[permute[5]] *
-                            DIM[permute[6]] * DIM[permute[7]] +
-                        dim[permute[4]] * DIM[permute[5]] * DIM[permute[6]] *
-                            DIM[permute[7]] +
-                        dim[permute[5]] * DIM[permute[6]] * DIM[permute[7]] +
-                        dim[permute[6]] * DIM[permute[7]] + dim[permute[7]];
-                    output[out_index] = input[in_index];
-                  }
-                }
-              }
-            }
-          }
-        }
-      }
-    }
+// y[permuted index] = x[index] for loop_d consecutive tensors of sum
+// elements of sizeof_dtype bytes, see strided_copy.h
+static void transposeCpuNd(const int loop_d, const void *x, void *y,
+                           const uint64_t sum, const uint64_t dim_num,
+                           const uint64_t *DIM, const uint64_t *permute,
+                           const size_t sizeof_dtype) {
+  std::vector<size_t> shape(1, loop_d), x_stride(1, sum), y_stride(1, sum);
+  shape.insert(shape.end(), DIM, DIM + dim_num);
+  x_stride.resize(dim_num + 1);
+  y_stride.resize(dim_num + 1);
+  size_t x_base = 1, y_base = 1;
+  for (int64_t i = dim_num - 1; i >= 0; i--) {
+    x_stride[i + 1] = x_base;
+    x_base *= DIM[i];
+    y_stride[permute[i] + 1] = y_base;
+    y_base *= DIM[permute[i]];
   }
+  mluoptest::stridedCopy(y, x, shape, y_stride, x_stride, sizeof_dtype);
 }
 
 mluOpStatus_t mluOpTransposeCpu(const int64_t dim_desc,
@@ -102,15 +69,8 @@ mluOpStatus_t mluOpTransposeCpu(const int64_t dim_desc,
   if (data_type == MLUOP_DTYPE_INT31) {
     loop_d = 2;
   }
-  // do not change the inited value(8) in permute
-  // 8 is used to match TRANSPOSE_MAX_DIM, which can make the loop below
-  // applies to all-dims transpose, from 2D transpose to 8D transpose
-  // if you change macro TRANSPOSE_MAX_DIM, the inited value(8) should alse be
-  // changed to TRANSPOSE_MAX_DIM. And the loop level should be equal to
-  // TRANSPOSE_MAX_DIM
-  uint64_t permute[TRANSPOSE_MAX_DIM] = {8, 8, 8, 8, 8, 8, 8, 8};
-  uint64_t DIM[TRANSPOSE_MAX_DIM + 1] = {1, 1, 1, 1, 1, 1, 1, 1, 1};
-  uint64_t dim[TRANSPOSE_MAX_DIM + 1] = {0};
+  uint64_t permute[TRANSPOSE_MAX_DIM] = {0};
+  uint64_t DIM[TRANSPOSE_MAX_DIM] = {0};
 
   if (x_desc->getDim() != dim_all || y_desc->getDim() != dim_all) {
     LOG(ERROR)
@@ -125,12 +85,12 @@ mluOpStatus_t mluOpTransposeCpu(const int64_t dim_desc,
     DIM[i] = x_desc->getDimIndex(i);
   }
   if (MLUOP_DTYPE_INT31 == data_type) {
-    transposeCpuNd(loop_d, (int16_t *)x, (int16_t *)y, sum, dim, DIM, permute);
+    transposeCpuNd(loop_d, x, y, sum, dim_all, DIM, permute, sizeof(int16_t));
   } else if (MLUOP_DTYPE_COMPLEX_HALF == data_type ||
              MLUOP_DTYPE_COMPLEX_FLOAT == data_type) {
-    transposeCpuNd(loop_d, (double *)x, (double *)y, sum, dim, DIM, permute);
+    transposeCpuNd(loop_d, x, y, sum, dim_all, DIM, permute, sizeof(double));
   } else {
-    transposeCpuNd(loop_d, (float *)x, (float *)y, sum, dim, DIM, permute);
+    transposeCpuNd(loop_d, x, y, sum, dim_all, DIM, permute, sizeof(float));
   }
   return MLUOP_STATUS_SUCCESS;
 }
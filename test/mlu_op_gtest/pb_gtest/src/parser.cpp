@@ -28,7 +28,9 @@
 #include <unistd.h>
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>  // NOLINT
+#include <cstring>
 #include <functional>
 #include <set>
 #include <string>
@@ -36,6 +38,7 @@
 #include <utility>
 #include <vector>
 
+#include "cpu_parallel.h"
 #include "file_reader.h"
 #include "socket_creator.h"
 #include "tools.h"
@@ -84,10 +87,12 @@ Parser::~Parser() {
 }
 
 void Parser::parse(const std::string &file) {
-  proto_node_ = new Node;
-  setCurPbPath(file);  // set root path of pb/prototxt
-  GTEST_CHECK(readMessageFromFile(file, proto_node_),
-              "Parser: parse *pb/*prototxt failed.");
+  if (!prefetched_) {
+    proto_node_ = new Node;
+    setCurPbPath(file);  // set root path of pb/prototxt
+    GTEST_CHECK(readMessageFromFile(file, proto_node_),
+                "Parser: parse *pb/*prototxt failed.");
+  }
   isSupportTF32(proto_node_);
 
   GTEST_CHECK(proto_node_->has_op_name(),
@@ -446,6 +451,101 @@ void Parser::getOutputTensorValue(size_t index, void *data, size_t count) {
                  outputs_[index].value_type, count);
 }
 
+namespace {
+
+// Elements decoded by one task, large enough to hide the task overhead.
+#define PARSER_VALUE_GRAIN (64 * 1024)
+
+// Value of every hex digit, 0xff for the other characters.
+struct HexTable {
+  uint8_t value[256];
+  HexTable() {
+    memset(value, 0xff, sizeof(value));
+    for (int c = 0; c < 10; ++c) {
+      value['0' + c] = c;
+    }
+    for (int c = 0; c < 6; ++c) {
+      value['a' + c] = 10 + c;
+      value['A' + c] = 10 + c;
+    }
+  }
+};
+
+const HexTable hex_table;
+
+// Decodes value_h strings [begin, end) into the bit patterns of dst. Strings
+// have no leading zeros, longer strings keep their low digits. Returns false
+// if a character is not a hex digit.
+template <typename BitsT>
+bool decodeHex(const google::protobuf::RepeatedPtrField<std::string> &values,
+               int64_t begin, int64_t end, BitsT *dst) {
+  uint8_t invalid = 0;
+  for (int64_t i = begin; i < end; ++i) {
+    const std::string &str = values.Get(i);
+    const uint8_t *c = (const uint8_t *)str.data();
+    const size_t len = str.size();
+    BitsT bits = 0;
+    for (size_t j = 0; j < len; ++j) {
+      const uint8_t digit = hex_table.value[c[j]];
+      invalid |= digit;
+      bits = (BitsT)(bits << 4) | (digit & 0xf);
+    }
+    dst[i] = bits;
+  }
+  return (invalid & 0xf0) == 0;
+}
+
+template <typename BitsT>
+void parseHexValues(const Tensor *pt, void *data, size_t num) {
+  std::atomic<bool> valid(true);
+  cpuParallelChunks(0, num, PARSER_VALUE_GRAIN, [&](int64_t b, int64_t e) {
+    if (!decodeHex(pt->value_h(), b, e, (BitsT *)data)) {
+      valid = false;
+    }
+  });
+  GTEST_CHECK(valid, "Parser: found a non hex character in value_h.");
+}
+
+// dst[i] = convert(src[i]) for i in [0, num), in parallel chunks.
+template <typename DstT, typename SrcT, typename Convert>
+void convertValues(const SrcT *src, size_t num, void *data, Convert convert) {
+  DstT *dst = (DstT *)data;
+  cpuParallelChunks(0, num, PARSER_VALUE_GRAIN, [&](int64_t b, int64_t e) {
+    for (int64_t i = b; i < e; ++i) {
+      dst[i] = convert(src[i]);
+    }
+  });
+}
+
+template <typename DstT, typename SrcT>
+void castValues(const SrcT *src, size_t num, void *data) {
+  convertValues<DstT>(src, num, data, [](SrcT value) { return (DstT)value; });
+}
+
+// for floating point values saved as their bit pattern in value_i/value_l
+template <typename DstT, typename SrcT>
+void bitcastValues(const SrcT *src, size_t num, void *data) {
+  static_assert(sizeof(DstT) == sizeof(SrcT), "bitcast needs equal sizes");
+  convertValues<DstT>(src, num, data, [](SrcT value) {
+    DstT res;
+    memcpy(&res, &value, sizeof(res));
+    return res;
+  });
+}
+
+// in generator prototxt, 1*int31 split into 2*int16, high halves first
+template <typename SrcT>
+void splitInt31Values(const SrcT *src, size_t num, void *data) {
+  for (size_t i = 0; i < num; ++i) {
+    int16_t I1 = src[i];
+    int16_t I2 = src[i + num];
+    ((int16_t *)data)[i] = I2;        // low int16
+    ((int16_t *)data)[i + num] = I1;  // high int16
+  }
+}
+
+}  // namespace
+
 // Get value from field value_f
 // TODO(None): abandon value_f, use value_h for float numbers instead.
 void Parser::getTensorValueF(const Tensor *pt, void *data, size_t count) {
@@ -462,34 +562,24 @@ void Parser::getTensorValueF(const Tensor *pt, void *data, size_t count) {
                   "equal to real element num.");
   }
 
+  const float *value_f = pt->value_f().data();
+  auto to_half = [](float value) { return cvtFloatToHalf(value); };
   switch (pt->dtype()) {
     // may have precision issue since value_f is fixed to float in protobuf
     case DTYPE_DOUBLE:
-      for (int i = 0; i < count; ++i) {
-        ((double *)data)[i] = (double)pt->value_f(i);
-      }
+      castValues<double>(value_f, count, data);
       break;
     case DTYPE_FLOAT:
-      for (int i = 0; i < count; ++i) {
-        ((float *)data)[i] = pt->value_f(i);
-      }
+      castValues<float>(value_f, count, data);
       break;
     case DTYPE_HALF:
-      for (int i = 0; i < count; ++i) {
-        ((int16_t *)data)[i] = cvtFloatToHalf(pt->value_f(i));
-      }
+      convertValues<int16_t>(value_f, count, data, to_half);
       break;
     case DTYPE_COMPLEX_HALF:
-      for (int i = 0; i < 2 * count; i += 2) {
-        ((int16_t *)data)[i] = cvtFloatToHalf(pt->value_f(i));
-        ((int16_t *)data)[i + 1] = cvtFloatToHalf(pt->value_f(i + 1));
-      }
+      convertValues<int16_t>(value_f, 2 * count, data, to_half);
       break;
     case DTYPE_COMPLEX_FLOAT:
-      for (int i = 0; i < 2 * count; i += 2) {
-        ((float *)data)[i] = pt->value_f(i);
-        ((float *)data)[i + 1] = pt->value_f(i + 1);
-      }
+      castValues<float>(value_f, 2 * count, data);
       break;
     default:
       GTEST_CHECK(false,
@@ -516,77 +606,39 @@ void Parser::getTensorValueI(const Tensor *pt, void *data, size_t count) {
     //        real element num.");
   }
 
+  const int32_t *value_i = pt->value_i().data();
   switch (pt->dtype()) {
     case DTYPE_INT8:
-      for (int i = 0; i < count; ++i) {
-        ((int8_t *)data)[i] = pt->value_i(i);
-      }
+    case DTYPE_BOOL:  // parser value_i == BOOL
+      castValues<int8_t>(value_i, count, data);
       break;
     case DTYPE_UINT8:
-      for (int i = 0; i < count; ++i) {
-        ((uint8_t *)data)[i] = pt->value_i(i);
-      }
+      castValues<uint8_t>(value_i, count, data);
       break;
     case DTYPE_INT16:
-      for (int i = 0; i < count; ++i) {
-        ((int16_t *)data)[i] = pt->value_i(i);
-      }
+    case DTYPE_HALF:
+      castValues<int16_t>(value_i, count, data);
       break;
     case DTYPE_UINT16:
-      for (int i = 0; i < count; ++i) {
-        ((uint16_t *)data)[i] = pt->value_i(i);
-      }
+      castValues<uint16_t>(value_i, count, data);
       break;
     case DTYPE_INT32:
-      for (int i = 0; i < count; ++i) {
-        ((int32_t *)data)[i] = pt->value_i(i);
-      }
+      castValues<int32_t>(value_i, count, data);
       break;
     case DTYPE_INT64:
-      for (int i = 0; i < count; ++i) {
-        ((int64_t *)data)[i] = pt->value_i(i);
-      }
+      castValues<int64_t>(value_i, count, data);
       break;
-    case DTYPE_BOOL:  // parser value_i == BOOL
-      for (int i = 0; i < count; ++i) {
-        ((int8_t *)data)[i] = pt->value_i(i);
-      }
-      break;
-    case DTYPE_INT31: {
-      // in generator prototxt, 1*int31 split into 2*int16, so data_num =
-      // value_size() / 2
-      auto num = count;
-      for (int i = 0; i < num; ++i) {
-        int16_t I1 = pt->value_i(i);
-        int16_t I2 = pt->value_i(i + num);
-        ((int16_t *)data)[i] = I2;        // low int16
-        ((int16_t *)data)[i + num] = I1;  // high int16
-      }
-    } break;
-    case DTYPE_HALF:
-      for (int i = 0; i < count; ++i) {
-        ((int16_t *)data)[i] = pt->value_i(i);
-      }
+    case DTYPE_INT31:
+      splitInt31Values(value_i, count, data);
       break;
     case DTYPE_FLOAT:
-      for (int i = 0; i < count; ++i) {
-        int value_i = pt->value_i(i);
-        ((float *)data)[i] = *((float *)(&value_i));
-      }
+      bitcastValues<float>(value_i, count, data);
       break;
     case DTYPE_COMPLEX_HALF:
-      for (int i = 0; i < 2 * count; i += 2) {
-        ((int16_t *)data)[i] = pt->value_i(i);
-        ((int16_t *)data)[i + 1] = pt->value_i(i + 1);
-      }
+      castValues<int16_t>(value_i, 2 * count, data);
       break;
     case DTYPE_COMPLEX_FLOAT:
-      for (int i = 0; i < 2 * count; i += 2) {
-        int value_i = pt->value_i(i);
-        int value_i_imag = pt->value_i(i + 1);
-        ((float *)data)[i] = *((float *)(&value_i));
-        ((float *)data)[i + 1] = *((float *)(&value_i_imag));
-      }
+      bitcastValues<float>(value_i, 2 * count, data);
       break;
     default:
       GTEST_CHECK(
@@ -602,44 +654,26 @@ void Parser::getTensorValueL(const Tensor *pt, void *data, size_t count) {
   GTEST_CHECK(pt->value_l_size() == count,
               "Parser: when read value_l, expected element num is not equal to "
               "real element num.");
+  const int64_t *value_l = pt->value_l().data();
   switch (pt->dtype()) {
     case DTYPE_INT64:
-      for (int i = 0; i < count; ++i) {
-        ((int64_t *)data)[i] = pt->value_l(i);
-      }
+      castValues<int64_t>(value_l, count, data);
       break;
     case DTYPE_INT8:
     case DTYPE_BOOL:  // parser value_l == BOOL
-      for (int i = 0; i < count; ++i) {
-        ((int8_t *)data)[i] = pt->value_l(i);
-      }
+      castValues<int8_t>(value_l, count, data);
       break;
     case DTYPE_INT16:
-      for (int i = 0; i < count; ++i) {
-        ((int16_t *)data)[i] = pt->value_l(i);
-      }
+      castValues<int16_t>(value_l, count, data);
       break;
     case DTYPE_INT32:
-      for (int i = 0; i < count; ++i) {
-        ((int32_t *)data)[i] = pt->value_l(i);
-      }
+      castValues<int32_t>(value_l, count, data);
+      break;
+    case DTYPE_INT31:
+      splitInt31Values(value_l, count, data);
       break;
-    case DTYPE_INT31: {
-      // in generator prototxt, 1*int31 split into 2*int16, so data_num =
-      // value_size() / 2
-      auto num = count;
-      for (int i = 0; i < num; ++i) {
-        int16_t I1 = pt->value_l(i);
-        int16_t I2 = pt->value_l(i + num);
-        ((int16_t *)data)[i] = I2;        // low int16
-        ((int16_t *)data)[i + num] = I1;  // high int16
-      }
-    } break;
     case DTYPE_DOUBLE:
-      for (int i = 0; i < count; ++i) {
-        int64_t value_l = pt->value_l(i);
-        ((double *)data)[i] = *((double *)(&value_l));
-      }
+      bitcastValues<double>(value_l, count, data);
       break;
     default:
       GTEST_CHECK(
@@ -655,22 +689,17 @@ void Parser::getTensorValueUI(const Tensor *pt, void *data, size_t count) {
   GTEST_CHECK(pt->value_ui_size() == count,
               "Parser: when read value_ui, expected element num is not equal "
               "to real element num.");
+  const uint32_t *value_ui = pt->value_ui().data();
   switch (pt->dtype()) {
     case DTYPE_UINT8:
-      for (int i = 0; i < count; ++i) {
-        ((uint8_t *)data)[i] = pt->value_ui(i);
-      }
+      castValues<uint8_t>(value_ui, count, data);
       break;
     case DTYPE_UINT16:
     case DTYPE_BFLOAT16:
-      for (int i = 0; i < count; ++i) {
-        ((uint16_t *)data)[i] = pt->value_ui(i);
-      }
+      castValues<uint16_t>(value_ui, count, data);
       break;
     case DTYPE_UINT32:
-      for (int i = 0; i < count; ++i) {
-        ((uint32_t *)data)[i] = pt->value_ui(i);
-      }
+      castValues<uint32_t>(value_ui, count, data);
       break;
     default:
       GTEST_CHECK(
@@ -686,26 +715,19 @@ void Parser::getTensorValueUL(const Tensor *pt, void *data, size_t count) {
   GTEST_CHECK(pt->value_ul_size() == count,
               "Parser: when read value_ul, expected element num is not equal "
               "to real element num.");
+  const uint64_t *value_ul = pt->value_ul().data();
   switch (pt->dtype()) {
     case DTYPE_UINT64:
-      for (int i = 0; i < count; ++i) {
-        ((uint64_t *)data)[i] = pt->value_ul(i);
-      }
+      castValues<uint64_t>(value_ul, count, data);
       break;
     case DTYPE_UINT8:
-      for (int i = 0; i < count; ++i) {
-        ((uint8_t *)data)[i] = pt->value_ul(i);
-      }
+      castValues<uint8_t>(value_ul, count, data);
       break;
     case DTYPE_UINT16:
-      for (int i = 0; i < count; ++i) {
-        ((uint16_t *)data)[i] = pt->value_ul(i);
-      }
+      castValues<uint16_t>(value_ul, count, data);
       break;
     case DTYPE_UINT32:
-      for (int i = 0; i < count; ++i) {
-        ((uint32_t *)data)[i] = pt->value_ul(i);
-      }
+      castValues<uint32_t>(value_ul, count, data);
       break;
     default:
       GTEST_CHECK(
@@ -715,34 +737,6 @@ void Parser::getTensorValueUL(const Tensor *pt, void *data, size_t count) {
   }
 }
 
-inline double str2fp64(const std::string *in_str) {
-  uint64_t res = 0x0;
-  for (int i = 0; i < in_str->size(); ++i) {
-    char byte = in_str->c_str()[i];  // 0~f
-    res = res << 4;
-    res |= 0xf & (byte >= 'a') ? byte - 'a' + 10 : byte - '0';  // 0~15
-  }
-  return *(double *)(&res);
-}
-inline float str2fp32(const std::string *in_str) {
-  uint32_t res = 0x0;
-  for (int i = 0; i < in_str->size(); ++i) {
-    char byte = in_str->c_str()[i];  // 0~f
-    res = res << 4;
-    res |= 0xf & (byte >= 'a') ? byte - 'a' + 10 : byte - '0';  // 0~15
-  }
-  return *(float *)(&res);
-}
-inline uint16_t str2fp16(const std::string *in_str) {
-  uint16_t res = 0x0;
-  for (int i = 0; i < in_str->size(); ++i) {
-    char byte = in_str->c_str()[i];
-    res = res << 4;
-    res |= 0xf & (byte >= 'a') ? byte - 'a' + 10 : byte - '0';
-  }
-  return res;
-}
-
 // get value by value_h (hex)
 // we hope all float value come from value_h to keep precision
 void Parser::getTensorValueH(Tensor *pt, void *data, size_t count) {
@@ -763,29 +757,19 @@ void Parser::getTensorValueH(Tensor *pt, void *data, size_t count) {
 
   switch (pt->dtype()) {
     case DTYPE_HALF:
-      for (int i = 0; i < count; ++i) {
-        ((uint16_t *)data)[i] = str2fp16(pt->mutable_value_h(i));
-      }
+      parseHexValues<uint16_t>(pt, data, count);
       break;
     case DTYPE_FLOAT:
-      for (int i = 0; i < count; ++i) {
-        ((float *)data)[i] = str2fp32(pt->mutable_value_h(i));
-      }
+      parseHexValues<uint32_t>(pt, data, count);
       break;
     case DTYPE_DOUBLE:
-      for (int i = 0; i < count; ++i) {
-        ((double *)data)[i] = str2fp64(pt->mutable_value_h(i));
-      }
+      parseHexValues<uint64_t>(pt, data, count);
       break;
     case DTYPE_COMPLEX_HALF:
-      for (int i = 0; i < 2 * count; ++i) {
-        ((uint16_t *)data)[i] = str2fp16(pt->mutable_value_h(i));
-      }
+      parseHexValues<uint16_t>(pt, data, 2 * count);
       break;
     case DTYPE_COMPLEX_FLOAT:
-      for (int i = 0; i < 2 * count; ++i) {
-        ((float *)data)[i] = str2fp32(pt->mutable_value_h(i));
-      }
+      parseHexValues<uint32_t>(pt, data, 2 * count);
       break;
     default:
       GTEST_CHECK(false,
@@ -816,6 +800,32 @@ void Parser::getTensorValueByFile(mluoptest::Tensor *pt, void *data,
   size_t tensor_length = count * getTensorSize(pt);
   auto start = std::chrono::steady_clock::now();
 
+  auto prefetched = prefetched_values_.find(pt);
+  if (prefetched != prefetched_values_.end()) {
+    if (prefetched->second.size() == tensor_length) {
+      memcpy(data, prefetched->second.data(), tensor_length);
+      prefetched_values_.erase(prefetched);
+      VLOG(2) << __func__ << " " << cur_pb_path
+              << " prefetched, tensor_length: "
+              << tensor_length / 1024. / 1024. << " MB";
+      return;
+    }
+    prefetched_values_.erase(prefetched);
+  }
+
+  const void *view = getTensorPayloadView(pt, count);
+  if (view != nullptr) {
+    memcpy(data, view, tensor_length);
+    std::chrono::duration<double> cost_s =
+        std::chrono::steady_clock::now() - start;
+    VLOG(2) << __func__ << " " << cur_pb_path << ":" << pt->id()
+            << ", tensor_length: " << tensor_length / 1024. / 1024. << " MB"
+            << ", time cost: " << cost_s.count() << " s";
+    parsed_file_size += tensor_length;
+    parsed_cost_seconds += cost_s.count();
+    return;
+  }
+
   auto creator = std::make_shared<FileReaderCreator>(cur_pb_path);
   // find data file or file with the same name after modifying the suffix
   auto file_reader = creator->getFileReader();
@@ -848,11 +858,100 @@ void Parser::getTensorValueByFile(mluoptest::Tensor *pt, void *data,
   parsed_cost_seconds += cost_s.count();
 }
 
+const void *Parser::getTensorPayloadView(Tensor *pt, size_t count) {
+  if (!pt->has_path() || getFileExtension(pt->path()) != PAYLOAD_EXTENSION) {
+    return nullptr;
+  }
+  auto cur_payload_path = pb_path_ + pt->path();
+  if (payload_ == nullptr || payload_->path() != cur_payload_path) {
+    auto start = std::chrono::steady_clock::now();
+    payload_ = PayloadFile::open(cur_payload_path);
+    std::chrono::duration<double> cost_s =
+        std::chrono::steady_clock::now() - start;
+    parsed_cost_seconds += cost_s.count();
+  }
+  size_t length = 0;
+  const void *view = payload_->find(pt->id(), &length);
+  GTEST_CHECK(view != nullptr,
+              "Parser: tensor is missing in the payload file.");
+  GTEST_CHECK(length == count * getTensorSize(pt),
+              "Parser: the number of bytes saved in the payload file is not "
+              "equal to the number calculated by shape and stride.");
+  return view;
+}
+
+const void *Parser::getInputTensorView(size_t index, size_t count) {
+  if (inputs_[index].value_type != VALUE_PATH) {
+    return nullptr;
+  }
+  return getTensorPayloadView(proto_node_->mutable_input(index), count);
+}
+
+bool Parser::prefetch(const std::string &file) {
+  auto start = std::chrono::steady_clock::now();
+  proto_node_ = new Node;
+  setCurPbPath(file);
+  if (!readMessageFromFile(file, proto_node_)) {
+    delete proto_node_;
+    proto_node_ = nullptr;
+    return false;
+  }
+  prefetched_ = true;
+  prefetched_size_ = getFileSize(file);
+
+  auto prefetch_tensor = [this](const Tensor *pt) {
+    if (getValueType(pt) != VALUE_PATH ||
+        getFileExtension(pt->path()) == PAYLOAD_EXTENSION ||
+        !pt->has_shape()) {
+      return;
+    }
+    const Shape &shape = pt->shape();
+    if (shape.dim_stride_size() != 0 &&
+        shape.dim_stride_size() != shape.dims_size()) {
+      return;
+    }
+    size_t length = shapeStrideCount(&shape) * getDtypeWidth(pt->dtype());
+    auto creator = std::make_shared<FileReaderCreator>(pb_path_ + pt->path());
+    auto cur_path = creator->getRealFilePath();
+    if (length == 0 || cur_path.empty()) {
+      return;
+    }
+    std::vector<char> buffer(length);
+    try {
+      if (creator->getFileReader()->read(buffer.data(), length, cur_path) !=
+          length) {
+        return;
+      }
+    } catch (std::exception &e) {
+      VLOG(2) << "Parser: prefetch " << cur_path << " failed: " << e.what();
+      return;
+    }
+    parsed_file_size += getFileSize(cur_path);
+    prefetched_size_ += length;
+    prefetched_values_[pt] = std::move(buffer);
+  };
+  for (int i = 0; i < proto_node_->input_size(); ++i) {
+    prefetch_tensor(&proto_node_->input(i));
+  }
+  for (int i = 0; i < proto_node_->output_size(); ++i) {
+    prefetch_tensor(&proto_node_->output(i));
+  }
+
+  std::chrono::duration<double> cost_s =
+      std::chrono::steady_clock::now() - start;
+  prefetch_seconds_ = cost_s.count();
+  VLOG(2) << __func__ << " " << file << ", size: "
+          << prefetched_size_ / 1024. / 1024. << " MB"
+          << ", time cost: " << cost_s.count() << " s";
+  return true;
+}
+
 // set value in proto to meta_tensor.ptr
 // random data(for cpu compute) value is fp32 definitely
 // valueh valuef valuei dtype is according dtype in proto
 void Parser::getTensorValue(Tensor *pt, void *data, ValueType value_type,
                             size_t count) {
+  auto start = std::chrono::steady_clock::now();
   switch (value_type) {
     case VALUE_H:
       getTensorValueH(pt, data, count);
@@ -887,6 +986,20 @@ void Parser::getTensorValue(Tensor *pt, void *data, ValueType value_type,
       GTEST_CHECK(false,
                   "Parser: get tensor data failed, unsupported value type.");
   }
+
+  // values saved in pb/prototxt, the other sources record their own cost
+  if (value_type <= VALUE_UL) {
+    auto stop = std::chrono::steady_clock::now();
+    std::chrono::duration<double> cost_s = stop - start;
+    size_t tensor_length = count * getTensorSize(pt);
+    VLOG(2) << __func__ << " " << pt->id()
+            << ", tensor_length: " << tensor_length / 1024. / 1024. << " MB"
+            << ", time cost: " << cost_s.count() << " s"
+            << ", speed: " << tensor_length / 1024. / 1024. / cost_s.count()
+            << " MB/s";
+    parsed_value_size += tensor_length;
+    parsed_value_seconds += cost_s.count();
+  }
 }
 
 std::vector<int> Parser::threshold_use() {
@@ -1323,10 +1436,16 @@ void Parser::isSupportTF32(Node *protoNode) {
 }
 
 size_t Parser::getTensorSize(Tensor *pt) {
+  size_t width = getDtypeWidth(pt->dtype());
+  GTEST_CHECK(width != 0, "Parser: Unknown tensor DTYPE.");
+  return width;
+}
+
+size_t Parser::getDtypeWidth(DataType dtype) {
 #define GET_WIDTH_TENSOR_TYPE(TENSOR_DTYPE, WIDTH) \
   case TENSOR_DTYPE:                               \
     return WIDTH;
-  switch (pt->dtype()) {
+  switch (dtype) {
     GET_WIDTH_TENSOR_TYPE(DTYPE_COMPLEX_FLOAT, 8);
     GET_WIDTH_TENSOR_TYPE(DTYPE_COMPLEX_HALF, 4);
     GET_WIDTH_TENSOR_TYPE(DTYPE_DOUBLE, 8);
@@ -1344,7 +1463,7 @@ size_t Parser::getTensorSize(Tensor *pt) {
     GET_WIDTH_TENSOR_TYPE(DTYPE_BFLOAT16, 2);
     GET_WIDTH_TENSOR_TYPE(DTYPE_BOOL, 1);
     default:
-      GTEST_CHECK(false, "Parser: Unknown tensor DTYPE.");
+      return 0;
   }
 #undef GET_WIDTH_TENSOR_TYPE
 }
@@ -0,0 +1,114 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include "payload_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include "tools.h"
+
+namespace mluoptest {
+
+PayloadFile::~PayloadFile() {
+  if (data_ != nullptr) {
+    munmap((void *)data_, size_);
+  }
+}
+
+std::shared_ptr<PayloadFile> PayloadFile::open(const std::string &path) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    LOG(ERROR) << "PayloadFile: open " << path << " failed. Reason: " << errno
+               << "-" << strerror(errno);
+    throw std::invalid_argument(std::string(__FILE__) + " +" +
+                                std::to_string(__LINE__));
+  }
+  struct stat file_stat;
+  void *data = MAP_FAILED;
+  if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0) {
+    data = mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  GTEST_CHECK(data != MAP_FAILED, "PayloadFile: mmap payload file failed.");
+
+  std::shared_ptr<PayloadFile> file(new PayloadFile);
+  file->path_ = path;
+  file->data_ = (const uint8_t *)data;
+  file->size_ = file_stat.st_size;
+
+  PayloadHeader header;
+  GTEST_CHECK(file->size_ >= sizeof(header),
+              "PayloadFile: payload file is truncated.");
+  memcpy(&header, file->data_, sizeof(header));
+  GTEST_CHECK(memcmp(header.magic, PAYLOAD_MAGIC, sizeof(header.magic)) == 0,
+              "PayloadFile: bad magic, not a payload file.");
+  GTEST_CHECK(header.version == PAYLOAD_VERSION,
+              "PayloadFile: unsupported payload version.");
+  GTEST_CHECK(header.index_size <= file->size_ - sizeof(header),
+              "PayloadFile: payload index is truncated.");
+
+  // the index is packed, read it field by field
+  const uint8_t *pos = file->data_ + sizeof(header);
+  const uint8_t *index_end = pos + header.index_size;
+  auto take = [&](void *dst, size_t bytes) {
+    GTEST_CHECK(bytes <= (size_t)(index_end - pos),
+                "PayloadFile: payload index is truncated.");
+    memcpy(dst, pos, bytes);
+    pos += bytes;
+  };
+  for (uint32_t i = 0; i < header.entry_num; ++i) {
+    uint64_t offset, length;
+    uint32_t name_length;
+    take(&offset, sizeof(offset));
+    take(&length, sizeof(length));
+    take(&name_length, sizeof(name_length));
+    std::string name(name_length, '\0');
+    take(&name[0], name_length);
+    GTEST_CHECK(offset <= file->size_ && length <= file->size_ - offset,
+                "PayloadFile: tensor data is out of the payload file.");
+    GTEST_CHECK(file->index_.emplace(name, std::make_pair(offset, length))
+                    .second,
+                "PayloadFile: found duplicated tensor in payload index.");
+  }
+  VLOG(4) << "PayloadFile: mapped " << path << " (" << file->size_
+          << " Bytes, " << header.entry_num << " tensors)";
+  return file;
+}
+
+const void *PayloadFile::find(const std::string &name, size_t *length) const {
+  auto it = index_.find(name);
+  if (it == index_.end()) {
+    return nullptr;
+  }
+  *length = it->second.second;
+  return data_ + it->second.first;
+}
+
+}  // namespace mluoptest
@@ -0,0 +1,307 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include "philox_random.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include "cpu_parallel.h"
+#include "tools.h"
+
+#define PHILOX_M4X32_A 0xD2511F53
+#define PHILOX_M4X32_B 0xCD9E8D57
+#define PHILOX_W32_A 0x9E3779B9
+#define PHILOX_W32_B 0xBB67AE85
+#define PHILOX_ROUNDS 10
+// Blocks generated together, the rounds of the lanes map onto SIMD
+// registers of 32-bit integers.
+#define PHILOX_LANES 8
+// Elements filled by one cpu task, a multiple of the values of a group of
+// lanes so that every chunk starts on a group.
+#define PHILOX_GRAIN (64 * 1024)
+
+namespace mluoptest {
+namespace {
+
+#ifdef __AVX2__
+// high and low halves of the 32x32-bit products of the 8 lanes
+inline void mulHiLo(__m256i a, __m256i b, __m256i *hi, __m256i *lo) {
+  const __m256i even = _mm256_mul_epu32(a, b);
+  const __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), b);
+  *hi = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xaa);
+  *lo = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xaa);
+}
+#endif
+
+// out[w][l] = word w of block first + l.
+inline void philoxLanes(const uint64_t seed, const uint64_t first,
+                        uint32_t out[4][PHILOX_LANES]) {
+#if defined(__AVX2__) && PHILOX_LANES == 8
+  const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  // the low words of first + l may wrap, then the high words are one more
+  const __m256i low =
+      _mm256_add_epi32(_mm256_set1_epi32((uint32_t)first), lane);
+  const __m256i carry = _mm256_cmpgt_epi32(
+      _mm256_set1_epi32((int32_t)((uint32_t)first ^ 0x80000000u)),
+      _mm256_xor_si256(low, _mm256_set1_epi32(0x80000000u)));
+  __m256i c0 = low;
+  __m256i c1 = _mm256_sub_epi32(_mm256_set1_epi32((uint32_t)(first >> 32)),
+                                carry);
+  __m256i c2 = _mm256_setzero_si256();
+  __m256i c3 = _mm256_setzero_si256();
+  const __m256i a = _mm256_set1_epi32(PHILOX_M4X32_A);
+  const __m256i b = _mm256_set1_epi32(PHILOX_M4X32_B);
+  uint32_t k0 = (uint32_t)seed;
+  uint32_t k1 = (uint32_t)(seed >> 32);
+  for (int r = 0; r < PHILOX_ROUNDS; ++r) {
+    __m256i hi0, lo0, hi1, lo1;
+    mulHiLo(c0, a, &hi0, &lo0);
+    mulHiLo(c2, b, &hi1, &lo1);
+    c0 = _mm256_xor_si256(_mm256_xor_si256(hi1, c1), _mm256_set1_epi32(k0));
+    c2 = _mm256_xor_si256(_mm256_xor_si256(hi0, c3), _mm256_set1_epi32(k1));
+    c1 = lo1;
+    c3 = lo0;
+    k0 += PHILOX_W32_A;
+    k1 += PHILOX_W32_B;
+  }
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(out[0]), c0);
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(out[1]), c1);
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(out[2]), c2);
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(out[3]), c3);
+#else
+  uint32_t c0[PHILOX_LANES], c1[PHILOX_LANES], c2[PHILOX_LANES],
+      c3[PHILOX_LANES];
+  for (int l = 0; l < PHILOX_LANES; ++l) {
+    c0[l] = (uint32_t)(first + l);
+    c1[l] = (uint32_t)((first + l) >> 32);
+    c2[l] = 0;
+    c3[l] = 0;
+  }
+  uint32_t k0 = (uint32_t)seed;
+  uint32_t k1 = (uint32_t)(seed >> 32);
+  for (int r = 0; r < PHILOX_ROUNDS; ++r) {
+    for (int l = 0; l < PHILOX_LANES; ++l) {
+      const uint64_t p0 = (uint64_t)PHILOX_M4X32_A * c0[l];
+      const uint64_t p1 = (uint64_t)PHILOX_M4X32_B * c2[l];
+      c0[l] = (uint32_t)(p1 >> 32) ^ c1[l] ^ k0;
+      c2[l] = (uint32_t)(p0 >> 32) ^ c3[l] ^ k1;
+      c1[l] = (uint32_t)p1;
+      c3[l] = (uint32_t)p0;
+    }
+    k0 += PHILOX_W32_A;
+    k1 += PHILOX_W32_B;
+  }
+  for (int l = 0; l < PHILOX_LANES; ++l) {
+    out[0][l] = c0[l];
+    out[1][l] = c1[l];
+    out[2][l] = c2[l];
+    out[3][l] = c3[l];
+  }
+#endif
+}
+
+// uniform in [0, 1) from the high 24 bits of a word
+inline float toUnitFloat(uint32_t x) { return (x >> 8) * (1.0f / 16777216); }
+
+// uniform in [0, 1) from 53 bits of two words
+inline double toUnitDouble(uint32_t hi, uint32_t lo) {
+  return ((((uint64_t)hi << 32) | lo) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Float log and sincos of the lanes with the polynomials of Cephes, written
+// without branches so that the Box-Muller transform vectorizes. The error is
+// a few float ulps, plenty for test data.
+
+// y[l] = log(x[l]) for normal x[l] > 0
+inline void logLanes(const float *x, float *y) {
+  const int L = PHILOX_LANES;
+  uint32_t bits[L];
+  float e[L], v[L];
+  std::memcpy(bits, x, sizeof(bits));
+  for (int l = 0; l < L; ++l) {
+    // x = m * 2^e with m in [sqrt(0.5), sqrt(2))
+    const uint32_t small = ((bits[l] & 0x007fffffu) - 0x003504f3u) >> 31;
+    e[l] = (float)((int32_t)(bits[l] >> 23) - 126 - (int32_t)small);
+    bits[l] = (bits[l] & 0x007fffffu) | (0x3f000000u + (small << 23));
+  }
+  std::memcpy(v, bits, sizeof(v));
+  for (int l = 0; l < L; ++l) {
+    const float m = v[l] - 1.0f;
+    const float z = m * m;
+    float p = 7.0376836292e-2f;
+    p = p * m - 1.1514610310e-1f;
+    p = p * m + 1.1676998740e-1f;
+    p = p * m - 1.2420140846e-1f;
+    p = p * m + 1.4249322787e-1f;
+    p = p * m - 1.6668057665e-1f;
+    p = p * m + 2.0000714765e-1f;
+    p = p * m - 2.4999993993e-1f;
+    p = p * m + 3.3333331174e-1f;
+    const float r = m * z * p - 2.12194440e-4f * e[l] - 0.5f * z;
+    y[l] = m + r + 0.693359375f * e[l];
+  }
+}
+
+// s[l] = sin(2 * pi * u), c[l] = cos(2 * pi * u) for u = toUnitFloat(w[l])
+inline void sincos2PiLanes(const uint32_t *w, float *s, float *c) {
+  for (int l = 0; l < PHILOX_LANES; ++l) {
+    const float t = toUnitFloat(w[l]) * 4.0f;
+    const float q = std::floor(t + 0.5f);  // quadrant, 0 to 4
+    const float x = (t - q) * 1.57079632679489661923f;  // in [-pi/4, pi/4]
+    const float z = x * x;
+    const float sx =
+        x + x * z *
+                ((-1.9515295891e-4f * z + 8.3321608736e-3f) * z -
+                 1.6666654611e-1f);
+    const float cx =
+        1.0f - 0.5f * z +
+        z * z *
+            ((2.443315711809948e-5f * z - 1.388731625493765e-3f) * z +
+             4.166664568298827e-2f);
+    // rotate by the quadrant
+    const int quadrant = (int)q;
+    const float odd = (float)(quadrant & 1);
+    s[l] = (1 - (quadrant & 2)) * (odd * cx + (1.0f - odd) * sx);
+    c[l] = (1 - ((quadrant + 1) & 2)) * (odd * sx + (1.0f - odd) * cx);
+  }
+}
+
+// Fills data[0, count) by groups of PHILOX_LANES consecutive blocks.
+// convert(words, values) turns the words of a group into PerGroup values,
+// value j of a group only uses lane j % PHILOX_LANES, so the conversions
+// vectorize as well.
+template <int PerGroup, typename T, typename Convert>
+void philoxFill(T *data, const size_t count, const uint64_t seed,
+                Convert &&convert) {
+  static_assert(PHILOX_GRAIN % PerGroup == 0, "chunks must start on a group");
+  cpuParallelChunks(0, count, PHILOX_GRAIN, [&](int64_t begin, int64_t end) {
+    uint32_t words[4][PHILOX_LANES];
+    for (int64_t offset = begin; offset < end; offset += PerGroup) {
+      philoxLanes(seed, offset / PerGroup * PHILOX_LANES, words);
+      if (end - offset >= PerGroup) {
+        convert(words, data + offset);
+      } else {
+        T values[PerGroup];
+        convert(words, values);
+        std::copy(values, values + (end - offset), data + offset);
+      }
+    }
+  });
+}
+
+// Largest value of [lower, upper), lower + range * u may round up to upper.
+template <typename T>
+inline T belowUpper(T lower, T upper) {
+  return lower < upper ? std::nextafter(upper, lower)
+                       : std::numeric_limits<T>::infinity();
+}
+
+}  // namespace
+
+void philoxBlock(uint64_t seed, uint64_t block, uint32_t out[4]) {
+  uint32_t words[4][PHILOX_LANES];
+  philoxLanes(seed, block, words);
+  for (int w = 0; w < 4; ++w) {
+    out[w] = words[w][0];
+  }
+}
+
+void philoxUniform(float *data, size_t count, uint64_t seed, float lower,
+                   float upper) {
+  const float range = upper - lower;
+  const float max = belowUpper(lower, upper);
+  const int L = PHILOX_LANES;
+  philoxFill<4 * L>(data, count, seed, [=](uint32_t w[4][L], float *values) {
+    for (int i = 0; i < 4; ++i) {
+      for (int l = 0; l < L; ++l) {
+        values[i * L + l] =
+            std::min(lower + range * toUnitFloat(w[i][l]), max);
+      }
+    }
+  });
+}
+
+void philoxUniform(double *data, size_t count, uint64_t seed, double lower,
+                   double upper) {
+  const double range = upper - lower;
+  const double max = belowUpper(lower, upper);
+  const int L = PHILOX_LANES;
+  philoxFill<2 * L>(data, count, seed, [=](uint32_t w[4][L], double *values) {
+    for (int i = 0; i < 2; ++i) {
+      for (int l = 0; l < L; ++l) {
+        const double u = toUnitDouble(w[2 * i][l], w[2 * i + 1][l]);
+        values[i * L + l] = std::min(lower + range * u, max);
+      }
+    }
+  });
+}
+
+void philoxGaussian(float *data, size_t count, uint64_t seed, float mu,
+                    float sigma) {
+  const int L = PHILOX_LANES;
+  philoxFill<4 * L>(data, count, seed, [=](uint32_t w[4][L], float *values) {
+    for (int i = 0; i < 4; i += 2) {
+      float u1[L], r[L], sin[L], cos[L];
+      for (int l = 0; l < L; ++l) {
+        // in (0, 1], keeps the log finite
+        u1[l] = 1.0f - toUnitFloat(w[i][l]);
+      }
+      logLanes(u1, r);
+      // apart, sqrt may set errno and does not vectorize
+      for (int l = 0; l < L; ++l) {
+        r[l] = sigma * std::sqrt(-2.0f * r[l]);
+      }
+      sincos2PiLanes(w[i + 1], sin, cos);
+      for (int l = 0; l < L; ++l) {
+        values[i * L + l] = mu + r[l] * cos[l];
+        values[(i + 1) * L + l] = mu + r[l] * sin[l];
+      }
+    }
+  });
+}
+
+void philoxGaussian(double *data, size_t count, uint64_t seed, double mu,
+                    double sigma) {
+  const double two_pi = 6.28318530717958647692;
+  const int L = PHILOX_LANES;
+  philoxFill<2 * L>(data, count, seed, [=](uint32_t w[4][L], double *values) {
+    for (int l = 0; l < L; ++l) {
+      const double u1 = 1.0 - toUnitDouble(w[0][l], w[1][l]);
+      const double u2 = toUnitDouble(w[2][l], w[3][l]);
+      const double r = sigma * std::sqrt(-2.0 * std::log(u1));
+      values[l] = mu + r * std::cos(two_pi * u2);
+      values[L + l] = mu + r * std::sin(two_pi * u2);
+    }
+  });
+}
+
+bool useLegacyRandom() {
+  static const bool legacy = getEnv("MLUOP_GTEST_LEGACY_RANDOM", false);
+  return legacy;
+}
+
+}  // namespace mluoptest
@@ -22,30 +22,36 @@
  *************************************************************************/
 #include "stride.h"
 
+#include <algorithm>
+#include "cpu_parallel.h"
+#include "strided_copy.h"
+
 namespace mluoptest {
 
-void stride_map(void *dst,                              // dst ptr
-                void *src,                              // src ptr
-                const std::vector<size_t> &shape,       // shape
-                const std::vector<size_t> &dst_stride,  // stride
-                const std::vector<size_t> &src_stride,  // stride
-                size_t dst_offset, size_t src_offset, size_t d,
-                size_t sizeof_dtype, const size_t dst_max,
-                const size_t src_max) {
-  if (d == shape.size() - 1) {  // the last dim
-    for (size_t i = 0; i < shape[d]; ++i) {
-      size_t dst_idx = src_offset + i * src_stride[d];
-      size_t src_idx = dst_offset + i * dst_stride[d];
-      memcpy((char *)dst + dst_idx * sizeof_dtype,
-             (char *)src + src_idx * sizeof_dtype, sizeof_dtype);
-    }
-  } else {
-    for (size_t i = 0; i < shape[d]; ++i) {
-      stride_map(dst, src, shape, dst_stride, src_stride,
-                 dst_offset + i * dst_stride[d], src_offset + i * src_stride[d],
-                 d + 1, sizeof_dtype, dst_max, src_max);
-    }
+void stridedCopy(void *dst, const void *src, const std::vector<size_t> &shape,
+                 const std::vector<size_t> &dst_stride,
+                 const std::vector<size_t> &src_stride, size_t sizeof_dtype) {
+  StridedCopy plan(shape, dst_stride, src_stride, sizeof_dtype);
+  if (!plan.parallel() ||
+      plan.taskNum() * plan.taskBytes() < STRIDED_COPY_TASK_BYTES) {
+    plan.run(dst, src, 0, plan.taskNum());
+    return;
+  }
+  const int64_t grain = std::max<int64_t>(
+      1, STRIDED_COPY_TASK_BYTES / std::max<size_t>(1, plan.taskBytes()));
+  cpuParallelChunks(0, plan.taskNum(), grain, [&](int64_t b, int64_t e) {
+    plan.run(dst, src, b, e);
+  });
+}
+
+static std::vector<size_t> contiguousStride(const std::vector<size_t> &shape) {
+  std::vector<size_t> stride(shape.size());
+  size_t stride_base = 1;
+  for (ssize_t i = shape.size() - 1; i >= 0; --i) {
+    stride[i] = stride_base;
+    stride_base *= shape[i];
   }
+  return stride;
 }
 
 // src(strided) -> dst(shape)
@@ -56,22 +62,9 @@ void tensor_stride_in(void *dst, void *src, const std::vector<size_t> &shape,
                       size_t sizeof_dtype) {
   GTEST_CHECK(shape.size() == dst_stride.size(),
               "shape's size is not equal to stride's size.");
-
-  size_t shape_total = std::accumulate(shape.begin(), shape.end(), (size_t)1,
-                                       std::multiplies<size_t>());
-  size_t stride_total = 1;
-  for (size_t i = 0; i < shape.size(); ++i) {
-    stride_total += (shape[i] - 1) * dst_stride[i];
-  }
-
-  std::vector<size_t> src_stride(shape.size());
-  size_t stride_base = 1;
-  for (ssize_t i = shape.size() - 1; i >= 0; --i) {
-    src_stride[i] = stride_base;
-    stride_base *= shape[i];
-  }
-  stride_map(dst, src, shape, dst_stride, src_stride, 0, 0, 0, sizeof_dtype,
-             stride_total, shape_total);
+  // dst_stride is the stride of the strided tensor, which is src here
+  stridedCopy(dst, src, shape, contiguousStride(shape), dst_stride,
+              sizeof_dtype);
 }
 
 // src(shape) -> dst(strided)
@@ -82,22 +75,9 @@ void tensor_stride_out(void *dst, void *src, const std::vector<size_t> &shape,
                        size_t sizeof_dtype) {
   GTEST_CHECK(shape.size() == src_stride.size(),
               "shape's size is not equal to stride's size.");
-
-  size_t shape_total = std::accumulate(shape.begin(), shape.end(), (size_t)1,
-                                       std::multiplies<size_t>());
-  size_t stride_total = 1;
-  for (size_t i = 0; i < shape.size(); ++i) {
-    stride_total += (shape[i] - 1) * src_stride[i];
-  }
-
-  std::vector<size_t> dst_stride(shape.size());
-  size_t stride_base = 1;
-  for (ssize_t i = shape.size() - 1; i >= 0; --i) {
-    dst_stride[i] = stride_base;
-    stride_base *= shape[i];
-  }
-  stride_map(dst, src, shape, dst_stride, src_stride, 0, 0, 0, sizeof_dtype,
-             shape_total, stride_total);
+  // src_stride is the stride of the strided tensor, which is dst here
+  stridedCopy(dst, src, shape, src_stride, contiguousStride(shape),
+              sizeof_dtype);
 }
 
 class Stride::StrideImpl {
@@ -0,0 +1,341 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include "strided_copy.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace mluoptest {
+
+namespace {
+
+template <typename T>
+void copyRow(T *dst, const T *src, const int64_t num, const int64_t dst_stride,
+             const int64_t src_stride) {
+  if (dst_stride == 1 && src_stride == 1) {
+    memcpy(dst, src, num * sizeof(T));
+    return;
+  }
+  for (int64_t i = 0; i < num; ++i) {
+    dst[i * dst_stride] = src[i * src_stride];
+  }
+}
+
+void copyRowBytes(char *dst, const char *src, const int64_t num,
+                  const int64_t dst_stride, const int64_t src_stride,
+                  const size_t sizeof_dtype) {
+  switch (sizeof_dtype) {
+    case 1:
+      return copyRow((uint8_t *)dst, (const uint8_t *)src, num, dst_stride,
+                     src_stride);
+    case 2:
+      return copyRow((uint16_t *)dst, (const uint16_t *)src, num, dst_stride,
+                     src_stride);
+    case 4:
+      return copyRow((uint32_t *)dst, (const uint32_t *)src, num, dst_stride,
+                     src_stride);
+    case 8:
+      return copyRow((uint64_t *)dst, (const uint64_t *)src, num, dst_stride,
+                     src_stride);
+    default:
+      if (dst_stride == 1 && src_stride == 1) {
+        memcpy(dst, src, num * sizeof_dtype);
+        return;
+      }
+      for (int64_t i = 0; i < num; ++i) {
+        memcpy(dst + i * dst_stride * sizeof_dtype,
+               src + i * src_stride * sizeof_dtype, sizeof_dtype);
+      }
+  }
+}
+
+#if defined(__SSE2__)
+
+template <typename T>
+struct Unpack;
+
+template <>
+struct Unpack<uint8_t> {
+  static __m128i lo(__m128i x, __m128i y) { return _mm_unpacklo_epi8(x, y); }
+  static __m128i hi(__m128i x, __m128i y) { return _mm_unpackhi_epi8(x, y); }
+};
+
+template <>
+struct Unpack<uint16_t> {
+  static __m128i lo(__m128i x, __m128i y) { return _mm_unpacklo_epi16(x, y); }
+  static __m128i hi(__m128i x, __m128i y) { return _mm_unpackhi_epi16(x, y); }
+};
+
+template <>
+struct Unpack<uint32_t> {
+  static __m128i lo(__m128i x, __m128i y) { return _mm_unpacklo_epi32(x, y); }
+  static __m128i hi(__m128i x, __m128i y) { return _mm_unpackhi_epi32(x, y); }
+};
+
+template <>
+struct Unpack<uint64_t> {
+  static __m128i lo(__m128i x, __m128i y) { return _mm_unpacklo_epi64(x, y); }
+  static __m128i hi(__m128i x, __m128i y) { return _mm_unpackhi_epi64(x, y); }
+};
+
+// Transposes a tile of 16 bytes by 16 / sizeof(T) rows. Each stage
+// interleaves row i with row i + rows / 2, after log2(rows) stages row j
+// holds column j.
+template <typename T>
+inline void transposeTile(T *dst, const int64_t dst_ld, const T *src,
+                          const int64_t src_ld) {
+  constexpr int rows = 16 / sizeof(T);
+  __m128i r[rows], t[rows];
+  for (int i = 0; i < rows; ++i) {
+    r[i] = _mm_loadu_si128((const __m128i *)(src + i * src_ld));
+  }
+  for (int stage = 1; stage < rows; stage *= 2) {
+    for (int i = 0; i < rows / 2; ++i) {
+      t[2 * i] = Unpack<T>::lo(r[i], r[i + rows / 2]);
+      t[2 * i + 1] = Unpack<T>::hi(r[i], r[i + rows / 2]);
+    }
+    for (int i = 0; i < rows; ++i) {
+      r[i] = t[i];
+    }
+  }
+  for (int i = 0; i < rows; ++i) {
+    _mm_storeu_si128((__m128i *)(dst + i * dst_ld), r[i]);
+  }
+}
+
+#define STRIDED_COPY_TILE(T) (int64_t)(16 / sizeof(T))
+
+#else
+
+#define STRIDED_COPY_TILE(T) (int64_t)1
+
+#endif
+
+// dst[b * dst_b + a] = src[a * src_a + b] for a < na and b < nb
+template <typename T>
+void transposeLeaf(T *dst, const T *src, const int64_t na, const int64_t nb,
+                   const int64_t src_a, const int64_t dst_b) {
+  int64_t a = 0;
+#if defined(__SSE2__)
+  constexpr int64_t tile = STRIDED_COPY_TILE(T);
+  for (; a + tile <= na; a += tile) {
+    int64_t b = 0;
+    for (; b + tile <= nb; b += tile) {
+      transposeTile(dst + b * dst_b + a, dst_b, src + a * src_a + b, src_a);
+    }
+    for (; b < nb; ++b) {
+      for (int64_t i = a; i < a + tile; ++i) {
+        dst[b * dst_b + i] = src[i * src_a + b];
+      }
+    }
+  }
+#endif
+  for (int64_t b = 0; b < nb && a < na; ++b) {
+    for (int64_t i = a; i < na; ++i) {
+      dst[b * dst_b + i] = src[i * src_a + b];
+    }
+  }
+}
+
+// Halves the longer side until the block fits in L1, whatever the cache
+// sizes are. Cuts stay multiples of the SIMD tile.
+template <typename T>
+void transposeBlock(T *dst, const T *src, const int64_t na, const int64_t nb,
+                    const int64_t src_a, const int64_t dst_b) {
+  constexpr int64_t tile = STRIDED_COPY_TILE(T);
+  constexpr int64_t leaf = std::min<int64_t>(64, 256 / sizeof(T));
+  if (na >= nb && na > leaf) {
+    const int64_t half = (na / 2 + tile - 1) / tile * tile;
+    transposeBlock(dst, src, half, nb, src_a, dst_b);
+    transposeBlock(dst + half, src + half * src_a, na - half, nb, src_a,
+                   dst_b);
+  } else if (nb > leaf) {
+    const int64_t half = (nb / 2 + tile - 1) / tile * tile;
+    transposeBlock(dst, src, na, half, src_a, dst_b);
+    transposeBlock(dst + half * dst_b, src + half, na, nb - half, src_a,
+                   dst_b);
+  } else {
+    transposeLeaf(dst, src, na, nb, src_a, dst_b);
+  }
+}
+
+void transposeBytes(char *dst, const char *src, const int64_t na,
+                    const int64_t nb, const int64_t src_a, const int64_t dst_b,
+                    const size_t sizeof_dtype) {
+  switch (sizeof_dtype) {
+    case 1:
+      return transposeBlock((uint8_t *)dst, (const uint8_t *)src, na, nb,
+                            src_a, dst_b);
+    case 2:
+      return transposeBlock((uint16_t *)dst, (const uint16_t *)src, na, nb,
+                            src_a, dst_b);
+    case 4:
+      return transposeBlock((uint32_t *)dst, (const uint32_t *)src, na, nb,
+                            src_a, dst_b);
+    default:
+      return transposeBlock((uint64_t *)dst, (const uint64_t *)src, na, nb,
+                            src_a, dst_b);
+  }
+}
+
+}  // namespace
+
+StridedCopy::StridedCopy(const std::vector<size_t> &shape,
+                         const std::vector<size_t> &dst_stride,
+                         const std::vector<size_t> &src_stride,
+                         size_t sizeof_dtype)
+    : sizeof_dtype_(sizeof_dtype) {
+  std::vector<Dim> dims;
+  for (size_t i = 0; i < shape.size(); ++i) {
+    if (shape[i] == 0) {
+      return;
+    }
+    if (shape[i] > 1) {
+      dims.push_back({shape[i], dst_stride[i], src_stride[i]});
+    }
+  }
+
+  // dst elements are distinct if every dst stride is beyond the span of the
+  // smaller ones
+  std::vector<Dim> sorted = dims;
+  std::stable_sort(sorted.begin(), sorted.end(),
+                   [](const Dim &x, const Dim &y) {
+                     return x.dst_stride > y.dst_stride;
+                   });
+  size_t span = 1;
+  for (auto dim = sorted.rbegin(); dim != sorted.rend(); ++dim) {
+    if (dim->dst_stride < span) {
+      parallel_ = false;
+    }
+    span += (dim->size - 1) * dim->dst_stride;
+  }
+  if (parallel_) {
+    dims = sorted;
+  }
+
+  std::vector<Dim> merged;
+  for (const auto &dim : dims) {
+    if (!merged.empty() &&
+        merged.back().dst_stride == dim.dst_stride * dim.size &&
+        merged.back().src_stride == dim.src_stride * dim.size) {
+      merged.back().size *= dim.size;
+      merged.back().dst_stride = dim.dst_stride;
+      merged.back().src_stride = dim.src_stride;
+    } else {
+      merged.push_back(dim);
+    }
+  }
+  if (!merged.empty()) {
+    a_ = merged.back();
+    merged.pop_back();
+  }
+
+  const bool simd_dtype = sizeof_dtype == 1 || sizeof_dtype == 2 ||
+                          sizeof_dtype == 4 || sizeof_dtype == 8;
+  if (parallel_ && simd_dtype && a_.dst_stride == 1 && a_.src_stride != 1) {
+    auto b = std::find_if(merged.begin(), merged.end(),
+                          [](const Dim &dim) { return dim.src_stride == 1; });
+    if (b != merged.end()) {
+      kernel_ = TRANSPOSE;
+      b_ = *b;
+      merged.erase(b);
+    }
+  }
+  outer_ = merged;
+
+  int64_t outer_num = 1;
+  for (const auto &dim : outer_) {
+    outer_num *= dim.size;
+  }
+  if (kernel_ == TRANSPOSE) {
+    const int64_t row_bytes = a_.size * sizeof_dtype;
+    split_ = (STRIDED_COPY_TASK_BYTES + row_bytes - 1) / row_bytes;
+    split_ = std::min<int64_t>((split_ + 15) / 16 * 16, b_.size);
+    split_num_ = (b_.size + split_ - 1) / split_;
+    task_bytes_ = row_bytes * split_;
+  } else {
+    split_ = std::max<int64_t>(1, STRIDED_COPY_TASK_BYTES / sizeof_dtype);
+    split_ = std::min<int64_t>(split_, a_.size);
+    split_num_ = (a_.size + split_ - 1) / split_;
+    task_bytes_ = split_ * sizeof_dtype;
+  }
+  task_num_ = outer_num * split_num_;
+}
+
+void StridedCopy::runTask(char *dst, const char *src, int64_t part) const {
+  const int64_t begin = part * split_;
+  if (kernel_ == TRANSPOSE) {
+    const int64_t end = std::min<int64_t>(b_.size, begin + split_);
+    transposeBytes(dst + begin * b_.dst_stride * sizeof_dtype_,
+                   src + begin * sizeof_dtype_, a_.size, end - begin,
+                   a_.src_stride, b_.dst_stride, sizeof_dtype_);
+  } else {
+    const int64_t end = std::min<int64_t>(a_.size, begin + split_);
+    copyRowBytes(dst + begin * a_.dst_stride * sizeof_dtype_,
+                 src + begin * a_.src_stride * sizeof_dtype_, end - begin,
+                 a_.dst_stride, a_.src_stride, sizeof_dtype_);
+  }
+}
+
+void StridedCopy::run(void *dst, const void *src, int64_t task_begin,
+                      int64_t task_end) const {
+  if (task_begin >= task_end) {
+    return;
+  }
+  // index of the first task in the outer dims, then walked incrementally
+  std::vector<size_t> index(outer_.size(), 0);
+  int64_t outer = task_begin / split_num_;
+  int64_t part = task_begin % split_num_;
+  size_t dst_offset = 0, src_offset = 0;
+  for (size_t i = outer_.size(); i-- > 0;) {
+    index[i] = outer % outer_[i].size;
+    outer /= outer_[i].size;
+    dst_offset += index[i] * outer_[i].dst_stride;
+    src_offset += index[i] * outer_[i].src_stride;
+  }
+
+  for (int64_t task = task_begin; task < task_end; ++task) {
+    runTask((char *)dst + dst_offset * sizeof_dtype_,
+            (const char *)src + src_offset * sizeof_dtype_, part);
+    if (++part < split_num_) {
+      continue;
+    }
+    part = 0;
+    for (size_t i = outer_.size(); i-- > 0;) {
+      dst_offset += outer_[i].dst_stride;
+      src_offset += outer_[i].src_stride;
+      if (++index[i] < outer_[i].size) {
+        break;
+      }
+      dst_offset -= outer_[i].size * outer_[i].dst_stride;
+      src_offset -= outer_[i].size * outer_[i].src_stride;
+      index[i] = 0;
+    }
+  }
+}
+
+}  // namespace mluoptest
@@ -41,6 +41,8 @@
 #include "perf_test.h"
 #include "accuracy_test.h"
 #include "math_half.h"
+#include "cpu_cast.h"
+#include "cpu_parallel.h"
 
 namespace mluoptest {
 
@@ -597,10 +599,16 @@ void arrayCastFloatToHalf(int16_t *dst, float *src, size_t num) {
 
 template <AlgoHalfToFloat algo>
 void arrayCastHalfToFloatAlgoImpl(float *dst, uint16_t *src, size_t num) {
-#pragma omp parallel for schedule(guided)
-  for (size_t i = 0; i < num; ++i) {
-    dst[i] = cvtHalfToFloatImpl<algo>(src[i]);
-  }
+  const bool vectorized = castHalfToFloatVectorized(algo);
+  cpuParallelChunks(0, num, CPU_CAST_GRAIN, [&](int64_t b, int64_t e) {
+    if (vectorized) {
+      castHalfToFloatSpan(dst + b, src + b, e - b, algo);
+      return;
+    }
+    for (int64_t i = b; i < e; ++i) {
+      dst[i] = cvtHalfToFloatImpl<algo>(src[i]);
+    }
+  });
 }
 
 template <>
@@ -655,16 +663,14 @@ void arrayCastHalfToFloat(float *dst, int16_t *src, size_t num) {
 // support uint8, uint16, uint32, uint64, int32, int64
 template <typename TSrc, typename TDst>
 void arrayCastFloatAndNormal(void *dst, void *src, size_t num) {
-#pragma omp parallel for schedule(guided)
-  for (size_t i = 0; i < num; ++i) {
+  cpuParallelFor(0, num, CPU_CAST_GRAIN, [&](int64_t i) {
     ((TDst *)dst)[i] = (TDst)(((TSrc *)src)[i]);
-  }
+  });
 }
 
 template <>
 void arrayCastFloatAndNormal<float, bool>(void *dst, void *src, size_t num) {
-#pragma omp parallel for schedule(guided)
-  for (size_t i = 0; i < num; ++i) {
+  cpuParallelFor(0, num, CPU_CAST_GRAIN, [&](int64_t i) {
     // fabs(v) in (0, 1], will be 1, v >= 127 will be 0x7f, v <= -128 will be
     // 0xff, NAN will be 1, copy sign
     float v = ((float *)src)[i];
@@ -684,27 +690,16 @@ void arrayCastFloatAndNormal<float, bool>(void *dst, void *src, size_t num) {
       d |= 0x80;
     }
     ((int8_t *)dst)[i] = d;
-  }
+  });
 }
 
 // Note: here uint16_t is acutally bf16
-void arrayCastFloatToBF16(uint16_t *dst, float *src, size_t num) {
 // rounding mode: rn
-#pragma omp parallel for schedule(guided)
-  for (size_t i = 0; i < num; ++i) {
-    union {
-      uint32_t src_i_u32;
-      float src_i_f32;
-    };
-    src_i_f32 = src[i];
-    if (std::isnan(src_i_f32)) {
-      // XXX(zhaolianshui): loosing sign and quiet_nan/signaling_nan info
-      ((uint16_t *)dst)[i] = 0x7FC0;
-    } else {
-      uint32_t rounding_bias = ((src_i_u32 >> 16) & 1) + (uint32_t)0x7FFF;
-      dst[i] = static_cast<uint16_t>((src_i_u32 + rounding_bias) >> 16);
-    }
-  }
+// XXX(zhaolianshui): loosing sign and quiet_nan/signaling_nan info of NaN
+void arrayCastFloatToBF16(uint16_t *dst, float *src, size_t num) {
+  cpuParallelChunks(0, num, CPU_CAST_GRAIN, [&](int64_t b, int64_t e) {
+    castFloatToBF16Span(dst + b, src + b, e - b);
+  });
 }
 
 // the actual dtype of src is bf16
@@ -720,11 +715,9 @@ float cvtBF16ToFloat(uint16_t src_i) {
 
 // Note: here uint16_t is acutally bf16
 void arrayCastBF16ToFloat(float *dst, uint16_t *src, size_t num) {
-#pragma omp parallel for schedule(guided)
-  for (size_t i = 0; i < num; ++i) {
-    uint16_t src_i = src[i];
-    dst[i] = cvtBF16ToFloat(src_i);
-  }
+  cpuParallelChunks(0, num, CPU_CAST_GRAIN, [&](int64_t b, int64_t e) {
+    castBF16ToFloatSpan(dst + b, src + b, e - b);
+  });
 }
 
 // support uint8, uint16, uint32, uint64, int8, int16, int32, int64, bool
@@ -91,6 +91,10 @@ void GlobalVar::init(int *argc, char **argv) {
     thread_num_ = getParam(arg, "--thread").empty()
                       ? thread_num_
                       : to_int(getParam(arg, "--thread"), "--thread");
+    cpu_thread_num_ =
+        getParam(arg, "--cpu_thread").empty()
+            ? cpu_thread_num_
+            : to_int(getParam(arg, "--cpu_thread"), "--cpu_thread");
     half2float_algo_ =
         getParam(arg, "--half2float_algo").empty()
             ? half2float_algo_
@@ -223,6 +227,7 @@ void GlobalVar::print() {
   std::cout << "rand_n is " << rand_n_ << ENDL;
   std::cout << "repeat is " << repeat_ << ENDL;
   std::cout << "thread is " << thread_num_ << ENDL;
+  std::cout << "cpu_thread is " << cpu_thread_num_ << ENDL;
   std::cout << "half2float_algo is " << half2float_algo_ << ENDL;
   std::cout << "shuffle is " << shuffle_ << ENDL;
   std::cout << "mlu_only is " << mlu_only_ << ENDL;
@@ -0,0 +1,99 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include "voxel_hash_grid.h"
+
+#include <limits>
+#include "gtest/gtest.h"
+#include "check_tools.h"
+
+namespace mluoptest {
+
+VoxelHashGrid::VoxelHashGrid(const std::vector<int64_t> &extent,
+                             size_t expected_num)
+    : extent_(extent) {
+  const int64_t key_max = std::numeric_limits<int64_t>::max();
+  int64_t volume = 1;
+  for (auto size : extent_) {
+    GTEST_CHECK(size > 0 && volume <= key_max / size,
+                "VoxelHashGrid: voxel coordinates do not fit in int64_t.");
+    volume *= size;
+  }
+  keys_.reserve(expected_num);
+  size_t capacity = 16;
+  while (capacity < 2 * expected_num) {
+    capacity *= 2;
+  }
+  rehash(capacity);
+}
+
+size_t VoxelHashGrid::slot(int64_t key) const {
+  // splitmix64 finalizer, neighbouring voxels land far apart
+  uint64_t hash = (uint64_t)key;
+  hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+  hash ^= hash >> 31;
+  return hash & mask_;
+}
+
+void VoxelHashGrid::rehash(size_t capacity) {
+  table_.assign(capacity, -1);
+  mask_ = capacity - 1;
+  for (size_t id = 0; id < keys_.size(); ++id) {
+    size_t i = slot(keys_[id]);
+    while (table_[i] != -1) {
+      i = (i + 1) & mask_;
+    }
+    table_[i] = (int32_t)id;
+  }
+}
+
+int32_t VoxelHashGrid::insert(int64_t key) {
+  size_t i = slot(key);
+  while (table_[i] != -1) {
+    if (keys_[table_[i]] == key) {
+      return table_[i];
+    }
+    i = (i + 1) & mask_;
+  }
+  const int32_t id = (int32_t)keys_.size();
+  keys_.push_back(key);
+  table_[i] = id;
+  // keep the load under 1/2, probes stay short
+  if (2 * keys_.size() > table_.size()) {
+    rehash(2 * table_.size());
+  }
+  return id;
+}
+
+int32_t VoxelHashGrid::find(int64_t key) const {
+  size_t i = slot(key);
+  while (table_[i] != -1) {
+    if (keys_[table_[i]] == key) {
+      return table_[i];
+    }
+    i = (i + 1) & mask_;
+  }
+  return -1;
+}
+
+}  // namespace mluoptest
@@ -23,6 +23,7 @@
 
 #include <string>
 #include "dcn_backward_data.h"
+#include "cpu_gemm.h"
 #define USE_OPENBLAS 0
 
 #if USE_OPENBLAS
@@ -272,24 +273,6 @@ void DcnBackwardDataExecutor::hostDCNBackwardData(
       grad_mask[iter] = 0.0;
     }
   }
-#if USE_OPENBLAS
-#else
-  auto matmul = [](float *lhs, float *rhs, float *output, bool is_trans_a,
-                   bool is_trans_b, int M, int N, int K) {
-    for (int m = 0; m < M; m++) {
-      for (int n = 0; n < N; n++) {
-        output[m * N + n] = 0.0f;
-        for (int k = 0; k < K; k++) {
-          int lhs_idx = m * K + k;
-          if (is_trans_a) lhs_idx = k * M + m;
-          int rhs_idx = k * N + n;
-          if (is_trans_b) rhs_idx = n * K + k;
-          output[m * N + n] += lhs[lhs_idx] * rhs[rhs_idx];
-        }
-      }
-    }
-  };
-#endif
 
   for (int batch_iter = 0; batch_iter < n / im2col_step; batch_iter++) {
     VLOG(4) << "iter: " << batch_iter << " / " << n / im2col_step << ".";
@@ -325,8 +308,9 @@ void DcnBackwardDataExecutor::hostDCNBackwardData(
                   weight_addr, kd * kh * kw * ci, beta, col_addr,
                   kd * kh * kw * ci);
 #else
-      matmul(grad_output_addr, weight_addr, col_addr, false, false,
-             im2col_step * d_o * ho * wo, kd * kh * kw * ci, co);
+      cpuGemm(false, false, im2col_step * d_o * ho * wo, kd * kh * kw * ci, co,
+              1.0f, grad_output_addr, co, weight_addr, kd * kh * kw * ci, 0.0f,
+              col_addr, kd * kh * kw * ci);
 #endif
       int coeff = getCoefficientOfLT2CT();
       theory_ops_ += 2 * im2col_step * d_o * ho * wo * kd * kh * kw * ci * co /
@@ -21,6 +21,7 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  *************************************************************************/
 #include "dcn_backward_weight.h"
+#include "cpu_gemm.h"
 #include "internal_kernel/transpose_cpu/transpose_cpu.h"
 
 #define USE_OPENBLAS 0
@@ -402,32 +403,16 @@ static void BatchMatMul(const int &g, const int &m, const int &k, const int &n,
 
   float alpha = 1.0f;
   float beta = 1.0f;
-#else
-  auto matmul = [](float *lhs, float *rhs, float *output, bool is_trans_a,
-                   bool is_trans_b, int M, int N, int K) {
-    for (int m = 0; m < M; m++) {
-      for (int n = 0; n < N; n++) {
-        // output[m * N + n] = 0.0f;
-        for (int k = 0; k < K; k++) {
-          int lhs_idx = m * K + k;
-          if (is_trans_a) lhs_idx = k * M + m;
-          int rhs_idx = k * N + n;
-          if (is_trans_b) rhs_idx = n * K + k;
-          output[m * N + n] += lhs[lhs_idx] * rhs[rhs_idx];
-        }
-      }
-    }
-  };
-#endif
+
   for (int i = 0; i < batch_size; ++i) {
-#if USE_OPENBLAS
     cblas_sgemm(Order, TransA, TransB, m, n, k, alpha, input_a + i * m * k, lda,
                 input_b + i * k * n, ldb, beta, output + i * m * n, ldc);
+  }
 #else
-    matmul(input_a + i * m * k, input_b + i * k * n, output + i * m * n,
-           is_transa, is_transb, m, n, k);
+  cpuBatchGemm(batch_size, is_transa, is_transb, m, n, k, 1.0f, input_a,
+               is_transa ? m : k, (int64_t)m * k, input_b, is_transb ? k : n,
+               (int64_t)k * n, 1.0f, output, n, (int64_t)m * n);
 #endif
-  }
 }
 
 static void dealBias(float *cpu_grad_output, float *cpu_grad_bias, const int &N,
@@ -21,6 +21,8 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  *************************************************************************/
 #include "dcn_forward.h"
+#include "cpu_gemm.h"
+#include "cpu_parallel.h"
 #include "internal_kernel/transpose_cpu/transpose_cpu.h"
 
 #define USE_OPENBLAS 0
@@ -304,53 +306,54 @@ static void im2col(const int &N, const int &im2col_step, const int &dg,
                    const int &sh, const int &sw, const int &dh, const int &dw,
                    const float *cpu_input, const float *cpu_offset,
                    const float *cpu_mask, float *buffer) {
-  for (int idx_n = 0; idx_n < im2col_step; ++idx_n) {
-    for (int idx_ho = 0; idx_ho < ho; ++idx_ho) {
-      for (int idx_wo = 0; idx_wo < wo; ++idx_wo) {
-        float *input_ptr = (float *)cpu_input + idx_n * hi * wi * ci;
-        float *offset_ptr =
-            (float *)cpu_offset +
-            ((idx_n * ho + idx_ho) * wo + idx_wo) * dg * kh * kw * 2;
-        float *mask_ptr =
-            cpu_mask != nullptr
-                ? (float *)cpu_mask +
-                      ((idx_n * ho + idx_ho) * wo + idx_wo) * dg * kh * kw
-                : nullptr;
-        float *columns_ptr =
-            (float *)buffer +
-            ((idx_n * ho + idx_ho) * wo + idx_wo) * kh * kw * ci;
-        const int hi_start = idx_ho * sh - pt;
-        const int wi_start = idx_wo * sw - pl;
-        for (int idx_kh = 0; idx_kh < kh; ++idx_kh) {
-          for (int idx_kw = 0; idx_kw < kw; ++idx_kw) {
-            for (int idx_dg = 0; idx_dg < dg; ++idx_dg) {
-              const int data_offset_h =
-                  ((idx_dg * kh + idx_kh) * kw + idx_kw) * 2;
-              const int data_offset_w =
-                  ((idx_dg * kh + idx_kh) * kw + idx_kw) * 2 + 1;
-              const int data_mask = (idx_dg * kh + idx_kh) * kw + idx_kw;
-              const float offset_h = offset_ptr[data_offset_h];
-              const float offset_w = offset_ptr[data_offset_w];
-              const float mask =
-                  mask_ptr != nullptr ? mask_ptr[data_mask] : 1.0f;
-              const float h_in = hi_start + idx_kh * dh + offset_h;
-              const float w_in = wi_start + idx_kw * dw + offset_w;
-              if (h_in > -1 && w_in > -1 && h_in < hi && w_in < wi) {
-                for (int idx_ci = 0; idx_ci < ci / dg; ++idx_ci) {
-                  const int ci_offset = idx_dg * ci / dg + idx_ci;
-                  const int columns_offset =
-                      (idx_kh * kw + idx_kw) * ci + ci_offset;
-                  columns_ptr[columns_offset] =
-                      bilinear(input_ptr, ci_offset, hi, wi, ci, h_in, w_in) *
-                      mask;
-                }
+  // output rows write disjoint columns
+  cpuParallelFor(0, im2col_step * ho, [&](int64_t row) {
+    const int idx_n = row / ho;
+    const int idx_ho = row % ho;
+    for (int idx_wo = 0; idx_wo < wo; ++idx_wo) {
+      float *input_ptr = (float *)cpu_input + idx_n * hi * wi * ci;
+      float *offset_ptr =
+          (float *)cpu_offset +
+          ((idx_n * ho + idx_ho) * wo + idx_wo) * dg * kh * kw * 2;
+      float *mask_ptr =
+          cpu_mask != nullptr
+              ? (float *)cpu_mask +
+                    ((idx_n * ho + idx_ho) * wo + idx_wo) * dg * kh * kw
+              : nullptr;
+      float *columns_ptr =
+          (float *)buffer +
+          ((idx_n * ho + idx_ho) * wo + idx_wo) * kh * kw * ci;
+      const int hi_start = idx_ho * sh - pt;
+      const int wi_start = idx_wo * sw - pl;
+      for (int idx_kh = 0; idx_kh < kh; ++idx_kh) {
+        for (int idx_kw = 0; idx_kw < kw; ++idx_kw) {
+          for (int idx_dg = 0; idx_dg < dg; ++idx_dg) {
+            const int data_offset_h =
+                ((idx_dg * kh + idx_kh) * kw + idx_kw) * 2;
+            const int data_offset_w =
+                ((idx_dg * kh + idx_kh) * kw + idx_kw) * 2 + 1;
+            const int data_mask = (idx_dg * kh + idx_kh) * kw + idx_kw;
+            const float offset_h = offset_ptr[data_offset_h];
+            const float offset_w = offset_ptr[data_offset_w];
+            const float mask =
+                mask_ptr != nullptr ? mask_ptr[data_mask] : 1.0f;
+            const float h_in = hi_start + idx_kh * dh + offset_h;
+            const float w_in = wi_start + idx_kw * dw + offset_w;
+            if (h_in > -1 && w_in > -1 && h_in < hi && w_in < wi) {
+              for (int idx_ci = 0; idx_ci < ci / dg; ++idx_ci) {
+                const int ci_offset = idx_dg * ci / dg + idx_ci;
+                const int columns_offset =
+                    (idx_kh * kw + idx_kw) * ci + ci_offset;
+                columns_ptr[columns_offset] =
+                    bilinear(input_ptr, ci_offset, hi, wi, ci, h_in, w_in) *
+                    mask;
               }
             }
           }
         }
       }
     }
-  }
+  });
 }
 
 void DcnForwardExecutor::transpose(float *input, float *output,
@@ -406,32 +409,16 @@ static void BatchMatMul(const int &g, const int &m, const int &k, const int &n,
 
   float alpha = 1.0f;
   float beta = 1.0f;
-#else
-  auto matmul = [](float *lhs, float *rhs, float *output, bool is_trans_a,
-                   bool is_trans_b, int M, int N, int K) {
-    for (int m = 0; m < M; m++) {
-      for (int n = 0; n < N; n++) {
-        // output[m * N + n] = 0.0f;
-        for (int k = 0; k < K; k++) {
-          int lhs_idx = m * K + k;
-          if (is_trans_a) lhs_idx = k * M + m;
-          int rhs_idx = k * N + n;
-          if (is_trans_b) rhs_idx = n * K + k;
-          output[m * N + n] += lhs[lhs_idx] * rhs[rhs_idx];
-        }
-      }
-    }
-  };
-#endif
+
   for (int i = 0; i < batch_size; ++i) {
-#if USE_OPENBLAS
     cblas_sgemm(Order, TransA, TransB, m, n, k, alpha, input_a + i * m * k, lda,
                 input_b + i * k * n, ldb, beta, output + i * m * n, ldc);
+  }
 #else
-    matmul(input_a + i * m * k, input_b + i * k * n, output + i * m * n,
-           is_transa, is_transb, m, n, k);
+  cpuBatchGemm(batch_size, is_transa, is_transb, m, n, k, 1.0f, input_a,
+               is_transa ? m : k, (int64_t)m * k, input_b, is_transb ? k : n,
+               (int64_t)k * n, 1.0f, output, n, (int64_t)m * n);
 #endif
-  }
 }
 
 static void dealBias(float *cpu_output, float *cpu_bias, const int &N,
@@ -24,6 +24,9 @@
 #include "dynamic_point_to_voxel_forward.h"
 
 #include <algorithm>
+#include <vector>
+
+#include "voxel_hash_grid.h"
 
 namespace mluoptest {
 void DynamicPointToVoxelForwardExecutor::paramCheck() {
@@ -140,86 +143,64 @@ void DynamicPointToVoxelForwardExecutor::cpuCompute() {
   }
 
   // step 1
-  // 1.1 Get index
-  std::vector<int> index(N);
-  std::generate(index.begin(), index.end(), [n = 0]() mutable { return n++; });
-
-  // 1.2 Sort by comparing coordinates
-  auto compareInput = [=](int32_t i, int32_t j) {
-    for (int32_t idx = 0; idx < num_coors; ++idx) {
-      const int32_t lhs = coors[idx + i * num_coors];
-      const int32_t rhs = coors[idx + j * num_coors];
-      if (lhs < rhs) {
-        return true;
-      } else if (lhs > rhs) {
-        return false;
-      }
+  // 1.1 Find the voxel of every point, voxels are numbered by first point
+  std::vector<int64_t> coor_min(num_coors, 0), extent(num_coors, 1);
+  for (int32_t j = 0; j < num_coors; ++j) {
+    int64_t coor_max = coors[j];
+    coor_min[j] = coors[j];
+    for (int32_t i = 1; i < N; ++i) {
+      coor_min[j] = std::min<int64_t>(coor_min[j], coors[i * num_coors + j]);
+      coor_max = std::max<int64_t>(coor_max, coors[i * num_coors + j]);
     }
-    return false;
-  };
-  std::sort(index.begin(), index.end(), compareInput);
-  std::vector<int> index_sorted = index;
-
-  // 1.3 Unique
-  auto diffInput = [=](int32_t i, int32_t j) {
-    for (int32_t idx = 0; idx < num_coors; ++idx) {
-      const int32_t lhs = coors[idx + i * num_coors];
-      const int32_t rhs = coors[idx + j * num_coors];
-      if (lhs != rhs) {
-        return false;
-      }
+    extent[j] = coor_max - coor_min[j] + 1;
+  }
+  VoxelHashGrid grid(extent, N);
+  std::vector<int64_t> coor(num_coors);
+  std::vector<int32_t> point_voxel(N), first_point, count;
+  for (int32_t i = 0; i < N; ++i) {
+    for (int32_t j = 0; j < num_coors; ++j) {
+      coor[j] = (int64_t)coors[i * num_coors + j] - coor_min[j];
+    }
+    point_voxel[i] = grid.insert(grid.key(coor.data()));
+    if ((size_t)point_voxel[i] == first_point.size()) {
+      first_point.push_back(i);
+      count.push_back(0);
     }
-    return true;
-  };
-  std::vector<int>::iterator it =
-      std::unique(index.begin(), index.end(), diffInput);
-  index.resize(std::distance(index.begin(), it));
+    count[point_voxel[i]]++;
+  }
+
+  // 1.2 Sort the voxels, keys order like coordinates
+  const int32_t M = grid.size();
+  std::vector<int32_t> sorted_voxel(M), rank(M);
+  std::generate(sorted_voxel.begin(), sorted_voxel.end(),
+                [n = 0]() mutable { return n++; });
+  std::sort(sorted_voxel.begin(), sorted_voxel.end(),
+            [&](int32_t lhs, int32_t rhs) {
+              return grid.keys()[lhs] < grid.keys()[rhs];
+            });
+  for (int32_t r = 0; r < M; ++r) {
+    rank[sorted_voxel[r]] = r;
+  }
 
-  // 2. Calculate voxel_num
-  const bool flag = coors[index[0] * num_coors] == -1;
-  voxel_num[0] = index.size() - static_cast<int32_t>(flag);
+  // 2. Calculate voxel_num and voxel_coors, the voxel of the points with
+  // coors -1 sorts first and is dropped
+  const bool flag = coors[first_point[sorted_voxel[0]] * num_coors] == -1;
+  voxel_num[0] = M - static_cast<int32_t>(flag);
   for (int32_t i = 0; i < voxel_num[0]; ++i) {
+    const int32_t point = first_point[sorted_voxel[i + flag]];
     for (int32_t j = 0; j < num_coors; ++j) {
-      if (flag) {
-        voxel_coors[i * num_coors + j] = coors[index[i + 1] * num_coors + j];
-      } else {
-        voxel_coors[i * num_coors + j] = coors[index[i] * num_coors + j];
-      }
+      voxel_coors[i * num_coors + j] = coors[point * num_coors + j];
     }
   }
 
   // 3. Calculate point2voxel_map
-  std::vector<int> mask(N, 0);
-  for (int32_t i = 1; i < N; ++i) {
-    if (!diffInput(index_sorted[i], index_sorted[i - 1])) {
-      mask[i] = 1;
-    }
-    mask[i] += mask[i - 1];
-  }
-
   for (int32_t i = 0; i < N; ++i) {
-    point2voxel_map[index_sorted[i]] = mask[i] - static_cast<int32_t>(flag);
+    point2voxel_map[i] = rank[point_voxel[i]] - static_cast<int32_t>(flag);
   }
 
   // 4. Calculate voxel_points_count
-  int32_t voxel_points_count_idx = 0;
-  for (int32_t i = 0; i < index_sorted.size();) {
-    int32_t count = 1;
-    for (int32_t j = i + 1; j < N; ++j) {
-      if (diffInput(index_sorted[i], index_sorted[j])) {
-        count++;
-      } else {
-        break;
-      }
-    }
-    i += count;
-
-    if (flag && i == count) {
-      continue;
-    }
-
-    voxel_points_count[voxel_points_count_idx] = count;
-    voxel_points_count_idx++;
+  for (int32_t i = 0; i < voxel_num[0]; ++i) {
+    voxel_points_count[i] = count[sorted_voxel[i + flag]];
   }
 
   // 5. Calculate voxel_feats
@@ -22,6 +22,12 @@
  *************************************************************************/
 #include "fft.h"
 
+#include <algorithm>
+#include <functional>
+
+#include "cpu_fft.h"
+#include "cpu_parallel.h"
+
 namespace mluoptest {
 
 void FftExecutor::paramCheck() {
@@ -79,6 +85,53 @@ void FftExecutor::compute() {
   interface_timer_.stop();
 }
 
+void FftExecutor::cpuCompute() {
+  auto input_tensor = tensor_desc_[0].tensor;
+  auto output_tensor = tensor_desc_[1].tensor;
+  auto fft_param = parser_->getProtoNode()->fft_param();
+  const int rank = fft_param.rank();
+  GTEST_CHECK(rank >= 1 && rank <= CPU_FFT_RANK_MAX,
+              "FftExecutor: cpu fft supports rank 1 to 3.");
+  std::vector<int64_t> n(rank);
+  for (int i = 0; i < rank; i++) {
+    n[i] = fft_param.n(i);
+  }
+
+  auto isReal = [](mluOpDataType_t dtype) {
+    return dtype == MLUOP_DTYPE_HALF || dtype == MLUOP_DTYPE_FLOAT;
+  };
+  CpuFftType type = CPU_FFT_C2C;
+  if (isReal(input_tensor->getDtype())) {
+    type = CPU_FFT_R2C;
+  } else if (isReal(output_tensor->getDtype())) {
+    type = CPU_FFT_C2R;
+  }
+
+  // the cpu arrays are packed, a dim ahead of the rank dims is the batch
+  const int input_dim = input_tensor->getDim();
+  const int output_dim = output_tensor->getDim();
+  const int64_t batch = input_dim == rank ? 1 : input_tensor->getDimIndex(0);
+  std::vector<int64_t> inembed(rank), onembed(rank);
+  for (int i = 0; i < rank; i++) {
+    inembed[i] = input_tensor->getDimIndex(input_dim - rank + i);
+    onembed[i] = output_tensor->getDimIndex(output_dim - rank + i);
+  }
+
+  // outputs beyond the transform size are left untouched by CpuFft
+  const size_t output_num =
+      parser_->getOutputDataCount(0) * (type == CPU_FFT_C2R ? 1 : 2);
+  std::fill(cpu_fp32_output_[0], cpu_fp32_output_[0] + output_num, 0.0f);
+
+  CpuFft fft(type, n, batch, cpuFftPackedLayout(inembed),
+             cpuFftPackedLayout(onembed));
+  fft.run(cpu_fp32_input_[0], cpu_fp32_output_[0], fft_param.direction(),
+          fft_param.scale_factor(),
+          [](int64_t task_num,
+             const std::function<void(int64_t, int64_t)> &task) {
+            cpuParallelChunks(0, task_num, 1, task);
+          });
+}
+
 void FftExecutor::workspaceFree() {
   MLUOP_CHECK(mluOpDestroyFFTPlan(fft_plan_));
   for (auto &addr : workspace_) {
@@ -26,7 +26,12 @@
 #include <float.h>
 
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <iostream>
+#include <vector>
+
+#include "cpu_parallel.h"
 
 using namespace std;  // NOLINT
 
@@ -169,35 +174,102 @@ void creatAndFilterProposalsBox(T *anchors_slice, T *bbox_deltas_slice,
   }
 }
 
+// Picks of the former top k, which called findMaxScore pre_nms_num times
+// and marked each pick with FLOAT_MIN: the scores above FLOAT_MIN by
+// decreasing score then increasing index, after a nan first score, which
+// findMaxScore returned while it was the running max. Once those are used
+// up every further pick is the lowest marked index with score FLOAT_MIN,
+// or index 0 with its own -inf score the first time if nothing is marked.
 template <typename T>
-void findMaxScore(T *h_scores_buf, int size, T *max_score, int *max_score_id) {
-  if (size == 0) {
+void topKScores(const T *scores, const int num, const int k,
+                std::vector<int> *ids, std::vector<T> *top_scores) {
+  ids->clear();
+  top_scores->clear();
+  if (k <= 0 || num <= 0) {
     return;
   }
-  T max_score_local = h_scores_buf[0];
-  int max_score_id_local = 0;
-  for (int i = 1; i < size; ++i) {
-    if (h_scores_buf[i] > max_score_local) {
-      max_score_local = h_scores_buf[i];
-      max_score_id_local = i;
+  int lowest_marked = num;
+  if (std::isnan(scores[0])) {
+    ids->push_back(0);
+    top_scores->push_back(scores[0]);
+    lowest_marked = 0;
+  }
+  std::vector<int> order;
+  for (int i = 0; i < num; ++i) {
+    if (scores[i] > FLOAT_MIN) {
+      order.push_back(i);
+    } else if (scores[i] == FLOAT_MIN) {
+      lowest_marked = std::min(lowest_marked, i);
     }
   }
-  *max_score = max_score_local;
-  *max_score_id = max_score_id_local;
-  return;
+  auto higher = [scores](const int a, const int b) {
+    return scores[a] > scores[b] || (scores[a] == scores[b] && a < b);
+  };
+  const int take = std::min<int>(k - (int)ids->size(), order.size());
+  if (take < (int)order.size()) {
+    std::nth_element(order.begin(), order.begin() + take, order.end(),
+                     higher);
+  }
+  std::sort(order.begin(), order.begin() + take, higher);
+  for (int i = 0; i < take; ++i) {
+    ids->push_back(order[i]);
+    top_scores->push_back(scores[order[i]]);
+  }
+  if ((int)ids->size() == k) {
+    return;
+  }
+
+  // every score above FLOAT_MIN is marked now
+  for (const int id : order) {
+    lowest_marked = std::min(lowest_marked, id);
+  }
+  if (lowest_marked == num) {
+    ids->push_back(0);
+    top_scores->push_back(scores[0]);
+    lowest_marked = 0;
+  }
+  while ((int)ids->size() < k) {
+    ids->push_back(lowest_marked);
+    top_scores->push_back(FLOAT_MIN);
+  }
 }
 
+// Marks in removed the proposals after i whose IoU with proposal i is above
+// nms_thresh, 64 proposals a word. The IoU is computed as the former
+// calcIoU did, in float and in the same order, by a loop the compiler
+// vectorizes.
 template <typename T>
-T calcIoU(T *a, T *b, bool pixel_offset) {
-  float offset = pixel_offset ? static_cast<float>(1.0) : 0;
-  float left = max(a[0], b[0]), right = min(a[2], b[2]);
-  float top = max(a[1], b[1]), bottom = min(a[3], b[3]);
-  float width = max(right - left + offset, 0.f),
-        height = max(bottom - top + offset, 0.f);
-  float inter_s = width * height;
-  float s_a = (a[2] - a[0] + offset) * (a[3] - a[1] + offset);
-  float s_b = (b[2] - b[0] + offset) * (b[3] - b[1] + offset);
-  return inter_s / (s_a + s_b - inter_s);
+void suppressOverlaps(const std::vector<T> &x0, const std::vector<T> &y0,
+                      const std::vector<T> &x1, const std::vector<T> &y1,
+                      const std::vector<T> &areas, const int i,
+                      const T nms_thresh, const bool pixel_offset,
+                      std::vector<uint64_t> *removed) {
+  const int num = x0.size();
+  const float offset = pixel_offset ? static_cast<float>(1.0) : 0;
+  const float ax0 = x0[i], ay0 = y0[i], ax1 = x1[i], ay1 = y1[i];
+  const float s_a = areas[i];
+  for (int word = (i + 1) / 64; word < (int)removed->size(); ++word) {
+    if ((*removed)[word] == ~0ull) {
+      continue;
+    }
+    const int base = word * 64;
+    const int len = std::min(64, num - base);
+    uint8_t over[64];
+    for (int t = 0; t < len; ++t) {
+      const int j = base + t;
+      float left = max(ax0, x0[j]), right = min(ax1, x1[j]);
+      float top = max(ay0, y0[j]), bottom = min(ay1, y1[j]);
+      float width = max(right - left + offset, 0.f),
+            height = max(bottom - top + offset, 0.f);
+      float inter_s = width * height;
+      over[t] = inter_s / (s_a + areas[j] - inter_s) > nms_thresh;
+    }
+    uint64_t bits = 0;
+    for (int t = 0; t < len; ++t) {
+      bits |= (uint64_t)over[t] << t;
+    }
+    (*removed)[word] |= bits;
+  }
 }
 
 bool equal(float a, float b) { return abs(a - b) < 0.001; }
@@ -220,24 +292,19 @@ void ProposalForOneImage(T *scores_slice, T *bbox_deltas_slice,
     post_nms_num = pre_nms_num;
   }
 
-  T k_score = 0.0f;
-  T *out_scores_buf = new T[pre_nms_num];
-  T *out_box_buf = new T[pre_nms_num * 4];
-  T *out_area_buf = new T[pre_nms_num];
-  T *temp_scores = new T[HWA];
-  memcpy(temp_scores, scores_slice, HWA * sizeof(T));
+  std::vector<T> out_scores_buf(pre_nms_num);
+  std::vector<T> out_box_buf(pre_nms_num * 4);
+  std::vector<T> out_area_buf(pre_nms_num);
   // top k, creatbox, filter box
+  std::vector<int> top_ids;
+  std::vector<T> top_scores;
+  topKScores(scores_slice, HWA, pre_nms_num, &top_ids, &top_scores);
   for (int top_id = 0; top_id < pre_nms_num; ++top_id) {
-    int max_score_id = top_id;
-    T max_score = scores_slice[max_score_id];
-
-    findMaxScore(temp_scores, HWA, &max_score, &max_score_id);
-    temp_scores[max_score_id] = FLOAT_MIN;
-
     creatAndFilterProposalsBox<T>(
         anchors_slice, bbox_deltas_slice, im_shape_slice, variances_slice,
-        out_scores_buf, out_box_buf, out_area_buf, A, H, W, min_size, max_score,
-        max_score_id, pixel_offset, &proposals_num);
+        out_scores_buf.data(), out_box_buf.data(), out_area_buf.data(), A, H,
+        W, min_size, top_scores[top_id], top_ids[top_id], pixel_offset,
+        &proposals_num);
   }
 
   if (proposals_num == 0) {
@@ -250,60 +317,46 @@ void ProposalForOneImage(T *scores_slice, T *bbox_deltas_slice,
     return;
   }
 
-  float offset = pixel_offset ? 1 : 0;
+  // The proposals are sorted by score, so the max score the former NMS
+  // searched for is the first proposal neither kept nor suppressed, and
+  // it stopped at the first one not above FLOAT_MIN.
+  std::vector<T> x0(proposals_num), y0(proposals_num);
+  std::vector<T> x1(proposals_num), y1(proposals_num);
+  std::vector<T> areas(proposals_num);
+  const float offset = pixel_offset ? static_cast<float>(1.0) : 0;
+  for (int i = 0; i < proposals_num; ++i) {
+    x0[i] = out_box_buf[i * 4 + 0];
+    y0[i] = out_box_buf[i * 4 + 1];
+    x1[i] = out_box_buf[i * 4 + 2];
+    y1[i] = out_box_buf[i * 4 + 3];
+    areas[i] = (x1[i] - x0[i] + offset) * (y1[i] - y0[i] + offset);
+  }
+  std::vector<uint64_t> removed((proposals_num + 63) / 64, 0);
   int real_proposal_num = 0;
   int nms_num = std::min(proposals_num, post_nms_top_n);
 
-  for (int nms_id = 0; nms_id < nms_num; ++nms_id) {
-    // Find max score
-    float max_score = 0.0f;
-    int max_score_id = 0;
-    findMaxScore(out_scores_buf, proposals_num, &max_score, &max_score_id);
-    out_scores_buf[max_score_id] = FLOAT_MIN;
-
-    if (max_score <= FLOAT_MIN) {
+  for (int i = 0; i < proposals_num && real_proposal_num < nms_num; ++i) {
+    if ((removed[i / 64] >> (i % 64)) & 1) {
+      continue;
+    }
+    // a nan first score was the running max of the first search
+    const T score = out_scores_buf[i];
+    if (!(score > FLOAT_MIN) && !(i == 0 && std::isnan(score))) {
       break;
     }
-    // Compute max area
-    float max_score_x0 = out_box_buf[max_score_id * 4 + 0];
-    float max_score_y0 = out_box_buf[max_score_id * 4 + 1];
-    float max_score_x1 = out_box_buf[max_score_id * 4 + 2];
-    float max_score_y1 = out_box_buf[max_score_id * 4 + 3];
     // save max score and box to output
-    rpn_rois[(rpn_rois_batch_num + real_proposal_num) * 4 + 0] = max_score_x0;
-    rpn_rois[(rpn_rois_batch_num + real_proposal_num) * 4 + 1] = max_score_y0;
-    rpn_rois[(rpn_rois_batch_num + real_proposal_num) * 4 + 2] = max_score_x1;
-    rpn_rois[(rpn_rois_batch_num + real_proposal_num) * 4 + 3] = max_score_y1;
+    rpn_rois[(rpn_rois_batch_num + real_proposal_num) * 4 + 0] = x0[i];
+    rpn_rois[(rpn_rois_batch_num + real_proposal_num) * 4 + 1] = y0[i];
+    rpn_rois[(rpn_rois_batch_num + real_proposal_num) * 4 + 2] = x1[i];
+    rpn_rois[(rpn_rois_batch_num + real_proposal_num) * 4 + 3] = y1[i];
 
-    rpn_roi_probs[rpn_rois_batch_num + real_proposal_num] = max_score;
+    rpn_roi_probs[rpn_rois_batch_num + real_proposal_num] = score;
     real_proposal_num++;
 
-    float max_score_area = out_area_buf[max_score_id];
-
-    for (int inner_id = 0; inner_id < proposals_num; ++inner_id) {
-      if (inner_id == max_score_id) {
-        continue;
-      }
-
-      float *a = out_box_buf + max_score_id * 4;
-      float *b = out_box_buf + inner_id * 4;
-      float iou = calcIoU(a, b, pixel_offset);
-      if (iou > nms_thresh) {
-        out_scores_buf[inner_id] = FLOAT_MIN;
-      }
-    }
+    suppressOverlaps(x0, y0, x1, y1, areas, i, nms_thresh, pixel_offset,
+                     &removed);
   }
   *one_image_proposal_num = real_proposal_num;
-
-  delete[] out_scores_buf;
-  delete[] out_box_buf;
-  delete[] out_area_buf;
-  delete[] temp_scores;
-
-  out_scores_buf = nullptr;
-  out_box_buf = nullptr;
-  out_area_buf = nullptr;
-  temp_scores = nullptr;
 }
 
 void generateProposalsV2CPUImpl(
@@ -314,25 +367,40 @@ void generateProposalsV2CPUImpl(
     float *rpn_rois, float *rpn_roi_probs, float *rpn_rois_num,
     float *rpn_rois_batch_size) {
   const int HWA = A * H * W;
-  int rpn_rois_batch_num = 0;
-
-  for (int i = 0; i < N; ++i) {
+  const int pre_nms_num =
+      (pre_nms_top_n <= 0 || pre_nms_top_n > HWA) ? HWA : pre_nms_top_n;
+  // at most nms_num proposals or the zero box
+  const int image_rois_max = std::max(1, std::min(pre_nms_num, post_nms_top_n));
+
+  // images are independent, each one is computed into its own buffers
+  std::vector<std::vector<float>> image_rois(N);
+  std::vector<std::vector<float>> image_roi_probs(N);
+  std::vector<int> image_proposal_num(N, 0);
+  mluoptest::cpuParallelFor(0, N, 1, [&](int64_t i) {
     float *scores_slice = scores + i * HWA;
     float *bbox_deltas_slice = bbox_deltas + i * HWA * 4;
     float *im_shape_slice = im_shape + 2 * i;
     float *anchors_slice = anchors;      // [H, W, A, 4]
     float *variances_slice = variances;  // [H, W, A, 4]
-    float *rpn_rois_slice = rpn_rois + rpn_rois_batch_num * 4;
-    float *rpn_roi_probs_slice = rpn_roi_probs + rpn_rois_batch_num * 1;
-    float *rpn_rois_num_slice = rpn_rois_num + rpn_rois_batch_num * 1;
+    image_rois[i].resize(image_rois_max * 4);
+    image_roi_probs[i].resize(image_rois_max);
 
-    int one_image_proposal_num = 0;
     ProposalForOneImage<float>(
         scores_slice, bbox_deltas_slice, im_shape_slice, anchors_slice,
-        variances_slice, H, W, A, rpn_rois, rpn_roi_probs,
-        &one_image_proposal_num, rpn_rois_batch_num, pre_nms_top_n,
+        variances_slice, H, W, A, image_rois[i].data(),
+        image_roi_probs[i].data(), &image_proposal_num[i], 0, pre_nms_top_n,
         post_nms_top_n, nms_thresh, min_size, pixel_offset);
+  });
 
+  int rpn_rois_batch_num = 0;
+  for (int i = 0; i < N; ++i) {
+    const int one_image_proposal_num = image_proposal_num[i];
+    std::copy(image_rois[i].begin(),
+              image_rois[i].begin() + one_image_proposal_num * 4,
+              rpn_rois + rpn_rois_batch_num * 4);
+    std::copy(image_roi_probs[i].begin(),
+              image_roi_probs[i].begin() + one_image_proposal_num,
+              rpn_roi_probs + rpn_rois_batch_num);
     rpn_rois_batch_num += one_image_proposal_num;
     rpn_rois_num[i] = one_image_proposal_num;
   }
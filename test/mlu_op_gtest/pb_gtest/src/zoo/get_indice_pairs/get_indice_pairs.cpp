@@ -25,8 +25,11 @@
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <utility>
 #include "get_indice_pairs.h"
 #include "mlu_op.h"
+#include "cpu_parallel.h"
+#include "voxel_hash_grid.h"
 
 namespace mluoptest {
 GetIndicePairsExecutor::GetIndicePairsExecutor() {
@@ -144,34 +147,31 @@ void GetIndicePairsExecutor::diffPreprocess() {
   for (int i = 0; i < filter_space_.size(); i++) {
     kernel_volume *= filter_space_[i];
   }
-  std::vector<float> input;
-  std::vector<float> input_copy;
-  std::vector<float> output;
-  for (int i = 0; i < kernel_volume; i++) {
-    for (int j = 0; j < input_active_in; j++) {
-      if (cpu_input[i * input_active_in * 2 + j] != -1.0) {
-        input.push_back(cpu_input[i * input_active_in * 2 + j]);
-        input_copy.push_back(cpu_input[i * input_active_in * 2 + j]);
-        output.push_back(
-            cpu_input[i * input_active_in * 2 + input_active_in + j]);
+  // sort the active pairs of each kernel offset by input index, an input
+  // listed twice is paired with the output of its first occurrence
+  cpuParallelFor(0, kernel_volume, 1, [&](int64_t i) {
+    float *pairs_in = cpu_input + i * input_active_in * 2;
+    float *pairs_out = pairs_in + input_active_in;
+    std::vector<std::pair<float, int32_t>> input;
+    for (int32_t j = 0; j < input_active_in; j++) {
+      if (pairs_in[j] != -1.0) {
+        input.emplace_back(pairs_in[j], j);
       }
     }
-    sort(input.begin(), input.end());
-    for (int k = 0; k < input.size(); k++) {
-      cpu_input[i * input_active_in * 2 + k] = input[k];
-      int32_t index = -1;
-      for (int j = 0; j < input_copy.size(); j++) {
-        if (input_copy[j] == input[k]) {
-          index = j;
-          break;
-        }
+    std::sort(input.begin(), input.end());
+    std::vector<float> output(input.size());
+    int32_t first = 0;
+    for (int32_t k = 0; k < input.size(); k++) {
+      if (input[k].first != input[first].first) {
+        first = k;
       }
-      cpu_input[i * input_active_in * 2 + input_active_in + k] = output[index];
+      output[k] = pairs_out[input[first].second];
     }
-    input.clear();
-    output.clear();
-    input_copy.clear();
-  }
+    for (int32_t k = 0; k < input.size(); k++) {
+      pairs_in[k] = input[k].first;
+      pairs_out[k] = output[k];
+    }
+  });
 }
 
 void GetIndicePairsExecutor::cpuCompute() {
@@ -179,15 +179,6 @@ void GetIndicePairsExecutor::cpuCompute() {
   int *cpu_indice_out = (int *)cpu_fp32_output_[0];
   int *cpu_indice_pairs = (int *)cpu_fp32_output_[1];
   int *cpu_indice_num = (int *)cpu_fp32_output_[2];
-  int32_t grid_out_size = batch_;
-  for (int i = 0; i < (dimNb_ - 2); i++) {
-    grid_out_size = grid_out_size * output_space_[i];
-  }
-  int *cpu_grid_out =
-      (int *)cpu_runtime_.allocate((uint64_t)sizeof(int) * grid_out_size);
-  for (int32_t i = 0; i < grid_out_size; i++) {
-    cpu_grid_out[i] = -1;
-  }
   int32_t indice_pairs_size = mluOpGetTensorElementNum(indice_pairs_desc_);
   for (int i = 0; i < indice_pairs_size; i++) {
     cpu_indice_pairs[i] = -1;
@@ -203,9 +194,8 @@ void GetIndicePairsExecutor::cpuCompute() {
 
   VLOG(4) << "call cpuGetIndicePairs()";
   cpuGetIndicePairs(cpu_indice_in, cpu_indice_pairs, cpu_indice_out,
-                    cpu_indice_num, cpu_grid_out, indice_in_desc_,
-                    filter_space_, pad_, stride_, dilation_, output_space_,
-                    dimNb_, sub_m_, batch_);
+                    cpu_indice_num, indice_in_desc_, filter_space_, pad_,
+                    stride_, dilation_, output_space_, dimNb_, sub_m_, batch_);
 
   int32_t elements =
       std::max(indice_pairs_size, std::max(indice_num_size, indice_out_size));
@@ -226,16 +216,16 @@ void GetIndicePairsExecutor::cpuCompute() {
   memcpy(cpu_indice_out, cpu_result32, indice_out_size * sizeof(float));
 
   cpu_runtime_.deallocate(cpu_result32);
-  cpu_runtime_.deallocate(cpu_grid_out);
   cpu_runtime_.deallocate(input_host_);
   return;
 }
 
 int32_t GetIndicePairsExecutor::getValidOutPos(
-    int32_t *input_pos, std::vector<int32_t> kernel_size,
-    std::vector<int32_t> pad, std::vector<int32_t> stride,
-    std::vector<int32_t> dilation, std::vector<int32_t> out_spatail_shape,
-    int32_t *out, int32_t NDim) {
+    const int32_t *input_pos, const std::vector<int32_t> &kernel_size,
+    const std::vector<int32_t> &pad, const std::vector<int32_t> &stride,
+    const std::vector<int32_t> &dilation,
+    const std::vector<int32_t> &out_spatail_shape, int32_t *out,
+    int32_t NDim) {
   int32_t lowers[NDim];
   int32_t uppers[NDim];
   int32_t counter[NDim];
@@ -287,15 +277,12 @@ int32_t GetIndicePairsExecutor::getValidOutPos(
 
 void GetIndicePairsExecutor::cpuGetIndicePairs(
     int32_t *indice_in, int32_t *indice_pairs, int32_t *indice_out,
-    int32_t *indice_num, int32_t *grid_out,
-    const mluOpTensorDescriptor_t indice_in_desc,
-    std::vector<int32_t> kernel_size, std::vector<int32_t> pad,
-    std::vector<int32_t> stride, std::vector<int32_t> dilation,
-    std::vector<int32_t> out_spatail_shape, const int32_t dimNb,
+    int32_t *indice_num, const mluOpTensorDescriptor_t indice_in_desc,
+    const std::vector<int32_t> &kernel_size, const std::vector<int32_t> &pad,
+    const std::vector<int32_t> &stride, const std::vector<int32_t> &dilation,
+    const std::vector<int32_t> &out_spatail_shape, const int32_t dimNb,
     const int32_t sub_m, const int32_t batch_size) {
-  int32_t num_act = 0;
   int32_t num_act_in = indice_in_desc->getDimIndex(0);
-  int32_t batch_idx = 0;
   int32_t spatail_volume = 1;
   int32_t NDim = dimNb - 2;
   for (int i = 0; i < NDim; ++i) {
@@ -305,19 +292,9 @@ void GetIndicePairsExecutor::cpuGetIndicePairs(
   for (int i = 0; i < NDim; ++i) {
     kernel_volume *= kernel_size[i];
   }
-  int32_t num_valid_points = 0;
-  int *valid_points_ =
-      (int *)cpu_runtime_.allocate(kernel_volume * (NDim + 1) * sizeof(int));
-  int *indicePairUnqie =
-      (int *)cpu_runtime_.allocate(kernel_volume * num_act_in * sizeof(int));
-  int32_t *point_ptr = nullptr;
-  int32_t index = 0;
-  int32_t output_space_size = batch_size * spatail_volume + 1;
-  for (int i = 0; i < kernel_volume * num_act_in; i++) {
-    indicePairUnqie[i] = output_space_size;
-  }
 
-  auto getIndex = [](int32_t *indice_in_temp, std::vector<int32_t> kernel_size,
+  auto getIndex = [](const int32_t *indice_in_temp,
+                     const std::vector<int32_t> &kernel_size,
                      int32_t NDim) -> int32_t {
     int32_t index_return = 0;
     int32_t size_temp = 1;
@@ -328,59 +305,103 @@ void GetIndicePairsExecutor::cpuGetIndicePairs(
     return index_return;
   };
 
+  // sparse grids keyed by the linear index batch * spatail_volume + spatial
+  // position, the memory only depends on the number of active sites
+  const std::vector<int64_t> grid_extent = {(int64_t)batch_size *
+                                            spatail_volume};
+  VoxelHashGrid grid_in(grid_extent, sub_m ? num_act_in : 0);
+  std::vector<int32_t> grid_in_value;  // the last input at each position
   if (sub_m) {
     // prepareSubmGridKernel
     for (int j = 0; j < num_act_in; ++j) {
-      index =
+      int32_t index =
           getIndex(indice_in + j * (NDim + 1) + 1, out_spatail_shape, NDim) +
           spatail_volume * ((indice_in + j * (NDim + 1))[0]);
-      grid_out[index] = j;
+      int32_t id = grid_in.insert(index);
+      if (id == grid_in_value.size()) {
+        grid_in_value.push_back(j);
+      } else {
+        grid_in_value[id] = j;
+      }
     }
     for (int j = 0; j < num_act_in * (NDim + 1); j++) {
       indice_out[j] = indice_in[j];
     }
   }
 
-  for (int j = 0; j < num_act_in; ++j) {
-    int32_t batchIdx = (indice_in + j * (NDim + 1))[0];
-    num_valid_points =
-        getValidOutPos(indice_in + j * (NDim + 1) + 1, kernel_size, pad, stride,
-                       dilation, out_spatail_shape, valid_points_, NDim);
-    for (int i = 0; i < num_valid_points; ++i) {
-      point_ptr = valid_points_ + i * (NDim + 1);
-      int32_t offset = point_ptr[NDim];  // filter_index
-      index = getIndex(point_ptr, out_spatail_shape, NDim) +
-              spatail_volume * batchIdx;
-      if (sub_m) {
-        if (grid_out[index] > -1) {
-          int32_t  oldNum = indice_num[offset];
-          indice_num[offset]++;
-          indice_pairs[offset * 2 * num_act_in + oldNum] = j;
-          indice_pairs[offset * 2 * num_act_in + num_act_in +
-                       oldNum] = grid_out[index];
+  // output positions reached by each input, in the order getValidOutPos
+  // lists them, with the linear output index or, for subm, the input found
+  // there and -1 if there is none
+  const int64_t rule_size = (int64_t)kernel_volume * num_act_in;
+  std::vector<int32_t> rule_num(num_act_in);
+  std::vector<int32_t> rule_offset(rule_size);
+  std::vector<int32_t> rule_index(rule_size);
+  cpuParallelChunks(
+      0, num_act_in, cpuParallelGrain(0, num_act_in, 64),
+      [&](int64_t begin, int64_t end) {
+        std::vector<int32_t> valid_points(kernel_volume * (NDim + 1));
+        for (int64_t j = begin; j < end; ++j) {
+          int32_t batchIdx = (indice_in + j * (NDim + 1))[0];
+          int32_t num_valid_points = getValidOutPos(
+              indice_in + j * (NDim + 1) + 1, kernel_size, pad, stride,
+              dilation, out_spatail_shape, valid_points.data(), NDim);
+          rule_num[j] = num_valid_points;
+          for (int i = 0; i < num_valid_points; ++i) {
+            const int32_t *point_ptr = valid_points.data() + i * (NDim + 1);
+            int32_t index = getIndex(point_ptr, out_spatail_shape, NDim) +
+                            spatail_volume * batchIdx;
+            if (sub_m) {
+              int32_t id = grid_in.find(index);
+              index = id < 0 ? -1 : grid_in_value[id];
+            }
+            rule_offset[j * kernel_volume + i] = point_ptr[NDim];
+            rule_index[j * kernel_volume + i] = index;
+          }
         }
-      } else {
-        int32_t oldNum = indice_num[offset];
-        indice_num[offset]++;
-        indice_pairs[offset * 2 * num_act_in + oldNum] = j;
-        indice_pairs[offset * 2 * num_act_in + num_act_in + oldNum] = index;
-        indicePairUnqie[offset * num_act_in + oldNum] = index;
-      }  //  sub_m
-    }    // num_valid_points
-  }      //  num_act_in(L)
+      });
+
+  // append the pairs to the rulebook of their kernel offset in input order,
+  // outputs of the normal mode get their voxel id in grid_out
+  VoxelHashGrid grid_out(grid_extent, sub_m ? 0 : num_act_in);
+  for (int j = 0; j < num_act_in; ++j) {
+    for (int i = 0; i < rule_num[j]; ++i) {
+      int32_t offset = rule_offset[(int64_t)j * kernel_volume + i];
+      int32_t index = rule_index[(int64_t)j * kernel_volume + i];
+      if (sub_m && index < 0) {
+        continue;
+      }
+      if (!sub_m) {
+        index = grid_out.insert(index);
+      }
+      int32_t oldNum = indice_num[offset];
+      indice_num[offset]++;
+      indice_pairs[offset * 2 * num_act_in + oldNum] = j;
+      indice_pairs[offset * 2 * num_act_in + num_act_in + oldNum] = index;
+    }
+  }
 
   if (!sub_m) {
-    std::vector<int> indice_unique;
-    for (int i = 0; i < kernel_volume * num_act_in; i++) {
-      indice_unique.push_back(indicePairUnqie[i]);
+    // outputs are numbered in ascending order of their linear index. Like
+    // the unique over the whole (kernel_volume, num_act_in) rulebook, whose
+    // unused slots count as one more index past all others, the last one is
+    // left out
+    const std::vector<int64_t> &keys = grid_out.keys();
+    std::vector<int32_t> ids(keys.size());
+    for (int32_t id = 0; id < ids.size(); ++id) {
+      ids[id] = id;
+    }
+    std::sort(ids.begin(), ids.end(),
+              [&](int32_t a, int32_t b) { return keys[a] < keys[b]; });
+    int64_t pair_num = 0;
+    for (int k = 0; k < kernel_volume; k++) {
+      pair_num += indice_num[k];
     }
-    sort(indice_unique.begin(), indice_unique.end());
-    auto num_act = unique(indice_unique.begin(), indice_unique.end());
-    indice_unique.erase(num_act, indice_unique.end());
-    auto num_act_out = indice_unique.size() - 1;
+    int32_t num_act_out = std::max<int64_t>(
+        0, (int64_t)keys.size() - (pair_num == rule_size ? 1 : 0));
+    std::vector<int32_t> out_of_id(keys.size(), -1);
     for (int j = 0; j < num_act_out; ++j) {
-      index = indice_unique[j];
-      grid_out[index] = j;
+      out_of_id[ids[j]] = j;
+      int32_t index = keys[ids[j]];
       indice_out[j * (NDim + 1)] = index / spatail_volume;  //  n
       index -= indice_out[j * (NDim + 1)] * spatail_volume;
       indice_out[j * (NDim + 1) + 1] =
@@ -392,17 +413,13 @@ void GetIndicePairsExecutor::cpuGetIndicePairs(
       indice_out[j * (NDim + 1) + 3] = index;  //  w
     }
 
-    for (int j = 0; j < num_act_in; ++j) {
-      for (int k = 0; k < kernel_volume; k++) {
-        index = indice_pairs[k * 2 * num_act_in + num_act_in + j];
-        if (index > -1) {
-          indice_pairs[k * 2 * num_act_in + num_act_in + j] = grid_out[index];
-        }
+    cpuParallelFor(0, kernel_volume, 1, [&](int64_t k) {
+      int32_t *pairs_out = indice_pairs + k * 2 * num_act_in + num_act_in;
+      for (int j = 0; j < indice_num[k]; ++j) {
+        pairs_out[j] = out_of_id[pairs_out[j]];
       }
-    }
+    });
   }  //  !sub_m
-  cpu_runtime_.deallocate(valid_points_);
-  cpu_runtime_.deallocate(indicePairUnqie);
 }
 
 int64_t GetIndicePairsExecutor::getTheoryOps() {
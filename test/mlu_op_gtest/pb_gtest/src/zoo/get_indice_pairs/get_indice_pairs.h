@@ -50,16 +50,18 @@ class GetIndicePairsExecutor : public Executor {
   void initParam();
   void cpuGetIndicePairs(
       int32_t *indice_in, int32_t *indice_pairs, int32_t *indice_out,
-      int32_t *indice_num, int32_t *grid_out,
-      mluOpTensorDescriptor_t indice_in_desc, std::vector<int32_t> kernel_size,
-      std::vector<int32_t> pad, std::vector<int32_t> stride,
-      std::vector<int32_t> dilation, std::vector<int32_t> out_spatail_shape,
-      const int32_t dimNb, const int32_t sub_m, const int32_t batch_size);
-  int32_t getValidOutPos(int32_t *input_pos, std::vector<int32_t> kernel_size,
-                         std::vector<int32_t> pad, std::vector<int32_t> stride,
-                         std::vector<int32_t> dilation,
-                         std::vector<int32_t> out_spatail_shape, int32_t *out,
-                         int NDim);
+      int32_t *indice_num, mluOpTensorDescriptor_t indice_in_desc,
+      const std::vector<int32_t> &kernel_size, const std::vector<int32_t> &pad,
+      const std::vector<int32_t> &stride, const std::vector<int32_t> &dilation,
+      const std::vector<int32_t> &out_spatail_shape, const int32_t dimNb,
+      const int32_t sub_m, const int32_t batch_size);
+  int32_t getValidOutPos(const int32_t *input_pos,
+                         const std::vector<int32_t> &kernel_size,
+                         const std::vector<int32_t> &pad,
+                         const std::vector<int32_t> &stride,
+                         const std::vector<int32_t> &dilation,
+                         const std::vector<int32_t> &out_spatail_shape,
+                         int32_t *out, int NDim);
   int32_t dimNb_;
   int32_t batch_;
   int32_t sub_m_;
@@ -27,6 +27,7 @@
 #include <string>
 #include <vector>
 #include "math.h"
+#include "cpu_parallel.h"
 
 namespace mluoptest {
 
@@ -93,7 +94,9 @@ void MsDeformAttnForwardExecutor::cpuMsDeformAttnForward(
     const int num_point,
     float *data_col) {
   const int n = batch_size * num_query * num_heads * channels;
-  for (int index = 0; index < n; ++index) {
+  // every output element is reduced on its own, in the serial order
+  cpuParallelFor(0, n, [&](int64_t i) {
+    const int index = i;
     int _temp = index;
     const int c_col = _temp % channels;
     _temp /= channels;
@@ -133,7 +136,7 @@ void MsDeformAttnForwardExecutor::cpuMsDeformAttnForward(
       }
     }
     *data_col_ptr = col;
-  }
+  });
   return;
 }
 
@@ -21,7 +21,12 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  *************************************************************************/
 #include <sys/time.h>
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
 #include "nms.h"
+#include "cpu_parallel.h"
 #include "mlu_op.h"
 
 namespace mluoptest {
@@ -176,256 +181,520 @@ void NmsExecutor::compute() {
   cpu_runtime_.deallocate(nms_desc);
 }
 
+namespace {
+
+// Sorted candidates checked together by the hard NMS: each block is first
+// tested against the boxes kept before it, then resolved box by box.
+#define NMS_CPU_BLOCK 64
+// Kept boxes spanning more grid cells than this on one axis are tested
+// against every block.
+#define NMS_CPU_GRID_SPAN 4
+// Boxes of one NMS3D step checked by one task.
+#define NMS3D_CPU_GRAIN 512
+
+// Boxes of one class in corner form, stored as structure of arrays so that
+// the IoU of one box against a run of boxes vectorizes.
+struct NmsBoxes {
+  std::vector<float> x1, y1, x2, y2, area;
+  explicit NmsBoxes(int num)
+      : x1(num), y1(num), x2(num), y2(num), area(num) {}
+};
+
+inline void loadNmsBox(const float *input_data, int input_box_num,
+                       int input_layout, int i, float *box) {
+  for (int c = 0; c < 4; ++c) {
+    if (input_layout == 0) {
+      // input layout is [boxes_num, 4]
+      box[c] = input_data[c + i * 4];
+    } else if (input_layout == 1) {
+      // input layout is [4, boxes_num]
+      box[c] = input_data[c * input_box_num + i];
+    } else {
+      box[c] = 0;
+    }
+  }
+}
+
+// Converts the box with index i to corner form at position pos of boxes.
+void setNmsBox(const float *input_data, int input_box_num,
+               const NmsCpuParam &param, int i, int pos, NmsBoxes *boxes) {
+  float box[4];
+  loadNmsBox(input_data, input_box_num, param.input_layout, i, box);
+  float x1 = box[0], y1 = box[1], x2 = box[2], y2 = box[3];
+  if (param.box_mode == 0) {
+    if (x1 > x2) {
+      std::swap(x1, x2);
+    }
+    if (y1 > y2) {
+      std::swap(y1, y2);
+    }
+  } else if (param.box_mode == 1) {
+    x1 = x1 - x2 * 0.5;
+    x2 = x1 + x2;
+    y1 = y1 - y2 * 0.5;
+    y2 = y1 + y2;
+  }
+  boxes->x1[pos] = x1;
+  boxes->y1[pos] = y1;
+  boxes->x2[pos] = x2;
+  boxes->y2[pos] = y2;
+  if (param.algo == 1) {
+    boxes->area[pos] = (x2 - x1 + param.offset) * (y2 - y1 + param.offset);
+  } else {
+    boxes->area[pos] = (x2 - x1) * (y2 - y1);
+  }
+}
+
+// iou[j - begin] = IoU of box k against box j, for j in [begin, end). The
+// arithmetic is the one of the mlu kernel, k plays the selected box.
+void nmsIouRow(const NmsBoxes &boxes, int k, int begin, int end,
+               const NmsCpuParam &param, float *iou) {
+  const float k_x1 = boxes.x1[k], k_y1 = boxes.y1[k];
+  const float k_x2 = boxes.x2[k], k_y2 = boxes.y2[k];
+  const float k_area = boxes.area[k];
+  const bool with_offset = param.algo == 1;
+  const float offset = param.offset;
+  const float *x1 = boxes.x1.data(), *y1 = boxes.y1.data();
+  const float *x2 = boxes.x2.data(), *y2 = boxes.y2.data();
+  const float *area = boxes.area.data();
+  for (int j = begin; j < end; ++j) {
+    const float inter_x1 = k_x1 > x1[j] ? k_x1 : x1[j];
+    const float inter_y1 = k_y1 > y1[j] ? k_y1 : y1[j];
+    const float inter_x2 = k_x2 > x2[j] ? x2[j] : k_x2;
+    const float inter_y2 = k_y2 > y2[j] ? y2[j] : k_y2;
+    float inter_w = inter_x2 - inter_x1;
+    float inter_h = inter_y2 - inter_y1;
+    if (with_offset) {
+      inter_w += offset;
+      inter_h += offset;
+    }
+    inter_w = inter_w < 0 ? 0 : inter_w;
+    inter_h = inter_h < 0 ? 0 : inter_h;
+    const float area_I = inter_w * inter_h;
+    const float area_U = k_area + area[j] - area_I;
+    iou[j - begin] = area_I / area_U;
+  }
+}
+
+// Uniform grid over the kept boxes of a hard NMS. Boxes that do not
+// intersect have an IoU of 0 or NaN, which never exceeds a non-negative
+// threshold, so a block of candidates only needs the kept boxes filed in
+// the cells it touches. A box is filed in every cell its extent touches,
+// boxes spanning too many cells go to a list seen by every block.
+class NmsGrid {
+ public:
+  // Returns false when the grid cannot skip any box exactly.
+  bool init(const NmsBoxes &boxes, int box_num, const NmsCpuParam &param) {
+    if (!(param.thresh_iou >= 0) || box_num == 0) {
+      return false;
+    }
+    // intersections are positive down to an overlap of -offset
+    pad_ = param.algo == 1 ? std::max(0.0, (double)param.offset) : 0.0;
+    double x_min = boxes.x1[0], x_max = boxes.x2[0];
+    double y_min = boxes.y1[0], y_max = boxes.y2[0];
+    double w_sum = 0, h_sum = 0;
+    for (int i = 0; i < box_num; ++i) {
+      const double x1 = boxes.x1[i], y1 = boxes.y1[i];
+      const double x2 = boxes.x2[i], y2 = boxes.y2[i];
+      if (!std::isfinite(x1 + y1 + x2 + y2 + boxes.area[i])) {
+        return false;
+      }
+      x_min = std::min(x_min, std::min(x1, x2));
+      x_max = std::max(x_max, std::max(x1, x2));
+      y_min = std::min(y_min, std::min(y1, y2));
+      y_max = std::max(y_max, std::max(y1, y2));
+      w_sum += std::fabs(x2 - x1);
+      h_sum += std::fabs(y2 - y1);
+    }
+    // slack for the float rounding of the intersection
+    eps_ = 1e-5 * (std::max(std::max(std::fabs(x_min), std::fabs(x_max)),
+                            std::max(std::fabs(y_min), std::fabs(y_max))) +
+                   1.0);
+    x0_ = x_min - pad_ - eps_;
+    y0_ = y_min - pad_ - eps_;
+    const int side = std::max(1, (int)std::sqrt((double)box_num));
+    gx_ = gridSide(x_max - x_min, w_sum / box_num, side);
+    gy_ = gridSide(y_max - y_min, h_sum / box_num, side);
+    inv_w_ = gx_ / (x_max - x_min + 2 * (pad_ + eps_));
+    inv_h_ = gy_ / (y_max - y_min + 2 * (pad_ + eps_));
+    cells_.assign((size_t)gx_ * gy_, std::vector<int>());
+    seen_.assign(box_num, -1);
+    return true;
+  }
+
+  void insert(const NmsBoxes &boxes, int k) {
+    all_.push_back(k);
+    int cx0, cx1, cy0, cy1;
+    cellRange(boxes, k, &cx0, &cx1, &cy0, &cy1);
+    if (cx1 - cx0 >= NMS_CPU_GRID_SPAN || cy1 - cy0 >= NMS_CPU_GRID_SPAN) {
+      large_.push_back(k);
+      return;
+    }
+    for (int cy = cy0; cy <= cy1; ++cy) {
+      for (int cx = cx0; cx <= cx1; ++cx) {
+        cells_[(size_t)cy * gx_ + cx].push_back(k);
+      }
+    }
+  }
+
+  // Appends the kept boxes that may intersect box j and are not yet in near
+  // for this block.
+  void gather(const NmsBoxes &boxes, int j, int block, std::vector<int> *near) {
+    int cx0, cx1, cy0, cy1;
+    cellRange(boxes, j, &cx0, &cx1, &cy0, &cy1);
+    auto add = [&](int k) {
+      if (seen_[k] != block) {
+        seen_[k] = block;
+        near->push_back(k);
+      }
+    };
+    if (cx1 - cx0 >= NMS_CPU_GRID_SPAN || cy1 - cy0 >= NMS_CPU_GRID_SPAN) {
+      std::for_each(all_.begin(), all_.end(), add);
+      return;
+    }
+    for (int cy = cy0; cy <= cy1; ++cy) {
+      for (int cx = cx0; cx <= cx1; ++cx) {
+        const auto &cell = cells_[(size_t)cy * gx_ + cx];
+        std::for_each(cell.begin(), cell.end(), add);
+      }
+    }
+    std::for_each(large_.begin(), large_.end(), add);
+  }
+
+ private:
+  // cells about the mean box size, at most side per axis
+  static int gridSide(double range, double mean_size, int side) {
+    if (!(range > 0)) {
+      return 1;
+    }
+    const double cells = range / std::max(mean_size, range / side);
+    return std::min(side, std::max(1, (int)cells));
+  }
+
+  void cellRange(const NmsBoxes &boxes, int k, int *cx0, int *cx1, int *cy0,
+                 int *cy1) const {
+    const double x1 = std::min(boxes.x1[k], boxes.x2[k]) - eps_;
+    const double x2 = std::max(boxes.x1[k], boxes.x2[k]) + pad_ + eps_;
+    const double y1 = std::min(boxes.y1[k], boxes.y2[k]) - eps_;
+    const double y2 = std::max(boxes.y1[k], boxes.y2[k]) + pad_ + eps_;
+    *cx0 = cell(x1, x0_, inv_w_, gx_);
+    *cx1 = cell(x2, x0_, inv_w_, gx_);
+    *cy0 = cell(y1, y0_, inv_h_, gy_);
+    *cy1 = cell(y2, y0_, inv_h_, gy_);
+  }
+
+  static int cell(double v, double origin, double inv, int num) {
+    const double c = std::floor((v - origin) * inv);
+    return (int)std::min<double>(num - 1, std::max(0.0, c));
+  }
+
+  double pad_ = 0, eps_ = 0, x0_ = 0, y0_ = 0, inv_w_ = 0, inv_h_ = 0;
+  int gx_ = 1, gy_ = 1;
+  std::vector<std::vector<int>> cells_;
+  std::vector<int> large_;
+  std::vector<int> all_;
+  std::vector<int> seen_;  // last block a kept box was gathered for
+};
+
+// Hard NMS on boxes sorted by descending score, which visits them in the
+// order of the argmax loop as scores do not change. Each block of
+// candidates is first tested against the kept boxes near it as a
+// kept x block IoU matrix, then resolved box by box.
+void hardNms(const NmsBoxes &boxes, int box_num, const NmsCpuParam &param,
+             std::vector<int> *kept) {
+  NmsGrid grid;
+  const bool use_grid = grid.init(boxes, box_num, param);
+  std::vector<int> near;
+  // candidates are in score order and spread over the image, with the grid
+  // they share few kept boxes and are looked up one by one
+  const int block = use_grid ? 1 : NMS_CPU_BLOCK;
+  float iou[NMS_CPU_BLOCK];
+  char suppressed[NMS_CPU_BLOCK];
+  for (int begin = 0;
+       begin < box_num && (int)kept->size() < param.keep_num;
+       begin += block) {
+    const int end = std::min(box_num, begin + block);
+    const int len = end - begin;
+    const int kept_before = kept->size();
+    const int *against = kept->data();
+    int against_num = kept_before;
+    if (use_grid) {
+      near.clear();
+      for (int j = begin; j < end; ++j) {
+        grid.gather(boxes, j, begin, &near);
+      }
+      against = near.data();
+      against_num = near.size();
+    }
+
+    std::fill(suppressed, suppressed + len, 0);
+    int alive = len;
+    for (int k = 0; k < against_num && alive > 0; ++k) {
+      nmsIouRow(boxes, against[k], begin, end, param, iou);
+      alive = 0;
+      for (int j = 0; j < len; ++j) {
+        suppressed[j] |= iou[j] > param.thresh_iou;
+        alive += !suppressed[j];
+      }
+    }
+    for (int j = 0; j < len && alive > 0; ++j) {
+      if (suppressed[j]) {
+        continue;
+      }
+      kept->push_back(begin + j);
+      if ((int)kept->size() == param.keep_num) {
+        break;
+      }
+      nmsIouRow(boxes, begin + j, begin + j + 1, end, param, iou);
+      for (int i = j + 1; i < len; ++i) {
+        suppressed[i] |= iou[i - j - 1] > param.thresh_iou;
+      }
+    }
+    if (use_grid) {
+      for (size_t k = kept_before; k < kept->size(); ++k) {
+        grid.insert(boxes, (*kept)[k]);
+      }
+    }
+  }
+}
+
+// The reference loop: select the first box with the highest score, then
+// decay or clear the score of the others. Needed when scores change with
+// soft NMS, or when a cleared score could be selected again.
+void greedyNms(const NmsBoxes &boxes, std::vector<float> score,
+               const NmsCpuParam &param,
+               std::vector<std::pair<int, float>> *keep) {
+  const int box_num = score.size();
+  std::vector<float> iou(box_num);
+  for (int k = 0; k < param.keep_num; k++) {
+    float max_score = score[0];
+    int max_index = 0;
+    for (int i = 1; i < box_num; i++) {
+      if (score[i] > max_score) {
+        max_score = score[i];
+        max_index = i;
+      }
+    }
+    if (max_score <= param.thresh_score) {
+      break;
+    }
+    keep->emplace_back(max_index, max_score);
+    score[max_index] = 0;
+
+    nmsIouRow(boxes, max_index, 0, box_num, param, iou.data());
+    const float thresh_iou = param.thresh_iou;
+    const float soft_nms_sigma = param.soft_nms_sigma;
+    if (param.method_mode == 0) {
+      for (int i = 0; i < box_num; i++) {
+        score[i] = iou[i] > thresh_iou ? 0 : score[i];
+      }
+    } else if (param.method_mode == 1) {
+      for (int i = 0; i < box_num; i++) {
+        score[i] = iou[i] > thresh_iou ? score[i] * (1 - iou[i]) : score[i];
+      }
+    } else if (soft_nms_sigma > 0.0) {
+      // TODO(wch): make sure the formula
+      for (int i = 0; i < box_num; i++) {
+        score[i] *= exp(-iou[i] * iou[i] / (2 * soft_nms_sigma));
+      }
+    } else {
+      for (int i = 0; i < box_num; i++) {
+        score[i] = (iou[i] > thresh_iou) ? 0.0 : score[i];
+      }
+    }
+  }
+}
+
+}  // namespace
+
 void NmsExecutor::nms3D_detection_cpu(float *output_data, int &output_box_num,
                                       float *input_data, int input_box_num,
                                       float thresh_iou, int input_layout) {
-  float *x1 = cpu_runtime_.allocate(new float[input_box_num]);
-  float *y1 = cpu_runtime_.allocate(new float[input_box_num]);
-  float *dx = cpu_runtime_.allocate(new float[input_box_num]);
-  float *dy = cpu_runtime_.allocate(new float[input_box_num]);
-  float *angle = cpu_runtime_.allocate(new float[input_box_num]);
-  float *score = cpu_runtime_.allocate(new float[input_box_num]);
-  float *box_a = cpu_runtime_.allocate(new float[7]);
-  float *box_b = cpu_runtime_.allocate(new float[7]);
-  memset(score, 1, input_box_num * sizeof(int));
+  // params box: [x, y, z, dx, dy, dz, heading], z and dz are not used
+  std::vector<float> boxes(input_box_num * 7, 0.0f);
+  std::vector<float> radius(input_box_num);
+  std::vector<char> suppressed(input_box_num, 0);
   if (input_layout == 0) {
-    // x,y,z,dx,dy,dz,angle
+    memcpy(boxes.data(), input_data, input_box_num * 7 * sizeof(float));
+  } else if (input_layout == 1) {
     for (int i = 0; i < input_box_num; i++) {
-      x1[i] = input_data[0 + i * 7];
-      y1[i] = input_data[1 + i * 7];
-      dx[i] = input_data[3 + i * 7];
-      dy[i] = input_data[4 + i * 7];
-      angle[i] = input_data[6 + i * 7];
+      for (int c = 0; c < 7; c++) {
+        boxes[i * 7 + c] = input_data[c * input_box_num + i];
+      }
     }
-  } else if (input_layout == 1) {
-    memcpy(x1, input_data, input_box_num * sizeof(float));
-    memcpy(y1, input_data + 1 * input_box_num, input_box_num * sizeof(float));
-    memcpy(dx, input_data + 3 * input_box_num, input_box_num * sizeof(float));
-    memcpy(dy, input_data + 4 * input_box_num, input_box_num * sizeof(float));
-    memcpy(angle, input_data + 6 * input_box_num,
-           input_box_num * sizeof(float));
   } else {
     VLOG(4) << "unsupport data layout now.";
   }
+  for (int i = 0; i < input_box_num; i++) {
+    const float *box = boxes.data() + i * 7;
+    radius[i] = 0.5 * std::sqrt((double)box[3] * box[3] +
+                                (double)box[4] * box[4]);
+  }
 
+  // Boxes are visited in index order, a box is kept unless a kept box before
+  // it overlaps it by more than thresh_iou. Boxes whose bounding circles are
+  // apart have an overlap of exactly 0, their iou_bev is skipped when that
+  // cannot exceed the threshold.
+  const bool skip_apart = thresh_iou >= 0;
   for (int cur_box = 0; cur_box < input_box_num; cur_box++) {
-    if (score[cur_box] == 0) {
+    if (suppressed[cur_box]) {
       continue;
     }
     output_data[output_box_num] = cur_box;
     output_box_num++;
-    // params box_a: [x, y, z, dx, dy, dz, heading]
-    box_a[0] = x1[cur_box], box_a[1] = y1[cur_box];
-    box_a[3] = dx[cur_box], box_a[4] = dy[cur_box];
-    box_a[6] = angle[cur_box];
-
-    for (int i = 0; i < input_box_num; i++) {
-      box_b[0] = x1[i], box_b[1] = y1[i];
-      box_b[3] = dx[i], box_b[4] = dy[i];
-      box_b[6] = angle[i];
-      // get IOU
+    const float *box_a = boxes.data() + cur_box * 7;
+    auto check = [&](int64_t i) {
+      if (suppressed[i]) {
+        return;
+      }
+      const float *box_b = boxes.data() + i * 7;
+      if (skip_apart) {
+        const double dx = (double)box_a[0] - box_b[0];
+        const double dy = (double)box_a[1] - box_b[1];
+        const double reach = radius[cur_box] + radius[i];
+        // margin covers check_in_box2d and float rounding of the corners
+        const double margin =
+            0.1 + 1e-3 * reach +
+            1e-5 * (std::fabs(box_a[0]) + std::fabs(box_a[1]) +
+                    std::fabs(box_b[0]) + std::fabs(box_b[1]));
+        if (dx * dx + dy * dy > (reach + margin) * (reach + margin)) {
+          return;
+        }
+      }
       float iou = Nms3DUtils::UtilsFunctions::iou_bev(box_a, box_b);
       if (iou > thresh_iou) {
-        score[i] = 0;
+        suppressed[i] = 1;
       }
-    }
+    };
+    cpuParallelFor(cur_box + 1, input_box_num, NMS3D_CPU_GRAIN, check);
   }
   VLOG(4) << "ouput_boxes_num:" << output_box_num;
-
-  cpu_runtime_.deallocate(score);
-  cpu_runtime_.deallocate(x1);
-  cpu_runtime_.deallocate(y1);
-  cpu_runtime_.deallocate(dx);
-  cpu_runtime_.deallocate(dy);
-  cpu_runtime_.deallocate(angle);
-  cpu_runtime_.deallocate(box_a);
-  cpu_runtime_.deallocate(box_b);
 }
 
-void NmsExecutor::nms_detection_cpu(
-    float *output_data, int &output_box_num, float *input_data,
-    float *input_score, int input_box_num, int keepNum, float thresh_iou,
-    float thresh_score, mluOpNmsOutputMode_t output_mode, int input_layout,
-    mluOpNmsAlgo_t algo, float offset, mluOpNmsBoxPointMode_t box_mode,
-    mluOpNmsMethodMode_t method_mode, float soft_nms_sigma, int batch_idx,
-    int class_idx) {
-  float *score = cpu_runtime_.allocate(new float[input_box_num]);
-  float *x1 = cpu_runtime_.allocate(new float[input_box_num]);
-  float *y1 = cpu_runtime_.allocate(new float[input_box_num]);
-  float *x2 = cpu_runtime_.allocate(new float[input_box_num]);
-  float *y2 = cpu_runtime_.allocate(new float[input_box_num]);
-  if (input_layout == 0) {
-    // input layout is [boxes_num, 4]
-    for (int i = 0; i < input_box_num; i++) {
-      x1[i] = input_data[0 + i * 4];
-      y1[i] = input_data[1 + i * 4];
-      x2[i] = input_data[2 + i * 4];
-      y2[i] = input_data[3 + i * 4];
-      // VLOG(4) << i << " x1:" << x1[i] << "y1:" << y1[i] << "x2:" << x2[i] <<
-      // "y2:" << y2[i];
-    }
-  } else if (input_layout == 1) {
-    // input layout is [4, boxes_num]
-    memcpy(x1, input_data, input_box_num * sizeof(float));
-    memcpy(y1, input_data + 1 * input_box_num, input_box_num * sizeof(float));
-    memcpy(x2, input_data + 2 * input_box_num, input_box_num * sizeof(float));
-    memcpy(y2, input_data + 3 * input_box_num, input_box_num * sizeof(float));
-  } else {
+void NmsExecutor::nms_detection_cpu(std::vector<std::pair<int, float>> &keep,
+                                    const float *input_data,
+                                    const float *input_score,
+                                    int input_box_num,
+                                    const NmsCpuParam &param) {
+  keep.clear();
+  if (input_box_num <= 0 || param.keep_num <= 0) {
+    return;
+  }
+  if (param.input_layout != 0 && param.input_layout != 1) {
     VLOG(4) << "unsupport data layout now.";
   }
-  memcpy(score, input_score, input_box_num * sizeof(float));
-  for (int keep = 0; keep < keepNum; keep++) {
-    // find the max score
-    float max_score = score[0];
-    int max_index = 0;
-    float max_x1, max_y1, max_x2, max_y2;
-    float output_x1, output_y1, output_x2, output_y2;
-    float max_area = 0;
-
-    for (int i = 1; i < input_box_num; i++) {
-      if (score[i] > max_score) {
-        max_score = score[i];
-        max_index = i;
+  // Hard NMS never raises a score and clears the suppressed ones, so with a
+  // non-negative score threshold the argmax loop visits the boxes above the
+  // threshold in (score desc, index asc) order and stops at the first one
+  // below. Sorting once replaces keep_num full rescans.
+  const bool hard = param.method_mode == 0 ||
+                    (param.method_mode != 1 && !(param.soft_nms_sigma > 0.0));
+  bool sortable = hard && param.thresh_score >= 0;
+  std::vector<int> order;
+  if (sortable) {
+    order.reserve(input_box_num);
+    for (int i = 0; i < input_box_num; i++) {
+      if (std::isnan(input_score[i])) {
+        sortable = false;
+        break;
+      }
+      if (input_score[i] > param.thresh_score) {
+        order.push_back(i);
       }
     }
-    max_x1 = x1[max_index];
-    max_y1 = y1[max_index];
-    max_x2 = x2[max_index];
-    max_y2 = y2[max_index];
+  }
 
-    if (max_score <= thresh_score) {
-      break;
+  if (sortable) {
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+      return input_score[a] > input_score[b];
+    });
+    const int box_num = order.size();
+    NmsBoxes boxes(box_num);
+    for (int pos = 0; pos < box_num; pos++) {
+      setNmsBox(input_data, input_box_num, param, order[pos], pos, &boxes);
     }
+    std::vector<int> kept;
+    hardNms(boxes, box_num, param, &kept);
+    for (int pos : kept) {
+      keep.emplace_back(order[pos], input_score[order[pos]]);
+    }
+  } else {
+    NmsBoxes boxes(input_box_num);
+    for (int i = 0; i < input_box_num; i++) {
+      setNmsBox(input_data, input_box_num, param, i, i, &boxes);
+    }
+    std::vector<float> score(input_score, input_score + input_box_num);
+    greedyNms(boxes, score, param, &keep);
+  }
+}
 
-    // VLOG(4) << "max_index:" << max_index;
-    // VLOG(4) << "max_score: " << max_score << "x1: " << max_x1 << "y1: " <<
-    // max_y1
-    //        << "x2: " << max_x2 << "y2: " << max_y2;
-    if (output_mode == 0) {
+void NmsExecutor::nms_output_cpu(float *output_data,
+                                 const std::vector<std::pair<int, float>> &keep,
+                                 const float *input_data, int input_box_num,
+                                 const NmsCpuParam &param, int batch_idx,
+                                 int class_idx) {
+  const int keepNum = param.keep_num;
+  for (int output_box_num = 0; output_box_num < (int)keep.size();
+       output_box_num++) {
+    const int max_index = keep[output_box_num].first;
+    const float max_score = keep[output_box_num].second;
+    float box[4];
+    loadNmsBox(input_data, input_box_num, param.input_layout, max_index, box);
+    if (param.output_mode == 0) {
       // save index of max score
       output_data[output_box_num] = max_index;
-    } else if (output_mode == 1) {
+    } else if (param.output_mode == 1) {
       output_data[output_box_num * 5 + 0] = max_score;
-      output_data[output_box_num * 5 + 1] = max_x1;
-      output_data[output_box_num * 5 + 2] = max_y1;
-      output_data[output_box_num * 5 + 3] = max_x2;
-      output_data[output_box_num * 5 + 4] = max_y2;
-    } else if (output_mode == 2) {
+      for (int c = 0; c < 4; c++) {
+        output_data[output_box_num * 5 + 1 + c] = box[c];
+      }
+    } else if (param.output_mode == 2) {
       output_data[0 * keepNum + output_box_num] = max_score;
-      output_data[1 * keepNum + output_box_num] = max_x1;
-      output_data[2 * keepNum + output_box_num] = max_y1;
-      output_data[3 * keepNum + output_box_num] = max_x2;
-      output_data[4 * keepNum + output_box_num] = max_y2;
-    } else if (output_mode == 3) {
+      for (int c = 0; c < 4; c++) {
+        output_data[(1 + c) * keepNum + output_box_num] = box[c];
+      }
+    } else if (param.output_mode == 3) {
       output_data[output_box_num * 3 + 0] = batch_idx;
       output_data[output_box_num * 3 + 1] = class_idx;
       output_data[output_box_num * 3 + 2] = max_index;
     } else {
       VLOG(4) << "unsupport output mode now.";
     }
-    output_box_num++;
-    score[max_index] = 0;
+  }
+}
 
-    if (box_mode == 0) {
-      if (max_x1 > max_x2) {
-        float tmp = max_x1;
-        max_x1 = max_x2;
-        max_x2 = tmp;
-      }
-      if (max_y1 > max_y2) {
-        float tmp = max_y1;
-        max_y1 = max_y2;
-        max_y2 = tmp;
-      }
-    } else if (box_mode == 1) {
-      max_x1 = max_x1 - max_x2 * 0.5;
-      max_x2 = max_x1 + max_x2;
-      max_y1 = max_y1 - max_y2 * 0.5;
-      max_y2 = max_y1 + max_y2;
-    }
-    if (algo == 0 || offset == 0.0) {
-      max_area = (max_x2 - max_x1) * (max_y2 - max_y1);
-    } else {
-      max_area = (max_x2 - max_x1 + offset) * (max_y2 - max_y1 + offset);
-    }
+int NmsExecutor::nms_multiclass_cpu(float *output_info,
+                                    const float *input_boxes,
+                                    const float *input_conf,
+                                    int input_batches_num,
+                                    int input_classes_num, int input_box_num,
+                                    const NmsCpuParam &param) {
+  // the classes are independent, only their outputs are packed in order
+  const int task_num = input_batches_num * input_classes_num;
+  std::vector<std::vector<std::pair<int, float>>> keeps(task_num);
+  cpuParallelFor(0, task_num, 1, [&](int64_t task) {
+    const int batch_idx = task / input_classes_num;
+    const int class_idx = task % input_classes_num;
+    const int boxes_offset = input_box_num * 4 * batch_idx;
+    const int conf_offset = input_classes_num * input_box_num * batch_idx +
+                            input_box_num * class_idx;
+    nms_detection_cpu(keeps[task], input_boxes + boxes_offset,
+                      input_conf + conf_offset, input_box_num, param);
+  });
 
-    for (int i = 0; i < input_box_num; i++) {
-      // compute the IOU
-      float x1_cur = x1[i];
-      float y1_cur = y1[i];
-      float x2_cur = x2[i];
-      float y2_cur = y2[i];
-      float area_cur = 0.0;
-      if (box_mode == 0) {
-        if (x1_cur > x2_cur) {
-          float tmp = x1_cur;
-          x1_cur = x2_cur;
-          x2_cur = tmp;
-        }
-        if (y1_cur > y2_cur) {
-          float tmp = y1_cur;
-          y1_cur = y2_cur;
-          y2_cur = tmp;
-        }
-      } else if (box_mode == 1) {
-        x1_cur = x1_cur - x2_cur * 0.5;
-        x2_cur = x1_cur + x2_cur;
-        y1_cur = y1_cur - y2_cur * 0.5;
-        y2_cur = y1_cur + y2_cur;
-      }
-      if (algo == 1) {
-        area_cur = (x2_cur - x1_cur + offset) * (y2_cur - y1_cur + offset);
-      } else {
-        area_cur = (x2_cur - x1_cur) * (y2_cur - y1_cur);
-      }
-
-      // get the area_I
-      float inter_x1 = (max_x1 > x1_cur ? max_x1 : x1_cur);
-      float inter_y1 = (max_y1 > y1_cur ? max_y1 : y1_cur);
-      float inter_x2 = (max_x2 > x2_cur ? x2_cur : max_x2);
-      float inter_y2 = (max_y2 > y2_cur ? y2_cur : max_y2);
-      float inter_w = 0.0, inter_h = 0.0;
-      if (algo == 1) {
-        inter_w = inter_x2 - inter_x1 + offset;
-        inter_h = inter_y2 - inter_y1 + offset;
-      } else {
-        inter_w = inter_x2 - inter_x1;
-        inter_h = inter_y2 - inter_y1;
-      }
-      if (inter_w < 0) {
-        inter_w = 0;
-      }
-      if (inter_h < 0) {
-        inter_h = 0;
-      }
-      float area_I = inter_w * inter_h;
-      // get the area_U
-      float area_U = max_area + area_cur - area_I;
-      float iou = area_I / area_U;
-      // update the score
-      if (method_mode == 0) {
-        if (iou > thresh_iou) {
-          score[i] = 0;
-        }
-      } else if (method_mode == 1) {
-        score[i] = iou > thresh_iou ? score[i] * (1 - iou) : score[i];
-      } else {
-        // assert method_mode == 2
-        // TODO(wch): make sure the formula
-        if (soft_nms_sigma > 0.0) {
-          score[i] *= exp(-iou * iou / (2 * soft_nms_sigma));
-        } else {
-          score[i] = (iou > thresh_iou) ? 0.0 : score[i];
-        }
-      }
-    }
+  int total_output_boxes_num = 0;
+  for (int task = 0; task < task_num; ++task) {
+    const int batch_idx = task / input_classes_num;
+    const int class_idx = task % input_classes_num;
+    const int boxes_offset = input_box_num * 4 * batch_idx;
+    const int output_offset =
+        param.output_mode == 3 ? 3 * total_output_boxes_num : 0;
+    nms_output_cpu(output_info + output_offset, keeps[task],
+                   input_boxes + boxes_offset, input_box_num, param, batch_idx,
+                   class_idx);
+    total_output_boxes_num += keeps[task].size();
   }
-  // VLOG(4) << "ouput_boxes_num:" << output_box_num;
-  cpu_runtime_.deallocate(score);
-  cpu_runtime_.deallocate(x1);
-  cpu_runtime_.deallocate(y1);
-  cpu_runtime_.deallocate(x2);
-  cpu_runtime_.deallocate(y2);
+  return total_output_boxes_num;
 }
 
 void NmsExecutor::cpuCompute() {
@@ -497,23 +766,12 @@ void NmsExecutor::cpuCompute() {
     nms3D_detection_cpu(output_info, total_output_boxes_num, input_boxes,
                         input_boxes_num, iou_thresh, input_layout);
   } else {
-    for (int batch_idx = 0; batch_idx < input_batches_num; ++batch_idx) {
-      for (int class_idx = 0; class_idx < input_classes_num; ++class_idx) {
-        int boxes_offset = input_boxes_num * 4 * batch_idx;
-        int conf_offset = input_classes_num * input_boxes_num * batch_idx +
-                          input_boxes_num * class_idx;
-        int output_offset = mode == 3 ? 3 * total_output_boxes_num : 0;
-        int output_boxes_num = 0;
-        nms_detection_cpu((float *)output_info + output_offset,
-                          output_boxes_num, (float *)input_boxes + boxes_offset,
-                          (float *)input_conf + conf_offset, input_boxes_num,
-                          max_output_boxes, iou_thresh, confidence_threshold,
-                          mode, input_layout, algo, offset, box_mode,
-                          method_mode, soft_nms_sigma, batch_idx, class_idx);
-        total_output_boxes_num += output_boxes_num;
-        // VLOG(4) << "total_output_boxes:" << total_output_boxes_num;
-      }
-    }
+    NmsCpuParam param = {max_output_boxes, iou_thresh, confidence_threshold,
+                         mode, input_layout, algo, offset, box_mode,
+                         method_mode, soft_nms_sigma};
+    total_output_boxes_num = nms_multiclass_cpu(
+        (float *)output_info, (float *)input_boxes, (float *)input_conf,
+        input_batches_num, input_classes_num, input_boxes_num, param);
   }
   // save the output boxes num, computed by CPU
   VLOG(4) << "total_output_boxes_num:" << total_output_boxes_num;
@@ -739,22 +997,12 @@ int64_t NmsExecutor::getTheoryOps() {
     nms3D_detection_cpu(output_info, total_output_boxes_num, input_boxes,
                         input_boxes_num, iou_thresh, input_layout);
   } else {
-    for (int batch_idx = 0; batch_idx < input_batches_num; ++batch_idx) {
-      for (int class_idx = 0; class_idx < input_classes_num; ++class_idx) {
-        int boxes_offset = input_boxes_num * 4 * batch_idx;
-        int conf_offset = input_classes_num * input_boxes_num * batch_idx +
-                          input_boxes_num * class_idx;
-        int output_offset = mode == 3 ? 3 * total_output_boxes_num : 0;
-        int output_boxes_num = 0;
-        nms_detection_cpu((float *)output_info + output_offset,
-                          output_boxes_num, (float *)input_boxes + boxes_offset,
-                          (float *)input_conf + conf_offset, input_boxes_num,
-                          max_output_boxes, iou_thresh, confidence_threshold,
-                          mode, input_layout, algo, offset, box_mode,
-                          method_mode, soft_nms_sigma, batch_idx, class_idx);
-        total_output_boxes_num += output_boxes_num;
-      }
-    }
+    NmsCpuParam param = {max_output_boxes, iou_thresh, confidence_threshold,
+                         mode, input_layout, algo, offset, box_mode,
+                         method_mode, soft_nms_sigma};
+    total_output_boxes_num = nms_multiclass_cpu(
+        (float *)output_info, (float *)input_boxes, (float *)input_conf,
+        input_batches_num, input_classes_num, input_boxes_num, param);
   }
   cpu_runtime_.deallocate(output_info);
   cp_count *= total_output_boxes_num;
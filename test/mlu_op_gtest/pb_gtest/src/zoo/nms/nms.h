@@ -22,10 +22,25 @@
  *************************************************************************/
 #ifndef TEST_MLU_OP_GTEST_SRC_ZOO_NMS_NMS_H_
 #define TEST_MLU_OP_GTEST_SRC_ZOO_NMS_NMS_H_
+#include <utility>
+#include <vector>
 #include "executor.h"
 #include "nms3D_utils.h"
 #include "mlu_op.h"
 namespace mluoptest {
+struct NmsCpuParam {
+  int keep_num;
+  float thresh_iou;
+  float thresh_score;
+  mluOpNmsOutputMode_t output_mode;
+  int input_layout;
+  mluOpNmsAlgo_t algo;
+  float offset;
+  mluOpNmsBoxPointMode_t box_mode;
+  mluOpNmsMethodMode_t method_mode;
+  float soft_nms_sigma;
+};
+
 class NmsExecutor : public Executor {
  public:
   NmsExecutor() {}
@@ -35,18 +50,29 @@ class NmsExecutor : public Executor {
   void workspaceFree();
   void compute();
   void cpuCompute();
-  void nms3D_detection_cpu(float *output_data, int &output_box_num,
-                           float *input_data, int input_box_num,
-                           float thresh_iou, int input_layout);
+  // The cpu references below only depend on their arguments, so that
+  // GTEST_NMS_CPU can check them outside of a case.
+  static void nms3D_detection_cpu(float *output_data, int &output_box_num,
+                                  float *input_data, int input_box_num,
+                                  float thresh_iou, int input_layout);
 
-  void nms_detection_cpu(float *output_data, int &output_box_num,
-                         float *input_data, float *input_score,
-                         int input_box_num, int keepNum, float thresh_iou,
-                         float thresh_score, mluOpNmsOutputMode_t output_mode,
-                         int input_layout, mluOpNmsAlgo_t algo, float offset,
-                         mluOpNmsBoxPointMode_t box_mode,
-                         mluOpNmsMethodMode_t method_mode, float soft_nms_sigma,
-                         int batch_idx, int class_idx);
+  // Keeps the boxes of one class, in keep order, with the score they had
+  // when they were selected.
+  static void nms_detection_cpu(std::vector<std::pair<int, float>> &keep,
+                                const float *input_data,
+                                const float *input_score, int input_box_num,
+                                const NmsCpuParam &param);
+  static void nms_output_cpu(float *output_data,
+                             const std::vector<std::pair<int, float>> &keep,
+                             const float *input_data, int input_box_num,
+                             const NmsCpuParam &param, int batch_idx,
+                             int class_idx);
+  // Runs every batch and class and writes output_info like the kernel does,
+  // returns the total number of output boxes.
+  static int nms_multiclass_cpu(float *output_info, const float *input_boxes,
+                                const float *input_conf, int input_batches_num,
+                                int input_classes_num, int input_box_num,
+                                const NmsCpuParam &param);
   int64_t getTheoryOps() override;
 
  private:
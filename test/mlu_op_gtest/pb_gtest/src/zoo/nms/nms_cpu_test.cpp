@@ -0,0 +1,375 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+// Checks the sorted, blocked and parallel NMS cpu references of nms.cpp bit
+// for bit against the argmax and index loops they replaced, on random cases.
+#include <string.h>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+#include "nms.h"
+
+namespace mluoptest {
+namespace {
+
+#define NMS_CPU_TEST_CASES 3000
+#define NMS3D_CPU_TEST_CASES 200
+
+// The argmax loop of one class: select the first box with the highest
+// score, write it out, then decay or clear the score of every box.
+void argmaxNmsCpu(float *output_data, int &output_box_num,
+                  const float *input_data, const float *input_score,
+                  int input_box_num, const NmsCpuParam &param, int batch_idx,
+                  int class_idx) {
+  const int keepNum = param.keep_num;
+  std::vector<float> score(input_score, input_score + input_box_num);
+  std::vector<float> x1(input_box_num), y1(input_box_num);
+  std::vector<float> x2(input_box_num), y2(input_box_num);
+  for (int i = 0; i < input_box_num; i++) {
+    if (param.input_layout == 0) {
+      x1[i] = input_data[0 + i * 4];
+      y1[i] = input_data[1 + i * 4];
+      x2[i] = input_data[2 + i * 4];
+      y2[i] = input_data[3 + i * 4];
+    } else {
+      x1[i] = input_data[0 * input_box_num + i];
+      y1[i] = input_data[1 * input_box_num + i];
+      x2[i] = input_data[2 * input_box_num + i];
+      y2[i] = input_data[3 * input_box_num + i];
+    }
+  }
+  for (int keep = 0; keep < keepNum; keep++) {
+    float max_score = score[0];
+    int max_index = 0;
+    for (int i = 1; i < input_box_num; i++) {
+      if (score[i] > max_score) {
+        max_score = score[i];
+        max_index = i;
+      }
+    }
+    float max_x1 = x1[max_index];
+    float max_y1 = y1[max_index];
+    float max_x2 = x2[max_index];
+    float max_y2 = y2[max_index];
+    if (max_score <= param.thresh_score) {
+      break;
+    }
+    if (param.output_mode == 0) {
+      output_data[output_box_num] = max_index;
+    } else if (param.output_mode == 1) {
+      output_data[output_box_num * 5 + 0] = max_score;
+      output_data[output_box_num * 5 + 1] = max_x1;
+      output_data[output_box_num * 5 + 2] = max_y1;
+      output_data[output_box_num * 5 + 3] = max_x2;
+      output_data[output_box_num * 5 + 4] = max_y2;
+    } else if (param.output_mode == 2) {
+      output_data[0 * keepNum + output_box_num] = max_score;
+      output_data[1 * keepNum + output_box_num] = max_x1;
+      output_data[2 * keepNum + output_box_num] = max_y1;
+      output_data[3 * keepNum + output_box_num] = max_x2;
+      output_data[4 * keepNum + output_box_num] = max_y2;
+    } else if (param.output_mode == 3) {
+      output_data[output_box_num * 3 + 0] = batch_idx;
+      output_data[output_box_num * 3 + 1] = class_idx;
+      output_data[output_box_num * 3 + 2] = max_index;
+    }
+    output_box_num++;
+    score[max_index] = 0;
+
+    if (param.box_mode == 0) {
+      if (max_x1 > max_x2) {
+        std::swap(max_x1, max_x2);
+      }
+      if (max_y1 > max_y2) {
+        std::swap(max_y1, max_y2);
+      }
+    } else if (param.box_mode == 1) {
+      max_x1 = max_x1 - max_x2 * 0.5;
+      max_x2 = max_x1 + max_x2;
+      max_y1 = max_y1 - max_y2 * 0.5;
+      max_y2 = max_y1 + max_y2;
+    }
+    float max_area = 0;
+    if (param.algo == 0 || param.offset == 0.0) {
+      max_area = (max_x2 - max_x1) * (max_y2 - max_y1);
+    } else {
+      max_area = (max_x2 - max_x1 + param.offset) *
+                 (max_y2 - max_y1 + param.offset);
+    }
+
+    for (int i = 0; i < input_box_num; i++) {
+      float x1_cur = x1[i];
+      float y1_cur = y1[i];
+      float x2_cur = x2[i];
+      float y2_cur = y2[i];
+      float area_cur = 0.0;
+      if (param.box_mode == 0) {
+        if (x1_cur > x2_cur) {
+          std::swap(x1_cur, x2_cur);
+        }
+        if (y1_cur > y2_cur) {
+          std::swap(y1_cur, y2_cur);
+        }
+      } else if (param.box_mode == 1) {
+        x1_cur = x1_cur - x2_cur * 0.5;
+        x2_cur = x1_cur + x2_cur;
+        y1_cur = y1_cur - y2_cur * 0.5;
+        y2_cur = y1_cur + y2_cur;
+      }
+      if (param.algo == 1) {
+        area_cur = (x2_cur - x1_cur + param.offset) *
+                   (y2_cur - y1_cur + param.offset);
+      } else {
+        area_cur = (x2_cur - x1_cur) * (y2_cur - y1_cur);
+      }
+      float inter_x1 = (max_x1 > x1_cur ? max_x1 : x1_cur);
+      float inter_y1 = (max_y1 > y1_cur ? max_y1 : y1_cur);
+      float inter_x2 = (max_x2 > x2_cur ? x2_cur : max_x2);
+      float inter_y2 = (max_y2 > y2_cur ? y2_cur : max_y2);
+      float inter_w = 0.0, inter_h = 0.0;
+      if (param.algo == 1) {
+        inter_w = inter_x2 - inter_x1 + param.offset;
+        inter_h = inter_y2 - inter_y1 + param.offset;
+      } else {
+        inter_w = inter_x2 - inter_x1;
+        inter_h = inter_y2 - inter_y1;
+      }
+      if (inter_w < 0) {
+        inter_w = 0;
+      }
+      if (inter_h < 0) {
+        inter_h = 0;
+      }
+      float area_I = inter_w * inter_h;
+      float area_U = max_area + area_cur - area_I;
+      float iou = area_I / area_U;
+      if (param.method_mode == 0) {
+        if (iou > param.thresh_iou) {
+          score[i] = 0;
+        }
+      } else if (param.method_mode == 1) {
+        score[i] = iou > param.thresh_iou ? score[i] * (1 - iou) : score[i];
+      } else {
+        if (param.soft_nms_sigma > 0.0) {
+          score[i] *= exp(-iou * iou / (2 * param.soft_nms_sigma));
+        } else {
+          score[i] = (iou > param.thresh_iou) ? 0.0 : score[i];
+        }
+      }
+    }
+  }
+}
+
+// The index loop of NMS3D: every box not suppressed yet is kept and
+// suppresses all boxes overlapping it by more than thresh_iou.
+void indexNms3DCpu(float *output_data, int &output_box_num,
+                   const float *input_data, int input_box_num,
+                   float thresh_iou, int input_layout) {
+  std::vector<float> box(input_box_num * 7, 0.0f);
+  for (int i = 0; i < input_box_num; i++) {
+    for (int c = 0; c < 7; c++) {
+      box[i * 7 + c] = input_layout == 0 ? input_data[c + i * 7]
+                                         : input_data[c * input_box_num + i];
+    }
+  }
+  std::vector<char> suppressed(input_box_num, 0);
+  float box_a[7] = {0}, box_b[7] = {0};
+  for (int cur_box = 0; cur_box < input_box_num; cur_box++) {
+    if (suppressed[cur_box]) {
+      continue;
+    }
+    output_data[output_box_num] = cur_box;
+    output_box_num++;
+    box_a[0] = box[cur_box * 7 + 0], box_a[1] = box[cur_box * 7 + 1];
+    box_a[3] = box[cur_box * 7 + 3], box_a[4] = box[cur_box * 7 + 4];
+    box_a[6] = box[cur_box * 7 + 6];
+    for (int i = 0; i < input_box_num; i++) {
+      box_b[0] = box[i * 7 + 0], box_b[1] = box[i * 7 + 1];
+      box_b[3] = box[i * 7 + 3], box_b[4] = box[i * 7 + 4];
+      box_b[6] = box[i * 7 + 6];
+      float iou = Nms3DUtils::UtilsFunctions::iou_bev(box_a, box_b);
+      if (iou > thresh_iou) {
+        suppressed[i] = 1;
+      }
+    }
+  }
+}
+
+template <typename T>
+T pick(std::mt19937 &gen, const std::vector<T> &values) {
+  return values[std::uniform_int_distribution<int>(
+      0, values.size() - 1)(gen)];
+}
+
+float uniform(std::mt19937 &gen, float lo, float hi) {
+  return std::uniform_real_distribution<float>(lo, hi)(gen);
+}
+
+bool chance(std::mt19937 &gen, double p) {
+  return std::bernoulli_distribution(p)(gen);
+}
+
+std::string describe(const NmsCpuParam &param, int batches, int classes,
+                     int box_num) {
+  return "batches " + std::to_string(batches) + ", classes " +
+         std::to_string(classes) + ", boxes " + std::to_string(box_num) +
+         ", keep_num " + std::to_string(param.keep_num) + ", thresh_iou " +
+         std::to_string(param.thresh_iou) + ", thresh_score " +
+         std::to_string(param.thresh_score) + ", output_mode " +
+         std::to_string(param.output_mode) + ", layout " +
+         std::to_string(param.input_layout) + ", algo " +
+         std::to_string(param.algo) + ", offset " +
+         std::to_string(param.offset) + ", box_mode " +
+         std::to_string(param.box_mode) + ", method_mode " +
+         std::to_string(param.method_mode) + ", sigma " +
+         std::to_string(param.soft_nms_sigma);
+}
+
+}  // namespace
+
+TEST(GTEST_NMS_CPU, same_as_argmax_loop) {
+  std::mt19937 gen(20240601);
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  for (int c = 0; c < NMS_CPU_TEST_CASES; ++c) {
+    NmsCpuParam param;
+    const int batches = std::uniform_int_distribution<int>(1, 2)(gen);
+    const int classes = std::uniform_int_distribution<int>(1, 3)(gen);
+    const int box_num = std::uniform_int_distribution<int>(1, 300)(gen);
+    param.keep_num = std::uniform_int_distribution<int>(0, box_num + 2)(gen);
+    param.thresh_iou = pick<float>(gen, {-0.1f, 0.0f, uniform(gen, 0, 1)});
+    param.thresh_score =
+        pick<float>(gen, {-0.5f, 0.0f, uniform(gen, 0, 0.5)});
+    param.output_mode = (mluOpNmsOutputMode_t)pick<int>(gen, {0, 1, 2, 3});
+    param.input_layout = pick<int>(gen, {0, 1});
+    param.algo = (mluOpNmsAlgo_t)pick<int>(gen, {0, 1});
+    param.offset = pick<float>(gen, {0.0f, 0.5f, 1.0f});
+    param.box_mode = (mluOpNmsBoxPointMode_t)pick<int>(gen, {0, 1});
+    param.method_mode = (mluOpNmsMethodMode_t)pick<int>(gen, {0, 1, 2});
+    param.soft_nms_sigma = pick<float>(gen, {0.0f, 0.5f});
+
+    // a few score levels make ties, a crowded image makes overlaps
+    const bool tied = chance(gen, 0.3);
+    const bool with_nan = chance(gen, 0.1);
+    const float extent = pick<float>(gen, {20.0f, 100.0f, 1000.0f});
+    std::vector<float> boxes(batches * box_num * 4);
+    std::vector<float> conf(batches * classes * box_num);
+    for (int b = 0; b < batches; ++b) {
+      for (int i = 0; i < box_num; ++i) {
+        float box[4];
+        if (param.box_mode == 0) {
+          box[0] = uniform(gen, 0, extent);
+          box[1] = uniform(gen, 0, extent);
+          box[2] = box[0] + uniform(gen, -5, 30);
+          box[3] = box[1] + uniform(gen, -5, 30);
+        } else {
+          box[0] = uniform(gen, 0, extent);
+          box[1] = uniform(gen, 0, extent);
+          box[2] = uniform(gen, 0, 30);
+          box[3] = uniform(gen, 0, 30);
+        }
+        for (int k = 0; k < 4; ++k) {
+          const int pos = param.input_layout == 0 ? i * 4 + k
+                                                  : k * box_num + i;
+          boxes[b * box_num * 4 + pos] = box[k];
+        }
+      }
+    }
+    for (auto &score : conf) {
+      score = tied ? pick<float>(gen, {0.1f, 0.3f, 0.5f, 0.9f})
+                   : uniform(gen, -0.2, 1);
+      if (with_nan && chance(gen, 0.05)) {
+        score = nan;
+      }
+    }
+
+    const size_t output_size =
+        (size_t)batches * classes * 5 * (param.keep_num + 1);
+    std::vector<float> expected(output_size, -7.0f);
+    std::vector<float> actual(output_size, -7.0f);
+    int expected_num = 0;
+    for (int b = 0; b < batches; ++b) {
+      for (int k = 0; k < classes; ++k) {
+        const int output_offset =
+            param.output_mode == 3 ? 3 * expected_num : 0;
+        int output_box_num = 0;
+        argmaxNmsCpu(expected.data() + output_offset, output_box_num,
+                     boxes.data() + box_num * 4 * b,
+                     conf.data() + (b * classes + k) * box_num, box_num,
+                     param, b, k);
+        expected_num += output_box_num;
+      }
+    }
+    const int actual_num = NmsExecutor::nms_multiclass_cpu(
+        actual.data(), boxes.data(), conf.data(), batches, classes, box_num,
+        param);
+
+    ASSERT_EQ(expected_num, actual_num)
+        << "case " << c << ": " << describe(param, batches, classes, box_num);
+    ASSERT_EQ(0, memcmp(expected.data(), actual.data(),
+                        output_size * sizeof(float)))
+        << "case " << c << ": " << describe(param, batches, classes, box_num);
+  }
+}
+
+TEST(GTEST_NMS_CPU, nms3D_same_as_index_loop) {
+  std::mt19937 gen(20240602);
+  for (int c = 0; c < NMS3D_CPU_TEST_CASES; ++c) {
+    const int box_num = std::uniform_int_distribution<int>(1, 120)(gen);
+    const float thresh_iou =
+        pick<float>(gen, {-0.1f, 0.0f, uniform(gen, 0, 1)});
+    const int input_layout = pick<int>(gen, {0, 1});
+    const float extent = pick<float>(gen, {10.0f, 50.0f, 500.0f});
+    std::vector<float> boxes(box_num * 7);
+    for (int i = 0; i < box_num; ++i) {
+      // x, y, z, dx, dy, dz, heading
+      const float box[7] = {uniform(gen, 0, extent), uniform(gen, 0, extent),
+                            uniform(gen, -2, 2),     uniform(gen, 0.5, 10),
+                            uniform(gen, 0.5, 10),   uniform(gen, 0.5, 3),
+                            uniform(gen, -M_PI, M_PI)};
+      for (int k = 0; k < 7; ++k) {
+        boxes[input_layout == 0 ? i * 7 + k : k * box_num + i] = box[k];
+      }
+    }
+
+    std::vector<float> expected(box_num, -7.0f);
+    std::vector<float> actual(box_num, -7.0f);
+    int expected_num = 0;
+    int actual_num = 0;
+    indexNms3DCpu(expected.data(), expected_num, boxes.data(), box_num,
+                  thresh_iou, input_layout);
+    NmsExecutor::nms3D_detection_cpu(actual.data(), actual_num, boxes.data(),
+                                     box_num, thresh_iou, input_layout);
+
+    ASSERT_EQ(expected_num, actual_num)
+        << "case " << c << ": boxes " << box_num << ", thresh_iou "
+        << thresh_iou << ", layout " << input_layout;
+    ASSERT_EQ(0, memcmp(expected.data(), actual.data(),
+                        box_num * sizeof(float)))
+        << "case " << c << ": boxes " << box_num << ", thresh_iou "
+        << thresh_iou << ", layout " << input_layout;
+  }
+}
+
+}  // namespace mluoptest
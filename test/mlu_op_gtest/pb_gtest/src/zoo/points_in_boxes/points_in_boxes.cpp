@@ -21,29 +21,45 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  *************************************************************************/
 #include "points_in_boxes.h"
+
+#include <vector>
+
 #include "mlu_op.h"
+#include "bev_point_grid.h"
+#include "cpu_parallel.h"
 
 namespace mluoptest {
 
 static void lindar_to_local_coords_cpu(float shift_x, float shift_y,
-                                       float rot_angle, float &local_x,
+                                       float cosa, float sina, float &local_x,
                                        float &local_y) {
-  float cosa = cos(-rot_angle), sina = sin(-rot_angle);
   local_x = shift_x * cosa + shift_y * (-sina);
   local_y = shift_x * sina + shift_y * cosa;
 }
 
-static int check_pt_in_box3d_cpu(const float *pt, const float *box3d,
-                                 float &local_x, float &local_y) {
-  const float MARGIN = 1e-5;
-  float x = pt[0], y = pt[1], z = pt[2];
-  float cx = box3d[0], cy = box3d[1], cz = box3d[2];
-  float dx = box3d[3], dy = box3d[4], dz = box3d[5], rz = box3d[6];
+// box3d with the cosine and sine of -rz computed once for all points
+struct Box3dCpu {
+  float cx, cy, cz, dx, dy, dz, rz, cosa, sina;
+};
 
-  if (fabsf(z - cz) > dz / 2.0) return 0;
-  lindar_to_local_coords_cpu(x - cx, y - cy, rz, local_x, local_y);
-  float in_flag =
-      (fabs(local_x) < dx / 2.0 + MARGIN) & (fabs(local_y) < dy / 2.0 + MARGIN);
+static Box3dCpu load_box3d_cpu(const float *box3d) {
+  Box3dCpu box;
+  box.cx = box3d[0], box.cy = box3d[1], box.cz = box3d[2];
+  box.dx = box3d[3], box.dy = box3d[4], box.dz = box3d[5], box.rz = box3d[6];
+  box.cosa = cos(-box.rz), box.sina = sin(-box.rz);
+  return box;
+}
+
+// branch free, so that the tests of a span of points are vectorized
+static inline int check_pt_in_box3d_cpu(float x, float y, float z,
+                                        const Box3dCpu &box) {
+  const float MARGIN = 1e-5;
+  float local_x, local_y;
+  int in_z = !(fabsf(z - box.cz) > box.dz / 2.0);
+  lindar_to_local_coords_cpu(x - box.cx, y - box.cy, box.cosa, box.sina,
+                             local_x, local_y);
+  int in_flag = in_z & (fabs(local_x) < box.dx / 2.0 + MARGIN) &
+                (fabs(local_y) < box.dy / 2.0 + MARGIN);
   return in_flag;
 }
 
@@ -51,23 +67,34 @@ static void points_in_boxes_cpu(
     const mluOpTensorDescriptor_t points_desc, const void *points,
     const mluOpTensorDescriptor_t boxes_desc, const void *boxes,
     const mluOpTensorDescriptor_t points_indices_desc, void *points_indices) {
+  const float MARGIN = 1e-5;
   for (int64_t i = 0; i < points_indices_desc->getDimIndex(0) *
                               points_indices_desc->getDimIndex(1);
        i++) {
     *((float *)points_indices + i) = -1.0;
   }
+  const int64_t pts_num = points_desc->getDimIndex(1);
+  const int64_t boxes_num = boxes_desc->getDimIndex(1);
   for (int64_t i = 0; i < points_desc->getDimIndex(0); i++) {
-    for (int64_t j = 0; j < points_desc->getDimIndex(1); j++) {
-      for (int64_t m = 0; m < boxes_desc->getDimIndex(1); m++) {
-        float local_x, local_y;
-        int cur_in_flag = check_pt_in_box3d_cpu(
-            (float *)points + (i * points_desc->getDimIndex(1) + j) * 3,
-            (float *)boxes + (i * boxes_desc->getDimIndex(1) + m) * 7, local_x,
-            local_y);
-        if (cur_in_flag) {
-          *((float *)points_indices + i * points_desc->getDimIndex(1) + j) =
-              (float)m;
-          break;
+    const float *pts_cur_batch = (float *)points + i * pts_num * 3;
+    const float *boxes_cur_batch = (float *)boxes + i * boxes_num * 7;
+    float *indices_cur_batch = (float *)points_indices + i * pts_num;
+    BevPointGrid grid(pts_cur_batch, pts_num);
+    std::vector<std::vector<int32_t>> pts_in_box(boxes_num);
+    cpuParallelFor(0, boxes_num, [&](int64_t m) {
+      const Box3dCpu box = load_box3d_cpu(boxes_cur_batch + m * 7);
+      grid.query(
+          box.cx, box.cy, box.dx / 2.0 + MARGIN, box.dy / 2.0 + MARGIN, box.rz,
+          [&](float x, float y, float z) {
+            return check_pt_in_box3d_cpu(x, y, z, box);
+          },
+          &pts_in_box[m]);
+    });
+    // a point belongs to the first box containing it
+    for (int64_t m = 0; m < boxes_num; m++) {
+      for (auto j : pts_in_box[m]) {
+        if (indices_cur_batch[j] < 0) {
+          indices_cur_batch[j] = (float)m;
         }
       }
     }
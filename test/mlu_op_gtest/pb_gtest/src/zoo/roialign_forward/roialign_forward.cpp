@@ -22,7 +22,9 @@
  *************************************************************************/
 #include <string>
 #include <algorithm>
+#include <vector>
 #include "roialign_forward.h"
+#include "cpu_parallel.h"
 #include "mlu_op.h"
 
 namespace mluoptest {
@@ -152,11 +154,12 @@ void RoialignForwardExecutor::cpuCompute() {
     // roialign cpu
     VLOG(4) << "BEGIN CPU pool_mode avg";
 
-    float *pooled_value =
-        (float *)cpu_runtime_.allocate(channels * sizeof(float));
-    int channel_idx = 0;
-
-    for (int roi_idx = 0; roi_idx < num_rois; roi_idx++) {
+    // rois write disjoint outputs, the sizes of rois differ a lot
+    cpuParallelFor(0, num_rois, 1, [&](int64_t roi) {
+      const int roi_idx = roi;
+      std::vector<float> pooled_buffer(channels);
+      float *pooled_value = pooled_buffer.data();
+      int channel_idx = 0;
       int batch_idx = int(input_rois[roi_idx * roi_offset]);
       if (batch_idx < 0 || batch_idx >= input_n) {
         LOG(ERROR) << "RoiAlign cpu : batch_id should be in [0," << input_n - 1
@@ -250,8 +253,7 @@ void RoialignForwardExecutor::cpuCompute() {
           memcpy(output_channel_ptr, pooled_value, channels * sizeof(float));
         }  // pw
       }    // ph
-    }      // roi
-    cpu_runtime_.deallocate(pooled_value);
+    });    // roi
   } else if (pool_mode == 0) {
     // roialign cpu
 
@@ -261,14 +263,15 @@ void RoialignForwardExecutor::cpuCompute() {
 
     float *output_argmax_x = cpu_fp32_output_[1];
     float *output_argmax_y = cpu_fp32_output_[2];
-    float *pooled_value =
-        (float *)cpu_runtime_.allocate(channels * sizeof(float));
-    float *argmax_x_value =
-        (float *)cpu_runtime_.allocate(channels * sizeof(float));
-    float *argmax_y_value =
-        (float *)cpu_runtime_.allocate(channels * sizeof(float));
-
-    for (int roi_idx = 0; roi_idx < num_rois; roi_idx++) {
+
+    cpuParallelFor(0, num_rois, 1, [&](int64_t roi) {
+      const int roi_idx = roi;
+      std::vector<float> pooled_buffer(channels);
+      std::vector<float> argmax_x_buffer(channels);
+      std::vector<float> argmax_y_buffer(channels);
+      float *pooled_value = pooled_buffer.data();
+      float *argmax_x_value = argmax_x_buffer.data();
+      float *argmax_y_value = argmax_y_buffer.data();
       int batch_idx = int(input_rois[roi_idx * roi_offset + 0]);
       if (batch_idx < 0 || batch_idx >= input_n) {
         LOG(ERROR) << "RoiAlign cpu : batch_id should be in [0," << input_n - 1
@@ -366,10 +369,7 @@ void RoialignForwardExecutor::cpuCompute() {
                  channels * sizeof(float));
         }  // pw
       }    // ph
-    }      // roi
-    cpu_runtime_.deallocate(pooled_value);
-    cpu_runtime_.deallocate(argmax_x_value);
-    cpu_runtime_.deallocate(argmax_y_value);
+    });    // roi
   }
 }
 
@@ -24,34 +24,49 @@
 
 #include <algorithm>
 #include <string>
+#include <vector>
 
 #include "mlu_op.h"
+#include "bev_point_grid.h"
+#include "cpu_parallel.h"
 
 namespace mluoptest {
 
 static void lidarToLocalCoords(const float shift_x, const float shift_y,
-                               const float rz, float &local_x, float &local_y) {
-  float cosa = cos(-rz), sina = sin(-rz);
+                               const float cosa, const float sina,
+                               float &local_x, float &local_y) {
   local_x = shift_x * cosa + shift_y * (-sina);
   local_y = shift_x * sina + shift_y * cosa;
 }
 
-static int checkPtInBox3d(const float *pt, const float *box3d, float &local_x,
-                          float &local_y) {
-  // pt: [x, y, z]
-  // box3d: [cx, cy, cz, dx, dy, dz, rz] in LiDAR coordinate
-  // cz in the bottom center
-  float x = pt[0], y = pt[1], z = pt[2];
-  float cx = box3d[0], cy = box3d[1], cz = box3d[2];
-  float dx = box3d[3], dy = box3d[4], dz = box3d[5], rz = box3d[6];
+// box3d: [cx, cy, cz, dx, dy, dz, rz] in LiDAR coordinate, with the cosine
+// and sine of -rz computed once for all points
+struct Box3d {
+  float cx, cy, cz, dx, dy, dz, rz, cosa, sina;
+};
+
+static Box3d loadBox3d(const float *box3d) {
+  Box3d box;
+  box.cx = box3d[0], box.cy = box3d[1], box.cz = box3d[2];
+  box.dx = box3d[3], box.dy = box3d[4], box.dz = box3d[5], box.rz = box3d[6];
+  box.cosa = cos(-box.rz), box.sina = sin(-box.rz);
+  return box;
+}
+
+// branch free, so that the tests of a span of points are vectorized
+static inline int checkPtInBox3d(const float x, const float y, const float z,
+                                 const Box3d &box, float &local_x,
+                                 float &local_y) {
   // shift to the center since cz in box3d is the bottom center
-  cz += dz / 2.0;
+  float cz = box.cz;
+  cz += box.dz / 2.0;
 
-  if (fabsf(z - cz) > dz / 2.0) return 0;
+  int in_z = !(fabsf(z - cz) > box.dz / 2.0);
 
-  lidarToLocalCoords(x - cx, y - cy, rz, local_x, local_y);
-  int in_flag = (local_x > -dx / 2.0) & (local_x < dx / 2.0) &
-                (local_y > -dy / 2.0) & (local_y < dy / 2.0);
+  lidarToLocalCoords(x - box.cx, y - box.cy, box.cosa, box.sina, local_x,
+                     local_y);
+  int in_flag = in_z & (local_x > -box.dx / 2.0) & (local_x < box.dx / 2.0) &
+                (local_y > -box.dy / 2.0) & (local_y < box.dy / 2.0);
   return in_flag;
 }
 
@@ -65,45 +80,54 @@ static void collectInsidePtsForBox3d(const int boxes_num, const int pts_num,
   // pts_idx_of_voxels: (boxes_num, out_x, out_y, out_z, max_pts_each_voxel)
 
   const int max_num_pts = max_pts_each_voxel - 1;  // index 0 is the counter
-  for (int box_idx = 0; box_idx < boxes_num; box_idx++) {
+  BevPointGrid grid(pts, pts_num);
+  cpuParallelFor(0, boxes_num, [&](int64_t box_idx) {
     const float *rois_cur_box = rois + box_idx * 7;
     int *pts_idx_of_voxels_cur_box = pts_idx_of_voxels + box_idx * out_x *
                                                              out_y * out_z *
                                                              max_pts_each_voxel;
-    for (int pt_idx = 0; pt_idx < pts_num; pt_idx++) {
+    const Box3d box = loadBox3d(rois_cur_box);
+    std::vector<int32_t> inside_pts;
+    grid.query(
+        box.cx, box.cy, box.dx / 2.0, box.dy / 2.0, box.rz,
+        [&](float x, float y, float z) {
+          float local_x, local_y;
+          return checkPtInBox3d(x, y, z, box, local_x, local_y);
+        },
+        &inside_pts);
+    // points in ascending order, voxels keep the first max_num_pts ones
+    for (const int pt_idx : inside_pts) {
       const float *pts_cur_pts = pts + pt_idx * 3;
       float local_x = 0, local_y = 0;
-      int cur_in_flag =
-          checkPtInBox3d(pts_cur_pts, rois_cur_box, local_x, local_y);
-      if (cur_in_flag > 0) {
-        // cz=rois[2] in the bottom center
-        float local_z = pts_cur_pts[2] - rois_cur_box[2];
-        float x_size = rois_cur_box[3], y_size = rois_cur_box[4],
-              z_size = rois_cur_box[5];
-
-        float x_res = x_size / out_x;
-        float y_res = y_size / out_y;
-        float z_res = z_size / out_z;
-
-        int x_idx = int((local_x + x_size / 2) / x_res);
-        int y_idx = int((local_y + y_size / 2) / y_res);
-        int z_idx = int(local_z / z_res);
-
-        x_idx = std::min(std::max(x_idx, 0), out_x - 1);
-        y_idx = std::min(std::max(y_idx, 0), out_y - 1);
-        z_idx = std::min(std::max(z_idx, 0), out_z - 1);
-
-        int base_offset = x_idx * out_y * out_z * max_pts_each_voxel +
-                          y_idx * out_z * max_pts_each_voxel +
-                          z_idx * max_pts_each_voxel;
-        int cnt = pts_idx_of_voxels_cur_box[base_offset];
-        if (cnt < max_num_pts) {
-          pts_idx_of_voxels_cur_box[base_offset + cnt + 1] = pt_idx;
-          pts_idx_of_voxels_cur_box[base_offset]++;
-        }
+      checkPtInBox3d(pts_cur_pts[0], pts_cur_pts[1], pts_cur_pts[2], box,
+                     local_x, local_y);
+      // cz=rois[2] in the bottom center
+      float local_z = pts_cur_pts[2] - rois_cur_box[2];
+      float x_size = rois_cur_box[3], y_size = rois_cur_box[4],
+            z_size = rois_cur_box[5];
+
+      float x_res = x_size / out_x;
+      float y_res = y_size / out_y;
+      float z_res = z_size / out_z;
+
+      int x_idx = int((local_x + x_size / 2) / x_res);
+      int y_idx = int((local_y + y_size / 2) / y_res);
+      int z_idx = int(local_z / z_res);
+
+      x_idx = std::min(std::max(x_idx, 0), out_x - 1);
+      y_idx = std::min(std::max(y_idx, 0), out_y - 1);
+      z_idx = std::min(std::max(z_idx, 0), out_z - 1);
+
+      int base_offset = x_idx * out_y * out_z * max_pts_each_voxel +
+                        y_idx * out_z * max_pts_each_voxel +
+                        z_idx * max_pts_each_voxel;
+      int cnt = pts_idx_of_voxels_cur_box[base_offset];
+      if (cnt < max_num_pts) {
+        pts_idx_of_voxels_cur_box[base_offset + cnt + 1] = pt_idx;
+        pts_idx_of_voxels_cur_box[base_offset]++;
       }
     }
-  }
+  });
 }
 
 static void roiawareMaxPool3d(const int boxes_num, const int pts_num,
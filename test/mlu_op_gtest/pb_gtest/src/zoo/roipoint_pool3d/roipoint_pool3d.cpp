@@ -27,97 +27,89 @@
 #include <string>
 #include <vector>
 
+#include "bev_point_grid.h"
+#include "cpu_parallel.h"
+
 namespace mluoptest {
 
-void lidarToLocalCoords(float shift_x, float shift_y, float rz, float &local_x,
-                        float &local_y) {
-  float cosa = std::cos(-rz), sina = std::sin(-rz);
+void lidarToLocalCoords(float shift_x, float shift_y, float cosa, float sina,
+                        float &local_x, float &local_y) {
   local_x = shift_x * cosa + shift_y * (-sina);
   local_y = shift_x * sina + shift_y * cosa;
 }
 
-int checkPointInBox3d(const float *pt, const float *box3d, float &local_x,
-                      float &local_y) {
-  // param pt: (x, y, z)
-  // param box3d: (cx, cy, cz, dx, dy, dz, rz) in LiDAR coordinate, cz in the
-  // bottom center
-  float x = pt[0], y = pt[1], z = pt[2];
-  float cx = box3d[0], cy = box3d[1], cz = box3d[2];
-  float dx = box3d[3], dy = box3d[4], dz = box3d[5], rz = box3d[6];
-  // shift to the center since cz in box3d is the bottom center
-  cz += dz / 2.0;
-
-  if ((z - cz) > (dz / 2.0) || (z - cz) < -(dz / 2.0)) {
-    return 0;
-  }
-  lidarToLocalCoords(x - cx, y - cy, rz, local_x, local_y);
-  int in_flag = (local_x > -dx / 2.0) & (local_x < dx / 2.0) &
-                (local_y > -dy / 2.0) & (local_y < dy / 2.0);
-  return in_flag;
+// param box3d: (cx, cy, cz, dx, dy, dz, rz) in LiDAR coordinate, cz in the
+// bottom center, with the cosine and sine of -rz computed once for all points
+struct RoipointBox3d {
+  float cx, cy, cz, dx, dy, dz, rz, cosa, sina;
+};
+
+static RoipointBox3d loadBox3d(const float *box3d) {
+  RoipointBox3d box;
+  box.cx = box3d[0], box.cy = box3d[1], box.cz = box3d[2];
+  box.dx = box3d[3], box.dy = box3d[4], box.dz = box3d[5], box.rz = box3d[6];
+  box.cosa = std::cos(-box.rz), box.sina = std::sin(-box.rz);
+  return box;
 }
 
-void assignPointsToBox3d(int batch_size, int pts_num, int boxes_num,
-                         const float *xyz, const float *boxes3d,
-                         int *pts_assign) {
-  // params xyz: (B, N, 3)
-  // params boxes3d: (B, M, 7)
-  // params pts_assign: (B, N, M): idx of the corresponding box3d, -1 means
-  // background points
-  for (int bs_idx = 0; bs_idx < batch_size; bs_idx++) {
-    for (int box_idx = 0; box_idx < boxes_num; box_idx++) {
-      for (int pt_idx = 0; pt_idx < pts_num; pt_idx++) {
-        int assign_idx =
-            bs_idx * pts_num * boxes_num + pt_idx * boxes_num + box_idx;
-        pts_assign[assign_idx] = 0;
-
-        int box_offset = bs_idx * boxes_num * 7 + box_idx * 7;
-        int pt_offset = bs_idx * pts_num * 3 + pt_idx * 3;
-        float local_x = 0, local_y = 0;
-        int cur_in_flag = checkPointInBox3d(
-            xyz + pt_offset, boxes3d + box_offset, local_x, local_y);
-        pts_assign[assign_idx] = cur_in_flag;
-      }
-    }
-  }
+// branch free, so that the tests of a span of points are vectorized
+static inline int checkPointInBox3d(float x, float y, float z,
+                                    const RoipointBox3d &box) {
+  // shift to the center since cz in box3d is the bottom center
+  float cz = box.cz;
+  cz += box.dz / 2.0;
+
+  int in_z = !((z - cz) > (box.dz / 2.0) || (z - cz) < -(box.dz / 2.0));
+  float local_x, local_y;
+  lidarToLocalCoords(x - box.cx, y - box.cy, box.cosa, box.sina, local_x,
+                     local_y);
+  int in_flag = in_z & (local_x > -box.dx / 2.0) & (local_x < box.dx / 2.0) &
+                (local_y > -box.dy / 2.0) & (local_y < box.dy / 2.0);
+  return in_flag;
 }
 
 void getPooledIdx(int batch_size, int pts_num, int boxes_num,
-                  int sampled_pts_num, const int *pts_assign, int *pts_idx,
-                  float *pooled_empty_flag) {
+                  int sampled_pts_num, const float *xyz, const float *boxes3d,
+                  int *pts_idx, float *pooled_empty_flag) {
   // params xyz: (B, N, 3)
-  // params pts_feature: (B, N, C)
-  // params pts_assign: (B, N, M)
+  // params boxes3d: (B, M, 7)
   // params pts_idx: (B, M, sampled_pts_num)
   // params pooled_empty_flag: (B, M)
+  std::vector<BevPointGrid> grids;
+  grids.reserve(batch_size);
   for (int bs_idx = 0; bs_idx < batch_size; bs_idx++) {
-    for (int box_idx = 0; box_idx < boxes_num; box_idx++) {
-      int cnt = 0;
-      for (int pt_idx = 0; pt_idx < pts_num; pt_idx++) {
-        if (pts_assign[bs_idx * pts_num * boxes_num + pt_idx * boxes_num +
-                       box_idx]) {
-          if (cnt < sampled_pts_num) {
-            pts_idx[bs_idx * boxes_num * sampled_pts_num +
-                    box_idx * sampled_pts_num + cnt] = pt_idx;
-            cnt++;
-          } else {
-            break;
-          }
-        }
-      }
-
-      if (cnt == 0) {
-        pooled_empty_flag[bs_idx * boxes_num + box_idx] = 1;
-      } else if (cnt < sampled_pts_num) {
-        // duplicate same points for sampling
-        for (int pt_idx = cnt; pt_idx < sampled_pts_num; pt_idx++) {
-          int duplicate_idx = pt_idx % cnt;
-          int base_offset =
-              bs_idx * boxes_num * sampled_pts_num + box_idx * sampled_pts_num;
-          pts_idx[base_offset + pt_idx] = pts_idx[base_offset + duplicate_idx];
-        }
+    grids.emplace_back(xyz + bs_idx * pts_num * 3, pts_num);
+  }
+  cpuParallelFor(0, (int64_t)batch_size * boxes_num, [&](int64_t i) {
+    const int bs_idx = i / boxes_num;
+    const int box_idx = i % boxes_num;
+    const RoipointBox3d box =
+        loadBox3d(boxes3d + bs_idx * boxes_num * 7 + box_idx * 7);
+    std::vector<int32_t> inside_pts;
+    grids[bs_idx].query(
+        box.cx, box.cy, box.dx / 2.0, box.dy / 2.0, box.rz,
+        [&](float x, float y, float z) {
+          return checkPointInBox3d(x, y, z, box);
+        },
+        &inside_pts);
+
+    // the first sampled_pts_num points in the box, in index order
+    int base_offset =
+        bs_idx * boxes_num * sampled_pts_num + box_idx * sampled_pts_num;
+    int cnt = std::min<int>(inside_pts.size(), sampled_pts_num);
+    std::copy(inside_pts.begin(), inside_pts.begin() + cnt,
+              pts_idx + base_offset);
+
+    if (cnt == 0) {
+      pooled_empty_flag[bs_idx * boxes_num + box_idx] = 1;
+    } else if (cnt < sampled_pts_num) {
+      // duplicate same points for sampling
+      for (int pt_idx = cnt; pt_idx < sampled_pts_num; pt_idx++) {
+        int duplicate_idx = pt_idx % cnt;
+        pts_idx[base_offset + pt_idx] = pts_idx[base_offset + duplicate_idx];
       }
     }
-  }
+  });
 }
 
 void roipointPool3dForward(int batch_size, int pts_num, int boxes_num,
@@ -160,13 +152,10 @@ void roipointPool3dForward(int batch_size, int pts_num, int boxes_num,
 
 void cpuRoiPointPool3d(int batch_size, int pts_num, int boxes_num,
                        int feature_len, int sampled_pts_num, float *points,
-                       float *point_features, float *boxes3d, int *pts_assign,
-                       int *pts_idx, float *pooled_features,
-                       float *pooled_empty_flag) {
-  assignPointsToBox3d(batch_size, pts_num, boxes_num, points, boxes3d,
-                      pts_assign);
-  getPooledIdx(batch_size, pts_num, boxes_num, sampled_pts_num, pts_assign,
-               pts_idx, pooled_empty_flag);
+                       float *point_features, float *boxes3d, int *pts_idx,
+                       float *pooled_features, float *pooled_empty_flag) {
+  getPooledIdx(batch_size, pts_num, boxes_num, sampled_pts_num, points,
+               boxes3d, pts_idx, pooled_empty_flag);
   roipointPool3dForward(batch_size, pts_num, boxes_num, feature_len,
                         sampled_pts_num, points, pts_idx, point_features,
                         pooled_features, pooled_empty_flag);
@@ -265,20 +254,14 @@ void RoipointPool3dExecutor::cpuCompute() {
   auto pooled_features = cpu_fp32_output_[0];
   auto pooled_empty_flag = cpu_fp32_output_[1];
 
-  // params pts_assign: (B, N, M)
-  int count = batch_size * pts_num * boxes_num;
-  int *pts_assign = (int *)cpu_runtime_.allocate(new int[count]);
-
   // params pts_idx: (B, M ,sampled_pts_num)
-  count = batch_size * boxes_num * sampled_pts_num;
+  int count = batch_size * boxes_num * sampled_pts_num;
   int *pts_idx = (int *)cpu_runtime_.allocate(new int[count]);
 
   cpuRoiPointPool3d(batch_size, pts_num, boxes_num, feature_len,
                     sampled_pts_num, points, point_features, boxes3d,
-                    pts_assign, pts_idx, pooled_features, pooled_empty_flag);
+                    pts_idx, pooled_features, pooled_empty_flag);
 
-  cpu_runtime_.deallocate(pts_assign);
-  pts_assign = nullptr;
   cpu_runtime_.deallocate(pts_idx);
   pts_idx = nullptr;
   VLOG(4) << "RoipointPool3dExecutor::cpuCompute() End.";
@@ -23,6 +23,7 @@
 #include <vector>
 
 #include "three_nn_forward.h"
+#include "cpu_parallel.h"
 
 #include "mlu_op.h"
 
@@ -86,60 +87,60 @@ void ThreeNnForwardExecutor::cpuCompute() {
   const int64_t b = unknown_shape[0];
   const int64_t n = unknown_shape[1];
   const int64_t m = known_shape[1];
-  auto unknown = cpu_fp32_input_[0];
-  auto known = cpu_fp32_input_[1];
-  auto dist2 = cpu_fp32_output_[0];
+  const float *unknown_start = cpu_fp32_input_[0];
+  const float *known_start = cpu_fp32_input_[1];
   float *dist2_start = (float *)cpu_fp32_output_[0];
-  float *idx = (float *)cpu_fp32_output_[1];
   float *idx_start = (float *)cpu_fp32_output_[1];
 
-  for (int64_t i = 0; i < b; ++i) {
-    for (int64_t j = 0; j < n; ++j) {
-      float ux = unknown[j * 3 + 0];
-      float uy = unknown[j * 3 + 1];
-      float uz = unknown[j * 3 + 2];
-      double best1 = 1e40;
-      double best2 = 1e40;
-      double best3 = 1e40;
-      int besti1 = 0;
-      int besti2 = 0;
-      int besti3 = 0;
-
-      for (int k = 0; k < m; ++k) {
-        float x = known[k * 3 + 0];
-        float y = known[k * 3 + 1];
-        float z = known[k * 3 + 2];
-        double d =
-            (ux - x) * (ux - x) + (uy - y) * (uy - y) + (uz - z) * (uz - z);
-        if (d < best1) {
-          best3 = best2;
-          besti3 = besti2;
-          best2 = best1;
-          besti2 = besti1;
-          best1 = d;
-          besti1 = k;
-        } else if (d < best2) {
-          best3 = best2;
-          besti3 = besti2;
-          best2 = d;
-          besti2 = k;
-        } else if (d < best3) {
-          best3 = d;
-          besti3 = k;
-        }
+  // every unknown point searches the known points of its batch on its own
+  cpuParallelFor(0, b * n, [&](int64_t point) {
+    const int64_t i = point / n;
+    const int64_t j = point % n;
+    const float *unknown = unknown_start + i * n * 3;
+    const float *known = known_start + i * m * 3;
+    float *dist2 = dist2_start + i * n * 3;
+    float *idx = idx_start + i * n * 3;
+
+    float ux = unknown[j * 3 + 0];
+    float uy = unknown[j * 3 + 1];
+    float uz = unknown[j * 3 + 2];
+    double best1 = 1e40;
+    double best2 = 1e40;
+    double best3 = 1e40;
+    int besti1 = 0;
+    int besti2 = 0;
+    int besti3 = 0;
+
+    for (int k = 0; k < m; ++k) {
+      float x = known[k * 3 + 0];
+      float y = known[k * 3 + 1];
+      float z = known[k * 3 + 2];
+      double d =
+          (ux - x) * (ux - x) + (uy - y) * (uy - y) + (uz - z) * (uz - z);
+      if (d < best1) {
+        best3 = best2;
+        besti3 = besti2;
+        best2 = best1;
+        besti2 = besti1;
+        best1 = d;
+        besti1 = k;
+      } else if (d < best2) {
+        best3 = best2;
+        besti3 = besti2;
+        best2 = d;
+        besti2 = k;
+      } else if (d < best3) {
+        best3 = d;
+        besti3 = k;
       }
-      dist2[j * 3 + 0] = float(best1);
-      dist2[j * 3 + 1] = float(best2);
-      dist2[j * 3 + 2] = float(best3);
-      idx[j * 3 + 0] = besti1;
-      idx[j * 3 + 1] = besti2;
-      idx[j * 3 + 2] = besti3;
     }
-    unknown += n * 3;
-    known += m * 3;
-    dist2 += n * 3;
-    idx += n * 3;
-  }
+    dist2[j * 3 + 0] = float(best1);
+    dist2[j * 3 + 1] = float(best2);
+    dist2[j * 3 + 2] = float(best3);
+    idx[j * 3 + 0] = besti1;
+    idx[j * 3 + 1] = besti2;
+    idx[j * 3 + 2] = besti3;
+  });
 }
 
 int64_t ThreeNnForwardExecutor::getTheoryOps() {
@@ -22,6 +22,11 @@
  *************************************************************************/
 #include "voxelization.h"
 
+#include <algorithm>
+#include <vector>
+
+#include "cpu_parallel.h"
+#include "voxel_hash_grid.h"
 #include "kernels/kernel.h"
 #include "mlu_op.h"
 
@@ -119,20 +124,20 @@ void dynamicVoxelize(const float *points, int32_t *coors, const float voxel_x,
                      const int32_t grid_x, const int32_t grid_y,
                      const int32_t grid_z, const size_t num_points,
                      const size_t num_features, const size_t NDim) {
-  for (size_t index = 0; index < num_points; ++index) {
+  cpuParallelFor(0, num_points, [&](int64_t index) {
     const float *points_offset = points + index * num_features;
     int32_t *coors_offset = coors + index * NDim;
     int32_t c_x = floorf((points_offset[0] - coors_x_min) / voxel_x);
     if (c_x < 0 || c_x >= grid_x) {
       coors_offset[0] = -1;
-      continue;
+      return;
     }
 
     int32_t c_y = floorf((points_offset[1] - coors_y_min) / voxel_y);
     if (c_y < 0 || c_y >= grid_y) {
       coors_offset[0] = -1;
       coors_offset[1] = -1;
-      continue;
+      return;
     }
 
     int32_t c_z = floorf((points_offset[2] - coors_z_min) / voxel_z);
@@ -145,13 +150,21 @@ void dynamicVoxelize(const float *points, int32_t *coors, const float voxel_x,
       coors_offset[1] = c_y;
       coors_offset[2] = c_x;
     }
-  }
+  });
 }
 
 void pointToVoxelidx(const int32_t *coor, int32_t *point_to_voxelidx,
                      int32_t *point_to_pointidx, const int32_t max_points,
                      const int32_t max_voxels, const size_t num_points,
-                     const size_t NDim) {
+                     const size_t NDim, const int32_t grid_x,
+                     const int32_t grid_y, const int32_t grid_z) {
+  // coor is (z, y, x). Points go in by index, a point is ranked after the
+  // previous points of its voxel and refers to the first of them.
+  VoxelHashGrid grid({std::max(grid_z, 1), std::max(grid_y, 1),
+                      std::max(grid_x, 1)},
+                     num_points);
+  std::vector<int32_t> first_point;
+  std::vector<int32_t> point_num;
   for (size_t index = 0; index < num_points; ++index) {
     const int32_t *coor_offset = coor + index * NDim;
     if (coor_offset[0] == -1) {
@@ -160,30 +173,13 @@ void pointToVoxelidx(const int32_t *coor, int32_t *point_to_voxelidx,
       continue;
     }
 
-    int32_t num = 0;
-    int32_t coor_x = coor_offset[0];
-    int32_t coor_y = coor_offset[1];
-    int32_t coor_z = coor_offset[2];
-
-    for (int i = 0; i < index; ++i) {
-      auto prev_coor = coor + i * NDim;
-      if (prev_coor[0] == -1) {
-        continue;
-      }
-
-      if ((prev_coor[0] == coor_x) && (prev_coor[1] == coor_y) &&
-          (prev_coor[2] == coor_z)) {
-        num++;
-        if (num == 1) {
-          point_to_pointidx[index] = i;
-        } else if (num >= max_points) {
-          break;
-        }
-      }
-    }
-    if (num == 0) {
-      point_to_pointidx[index] = index;
+    const int32_t voxel = grid.insert(grid.key(coor_offset));
+    if ((size_t)voxel == first_point.size()) {
+      first_point.push_back(index);
+      point_num.push_back(0);
     }
+    const int32_t num = point_num[voxel]++;
+    point_to_pointidx[index] = num == 0 ? index : first_point[voxel];
     if (num < max_points) {
       point_to_voxelidx[index] = num;
     } else {
@@ -223,8 +219,8 @@ void assignPointToVoxel(const float *points, int32_t *point_to_voxelidx,
                         int32_t *coor_to_voxelidx, float *voxels,
                         const int32_t max_points, const size_t num_features,
                         const size_t num_points, const size_t NDim) {
-  for (size_t thread_idx = 0; thread_idx < num_points * num_features;
-       ++thread_idx) {
+  // every point owns its slot in the voxels
+  cpuParallelFor(0, num_points * num_features, [&](int64_t thread_idx) {
     int32_t index = thread_idx / num_features;
     int32_t num = point_to_voxelidx[index];
     int32_t voxelidx = coor_to_voxelidx[index];
@@ -235,13 +231,13 @@ void assignPointToVoxel(const float *points, int32_t *point_to_voxelidx,
       int32_t k = thread_idx % num_features;
       voxels_offset[k] = points[thread_idx];
     }
-  }
+  });
 }
 
 void assignVoxelCoors(int32_t *temp_coors, int32_t *point_to_voxelidx,
                       int32_t *coor_to_voxelidx, float *coors,
                       const size_t num_points, const size_t NDim) {
-  for (size_t thread_idx = 0; thread_idx < num_points * NDim; ++thread_idx) {
+  cpuParallelFor(0, num_points * NDim, [&](int64_t thread_idx) {
     int32_t index = thread_idx / NDim;
     int32_t num = point_to_voxelidx[index];
     int32_t voxelidx = coor_to_voxelidx[index];
@@ -250,7 +246,7 @@ void assignVoxelCoors(int32_t *temp_coors, int32_t *point_to_voxelidx,
       int32_t k = thread_idx % NDim;
       coors_offset[k] = temp_coors[thread_idx];
     }
-  }
+  });
 }
 
 void VoxelizationExecutor::deterministic_hard_voxelize(
@@ -290,7 +286,7 @@ void VoxelizationExecutor::deterministic_hard_voxelize(
       (int32_t *)cpu_runtime_.allocate(count * sizeof(int32_t));
 
   pointToVoxelidx(temp_coors, point_to_voxelidx, point_to_pointidx, max_points,
-                  max_voxels, num_points, NDim);
+                  max_voxels, num_points, NDim, grid_x, grid_y, grid_z);
 
   count = num_points;
   int32_t *coor_to_voxelidx =
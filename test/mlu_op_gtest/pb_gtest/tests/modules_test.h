@@ -25,7 +25,9 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 #include "gtest/gtest.h"
+#include "case_prefetcher.h"
 #include "parser.h"
 
 #define TAKE_TIME(func)                                                      \
@@ -75,4 +77,19 @@ TEST(DISABLED_GTEST_PARSER, parse) {
   ASSERT_NO_THROW(parse(test_path));
 }
 
+TEST(GTEST_CASE_PREFETCHER, take_decreasing_index) {
+  // none of these cases exist, so every prefetch fails and take() can only
+  // return nullptr, but it must not touch the emptied read-ahead window
+  std::vector<std::string> case_paths;
+  for (int i = 0; i < 4; ++i) {
+    case_paths.push_back("case_prefetcher_missing_" + std::to_string(i) +
+                         ".prototxt");
+  }
+  mluoptest::CasePrefetcher prefetcher(case_paths, 2, 1024);
+  ASSERT_EQ(nullptr, prefetcher.take(3));
+  ASSERT_EQ(nullptr, prefetcher.take(1));
+  ASSERT_EQ(nullptr, prefetcher.take(0));
+  ASSERT_EQ(nullptr, prefetcher.take(2));
+}
+
 #endif  // TEST_MLU_OP_GTEST_TESTS_MODULES_TEST_H_
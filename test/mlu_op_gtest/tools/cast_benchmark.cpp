@@ -0,0 +1,211 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+
+/************************************************************************
+ *
+ *  @file cast_benchmark.cpp
+ *
+ **************************************************************************/
+// Checks the vectorized host dtype casts of pb_gtest (cpu_cast.h) against
+// their scalar versions bit by bit, then reports the bandwidth of each
+// conversion, with the array split across threads as arrayCast* does.
+#include <chrono>  // NOLINT
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+#include "cpu_cast.h"
+
+using mluoptest::AlgoHalfToFloat;
+
+void usage() {
+  std::cout << "Check and time the host dtype casts. Usage:" << std::endl;
+  std::cout << "cast_benchmark [element_num] [thread_num]" << std::endl;
+  std::cout << "element_num defaults to 64M, thread_num to all cores."
+            << std::endl;
+}
+
+uint16_t refFloatToBF16(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  if (std::isnan(value)) {
+    return 0x7FC0;
+  }
+  return (uint16_t)((bits + ((bits >> 16) & 1) + 0x7FFF) >> 16);
+}
+
+template <AlgoHalfToFloat algo>
+bool checkHalfToFloat() {
+  std::vector<uint16_t> src(UINT16_MAX + 1);
+  std::vector<float> dst(src.size());
+  for (size_t i = 0; i < src.size(); ++i) {
+    src[i] = (uint16_t)i;
+  }
+  // odd sizes and offsets cover the scalar tails
+  mluoptest::castHalfToFloatSpan(dst.data(), src.data(), 7, algo);
+  mluoptest::castHalfToFloatSpan(dst.data() + 7, src.data() + 7,
+                                 src.size() - 7, algo);
+  for (size_t i = 0; i < src.size(); ++i) {
+    float ref = mluoptest::cvtHalfToFloatImpl<algo>(src[i]);
+    if (memcmp(&ref, &dst[i], sizeof(float)) != 0) {
+      std::cout << "half to float (" << mluoptest::AlgoHalfToFloatStr.at(algo)
+                << ") differs at 0x" << std::hex << i << std::dec << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+bool checkBF16() {
+  std::vector<uint32_t> bits = {0x00000000, 0x80000000, 0x00000001,
+                                0x007fffff, 0x7f7fffff, 0x7f800000,
+                                0xff800000, 0x7f800001, 0xffc00000,
+                                0x3f808000, 0x3f818000, 0x3f80ffff};
+  std::mt19937 gen(0);
+  for (int i = 0; i < (1 << 20); ++i) {
+    bits.push_back(gen());
+  }
+  std::vector<float> src(bits.size());
+  memcpy(src.data(), bits.data(), bits.size() * sizeof(float));
+  std::vector<uint16_t> bf16(src.size());
+  std::vector<float> back(src.size());
+  mluoptest::castFloatToBF16Span(bf16.data(), src.data(), src.size());
+  mluoptest::castBF16ToFloatSpan(back.data(), bf16.data(), bf16.size());
+  for (size_t i = 0; i < src.size(); ++i) {
+    uint32_t back_bits;
+    memcpy(&back_bits, &back[i], sizeof(back_bits));
+    if (bf16[i] != refFloatToBF16(src[i]) ||
+        back_bits != (uint32_t)bf16[i] << 16) {
+      std::cout << "bf16 differs at 0x" << std::hex << bits[i] << std::dec
+                << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+// runs body on [0, num) split across thread_num threads
+double timeSplit(size_t num, size_t thread_num,
+                 const std::function<void(size_t, size_t)> &body) {
+  const size_t chunk = (num + thread_num - 1) / thread_num;
+  double best = 1e30;
+  for (int repeat = 0; repeat < 5; ++repeat) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < thread_num; ++t) {
+      size_t begin = std::min(num, t * chunk);
+      threads.emplace_back(body, begin, std::min(num, begin + chunk));
+    }
+    body(0, std::min(num, chunk));
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    std::chrono::duration<double> seconds =
+        std::chrono::steady_clock::now() - start;
+    best = std::min(best, seconds.count());
+  }
+  return best;
+}
+
+void report(const std::string &name, size_t bytes, double seconds) {
+  std::cout << std::left << std::setw(32) << name << std::right
+            << std::setw(10) << std::fixed << std::setprecision(2)
+            << bytes / seconds / 1e9 << " GB/s" << std::endl;
+}
+
+int main(int argc, char **argv) {
+  if (argc > 3) {
+    usage();
+    exit(0);
+  }
+  size_t num = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : (64 << 20);
+  size_t thread_num = argc > 2 ? std::strtoull(argv[2], nullptr, 10)
+                               : std::thread::hardware_concurrency();
+  thread_num = std::max<size_t>(1, thread_num);
+
+  bool exact = checkHalfToFloat<AlgoHalfToFloat::SOPA>() &&
+               checkHalfToFloat<AlgoHalfToFloat::MLUOPGTEST2>() &&
+               checkHalfToFloat<AlgoHalfToFloat::CPU_INTRINSIC>() &&
+               checkBF16();
+  std::cout << "bit exact with scalar casts: " << (exact ? "yes" : "NO")
+            << std::endl;
+  std::cout << "vectorized: "
+            << (mluoptest::castHalfToFloatVectorized(
+                    AlgoHalfToFloat::CPU_INTRINSIC)
+                    ? "yes"
+                    : "no")
+            << ", elements: " << num << ", threads: " << thread_num
+            << std::endl;
+
+  std::vector<float> f32(num);
+  std::vector<uint16_t> u16(num);
+  std::mt19937 gen(0);
+  std::uniform_real_distribution<float> dist(-1000.f, 1000.f);
+  for (size_t i = 0; i < num; ++i) {
+    f32[i] = dist(gen);
+  }
+  const size_t half_bytes = num * (sizeof(uint16_t) + sizeof(float));
+
+  for (auto algo : {AlgoHalfToFloat::SOPA, AlgoHalfToFloat::MLUOPGTEST2,
+                    AlgoHalfToFloat::CPU_INTRINSIC}) {
+    double vec = timeSplit(num, thread_num, [&](size_t b, size_t e) {
+      mluoptest::castHalfToFloatSpan(f32.data() + b, u16.data() + b, e - b,
+                                     algo);
+    });
+    report("half->float " + mluoptest::AlgoHalfToFloatStr.at(algo),
+           half_bytes, vec);
+  }
+  double scalar = timeSplit(num, thread_num, [&](size_t b, size_t e) {
+    for (size_t i = b; i < e; ++i) {
+      f32[i] = mluoptest::cvtHalfToFloatImpl<AlgoHalfToFloat::MLUOPGTEST2>(
+          u16[i]);
+    }
+  });
+  report("half->float scalar MLUOPGTEST2", half_bytes, scalar);
+
+  for (size_t i = 0; i < num; ++i) {
+    f32[i] = dist(gen);
+  }
+  double to_bf16 = timeSplit(num, thread_num, [&](size_t b, size_t e) {
+    mluoptest::castFloatToBF16Span(u16.data() + b, f32.data() + b, e - b);
+  });
+  report("float->bf16", half_bytes, to_bf16);
+  double to_bf16_scalar = timeSplit(num, thread_num, [&](size_t b, size_t e) {
+    for (size_t i = b; i < e; ++i) {
+      u16[i] = refFloatToBF16(f32[i]);
+    }
+  });
+  report("float->bf16 scalar", half_bytes, to_bf16_scalar);
+  double from_bf16 = timeSplit(num, thread_num, [&](size_t b, size_t e) {
+    mluoptest::castBF16ToFloatSpan(f32.data() + b, u16.data() + b, e - b);
+  });
+  report("bf16->float", half_bytes, from_bf16);
+  return exact ? 0 : 1;
+}
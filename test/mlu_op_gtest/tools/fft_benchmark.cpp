@@ -0,0 +1,232 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+/************************************************************************
+ *
+ *  @file fft_benchmark.cpp
+ *
+ **************************************************************************/
+// Times the host FFT of pb_gtest (cpu_fft.h) that generates the fft
+// baselines: checks a few small transforms against a direct DFT and the
+// round trip of every case, then reports the throughput on one and on all
+// threads for the lengths fftFactor tunes, a Bluestein prime and 2-d and
+// 3-d transforms.
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+#include "cpu_fft.h"
+
+using mluoptest::CpuFft;
+using mluoptest::CpuFftType;
+
+void usage() {
+  std::cout << "Check and time the host fft. Usage:" << std::endl;
+  std::cout << "fft_benchmark [point_num] [thread_num]" << std::endl;
+  std::cout << "point_num defaults to 4M, thread_num to all cores."
+            << std::endl;
+}
+
+double timeBest(const std::function<void()> &body) {
+  double best = 1e30;
+  for (int repeat = 0; repeat < 3; ++repeat) {
+    auto start = std::chrono::steady_clock::now();
+    body();
+    std::chrono::duration<double> seconds =
+        std::chrono::steady_clock::now() - start;
+    best = std::min(best, seconds.count());
+  }
+  return best;
+}
+
+// runs the tasks of a pass on thread_num threads, as cpuParallelChunks does
+CpuFft::TaskRunner taskRunner(size_t thread_num) {
+  return [thread_num](int64_t task_num,
+                      const std::function<void(int64_t, int64_t)> &task) {
+    if (thread_num == 1 || task_num == 1) {
+      task(0, task_num);
+      return;
+    }
+    const int64_t chunk = (task_num + thread_num - 1) / thread_num;
+    std::vector<std::thread> threads;
+    for (int64_t begin = chunk; begin < task_num; begin += chunk) {
+      threads.emplace_back(task, begin, std::min(task_num, begin + chunk));
+    }
+    task(0, std::min(task_num, chunk));
+    for (auto &thread : threads) {
+      thread.join();
+    }
+  };
+}
+
+std::string join(const std::vector<int64_t> &values) {
+  std::ostringstream stream;
+  for (size_t i = 0; i < values.size(); ++i) {
+    stream << (i ? "x" : "") << values[i];
+  }
+  return stream.str();
+}
+
+struct Bench {
+  size_t thread_num;
+  bool accurate = true;
+
+  void header() {
+    std::cout << std::left << std::setw(36) << "case" << std::right
+              << std::setw(12) << "error" << std::setw(12) << "GF/s 1t"
+              << std::setw(12) << "GF/s" << std::setw(10) << "speedup"
+              << std::endl;
+  }
+
+  // Direct DFT of a 1-d c2c case, against the forward transform.
+  void direct(int64_t n) {
+    typedef std::complex<double> Complex;
+    std::vector<float> x(2 * n), y(2 * n);
+    std::mt19937 gen(n);
+    std::uniform_real_distribution<float> dist(-1, 1);
+    for (auto &value : x) {
+      value = dist(gen);
+    }
+    CpuFft fft(mluoptest::CPU_FFT_C2C, {n}, 1,
+               mluoptest::cpuFftPackedLayout({n}),
+               mluoptest::cpuFftPackedLayout({n}));
+    fft.run(x.data(), y.data(), 0, 1.0);
+    double error = 0, norm = 0;
+    for (int64_t k = 0; k < n; ++k) {
+      Complex sum = 0;
+      for (int64_t j = 0; j < n; ++j) {
+        const double phase = -2 * M_PI * (double)(j * k % n) / n;
+        sum += Complex(x[2 * j], x[2 * j + 1]) * std::polar(1.0, phase);
+      }
+      error = std::max(error, std::abs(sum - Complex(y[2 * k], y[2 * k + 1])));
+      norm = std::max(norm, std::abs(sum));
+    }
+    report("direct dft " + std::to_string(n), error / norm);
+  }
+
+  void report(const std::string &name, double error) {
+    // float outputs, 1e-5 leaves room for the rounding of large sums
+    if (!(error < 1e-5)) {
+      std::cout << name << " is inaccurate" << std::endl;
+      accurate = false;
+    }
+  }
+
+  // batch transforms of n, timed forward and checked by a backward round trip
+  void transform(CpuFftType type, const std::vector<int64_t> &n,
+                 size_t point_num) {
+    int64_t size = 1;
+    for (auto len : n) {
+      size *= len;
+    }
+    const int64_t batch = std::max<int64_t>(1, point_num / size);
+    std::vector<int64_t> half = n;
+    half.back() = n.back() / 2 + 1;
+    const auto real = mluoptest::cpuFftPackedLayout(n);
+    const auto spectrum = type == mluoptest::CPU_FFT_C2C
+                              ? real
+                              : mluoptest::cpuFftPackedLayout(half);
+    const int64_t in_num = batch * (type == mluoptest::CPU_FFT_C2C ? 2 : 1) *
+                           real.dist;
+    const int64_t out_num = batch * 2 * spectrum.dist;
+    std::vector<float> x(in_num), y(out_num), z(in_num);
+    std::mt19937 gen(size);
+    std::uniform_real_distribution<float> dist(-1, 1);
+    for (auto &value : x) {
+      value = dist(gen);
+    }
+
+    CpuFft forward(type, n, batch, real, spectrum);
+    CpuFft backward(type == mluoptest::CPU_FFT_C2C ? type
+                                                   : mluoptest::CPU_FFT_C2R,
+                    n, batch, spectrum, real);
+    double one_seconds = timeBest([&] {
+      forward.run(x.data(), y.data(), 0, 1.0, taskRunner(1));
+    });
+    double seconds = timeBest([&] {
+      forward.run(x.data(), y.data(), 0, 1.0, taskRunner(thread_num));
+    });
+    backward.run(y.data(), z.data(), 1, 1.0 / size, taskRunner(thread_num));
+    double error = 0;
+    for (int64_t i = 0; i < in_num; ++i) {
+      error = std::max(error, (double)std::abs(z[i] - x[i]));
+    }
+
+    std::string name = std::string(type == mluoptest::CPU_FFT_C2C ? "c2c "
+                                                                  : "r2c ") +
+                       join(n) + " batch " + std::to_string(batch);
+    report(name, error);
+    // 5 n log2(n) flops of a complex transform, half of it for r2c
+    const double flops = (type == mluoptest::CPU_FFT_C2C ? 5.0 : 2.5) *
+                         batch * size * std::log2((double)size);
+    std::cout << std::left << std::setw(36) << name << std::right
+              << std::scientific << std::setprecision(2) << std::setw(12)
+              << error << std::fixed << std::setw(12)
+              << flops / one_seconds / 1e9 << std::setw(12)
+              << flops / seconds / 1e9 << std::setw(9)
+              << one_seconds / seconds << "x" << std::endl;
+  }
+};
+
+int main(int argc, char **argv) {
+  if (argc > 3) {
+    usage();
+    exit(0);
+  }
+  size_t num = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : (4 << 20);
+  size_t thread_num = argc > 2 ? std::strtoull(argv[2], nullptr, 10)
+                               : std::thread::hardware_concurrency();
+  Bench bench;
+  bench.thread_num = std::max<size_t>(1, thread_num);
+  std::cout << "points: " << num << ", threads: " << bench.thread_num
+            << std::endl;
+
+  // a power of two, a tuned mixed radix, a prime radix and Bluestein
+  for (int64_t n : {64, 300, 61, 67, 331}) {
+    bench.direct(n);
+  }
+
+  bench.header();
+  for (int64_t n : {256, 1024, 4096, 600, 6000, 7000, 4099}) {
+    bench.transform(mluoptest::CPU_FFT_C2C, {n}, num);
+  }
+  for (int64_t n : {400, 4096}) {
+    bench.transform(mluoptest::CPU_FFT_R2C, {n}, num);
+  }
+  bench.transform(mluoptest::CPU_FFT_C2C, {512, 512}, num);
+  bench.transform(mluoptest::CPU_FFT_R2C, {257, 300}, num);
+  bench.transform(mluoptest::CPU_FFT_C2C, {64, 64, 64}, num);
+
+  std::cout << "accurate against the direct dft and round trips: "
+            << (bench.accurate ? "yes" : "NO") << std::endl;
+  return bench.accurate ? 0 : 1;
+}
@@ -0,0 +1,538 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+/************************************************************************
+ *
+ *  @file pb2payload.cpp
+ *
+ **************************************************************************/
+// Moves the tensor values of a *pb/*prototxt case into a sidecar payload
+// file (see pb_gtest/include/payload_file.h). The output case keeps every
+// other field and refers to the payload through the "path" of its tensors.
+// Tensors the tool cannot lay out exactly as the Parser does (e.g. half
+// saved in value_f, or data already in a *.zst file) are left untouched.
+#include <unistd.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <google/protobuf/text_format.h>
+#include <google/protobuf/io/zero_copy_stream_impl.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "mlu_op_test.pb.h"
+#include "payload_file.h"
+
+void usage() {
+  std::cout << "Move tensor values of pb/prototxt into a payload file. Usage:"
+            << std::endl;
+  std::cout << "[1]: src_path dst_path" << std::endl;
+  std::cout << "[2]: src_file dst_path" << std::endl;
+  std::cout << "[3]: src_file dst_file" << std::endl;
+  std::cout << "dst_file.pb and dst_file.payload are written." << std::endl;
+}
+
+void listFiles(std::string dir, std::vector<std::string> &files) {
+  DIR *dp = opendir(dir.c_str());
+  if (dp == NULL) {
+    return;
+  }
+  struct dirent *dirp;
+  while ((dirp = readdir(dp)) != NULL) {
+    std::string name = std::string(dirp->d_name);
+    if (dirp->d_type == DT_DIR) {
+      if (name[name.length() - 1] != '.') {
+        listFiles(dir + "/" + name, files);
+      }
+    } else if (dirp->d_type == DT_REG || dirp->d_type == DT_UNKNOWN) {
+      files.push_back(dir + "/" + name);
+    }
+  }
+  closedir(dp);
+}
+
+bool isDir(std::string dir) {
+  struct stat s;
+  return stat(dir.c_str(), &s) == 0 && (s.st_mode & S_IFDIR);
+}
+
+bool isFile(std::string dir) {
+  struct stat s;
+  return stat(dir.c_str(), &s) == 0 && !(s.st_mode & S_IFDIR);
+}
+
+std::string getExtension(const std::string &filename) {
+  size_t dot = filename.rfind(".");
+  return dot == std::string::npos ? "" : filename.substr(dot + 1);
+}
+
+// read in pb or prototxt.
+bool readIn(const std::string &filename, mluoptest::Node *proto) {
+  std::string ext = getExtension(filename);
+  if (ext == "pb") {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd == -1) {
+      std::cout << "File not found: " << filename << std::endl;
+      return false;
+    }
+    google::protobuf::io::FileInputStream input(fd);
+    google::protobuf::io::CodedInputStream coded_stream(&input);
+#if GOOGLE_PROTOBUF_VERSION > 3005000
+    coded_stream.SetTotalBytesLimit(INT_MAX);
+#elif GOOGLE_PROTOBUF_VERSION
+    coded_stream.SetTotalBytesLimit(INT_MAX, 512LL << 20);
+#endif
+    bool status = proto->ParseFromCodedStream(&coded_stream);
+    close(fd);
+    return status;
+  } else if (ext == "prototxt" || ext == "txt") {
+    std::ifstream fin(filename, std::ios::in);
+    if (!fin.is_open()) {
+      std::cout << "File not found: " << filename << std::endl;
+      return false;
+    }
+    google::protobuf::io::IstreamInputStream input(&fin);
+    return google::protobuf::TextFormat::Parse(&input, proto);
+  }
+  std::cout << "Can't parse this file: " << filename << std::endl;
+  return false;
+}
+
+// bytes of one element, as Parser::getTensorSize()
+size_t dtypeSize(mluoptest::DataType dtype) {
+  switch (dtype) {
+    case mluoptest::DTYPE_COMPLEX_FLOAT:
+    case mluoptest::DTYPE_DOUBLE:
+    case mluoptest::DTYPE_INT64:
+    case mluoptest::DTYPE_UINT64:
+      return 8;
+    case mluoptest::DTYPE_COMPLEX_HALF:
+    case mluoptest::DTYPE_FLOAT:
+    case mluoptest::DTYPE_INT32:
+    case mluoptest::DTYPE_UINT32:
+    case mluoptest::DTYPE_INT31:
+      return 4;
+    case mluoptest::DTYPE_INT16:
+    case mluoptest::DTYPE_UINT16:
+    case mluoptest::DTYPE_HALF:
+    case mluoptest::DTYPE_BFLOAT16:
+      return 2;
+    case mluoptest::DTYPE_INT8:
+    case mluoptest::DTYPE_UINT8:
+    case mluoptest::DTYPE_BOOL:
+      return 1;
+    default:
+      return 0;
+  }
+}
+
+// element number including stride, as shapeStrideCount()
+size_t strideCount(const mluoptest::Shape &shape) {
+  size_t total = 1;
+  if (shape.dim_stride_size() == 0) {
+    for (int i = 0; i < shape.dims_size(); ++i) {
+      total *= (size_t)shape.dims(i);
+    }
+    return total;
+  }
+  for (int i = 0; i < shape.dims_size(); ++i) {
+    if (shape.dims(i) == 0) {
+      return 0;
+    }
+    total += (size_t)(shape.dims(i) - 1) * shape.dim_stride(i);
+  }
+  return total;
+}
+
+template <typename T, typename Field>
+void appendValues(const Field &values, std::vector<char> *bytes) {
+  size_t begin = bytes->size();
+  bytes->resize(begin + values.size() * sizeof(T));
+  T *dst = (T *)(bytes->data() + begin);
+  for (int i = 0; i < values.size(); ++i) {
+    dst[i] = (T)values.Get(i);
+  }
+}
+
+// floating point values saved as their bit pattern
+template <typename T, typename Field>
+void appendBits(const Field &values, std::vector<char> *bytes) {
+  size_t begin = bytes->size();
+  bytes->resize(begin + values.size() * sizeof(T));
+  for (int i = 0; i < values.size(); ++i) {
+    auto value = values.Get(i);
+    static_assert(sizeof(value) == sizeof(T), "bitcast needs equal sizes");
+    memcpy(bytes->data() + begin + i * sizeof(T), &value, sizeof(T));
+  }
+}
+
+// 1*int31 is split into 2*int16, high halves first
+template <typename Field>
+void appendInt31(const Field &values, std::vector<char> *bytes) {
+  size_t num = values.size() / 2;
+  bytes->resize(num * 2 * sizeof(int16_t));
+  int16_t *dst = (int16_t *)bytes->data();
+  for (size_t i = 0; i < num; ++i) {
+    dst[i] = (int16_t)values.Get(i + num);
+    dst[i + num] = (int16_t)values.Get(i);
+  }
+}
+
+template <typename T>
+bool appendHex(const mluoptest::Tensor &ts, std::vector<char> *bytes) {
+  bytes->resize(ts.value_h_size() * sizeof(T));
+  T *dst = (T *)bytes->data();
+  for (int i = 0; i < ts.value_h_size(); ++i) {
+    T bits = 0;
+    for (char c : ts.value_h(i)) {
+      int digit;
+      if (c >= '0' && c <= '9') {
+        digit = c - '0';
+      } else if (c >= 'a' && c <= 'f') {
+        digit = c - 'a' + 10;
+      } else if (c >= 'A' && c <= 'F') {
+        digit = c - 'A' + 10;
+      } else {
+        return false;
+      }
+      bits = (T)(bits << 4) | digit;
+    }
+    dst[i] = bits;
+  }
+  return true;
+}
+
+// Lays out the values of ts as Parser::getTensorValue() does. Returns false
+// if the tensor has to stay as it is.
+bool tensorBytes(const mluoptest::Tensor &ts, const std::string &case_dir,
+                 std::vector<char> *bytes) {
+  bytes->clear();
+  const auto dtype = ts.dtype();
+  if (ts.value_h_size() != 0) {
+    switch (dtype) {
+      case mluoptest::DTYPE_HALF:
+      case mluoptest::DTYPE_COMPLEX_HALF:
+        return appendHex<uint16_t>(ts, bytes);
+      case mluoptest::DTYPE_FLOAT:
+      case mluoptest::DTYPE_COMPLEX_FLOAT:
+        return appendHex<uint32_t>(ts, bytes);
+      case mluoptest::DTYPE_DOUBLE:
+        return appendHex<uint64_t>(ts, bytes);
+      default:
+        return false;
+    }
+  } else if (ts.value_f_size() != 0) {
+    switch (dtype) {
+      case mluoptest::DTYPE_FLOAT:
+      case mluoptest::DTYPE_COMPLEX_FLOAT:
+        appendValues<float>(ts.value_f(), bytes);
+        return true;
+      case mluoptest::DTYPE_DOUBLE:
+        appendValues<double>(ts.value_f(), bytes);
+        return true;
+      default:  // half needs the rounding of the gtest runtime
+        return false;
+    }
+  } else if (ts.value_i_size() != 0) {
+    switch (dtype) {
+      case mluoptest::DTYPE_INT8:
+      case mluoptest::DTYPE_BOOL:
+      case mluoptest::DTYPE_UINT8:
+        appendValues<int8_t>(ts.value_i(), bytes);
+        return true;
+      case mluoptest::DTYPE_INT16:
+      case mluoptest::DTYPE_UINT16:
+      case mluoptest::DTYPE_HALF:
+      case mluoptest::DTYPE_COMPLEX_HALF:
+        appendValues<int16_t>(ts.value_i(), bytes);
+        return true;
+      case mluoptest::DTYPE_INT32:
+        appendValues<int32_t>(ts.value_i(), bytes);
+        return true;
+      case mluoptest::DTYPE_INT64:
+        appendValues<int64_t>(ts.value_i(), bytes);
+        return true;
+      case mluoptest::DTYPE_INT31:
+        appendInt31(ts.value_i(), bytes);
+        return true;
+      case mluoptest::DTYPE_FLOAT:
+      case mluoptest::DTYPE_COMPLEX_FLOAT:
+        appendBits<float>(ts.value_i(), bytes);
+        return true;
+      default:
+        return false;
+    }
+  } else if (ts.value_l_size() != 0) {
+    switch (dtype) {
+      case mluoptest::DTYPE_INT64:
+        appendValues<int64_t>(ts.value_l(), bytes);
+        return true;
+      case mluoptest::DTYPE_INT8:
+      case mluoptest::DTYPE_BOOL:
+        appendValues<int8_t>(ts.value_l(), bytes);
+        return true;
+      case mluoptest::DTYPE_INT16:
+        appendValues<int16_t>(ts.value_l(), bytes);
+        return true;
+      case mluoptest::DTYPE_INT32:
+        appendValues<int32_t>(ts.value_l(), bytes);
+        return true;
+      case mluoptest::DTYPE_INT31:
+        appendInt31(ts.value_l(), bytes);
+        return true;
+      case mluoptest::DTYPE_DOUBLE:
+        appendBits<double>(ts.value_l(), bytes);
+        return true;
+      default:
+        return false;
+    }
+  } else if (ts.value_ui_size() != 0) {
+    switch (dtype) {
+      case mluoptest::DTYPE_UINT8:
+        appendValues<uint8_t>(ts.value_ui(), bytes);
+        return true;
+      case mluoptest::DTYPE_UINT16:
+      case mluoptest::DTYPE_BFLOAT16:
+        appendValues<uint16_t>(ts.value_ui(), bytes);
+        return true;
+      case mluoptest::DTYPE_UINT32:
+        appendValues<uint32_t>(ts.value_ui(), bytes);
+        return true;
+      default:
+        return false;
+    }
+  } else if (ts.value_ul_size() != 0) {
+    switch (dtype) {
+      case mluoptest::DTYPE_UINT64:
+        appendValues<uint64_t>(ts.value_ul(), bytes);
+        return true;
+      case mluoptest::DTYPE_UINT8:
+        appendValues<uint8_t>(ts.value_ul(), bytes);
+        return true;
+      case mluoptest::DTYPE_UINT16:
+        appendValues<uint16_t>(ts.value_ul(), bytes);
+        return true;
+      case mluoptest::DTYPE_UINT32:
+        appendValues<uint32_t>(ts.value_ul(), bytes);
+        return true;
+      default:
+        return false;
+    }
+  } else if (ts.has_path()) {
+    // raw data files only, *.zst and payloads are kept
+    std::string ext = getExtension(ts.path());
+    if (ext == "zst" || ext == PAYLOAD_EXTENSION) {
+      return false;
+    }
+    std::ifstream fin(case_dir + ts.path(), std::ios::binary);
+    if (!fin.is_open()) {
+      return false;
+    }
+    bytes->assign(std::istreambuf_iterator<char>(fin),
+                  std::istreambuf_iterator<char>());
+    return true;
+  }
+  return false;  // random data or no value
+}
+
+uint64_t alignUp(uint64_t value) {
+  return (value + PAYLOAD_ALIGN - 1) / PAYLOAD_ALIGN * PAYLOAD_ALIGN;
+}
+
+struct Entry {
+  std::string name;
+  std::vector<char> bytes;
+  uint64_t offset;
+};
+
+bool writePayload(const std::string &filename, std::vector<Entry> *entries) {
+  mluoptest::PayloadHeader header;
+  memcpy(header.magic, PAYLOAD_MAGIC, sizeof(header.magic));
+  header.version = PAYLOAD_VERSION;
+  header.entry_num = entries->size();
+  header.index_size = 0;
+  for (const auto &entry : *entries) {
+    header.index_size += 2 * sizeof(uint64_t) + sizeof(uint32_t) +
+                         entry.name.size();
+  }
+  uint64_t offset = alignUp(sizeof(header) + header.index_size);
+  for (auto &entry : *entries) {
+    entry.offset = offset;
+    offset = alignUp(offset + entry.bytes.size());
+  }
+
+  std::ofstream fout(filename, std::ios::out | std::ios::binary);
+  if (!fout.is_open()) {
+    std::cout << "Create file failed: " << filename << std::endl;
+    return false;
+  }
+  fout.write((const char *)&header, sizeof(header));
+  for (const auto &entry : *entries) {
+    uint64_t length = entry.bytes.size();
+    uint32_t name_length = entry.name.size();
+    fout.write((const char *)&entry.offset, sizeof(entry.offset));
+    fout.write((const char *)&length, sizeof(length));
+    fout.write((const char *)&name_length, sizeof(name_length));
+    fout.write(entry.name.data(), name_length);
+  }
+  const std::vector<char> zeros(PAYLOAD_ALIGN, 0);
+  for (const auto &entry : *entries) {
+    fout.write(zeros.data(), entry.offset - (uint64_t)fout.tellp());
+    fout.write(entry.bytes.data(), entry.bytes.size());
+  }
+  return fout.good();
+}
+
+// write to pb.
+bool writeTo(const google::protobuf::Message *proto,
+             const std::string &filename) {
+  std::ofstream fout(filename, std::ios::out | std::ios::binary);
+  if (!fout.is_open()) {
+    std::cout << "Create file failed: " << filename << std::endl;
+    return false;
+  }
+  google::protobuf::io::OstreamOutputStream output(&fout);
+  google::protobuf::io::CodedOutputStream coded_output(&output);
+  return proto->SerializeToCodedStream(&coded_output);
+}
+
+void makeDir(std::string path) {
+  if (0 != access(path.c_str(), 0)) {
+    mkdir(path.c_str(), 0777);
+  }
+}
+
+std::string dirName(const std::string &path) {
+  size_t slash = path.rfind("/");
+  return slash == std::string::npos ? "" : path.substr(0, slash + 1);
+}
+
+std::string splitFileName(std::string path) {
+  size_t slash = path.rfind("/");
+  size_t dot = path.rfind(".");
+  return path.substr(slash + 1, dot - slash - 1);
+}
+
+// dst is the output case without extension
+void dumpPayload(const std::string &src, const std::string &dst) {
+  std::cout << src << " => " << dst << ".pb" << std::endl;
+  if (isFile(dst + ".pb") || isFile(dst + "." + PAYLOAD_EXTENSION)) {
+    std::cout << dst << " already exists, create file failed." << std::endl;
+    return;
+  }
+  mluoptest::Node proto_node;
+  if (!readIn(src, &proto_node)) {
+    return;
+  }
+
+  const std::string payload_name =
+      splitFileName(dst + ".pb") + "." + PAYLOAD_EXTENSION;
+  std::vector<mluoptest::Tensor *> tensors;
+  for (int i = 0; i < proto_node.input_size(); ++i) {
+    tensors.push_back(proto_node.mutable_input(i));
+  }
+  for (int i = 0; i < proto_node.output_size(); ++i) {
+    tensors.push_back(proto_node.mutable_output(i));
+  }
+
+  std::vector<Entry> entries;
+  for (auto ts : tensors) {
+    Entry entry;
+    entry.name = ts->id();
+    bool duplicated = false;
+    for (const auto &e : entries) {
+      duplicated |= e.name == entry.name;
+    }
+    const size_t expected =
+        strideCount(ts->shape()) * dtypeSize(ts->dtype());
+    if (duplicated || !tensorBytes(*ts, dirName(src), &entry.bytes) ||
+        entry.bytes.size() != expected || expected == 0) {
+      std::cout << "  keep " << ts->id() << " in the case" << std::endl;
+      continue;
+    }
+    ts->clear_value_h();
+    ts->clear_value_f();
+    ts->clear_value_i();
+    ts->clear_value_l();
+    ts->clear_value_ui();
+    ts->clear_value_ul();
+    ts->set_path(payload_name);
+    entries.push_back(std::move(entry));
+  }
+
+  if (!writePayload(dst + "." + PAYLOAD_EXTENSION, &entries) ||
+      !writeTo(&proto_node, dst + ".pb")) {
+    std::cout << "Write " << dst << " failed." << std::endl;
+  }
+}
+
+std::string getCurrentDir() {
+  char *buffer = NULL;
+  if ((buffer = getcwd(NULL, 0)) == NULL) {
+    std::cout << "Get current dir failed." << std::endl;
+    return std::string("");
+  }
+  std::string current_dir = std::string(buffer);
+  free(buffer);
+  return current_dir + "/";
+}
+
+int main(int argc, char **argv) {
+  if (argc != 3) {
+    usage();
+    exit(0);
+  }
+
+  std::string src_path = argv[1];
+  std::string dst_path = argv[2];
+  src_path = (src_path[0] == '/') ? src_path : getCurrentDir() + src_path;
+  dst_path = (dst_path[0] == '/') ? dst_path : getCurrentDir() + dst_path;
+
+  if (isFile(src_path) && !isDir(dst_path)) {
+    std::string ext = getExtension(dst_path);
+    dumpPayload(src_path, ext == "pb" ? dst_path.substr(0, dst_path.size() - 3)
+                                      : dst_path);
+  } else if (isFile(src_path) && isDir(dst_path)) {
+    dumpPayload(src_path, dst_path + "/" + splitFileName(src_path));
+  } else if (isDir(src_path) && isDir(dst_path)) {
+    std::vector<std::string> all_files;
+    listFiles(src_path, all_files);
+    for (const auto &file : all_files) {
+      std::string ext = getExtension(file);
+      if (ext != "pb" && ext != "prototxt") {
+        continue;
+      }
+      std::string prefix = dirName(file).substr(src_path.length());
+      makeDir(dst_path + "/" + prefix);
+      dumpPayload(file, dst_path + "/" + prefix + splitFileName(file));
+    }
+  } else {
+    std::cout << "Can't read in from " << src_path << " and write to "
+              << dst_path << std::endl;
+  }
+}
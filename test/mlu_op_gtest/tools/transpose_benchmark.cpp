@@ -0,0 +1,316 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+/************************************************************************
+ *
+ *  @file transpose_benchmark.cpp
+ *
+ **************************************************************************/
+// Compares the strided copy engine of pb_gtest (strided_copy.h) with the
+// element-wise loops it replaced in mluOpTransposeCpu and tensor_stride_out:
+// checks that both give the same bytes, then reports the bandwidth of each
+// for every permutation of a 4-d tensor and a few 2-d, 3-d and strided cases.
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+#include "strided_copy.h"
+
+void usage() {
+  std::cout << "Check and time the host transpose. Usage:" << std::endl;
+  std::cout << "transpose_benchmark [element_num] [thread_num]" << std::endl;
+  std::cout << "element_num defaults to 16M, thread_num to all cores."
+            << std::endl;
+}
+
+// the former transposeCpuNd of transpose_cpu.cpp
+template <typename T>
+void oldTranspose(const std::vector<size_t> &shape,
+                  const std::vector<int> &perm, const T *input, T *output) {
+  uint64_t permute[8] = {8, 8, 8, 8, 8, 8, 8, 8};
+  uint64_t DIM[9] = {1, 1, 1, 1, 1, 1, 1, 1, 1};
+  uint64_t dim[9] = {0};
+  for (size_t i = 0; i < shape.size(); i++) {
+    permute[i] = perm[i];
+    DIM[i] = shape[i];
+  }
+  for (dim[0] = 0; dim[0] < DIM[0]; dim[0]++) {
+    for (dim[1] = 0; dim[1] < DIM[1]; dim[1]++) {
+      for (dim[2] = 0; dim[2] < DIM[2]; dim[2]++) {
+        for (dim[3] = 0; dim[3] < DIM[3]; dim[3]++) {
+          for (dim[4] = 0; dim[4] < DIM[4]; dim[4]++) {
+            for (dim[5] = 0; dim[5] < DIM[5]; dim[5]++) {
+              for (dim[6] = 0; dim[6] < DIM[6]; dim[6]++) {
+                for (dim[7] = 0; dim[7] < DIM[7]; dim[7]++) {
+                  uint64_t in_index =
+                      dim[0] * DIM[1] * DIM[2] * DIM[3] * DIM[4] * DIM[5] *
+                          DIM[6] * DIM[7] +
+                      dim[1] * DIM[2] * DIM[3] * DIM[4] * DIM[5] * DIM[6] *
+                          DIM[7] +
+                      dim[2] * DIM[3] * DIM[4] * DIM[5] * DIM[6] * DIM[7] +
+                      dim[3] * DIM[4] * DIM[5] * DIM[6] * DIM[7] +
+                      dim[4] * DIM[5] * DIM[6] * DIM[7] +
+                      dim[5] * DIM[6] * DIM[7] + dim[6] * DIM[7] + dim[7];
+                  uint64_t out_index =
+                      dim[permute[0]] * DIM[permute[1]] * DIM[permute[2]] *
+                          DIM[permute[3]] * DIM[permute[4]] * DIM[permute[5]] *
+                          DIM[permute[6]] * DIM[permute[7]] +
+                      dim[permute[1]] * DIM[permute[2]] * DIM[permute[3]] *
+                          DIM[permute[4]] * DIM[permute[5]] * DIM[permute[6]] *
+                          DIM[permute[7]] +
+                      dim[permute[2]] * DIM[permute[3]] * DIM[permute[4]] *
+                          DIM[permute[5]] * DIM[permute[6]] * DIM[permute[7]] +
+                      dim[permute[3]] * DIM[permute[4]] * DIM[permute[5]] *
+                          DIM[permute[6]] * DIM[permute[7]] +
+                      dim[permute[4]] * DIM[permute[5]] * DIM[permute[6]] *
+                          DIM[permute[7]] +
+                      dim[permute[5]] * DIM[permute[6]] * DIM[permute[7]] +
+                      dim[permute[6]] * DIM[permute[7]] + dim[permute[7]];
+                  output[out_index] = input[in_index];
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+// the former stride_map of stride.cpp
+void oldStrideMap(char *dst, const char *src, const std::vector<size_t> &shape,
+                  const std::vector<size_t> &dst_stride,
+                  const std::vector<size_t> &src_stride, size_t dst_offset,
+                  size_t src_offset, size_t d, size_t sizeof_dtype) {
+  for (size_t i = 0; i < shape[d]; ++i) {
+    if (d == shape.size() - 1) {
+      memcpy(dst + (dst_offset + i * dst_stride[d]) * sizeof_dtype,
+             src + (src_offset + i * src_stride[d]) * sizeof_dtype,
+             sizeof_dtype);
+    } else {
+      oldStrideMap(dst, src, shape, dst_stride, src_stride,
+                   dst_offset + i * dst_stride[d],
+                   src_offset + i * src_stride[d], d + 1, sizeof_dtype);
+    }
+  }
+}
+
+double timeBest(const std::function<void()> &body) {
+  double best = 1e30;
+  for (int repeat = 0; repeat < 3; ++repeat) {
+    auto start = std::chrono::steady_clock::now();
+    body();
+    std::chrono::duration<double> seconds =
+        std::chrono::steady_clock::now() - start;
+    best = std::min(best, seconds.count());
+  }
+  return best;
+}
+
+// runs the tasks of plan on thread_num threads, as stridedCopy does
+void runPlan(const mluoptest::StridedCopy &plan, void *dst, const void *src,
+             size_t thread_num) {
+  if (!plan.parallel() || thread_num == 1) {
+    plan.run(dst, src, 0, plan.taskNum());
+    return;
+  }
+  const int64_t chunk = (plan.taskNum() + thread_num - 1) / thread_num;
+  std::vector<std::thread> threads;
+  for (size_t t = 1; t < thread_num; ++t) {
+    int64_t begin = std::min<int64_t>(plan.taskNum(), t * chunk);
+    threads.emplace_back([&, begin] {
+      plan.run(dst, src, begin, std::min(plan.taskNum(), begin + chunk));
+    });
+  }
+  plan.run(dst, src, 0, std::min(plan.taskNum(), chunk));
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+std::string join(const std::vector<size_t> &values) {
+  std::ostringstream stream;
+  for (size_t i = 0; i < values.size(); ++i) {
+    stream << (i ? "," : "") << values[i];
+  }
+  return stream.str();
+}
+
+struct Bench {
+  size_t thread_num;
+  bool exact = true;
+
+  void header() {
+    std::cout << std::left << std::setw(48) << "case" << std::right
+              << std::setw(12) << "old GB/s" << std::setw(12) << "new 1t"
+              << std::setw(12) << "new GB/s" << std::setw(10) << "speedup"
+              << std::endl;
+  }
+
+  void row(const std::string &name, size_t bytes, double old_seconds,
+           double one_seconds, double new_seconds) {
+    std::cout << std::left << std::setw(48) << name << std::right
+              << std::fixed << std::setprecision(2) << std::setw(12)
+              << bytes / old_seconds / 1e9 << std::setw(12)
+              << bytes / one_seconds / 1e9 << std::setw(12)
+              << bytes / new_seconds / 1e9 << std::setw(9)
+              << old_seconds / new_seconds << "x" << std::endl;
+  }
+
+  template <typename T>
+  void transpose(const std::vector<size_t> &shape,
+                 const std::vector<int> &perm) {
+    size_t num = 1;
+    for (auto size : shape) {
+      num *= size;
+    }
+    std::vector<T> x(num), y_old(num), y_new(num);
+    std::mt19937_64 gen(num);
+    for (auto &value : x) {
+      value = (T)gen();
+    }
+    std::vector<size_t> x_stride(shape.size()), y_stride(shape.size());
+    size_t x_base = 1, y_base = 1;
+    for (size_t i = shape.size(); i-- > 0;) {
+      x_stride[i] = x_base;
+      x_base *= shape[i];
+      y_stride[perm[i]] = y_base;
+      y_base *= shape[perm[i]];
+    }
+    mluoptest::StridedCopy plan(shape, y_stride, x_stride, sizeof(T));
+
+    double old_seconds =
+        timeBest([&] { oldTranspose(shape, perm, x.data(), y_old.data()); });
+    double one_seconds =
+        timeBest([&] { runPlan(plan, y_new.data(), x.data(), 1); });
+    double new_seconds =
+        timeBest([&] { runPlan(plan, y_new.data(), x.data(), thread_num); });
+    std::string perm_str;
+    for (auto p : perm) {
+      perm_str += std::to_string(p);
+    }
+    std::string name = "transpose " + std::to_string(sizeof(T)) + "B [" +
+                       join(shape) + "] " + perm_str;
+    if (y_old != y_new) {
+      std::cout << name << " differs" << std::endl;
+      exact = false;
+    }
+    row(name, 2 * num * sizeof(T), old_seconds, one_seconds, new_seconds);
+  }
+
+  // contiguous -> strided, as tensor_stride_out
+  void strideOut(const std::vector<size_t> &shape,
+                 const std::vector<size_t> &stride, size_t sizeof_dtype) {
+    size_t num = 1, total = 1;
+    for (size_t i = 0; i < shape.size(); ++i) {
+      num *= shape[i];
+      total += (shape[i] - 1) * stride[i];
+    }
+    std::vector<char> src(num * sizeof_dtype);
+    std::vector<char> dst_old(total * sizeof_dtype);
+    std::vector<char> dst_new(total * sizeof_dtype);
+    std::mt19937 gen(0);
+    for (auto &value : src) {
+      value = (char)gen();
+    }
+    std::vector<size_t> src_stride(shape.size());
+    size_t base = 1;
+    for (size_t i = shape.size(); i-- > 0;) {
+      src_stride[i] = base;
+      base *= shape[i];
+    }
+    mluoptest::StridedCopy plan(shape, stride, src_stride, sizeof_dtype);
+
+    double old_seconds = timeBest([&] {
+      oldStrideMap(dst_old.data(), src.data(), shape, stride, src_stride, 0,
+                   0, 0, sizeof_dtype);
+    });
+    double one_seconds =
+        timeBest([&] { runPlan(plan, dst_new.data(), src.data(), 1); });
+    double new_seconds = timeBest(
+        [&] { runPlan(plan, dst_new.data(), src.data(), thread_num); });
+    std::string name = "stride_out " + std::to_string(sizeof_dtype) + "B [" +
+                       join(shape) + "] stride " + join(stride);
+    if (dst_old != dst_new) {
+      std::cout << name << " differs" << std::endl;
+      exact = false;
+    }
+    row(name, 2 * num * sizeof_dtype, old_seconds, one_seconds, new_seconds);
+  }
+};
+
+int main(int argc, char **argv) {
+  if (argc > 3) {
+    usage();
+    exit(0);
+  }
+  size_t num = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : (16 << 20);
+  size_t thread_num = argc > 2 ? std::strtoull(argv[2], nullptr, 10)
+                               : std::thread::hardware_concurrency();
+  Bench bench;
+  bench.thread_num = std::max<size_t>(1, thread_num);
+  std::cout << "elements: " << num << ", threads: " << bench.thread_num
+            << std::endl;
+  bench.header();
+
+  // uneven sizes leave tails around the SIMD tiles
+  const size_t side4 = std::max(4.0, std::pow((double)num, 0.25));
+  const std::vector<size_t> shape4 = {side4 - 1, side4 + 1, side4 - 2,
+                                      side4 + 2};
+  std::vector<int> perm = {0, 1, 2, 3};
+  do {
+    bench.transpose<float>(shape4, perm);
+  } while (std::next_permutation(perm.begin(), perm.end()));
+
+  const size_t side2 = std::max(2.0, std::sqrt((double)num));
+  const std::vector<size_t> shape2 = {side2 - 3, side2 + 3};
+  bench.transpose<int16_t>(shape2, {1, 0});
+  bench.transpose<float>(shape2, {1, 0});
+  bench.transpose<double>(shape2, {1, 0});
+
+  // NHWC <-> NCHW with few channels
+  const size_t side3 = std::max(1.0, std::sqrt((double)num / 4));
+  bench.transpose<float>({side3, side3, 4}, {2, 0, 1});
+  bench.transpose<float>({4, side3, side3}, {1, 2, 0});
+
+  const std::vector<size_t> shape_out = {side4, side4, side4, side4};
+  bench.strideOut(shape_out,
+                  {side4 * side4 * (side4 + 8), side4 * (side4 + 8),
+                   side4 + 8, 1},
+                  sizeof(float));
+  bench.strideOut(shape_out, {1, side4, side4 * side4, side4 * side4 * side4},
+                  sizeof(float));
+
+  std::cout << "bit exact with the element-wise loops: "
+            << (bench.exact ? "yes" : "NO") << std::endl;
+  return bench.exact ? 0 : 1;
+}
@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+# Copyright (C) [2024] by Cambricon, Inc.
+#
+# Permission is hereby granted, free of charge, to any person obtaining a
+# copy of this software and associated documentation files (the
+# "Software"), to deal in the Software without restriction, including
+# without limitation the rights to use, copy, modify, merge, publish,
+# distribute, sublicense, and/or sell copies of the Software, and to
+# permit persons to whom the Software is furnished to do so, subject to
+# the following conditions:
+#
+# The above copyright notice and this permission notice shall be included
+# in all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+# OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+# MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+# IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+# CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+# TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+# SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+"""
+Render a binary log written with MLUOP_LOG_BINARY_FILE as text, in the
+format of the text log. The record layout is described in core/cnlog_binary.hpp.
+
+usage: cnlog_decode.py mluop_log.bin [-o out.txt]
+"""
+
+import argparse
+import datetime
+import struct
+import sys
+
+MAGIC = b"MLUOPLG1"
+SITE, MESSAGE, DROPPED = 1, 2, 3
+PRINT_HEAD, PRINT_TAIL, CLEAR_ENDL = 1, 2, 4
+SEVERITY = ["INFO", "WARNING", "ERROR", "FATAL", "VLOG", "CNPAPI"]
+
+SITE_FMT = struct.Struct("<IB3xIQ")
+MESSAGE_FMT = struct.Struct("<IBBBxiIQQ")
+DROPPED_FMT = struct.Struct("<IB3xIQ")
+
+
+def read_records(data):
+    if data[:8] != MAGIC:
+        raise ValueError("not a mlu-ops binary log")
+    pid = struct.unpack_from("<I", data, 8)[0]
+    sites = {}
+    # (time, order, tid, kind, payload)
+    events = []
+    pos = 16
+    while pos + 5 <= len(data):
+        size, kind = struct.unpack_from("<IB", data, pos)
+        if size < 5 or pos + size > len(data):
+            print("truncated record at offset {}".format(pos),
+                  file=sys.stderr)
+            break
+        if kind == SITE:
+            _, _, line, site = SITE_FMT.unpack_from(data, pos)
+            name = data[pos + SITE_FMT.size:pos + size]
+            sites[site] = (name.decode(errors="replace"), line)
+        elif kind == MESSAGE:
+            (_, _, severity, flags, card, tid, time,
+             site) = MESSAGE_FMT.unpack_from(data, pos)
+            text = data[pos + MESSAGE_FMT.size:pos + size]
+            events.append((time, len(events), tid,
+                           (severity, flags, card, site,
+                            text.decode(errors="replace"))))
+        elif kind == DROPPED:
+            _, _, tid, count = DROPPED_FMT.unpack_from(data, pos)
+            # no time is recorded, show it after the last message of tid
+            last = max((e[0] for e in events if e[2] == tid), default=0)
+            events.append((last, len(events), tid, count))
+        pos += size
+    events.sort(key=lambda e: (e[0], e[1]))
+    return pid, sites, events
+
+
+def render(pid, sites, events, out):
+    for time, _, tid, payload in events:
+        if not isinstance(payload, tuple):
+            out.write("[MLU-OPS] {} message(s) of thread {} dropped, "
+                      "increase MLUOP_LOG_BINARY_BUFFER_KB\n".format(
+                          payload, tid))
+            continue
+        severity, flags, card, site, text = payload
+        line = ""
+        if flags & PRINT_HEAD:
+            stamp = datetime.datetime.fromtimestamp(time // 1000000000)
+            line += "[{}.{:06d}][MLU-OPS][{}][{}][Card:{}]: ".format(
+                stamp.strftime("%Y-%m-%d %H:%M:%S"),
+                time % 1000000000 // 1000,
+                SEVERITY[severity] if severity < len(SEVERITY) else severity,
+                pid, card)
+        line += text
+        if flags & PRINT_TAIL:
+            name, number = sites.get(site, ("?", 0))
+            real_id = str(pid) if pid == tid else "{" + str(tid) + "}"
+            line += "  [ {}:{}  pid:{}]".format(name, number, real_id)
+        if flags & CLEAR_ENDL:
+            line = line.replace("\n", " ") + "\n"
+        out.write(line)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.
+                                     RawDescriptionHelpFormatter)
+    parser.add_argument("log", help="binary log file")
+    parser.add_argument("-o", "--output", help="text file, default stdout")
+    args = parser.parse_args()
+    with open(args.log, "rb") as f:
+        pid, sites, events = read_records(f.read())
+    if args.output:
+        with open(args.output, "w") as out:
+            render(pid, sites, events, out)
+    else:
+        render(pid, sites, events, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()